@@ -13,27 +13,93 @@ namespace asyncio {
 
 #ifdef MARLIN_ASYNCIO_SIMULATOR
 
+/// Simulated handles all share the default simulator instance
+struct LoopContext {};
+
 struct EventLoop {
-	static int run() {
+	static int run(LoopContext = {}) {
 		simulator::Simulator::default_instance.run();
 		return 0;
 	}
 
-	static uint64_t now() {
+	static uint64_t now(LoopContext = {}) {
+		return simulator::Simulator::default_instance.current_tick() / simulator::Simulator::ticks_per_ms;
+	}
+
+	static uint64_t now_us() {
 		return simulator::Simulator::default_instance.current_tick();
 	}
 };
 
 #else
 
+/// @brief Loop that handles are created on, cheap to copy
+/// @details Default constructed contexts refer to the calling thread's current loop,
+/// which is the default loop unless the thread is running another loop.
+class LoopContext {
+private:
+	static inline thread_local uv_loop_t* current = nullptr;
+
+	uv_loop_t* uv_loop;
+public:
+	LoopContext() : uv_loop(current != nullptr ? current : uv_default_loop()) {}
+	LoopContext(uv_loop_t* loop) : uv_loop(loop) {}
+
+	uv_loop_t* get() const {
+		return uv_loop;
+	}
+
+	bool operator==(LoopContext const& other) const {
+		return uv_loop == other.uv_loop;
+	}
+
+	/// Make this the calling thread's current loop, returns the previous one
+	LoopContext make_current() const {
+		LoopContext prev;
+		current = uv_loop;
+		return prev;
+	}
+
+	/// Reset the calling thread's current loop to the default loop
+	static void reset_current() {
+		current = nullptr;
+	}
+};
+
 class EventLoop {
 public:
-	static int run() {
-		return uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+	/// Current loop of the calling thread
+	static uv_loop_t* loop() {
+		return LoopContext().get();
+	}
+
+	/// Attach handles created on the calling thread to the given loop, nullptr restores the default loop
+	static void set_loop(uv_loop_t* loop) {
+		if(loop == nullptr) {
+			LoopContext::reset_current();
+		} else {
+			LoopContext(loop).make_current();
+		}
+	}
+
+	/// Run the given loop, it is the thread's current loop while running so that
+	/// handles created from its callbacks attach to it
+	static int run(LoopContext loop = {}) {
+		auto prev = loop.make_current();
+		int res = uv_run(loop.get(), UV_RUN_DEFAULT);
+		prev.make_current();
+
+		return res;
+	}
+
+	/// Time in milliseconds, cached by the loop at the start of each iteration
+	static uint64_t now(LoopContext loop = {}) {
+		return uv_now(loop.get());
 	}
 
-	static uint64_t now() {
-		return uv_now(uv_default_loop());
+	/// Monotonic time in microseconds, read from the clock on every call
+	static uint64_t now_us() {
+		return uv_hrtime() / 1000;
 	}
 };
 
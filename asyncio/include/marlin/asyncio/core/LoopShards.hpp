@@ -0,0 +1,140 @@
+/*! \file LoopShards.hpp
+	\brief Event loops running on their own threads, one per core
+
+	Each shard owns a loop and a thread. Handles created while a shard is being set up attach
+	to its loop through EventLoop::loop(), so transports, factories and timers built there live
+	on the shard. Shards exchange work through lock-free task queues.
+*/
+
+#ifndef MARLIN_ASYNCIO_CORE_LOOPSHARDS_HPP
+#define MARLIN_ASYNCIO_CORE_LOOPSHARDS_HPP
+
+#include <uv.h>
+#include <marlin/core/SocketAddress.hpp>
+#include "marlin/asyncio/core/EventLoop.hpp"
+#include "marlin/asyncio/core/TaskQueue.hpp"
+#include "marlin/asyncio/udp/UdpReusePort.hpp"
+#include <spdlog/spdlog.h>
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <future>
+
+namespace marlin {
+namespace asyncio {
+
+/// @brief Fixed set of event loops, each run on its own thread
+/// @details Typical use is one UdpTransportFactory per shard bound to the same address
+/// with UdpReusePort{shard, size()}, so that each peer is served by a single shard.
+class LoopShards {
+private:
+	struct Shard {
+		uv_loop_t loop;
+		std::unique_ptr<TaskQueue> tasks;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Shard>> shards;
+public:
+	explicit LoopShards(size_t num_shards) {
+		for(size_t i = 0; i < num_shards; i++) {
+			auto &shard = *shards.emplace_back(new Shard());
+			uv_loop_init(&shard.loop);
+		}
+	}
+
+	LoopShards(LoopShards const&) = delete;
+	LoopShards(LoopShards&&) = delete;
+
+	~LoopShards() {
+		stop();
+
+		for(size_t idx = 0; idx < shards.size(); idx++) {
+			auto &shard = *shards[idx];
+
+			// Threads are done, the loops are safe to use from here
+			shard.tasks.reset();
+			uv_run(&shard.loop, UV_RUN_NOWAIT);
+
+			int res = uv_loop_close(&shard.loop);
+			if(res < 0) {
+				SPDLOG_WARN("Asyncio: Shard {}: Loop close error: {}", idx, res);
+			}
+		}
+	}
+
+	/// Number of shards
+	size_t size() const {
+		return shards.size();
+	}
+
+	/// Loop of the given shard
+	uv_loop_t *loop(size_t idx) {
+		return &shards[idx]->loop;
+	}
+
+	/// Shard serving the given peer, matches the socket the kernel picks in a UdpReusePort group
+	size_t shard_of(core::SocketAddress const &addr) const {
+		return UdpReusePort::shard_of(addr, shards.size());
+	}
+
+	/// Run f on the given shard's thread, safe to call from any thread once started
+	template<typename F>
+	void post(size_t idx, F &&f) {
+		shards[idx]->tasks->post(std::forward<F>(f));
+	}
+
+	/// Start a thread per shard, each calls f(idx) with its loop set as the thread's loop
+	/*!
+		f is expected to set up the shard and call EventLoop::run(), objects it creates are
+		destroyed on the shard's thread once run returns. Shards start one after the other,
+		the next one starts once the previous one is running its loop, so sockets join
+		UdpReusePort groups in shard order.
+	*/
+	template<typename F>
+	void start(F &&f) {
+		for(size_t idx = 0; idx < shards.size(); idx++) {
+			auto &shard = *shards[idx];
+			std::promise<void> running;
+			auto is_running = running.get_future();
+
+			shard.tasks.reset(new TaskQueue(&shard.loop));
+			// Runs once f starts the loop
+			shard.tasks->post([&running]() {
+				running.set_value();
+			});
+
+			shard.thread = std::thread([&shard, f, idx]() mutable {
+				EventLoop::set_loop(&shard.loop);
+				f(idx);
+
+				// Let pending close callbacks and tasks run, signals start if f never ran the loop
+				uv_run(&shard.loop, UV_RUN_NOWAIT);
+				EventLoop::set_loop(nullptr);
+			});
+
+			is_running.wait();
+		}
+	}
+
+	/// Stop every shard's loop and wait for the threads to finish, shards cannot be restarted
+	void stop() {
+		for(auto &shard : shards) {
+			if(!shard->thread.joinable()) {
+				continue;
+			}
+
+			auto *loop = &shard->loop;
+			shard->tasks->post([loop]() {
+				uv_stop(loop);
+			});
+			shard->thread.join();
+		}
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_CORE_LOOPSHARDS_HPP
@@ -0,0 +1,105 @@
+/*! \file RecvBuffer.hpp
+	\brief Pooled and batched receive buffers for libuv read callbacks
+*/
+
+#ifndef MARLIN_ASYNCIO_CORE_RECVBUFFER_HPP
+#define MARLIN_ASYNCIO_CORE_RECVBUFFER_HPP
+
+#include <uv.h>
+#include <memory>
+#include <marlin/core/Buffer.hpp>
+
+/// Receive buffer size for datagram sockets, fits a 9000 byte jumbo frame less IPv4 and UDP headers,
+/// the largest datagram path MTU discovery in the stream layer can settle on
+#define DEFAULT_UDP_RECV_SIZE 8972
+/// Receive buffer size for stream sockets
+#define DEFAULT_STREAM_RECV_SIZE 16384
+/// Max datagrams received per recvmmsg call, libuv does not go beyond 20
+#define MAX_UDP_RECV_BATCH 20
+
+namespace marlin {
+namespace asyncio {
+
+/// libuv alloc callback handing out pooled blocks of the given size.
+/// Ignores the suggested size, libuv always suggests 64KB.
+template<size_t size>
+void pooled_alloc_cb(
+	uv_handle_t*,
+	size_t,
+	uv_buf_t* buf
+) {
+	buf->base = (char*)core::BufferPool::allocate(size);
+	buf->len = size;
+}
+
+/// Return an unused receive buffer to the pool
+inline void pooled_free(uv_buf_t const* buf) {
+	core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
+}
+
+/// Wrap the bytes read into a receive buffer, the block is returned to the pool when the Buffer is destroyed
+inline core::Buffer pooled_recv_buffer(uv_buf_t const* buf, size_t nread) {
+	return core::Buffer::from_pool((uint8_t*)buf->base, buf->len).truncate_unsafe(buf->len - nread);
+}
+
+/// @brief Receive buffer for batched datagram receives
+/// @details libuv carves the buffer into one 64KB slot per datagram and receives
+/// into all slots with a single recvmmsg call. Slots are handed out as views into
+/// the buffer, so datagrams are copied out before the buffer is reused.
+/// A second buffer covers libuv asking for one before the first is given back,
+/// both are allocated once and kept for the lifetime of the socket.
+class UdpRecvBatch {
+public:
+	/// Slot size used by libuv for each datagram
+	static constexpr size_t slot_size = 65536;
+private:
+	std::unique_ptr<char[]> bufs[2];
+	bool in_use[2] = {false, false};
+	size_t num_slots;
+public:
+	/// Construct with given number of slots
+	UdpRecvBatch(size_t num_slots) :
+		num_slots(num_slots > MAX_UDP_RECV_BATCH ? MAX_UDP_RECV_BATCH : num_slots) {}
+
+	/// Hand out a free batch buffer, an empty one if both are in use so that libuv skips the read
+	void alloc(uv_buf_t* out) {
+		for(size_t i = 0; i < 2; i++) {
+			if(in_use[i]) {
+				continue;
+			}
+
+			if(!bufs[i]) {
+				bufs[i].reset(new char[num_slots * slot_size]);
+			}
+			in_use[i] = true;
+			out->base = bufs[i].get();
+			out->len = num_slots * slot_size;
+			return;
+		}
+
+		out->base = nullptr;
+		out->len = 0;
+	}
+
+	/// Take back a buffer handed out by alloc
+	void free(uv_buf_t const* in) {
+		for(size_t i = 0; i < 2; i++) {
+			if(in->base != nullptr && in->base == bufs[i].get()) {
+				in_use[i] = false;
+			}
+		}
+	}
+
+	/// Copy a received datagram into a pooled buffer
+	static core::Buffer copy(uv_buf_t const* in, size_t nread) {
+		core::Buffer packet(nread);
+		packet.write_unsafe(0, (uint8_t*)in->base, nread);
+
+		return packet;
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_CORE_RECVBUFFER_HPP
@@ -0,0 +1,38 @@
+/*! \file SendBuffer.hpp
+	\brief Gather lists for libuv send calls
+*/
+
+#ifndef MARLIN_ASYNCIO_CORE_SENDBUFFER_HPP
+#define MARLIN_ASYNCIO_CORE_SENDBUFFER_HPP
+
+#include <uv.h>
+#include <type_traits>
+#include <marlin/core/BufferChain.hpp>
+
+namespace marlin {
+namespace asyncio {
+
+/// uv_buf_t entries to be gathered into a single send
+using UvBufs = absl::InlinedVector<uv_buf_t, core::BufferChain::inline_segments>;
+
+/// Describe the bytes of a buffer or buffer chain as uv_buf_t entries, does not copy.
+/// libuv copies the entries on send, the bytes must stay alive until the send callback.
+template<typename BufferType>
+UvBufs to_uv_bufs(BufferType &bytes) {
+	UvBufs bufs;
+
+	if constexpr (std::is_same_v<BufferType, core::BufferChain>) {
+		for(auto &segment : bytes) {
+			bufs.push_back(uv_buf_init((char*)segment.data(), segment.size()));
+		}
+	} else {
+		bufs.push_back(uv_buf_init((char*)bytes.data(), bytes.size()));
+	}
+
+	return bufs;
+}
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_CORE_SENDBUFFER_HPP
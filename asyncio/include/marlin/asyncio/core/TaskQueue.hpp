@@ -0,0 +1,113 @@
+/*! \file TaskQueue.hpp
+	\brief Lock-free queue of tasks run on an event loop, posted from any thread
+*/
+
+#ifndef MARLIN_ASYNCIO_CORE_TASKQUEUE_HPP
+#define MARLIN_ASYNCIO_CORE_TASKQUEUE_HPP
+
+#include <uv.h>
+#include <atomic>
+#include <utility>
+#include <type_traits>
+
+namespace marlin {
+namespace asyncio {
+
+/// @brief Multi producer, single consumer queue of tasks run on a given loop
+/// @details Producers push onto an atomic list and wake the loop with a uv_async_t.
+/// The loop takes the whole list at once and runs the tasks in the order they were posted.
+/// Must be constructed and destroyed on the loop's thread, or while the loop is not running.
+class TaskQueue {
+private:
+	struct Task {
+		Task *next = nullptr;
+
+		virtual void run() = 0;
+		virtual ~Task() = default;
+	};
+
+	template<typename F>
+	struct FnTask : Task {
+		F f;
+
+		template<typename G>
+		FnTask(G &&g) : f(std::forward<G>(g)) {}
+
+		void run() override {
+			f();
+		}
+	};
+
+	/// Most recently posted task
+	std::atomic<Task *> head = nullptr;
+	uv_async_t *async;
+
+	static void async_cb(uv_async_t *handle) {
+		static_cast<TaskQueue *>(handle->data)->drain();
+	}
+
+	void drain() {
+		Task *task = head.exchange(nullptr, std::memory_order_acquire);
+
+		// List is newest first, reverse to run in posting order
+		Task *ordered = nullptr;
+		while(task != nullptr) {
+			auto *next = task->next;
+			task->next = ordered;
+			ordered = task;
+			task = next;
+		}
+
+		while(ordered != nullptr) {
+			auto *next = ordered->next;
+			ordered->run();
+			delete ordered;
+			ordered = next;
+		}
+	}
+public:
+	explicit TaskQueue(uv_loop_t *loop) {
+		async = new uv_async_t();
+		async->data = this;
+		uv_async_init(loop, async, async_cb);
+	}
+
+	TaskQueue(TaskQueue const&) = delete;
+	TaskQueue(TaskQueue&&) = delete;
+
+	/// Run f on the loop's thread, safe to call from any thread
+	template<typename F>
+	void post(F &&f) {
+		Task *task = new FnTask<std::decay_t<F>>(std::forward<F>(f));
+
+		task->next = head.load(std::memory_order_relaxed);
+		while(!head.compare_exchange_weak(
+			task->next,
+			task,
+			std::memory_order_release,
+			std::memory_order_relaxed
+		)) {}
+
+		// Coalesces with any pending wakeup
+		uv_async_send(async);
+	}
+
+	/// Drops tasks that have not run yet
+	~TaskQueue() {
+		uv_close((uv_handle_t *)async, [](uv_handle_t *handle) {
+			delete (uv_async_t *)handle;
+		});
+
+		Task *task = head.exchange(nullptr, std::memory_order_acquire);
+		while(task != nullptr) {
+			auto *next = task->next;
+			delete task;
+			task = next;
+		}
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_CORE_TASKQUEUE_HPP
@@ -6,7 +6,20 @@
 
 #include <uv.h>
 #include <type_traits>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
 #include <marlin/simulator/timer/Timer.hpp>
+#include "marlin/asyncio/core/EventLoop.hpp"
+#include "marlin/asyncio/core/TimerWheel.hpp"
 
 
 namespace marlin {
@@ -18,60 +31,223 @@ using Timer = simulator::Timer;
 
 #else
 
-class Timer {
+/// @brief Timer driven by a timing wheel shared by all timers of its loop
+/// @details Each loop has one wheel with microsecond ticks, armed for its next event
+/// with a timerfd on Linux and a uv timer elsewhere. Starting and stopping timers
+/// is O(1) and does not allocate.
+class Timer : private TimerWheel::Node {
 private:
 	using Self = Timer;
 
-	uv_timer_t* timer;
-	void* data = nullptr;
+	/// Wheel of a loop, lives as long as timers are attached to it
+	struct LoopWheel {
+		TimerWheel wheel;
+#ifdef __linux__
+		/// Allows sub-millisecond timeouts unlike uv timers
+		int timer_fd;
+		uv_poll_t handle;
+#else
+		uv_timer_t handle;
+#endif
+		size_t refs = 0;
+		/// Time the wheel is armed for
+		uint64_t scheduled = TimerWheel::NEVER;
+		/// Is the handle keeping the loop alive?
+		bool is_armed = false;
+		bool is_advancing = false;
 
-	static void timer_close_cb(uv_handle_t* handle) {
-		delete (uv_timer_t*)handle;
-	}
+		static inline std::mutex registry_mutex;
+		static inline std::unordered_map<uv_loop_t*, LoopWheel*> registry;
+
+		explicit LoopWheel(uv_loop_t* loop) : wheel(EventLoop::now_us()) {
+#ifdef __linux__
+			timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+			if(timer_fd < 0) {
+				SPDLOG_ERROR("Asyncio: Timerfd create error: {}", -errno);
+			}
+			uv_poll_init(loop, &handle, timer_fd);
+#else
+			uv_timer_init(loop, &handle);
+#endif
+			handle.data = this;
+		}
+
+		static LoopWheel& acquire(uv_loop_t* loop) {
+			std::lock_guard lock(registry_mutex);
+
+			auto*& loop_wheel = registry[loop];
+			if(loop_wheel == nullptr) {
+				loop_wheel = new LoopWheel(loop);
+			}
+			loop_wheel->refs++;
+
+			return *loop_wheel;
+		}
+
+		void release() {
+			std::lock_guard lock(registry_mutex);
+
+			if(--refs > 0) {
+				return;
+			}
+
+			registry.erase(handle.loop);
+			uv_close((uv_handle_t*)&handle, [](uv_handle_t* handle) {
+				auto* self = (LoopWheel*)handle->data;
+#ifdef __linux__
+				::close(self->timer_fd);
+#endif
+				delete self;
+			});
+		}
+
+		void schedule(uint64_t time) {
+			if(is_advancing || time >= scheduled) {
+				return;
+			}
+			scheduled = time;
+			is_armed = true;
+
+#ifdef __linux__
+			// Absolute time on the clock behind uv_hrtime, zero would disarm instead
+			uint64_t ns = std::max<uint64_t>(time * 1000, 1);
+			itimerspec spec = {};
+			spec.it_value.tv_sec = ns / 1000000000;
+			spec.it_value.tv_nsec = ns % 1000000000;
+			timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+			uv_poll_start(&handle, UV_READABLE, poll_cb);
+#else
+			uint64_t now = EventLoop::now_us();
+			uv_timer_start(&handle, timer_cb, time > now ? (time - now + 999) / 1000 : 0, 0);
+#endif
+		}
+
+		/// Stop keeping the loop alive once no timers are pending
+		void disarm_if_idle() {
+			if(is_advancing || !is_armed || !wheel.empty()) {
+				return;
+			}
+			scheduled = TimerWheel::NEVER;
+			is_armed = false;
+
+#ifdef __linux__
+			uv_poll_stop(&handle);
+#else
+			uv_timer_stop(&handle);
+#endif
+		}
+
+#ifdef __linux__
+		static void poll_cb(uv_poll_t* handle, int, int) {
+			auto& self = *(LoopWheel*)handle->data;
+
+			uint64_t expirations;
+			[[maybe_unused]] auto res = ::read(self.timer_fd, &expirations, sizeof(expirations));
+			self.fire();
+		}
+#else
+		static void timer_cb(uv_timer_t* handle) {
+			((LoopWheel*)handle->data)->fire();
+		}
+#endif
+
+		void fire() {
+			scheduled = TimerWheel::NEVER;
+			is_advancing = true;
+			wheel.advance(EventLoop::now_us(), [&](TimerWheel::Node& node) {
+				auto& timer = static_cast<Self&>(node);
+				if(timer.repeat > 0) {
+					wheel.insert(timer, EventLoop::now_us() + timer.repeat);
+				}
+				timer.callback(timer);
+			});
+			is_advancing = false;
+
+			// Every timer is gone, the handle is closing
+			if(refs == 0) {
+				return;
+			}
+
+			auto next = wheel.next_event();
+			if(next == TimerWheel::NEVER) {
+				disarm_if_idle();
+			} else {
+				schedule(next);
+			}
+		}
+	};
+
+	LoopWheel& loop_wheel;
+	void* data = nullptr;
+	/// Repeat interval in microseconds
+	uint64_t repeat = 0;
+	void (*callback)(Self&) = nullptr;
 
 	template<typename DelegateType, void (DelegateType::*callback)()>
-	static void timer_cb(uv_timer_t* handle) {
-		auto& timer = *(Self*)handle->data;
+	static void timer_cb(Self& timer) {
 		(((DelegateType*)(timer.delegate))->*callback)();
 	}
 
 	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
-	static void timer_cb(uv_timer_t* handle) {
-		auto& timer = *(Self*)handle->data;
+	static void timer_cb(Self& timer) {
 		(((DelegateType*)(timer.delegate))->*callback)(*(DataType*)timer.data);
 	}
+
+	void start_us(uint64_t timeout, uint64_t repeat, void (*callback)(Self&)) {
+		auto& wheel = loop_wheel.wheel;
+		uint64_t now = EventLoop::now_us();
+
+		this->repeat = repeat;
+		this->callback = callback;
+		wheel.idle_to(now);
+		wheel.insert(*this, now + timeout);
+		loop_wheel.schedule(now + timeout);
+	}
 public:
 	void* delegate;
 
 	template<typename DelegateType>
-	Timer(DelegateType* delegate) : delegate(delegate) {
-		timer = new uv_timer_t();
-		timer->data = this;
-		uv_timer_init(uv_default_loop(), timer);
-	}
+	Timer(DelegateType* delegate, LoopContext loop = {}) :
+		loop_wheel(LoopWheel::acquire(loop.get())), delegate(delegate) {}
+
+	Timer(Timer const&) = delete;
+	Timer(Timer&&) = delete;
 
 	template<typename DataType>
 	void set_data(DataType* data) {
 		this->data = (void*)data;
 	}
 
+	/// Start the timer, timeout and repeat in milliseconds
 	template<typename DelegateType, void (DelegateType::*callback)()>
 	void start(uint64_t timeout, uint64_t repeat) {
-		uv_timer_start(timer, timer_cb<DelegateType, callback>, timeout, repeat);
+		start_us(timeout * 1000, repeat * 1000, timer_cb<DelegateType, callback>);
 	}
 
 	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
 	void start(uint64_t timeout, uint64_t repeat) {
-		uv_timer_start(timer, timer_cb<DelegateType, DataType, callback>, timeout, repeat);
+		start_us(timeout * 1000, repeat * 1000, timer_cb<DelegateType, DataType, callback>);
+	}
+
+	/// Start the timer, timeout and repeat in microseconds
+	template<typename DelegateType, void (DelegateType::*callback)()>
+	void start_us(uint64_t timeout, uint64_t repeat) {
+		start_us(timeout, repeat, timer_cb<DelegateType, callback>);
+	}
+
+	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
+	void start_us(uint64_t timeout, uint64_t repeat) {
+		start_us(timeout, repeat, timer_cb<DelegateType, DataType, callback>);
 	}
 
 	void stop() {
-		uv_timer_stop(timer);
+		loop_wheel.wheel.remove(*this);
+		loop_wheel.disarm_if_idle();
 	}
 
 	~Timer() {
-		uv_timer_stop(timer);
-		uv_close((uv_handle_t*)timer, timer_close_cb);
+		stop();
+		loop_wheel.release();
 	}
 };
 
@@ -0,0 +1,272 @@
+/*! \file TimerWheel.hpp
+	\brief Hierarchical timing wheel with intrusive timer nodes
+*/
+
+#ifndef MARLIN_ASYNCIO_CORE_TIMERWHEEL_HPP
+#define MARLIN_ASYNCIO_CORE_TIMERWHEEL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <bit>
+
+namespace marlin {
+namespace asyncio {
+
+/// @brief Hierarchical timing wheel, O(1) insert and remove without allocation
+/// @details Level k holds timers expiring within 64^(k+1) ticks, bucketed by 64^k ticks.
+/// Buckets of higher levels cascade down as time reaches them, timers further out than
+/// the top level are parked in it and cascade until they are in range.
+/// Time is in ticks of any unit, callers pass the same clock to every call.
+class TimerWheel {
+public:
+	static constexpr size_t LEVEL_BITS = 6;
+	static constexpr size_t SLOTS = 1 << LEVEL_BITS;
+	static constexpr size_t LEVELS = 5;
+	static constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+	/// Intrusive timer node, embedded in the timer owning it
+	struct Node {
+		Node* prev = nullptr;
+		Node* next = nullptr;
+		uint64_t expiry = 0;
+		/// Level of the slot holding the node, LEVELS if in a list without a slot
+		uint8_t level = 0;
+		uint8_t slot = 0;
+
+		bool is_linked() const {
+			return next != nullptr;
+		}
+	};
+
+private:
+	/// Sentinel heads of circular lists
+	Node slots[LEVELS][SLOTS];
+	/// Timers that were already due when inserted
+	Node ready;
+	/// Bitmap of non-empty slots per level
+	uint64_t occupied[LEVELS] = {};
+
+	/// Next tick to process, timers expiring before it have fired
+	uint64_t current;
+
+	static void init_head(Node& head, uint8_t level, uint8_t slot) {
+		head.prev = &head;
+		head.next = &head;
+		head.level = level;
+		head.slot = slot;
+	}
+
+	static void link(Node& head, Node& node) {
+		node.prev = head.prev;
+		node.next = &head;
+		head.prev->next = &node;
+		head.prev = &node;
+	}
+
+	/// Move every node of src to the empty list dst
+	static void splice(Node& src, Node& dst) {
+		if(src.next == &src) {
+			return;
+		}
+
+		dst.next = src.next;
+		dst.prev = src.prev;
+		dst.next->prev = &dst;
+		dst.prev->next = &dst;
+
+		src.next = &src;
+		src.prev = &src;
+	}
+
+	void place(Node& node) {
+		uint64_t expiry = node.expiry;
+		if(expiry < current) {
+			node.level = LEVELS;
+			link(ready, node);
+			return;
+		}
+
+		uint64_t delta = expiry - current;
+		size_t level = 0;
+		while(level < LEVELS - 1 && delta >= (uint64_t)1 << (LEVEL_BITS * (level + 1))) {
+			level++;
+		}
+		if(level == LEVELS - 1 && delta >= (uint64_t)1 << (LEVEL_BITS * LEVELS)) {
+			// Out of range, park at the far end of the top level
+			expiry = current + ((uint64_t)1 << (LEVEL_BITS * LEVELS)) - 1;
+		}
+
+		size_t slot = (expiry >> (LEVEL_BITS * level)) & (SLOTS - 1);
+		node.level = level;
+		node.slot = slot;
+		link(slots[level][slot], node);
+		occupied[level] |= (uint64_t)1 << slot;
+	}
+
+	void cascade(size_t level, size_t slot) {
+		Node pending;
+		init_head(pending, LEVELS, 0);
+		splice(slots[level][slot], pending);
+		occupied[level] &= ~((uint64_t)1 << slot);
+
+		while(pending.next != &pending) {
+			Node& node = *pending.next;
+			unlink(node);
+			place(node);
+		}
+	}
+
+	void unlink(Node& node) {
+		node.prev->next = node.next;
+		node.next->prev = node.prev;
+		node.prev = nullptr;
+		node.next = nullptr;
+	}
+
+	template<typename F>
+	void fire_all(Node& list, F& fire) {
+		Node pending;
+		init_head(pending, LEVELS, 0);
+		splice(list, pending);
+
+		// Callbacks may insert or remove any node, including ones still pending
+		while(pending.next != &pending) {
+			Node& node = *pending.next;
+			unlink(node);
+			fire(node);
+		}
+	}
+public:
+	explicit TimerWheel(uint64_t now = 0) : current(now) {
+		for(size_t level = 0; level < LEVELS; level++) {
+			for(size_t slot = 0; slot < SLOTS; slot++) {
+				init_head(slots[level][slot], level, slot);
+			}
+		}
+		init_head(ready, LEVELS, 0);
+	}
+
+	TimerWheel(TimerWheel const&) = delete;
+	TimerWheel(TimerWheel&&) = delete;
+
+	bool empty() const {
+		if(ready.next != &ready) {
+			return false;
+		}
+		for(size_t level = 0; level < LEVELS; level++) {
+			if(occupied[level] != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Skip ahead to the given time if no timers are pending
+	void idle_to(uint64_t now) {
+		if(now > current && empty()) {
+			current = now;
+		}
+	}
+
+	/// Schedule the node to fire at expiry, rescheduling it if already scheduled
+	void insert(Node& node, uint64_t expiry) {
+		if(node.is_linked()) {
+			remove(node);
+		}
+
+		node.expiry = expiry;
+		place(node);
+	}
+
+	/// Unschedule the node, no-op if not scheduled
+	void remove(Node& node) {
+		if(!node.is_linked()) {
+			return;
+		}
+
+		auto level = node.level;
+		auto slot = node.slot;
+		unlink(node);
+
+		if(level < LEVELS && slots[level][slot].next == &slots[level][slot]) {
+			occupied[level] &= ~((uint64_t)1 << slot);
+		}
+	}
+
+	/// Fire every node expiring at or before now, nodes are unscheduled before fire(node) is called
+	template<typename F>
+	void advance(uint64_t now, F&& fire) {
+		fire_all(ready, fire);
+
+		while(current <= now) {
+			uint64_t tick = current;
+
+			for(size_t level = 1; level < LEVELS; level++) {
+				if((tick & (((uint64_t)1 << (LEVEL_BITS * level)) - 1)) != 0) {
+					break;
+				}
+				cascade(level, (tick >> (LEVEL_BITS * level)) & (SLOTS - 1));
+			}
+
+			size_t slot = tick & (SLOTS - 1);
+			current = tick + 1;
+			occupied[0] &= ~((uint64_t)1 << slot);
+			fire_all(slots[0][slot], fire);
+
+			// Jump over ticks that have nothing to fire or cascade
+			if(occupied[0] == 0) {
+				size_t level = 1;
+				while(level < LEVELS && occupied[level] == 0) {
+					level++;
+				}
+
+				uint64_t next = now + 1;
+				if(level < LEVELS) {
+					uint64_t mask = ((uint64_t)1 << (LEVEL_BITS * level)) - 1;
+					next = std::min(next, (current + mask) & ~mask);
+				}
+				current = std::max(current, next);
+			}
+		}
+	}
+
+	/// Earliest time advance needs to be called at, NEVER if no timers are pending.
+	/// Only a lower bound for timers further out than the first level.
+	uint64_t next_event() const {
+		if(ready.next != &ready) {
+			return 0;
+		}
+
+		uint64_t next = NEVER;
+		for(size_t level = 0; level < LEVELS; level++) {
+			if(occupied[level] == 0) {
+				continue;
+			}
+
+			size_t shift = LEVEL_BITS * level;
+			size_t base_slot = (current >> shift) & (SLOTS - 1);
+			uint64_t bits = std::rotr(occupied[level], base_slot);
+
+			uint64_t offset;
+			if(level == 0 || (current & (((uint64_t)1 << shift) - 1)) == 0) {
+				offset = std::countr_zero(bits);
+			} else if((bits & ~(uint64_t)1) != 0) {
+				// Slot at the current position has been cascaded, anything there is for the next rotation
+				offset = std::countr_zero(bits & ~(uint64_t)1);
+			} else {
+				offset = SLOTS;
+			}
+
+			next = std::min(next, ((current >> shift) + offset) << shift);
+		}
+
+		return next;
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_CORE_TIMERWHEEL_HPP
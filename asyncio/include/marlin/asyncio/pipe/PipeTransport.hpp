@@ -4,6 +4,8 @@
 #include <uv.h>
 #include <marlin/core/Buffer.hpp>
 #include "marlin/asyncio/core/Timer.hpp"
+#include "marlin/asyncio/core/EventLoop.hpp"
+#include "marlin/asyncio/core/RecvBuffer.hpp"
 #include <spdlog/spdlog.h>
 
 namespace marlin {
@@ -15,6 +17,7 @@ public:
 	using SelfType = PipeTransport<DelegateType>;
 private:
 	uv_pipe_t* pipe = nullptr;
+	LoopContext loop;
 
 	static void recv_cb(
 		uv_stream_t* handle,
@@ -26,7 +29,7 @@ private:
 public:
 	DelegateType* delegate;
 
-	PipeTransport();
+	PipeTransport(LoopContext loop = {});
 	PipeTransport(PipeTransport const&) = delete;
 	~PipeTransport();
 
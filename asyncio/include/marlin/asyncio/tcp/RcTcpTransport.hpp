@@ -5,6 +5,8 @@
 #include <marlin/core/Buffer.hpp>
 #include <marlin/core/SocketAddress.hpp>
 #include "marlin/asyncio/core/Timer.hpp"
+#include "marlin/asyncio/core/EventLoop.hpp"
+#include "marlin/asyncio/core/RecvBuffer.hpp"
 #include <spdlog/spdlog.h>
 
 namespace marlin {
@@ -16,6 +18,7 @@ public:
 	using SelfType = RcTcpTransport<DelegateType>;
 private:
 	uv_tcp_t* tcp = nullptr;
+	LoopContext loop;
 
 	static void recv_cb(
 		uv_stream_t* handle,
@@ -27,7 +30,7 @@ private:
 public:
 	DelegateType* delegate;
 
-	RcTcpTransport();
+	RcTcpTransport(LoopContext loop = {});
 	RcTcpTransport(RcTcpTransport const&) = delete;
 	~RcTcpTransport();
 
@@ -12,7 +12,7 @@ namespace asyncio {
 //---------------- Helper macros end ----------------//
 
 template<RCTCPTRANSPORT_TEMPLATE>
-RCTCPTRANSPORT::RcTcpTransport() {
+RCTCPTRANSPORT::RcTcpTransport(LoopContext loop) : loop(loop) {
 	tcp = new uv_tcp_t();
 	tcp->data = this;
 }
@@ -35,7 +35,7 @@ void RCTCPTRANSPORT::recv_cb(
 	// EOF
 	if(nread == -4095) {
 		transport->delegate->did_disconnect(*transport, 0);
-		delete[] buf->base;
+		pooled_free(buf);
 		return;
 	}
 
@@ -47,18 +47,18 @@ void RCTCPTRANSPORT::recv_cb(
 		);
 
 		transport->close();
-		delete[] buf->base;
+		pooled_free(buf);
 		return;
 	}
 
 	if(nread == 0) {
-		delete[] buf->base;
+		pooled_free(buf);
 		return;
 	}
 
 	transport->delegate->did_recv(
 		*transport,
-		core::Buffer((uint8_t*)buf->base, nread)
+		pooled_recv_buffer(buf, nread)
 	);
 }
 
@@ -75,14 +75,7 @@ void RCTCPTRANSPORT::connect_cb(uv_connect_t* req, int status) {
 
 	auto res = uv_read_start(
 		(uv_stream_t*)transport->tcp,
-		[](
-			uv_handle_t*,
-			size_t suggested_size,
-			uv_buf_t* buf
-		) {
-			buf->base = new char[suggested_size];
-			buf->len = suggested_size;
-		},
+		pooled_alloc_cb<DEFAULT_STREAM_RECV_SIZE>,
 		recv_cb
 	);
 
@@ -99,7 +92,7 @@ void RCTCPTRANSPORT::connect_cb(uv_connect_t* req, int status) {
 
 template<RCTCPTRANSPORT_TEMPLATE>
 void RCTCPTRANSPORT::connect(core::SocketAddress dst) {
-	uv_tcp_init(uv_default_loop(), tcp);
+	uv_tcp_init(loop.get(), tcp);
 
 	auto req = new uv_connect_t();
 	req->data = this;
@@ -9,6 +9,10 @@
 #include <marlin/core/SocketAddress.hpp>
 #include <marlin/core/CidrBlock.hpp>
 #include <marlin/core/TransportManager.hpp>
+#include <marlin/core/SharedBuffer.hpp>
+#include <marlin/core/BufferChain.hpp>
+#include "marlin/asyncio/core/RecvBuffer.hpp"
+#include "marlin/asyncio/core/SendBuffer.hpp"
 #include <uv.h>
 #include <spdlog/spdlog.h>
 
@@ -22,18 +26,13 @@ private:
 	uv_tcp_t *socket;
 	core::TransportManager<TcpTransport<DelegateType>> &transport_manager;
 
-	static void naive_alloc_cb(
-		uv_handle_t *,
-		size_t suggested_size,
-		uv_buf_t *buf
-	);
-
 	static void recv_cb(
 		uv_stream_t *handle,
 		ssize_t nread,
 		uv_buf_t const *buf
 	);
 
+	template<typename BufferType>
 	static void send_cb(
 		uv_write_t *req,
 		int status
@@ -41,10 +40,14 @@ private:
 
 	static void close_cb(uv_handle_t *handle);
 
+	template<typename BufferType>
 	struct SendPayload {
-		core::Buffer bytes;
+		BufferType bytes;
 		TcpTransport<DelegateType> &transport;
 	};
+
+	template<typename BufferType>
+	int send_impl(BufferType &&bytes);
 public:
 	core::SocketAddress src_addr;
 	core::SocketAddress dst_addr;
@@ -65,6 +68,8 @@ public:
 	void setup(DelegateType *delegate);
 	void did_recv(core::Buffer &&bytes);
 	int send(core::Buffer &&bytes);
+	int send(core::SharedBuffer &&bytes);
+	int send(core::BufferChain &&bytes);
 	uint16_t close_reason = 0;
 	void close(uint16_t reason = 0);
 
@@ -92,16 +97,6 @@ TcpTransport<DelegateType>::TcpTransport(
 	}
 }
 
-template<typename DelegateType>
-void TcpTransport<DelegateType>::naive_alloc_cb(
-	uv_handle_t *,
-	size_t suggested_size,
-	uv_buf_t *buf
-) {
-	buf->base = new char[suggested_size];
-	buf->len = suggested_size;
-}
-
 //! callback function on receipt of any message on this TCP connection instance
 template<typename DelegateType>
 void TcpTransport<DelegateType>::recv_cb(
@@ -114,7 +109,7 @@ void TcpTransport<DelegateType>::recv_cb(
 	// EOF
 	if(nread == -4095) {
 		transport->close();
-		delete[] buf->base;
+		pooled_free(buf);
 		return;
 	}
 
@@ -131,17 +126,17 @@ void TcpTransport<DelegateType>::recv_cb(
 			nread
 		);
 
-		delete[] buf->base;
+		pooled_free(buf);
 		return;
 	}
 
 	if(nread == 0) {
-		delete[] buf->base;
+		pooled_free(buf);
 		return;
 	}
 
 	transport->did_recv(
-		core::Buffer((uint8_t*)buf->base, nread)
+		pooled_recv_buffer(buf, nread)
 	);
 }
 
@@ -154,7 +149,7 @@ void TcpTransport<DelegateType>::setup(DelegateType *delegate) {
 	this->delegate = delegate;
 
 	socket->data = this;
-	auto res = uv_read_start((uv_stream_t *)socket, naive_alloc_cb, recv_cb);
+	auto res = uv_read_start((uv_stream_t *)socket, pooled_alloc_cb<DEFAULT_STREAM_RECV_SIZE>, recv_cb);
 
 	if (res < 0) {
 		SPDLOG_ERROR(
@@ -172,11 +167,12 @@ void TcpTransport<DelegateType>::did_recv(core::Buffer &&bytes) {
 }
 
 template<typename DelegateType>
+template<typename BufferType>
 void TcpTransport<DelegateType>::send_cb(
 	uv_write_t *req,
 	int status
 ) {
-	auto *data = (SendPayload *)req->data;
+	auto *data = (SendPayload<BufferType> *)req->data;
 
 	if(status < 0) {
 		SPDLOG_ERROR(
@@ -184,11 +180,24 @@ void TcpTransport<DelegateType>::send_cb(
 			data->transport.dst_addr.to_string(),
 			status
 		);
-	} else {
+	} else if constexpr (std::is_same_v<BufferType, core::Buffer>) {
 		data->transport.delegate->did_send(
 			data->transport,
 			std::move(data->bytes)
 		);
+	} else {
+		// Shared buffer and chain completions are optional
+		constexpr bool has_shared_did_send = requires(
+			DelegateType& d
+		) {
+			d.did_send(data->transport, std::move(data->bytes));
+		};
+		if constexpr (has_shared_did_send) {
+			data->transport.delegate->did_send(
+				data->transport,
+				std::move(data->bytes)
+			);
+		}
 	}
 
 	delete data;
@@ -203,24 +212,20 @@ void TcpTransport<DelegateType>::close_cb(uv_handle_t *handle) {
 	delete handle;
 }
 
-//! called by higher level to send data
-/*!
-	\param bytes Marlin::core::Buffer type of packet
-	\return integer, 0 for success, failure otherwise
-*/
 template<typename DelegateType>
-int TcpTransport<DelegateType>::send(core::Buffer &&bytes) {
+template<typename BufferType>
+int TcpTransport<DelegateType>::send_impl(BufferType &&bytes) {
 	auto *req = new uv_write_t();
-	auto req_data = new SendPayload { std::move(bytes), *this };
+	auto req_data = new SendPayload<BufferType> { std::move(bytes), *this };
 	req->data = req_data;
 
-	auto buf = uv_buf_init((char*)req_data->bytes.data(), req_data->bytes.size());
+	auto bufs = to_uv_bufs(req_data->bytes);
 	int res = uv_write(
 		req,
 		(uv_stream_t *)socket,
-		&buf,
-		1,
-		send_cb
+		bufs.data(),
+		bufs.size(),
+		send_cb<BufferType>
 	);
 
 	if (res < 0) {
@@ -235,6 +240,36 @@ int TcpTransport<DelegateType>::send(core::Buffer &&bytes) {
 	return 0;
 }
 
+//! called by higher level to send data
+/*!
+	\param bytes Marlin::core::Buffer type of packet
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int TcpTransport<DelegateType>::send(core::Buffer &&bytes) {
+	return send_impl(std::move(bytes));
+}
+
+//! called by higher level to send data shared with other transports, memory is held until the write completes
+/*!
+	\param bytes Marlin::core::SharedBuffer type of packet
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int TcpTransport<DelegateType>::send(core::SharedBuffer &&bytes) {
+	return send_impl(std::move(bytes));
+}
+
+//! called by higher level to send data gathered from multiple buffers, memory is held until the write completes
+/*!
+	\param bytes Marlin::core::BufferChain type of packet
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int TcpTransport<DelegateType>::send(core::BufferChain &&bytes) {
+	return send_impl(std::move(bytes));
+}
+
 //! closes the underlying tcp socket. calls the close callback which erases self entry from the transport manager, which in turn destroys this instance
 template<typename DelegateType>
 void TcpTransport<DelegateType>::close(uint16_t reason) {
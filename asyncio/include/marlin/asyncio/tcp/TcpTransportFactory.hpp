@@ -11,6 +11,7 @@
 #include "marlin/core/Buffer.hpp"
 #include "marlin/core/SocketAddress.hpp"
 #include "TcpTransport.hpp"
+#include "marlin/asyncio/core/EventLoop.hpp"
 
 #include <spdlog/spdlog.h>
 
@@ -26,6 +27,7 @@ template<typename ListenDelegate, typename TransportDelegate>
 class TcpTransportFactory {
 private:
 	uv_tcp_t *socket;
+	LoopContext loop;
 	core::TransportManager<TcpTransport<TransportDelegate>> transport_manager;
 
 	static void close_cb(uv_handle_t *handle);
@@ -48,7 +50,7 @@ private:
 public:
 	core::SocketAddress addr;
 
-	TcpTransportFactory();
+	explicit TcpTransportFactory(LoopContext loop = {});
 	~TcpTransportFactory();
 
 	TcpTransportFactory(TcpTransportFactory const&) = delete;
@@ -66,7 +68,7 @@ public:
 
 template<typename ListenDelegate, typename TransportDelegate>
 TcpTransportFactory<ListenDelegate, TransportDelegate>::
-TcpTransportFactory() {
+TcpTransportFactory(LoopContext loop) : loop(loop) {
 	socket = new uv_tcp_t();
 }
 
@@ -101,9 +103,7 @@ TcpTransportFactory<ListenDelegate, TransportDelegate>::
 bind(core::SocketAddress const &addr) {
 	this->addr = addr;
 
-	uv_loop_t *loop = uv_default_loop();
-
-	int res = uv_tcp_init(loop, socket);
+	int res = uv_tcp_init(loop.get(), socket);
 	if (res < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: Init error: {}",
@@ -164,7 +164,7 @@ connection_cb(uv_stream_t *handle, int status) {
 	}
 
 	auto *client = new uv_tcp_t();
-	status = uv_tcp_init(uv_default_loop(), client);
+	status = uv_tcp_init(factory.loop.get(), client);
 	if (status < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: TCP init error: {}",
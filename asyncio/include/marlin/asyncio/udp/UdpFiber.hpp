@@ -2,8 +2,12 @@
 #define MARLIN_ASYNCIO_UDP_UDPFIBER_HPP
 
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 #include <marlin/core/fibers/FiberScaffold.hpp>
 #include <marlin/uvpp/Udp.hpp>
+#include "marlin/asyncio/core/RecvBuffer.hpp"
+#include "marlin/asyncio/core/EventLoop.hpp"
+#include "marlin/asyncio/core/SendBuffer.hpp"
 
 #include <spdlog/spdlog.h>
 
@@ -32,6 +36,11 @@ public:
 private:
 	uvpp::UdpE* udp_handle = nullptr;
 
+	/// Max datagrams per receive call, batching is disabled if 1
+	size_t recv_batch_size = 1;
+	/// Batch receive buffer
+	UdpRecvBatch recv_batch{1};
+
 public:
 	UdpFiber(auto&&... args) :
 		FiberScaffoldType(std::forward<decltype(args)>(args)...) {
@@ -42,8 +51,18 @@ public:
 	UdpFiber(UdpFiber const&) = delete;
 	UdpFiber(UdpFiber&&) = delete;
 
-	[[nodiscard]] int bind(core::SocketAddress const& addr) {
-		int res = uv_udp_init(uv_default_loop(), udp_handle);
+	/// Bind to the given address, receives up to recv_batch_size datagrams per syscall using recvmmsg if greater than 1.
+	/// The socket is created on the given loop, the calling thread's loop by default.
+	[[nodiscard]] int bind(core::SocketAddress const& addr, size_t recv_batch_size = 1, LoopContext loop = {}) {
+		this->recv_batch_size = recv_batch_size;
+		recv_batch = UdpRecvBatch(recv_batch_size);
+
+		unsigned int flags = AF_UNSPEC;
+		if(recv_batch_size > 1) {
+			flags |= UV_UDP_RECVMMSG;
+		}
+
+		int res = uv_udp_init_ex(loop.get(), udp_handle, flags);
 		if (res < 0) {
 			SPDLOG_ERROR(
 				"Asyncio: Socket {}: Init error: {}",
@@ -70,21 +89,12 @@ public:
 		return 0;
 	}
 
-	static void naive_alloc_cb(
-		uv_handle_t*,
-		size_t suggested_size,
-		uv_buf_t* buf
-	) {
-		buf->base = new char[suggested_size];
-		buf->len = suggested_size;
-	}
-
 	static void recv_cb(
 		uv_udp_t* handle,
 		ssize_t nread,
 		uv_buf_t const* buf,
 		sockaddr const* _addr,
-		unsigned
+		unsigned flags
 	) {
 		// Error
 		if(nread < 0) {
@@ -99,12 +109,22 @@ public:
 				nread
 			);
 
-			delete[] buf->base;
+			pooled_free(buf);
 			return;
 		}
 
 		if(nread == 0) {
-			delete[] buf->base;
+			pooled_free(buf);
+			return;
+		}
+
+		// Datagram did not fit in the receive buffer
+		if(flags & UV_UDP_PARTIAL) {
+			SPDLOG_WARN(
+				"Asyncio: Dropping truncated datagram from {}",
+				reinterpret_cast<core::SocketAddress const*>(_addr)->to_string()
+			);
+			pooled_free(buf);
 			return;
 		}
 
@@ -113,17 +133,63 @@ public:
 
 		fiber.did_recv(
 			fiber,
-			core::Buffer((uint8_t*)buf->base, nread),
+			pooled_recv_buffer(buf, nread),
 			addr
 		);
 	}
 
+	static void batch_alloc_cb(
+		uv_handle_t* handle,
+		size_t,
+		uv_buf_t* buf
+	) {
+		auto& fiber = *(SelfType*)(handle->data);
+		fiber.recv_batch.alloc(buf);
+	}
+
+	static void recv_batch_cb(
+		uv_udp_t* handle,
+		ssize_t nread,
+		uv_buf_t const* buf,
+		sockaddr const* _addr,
+		unsigned flags
+	) {
+		auto& fiber = *(SelfType*)(handle->data);
+
+		// Batch done, buffer can be reused
+		if(flags & UV_UDP_MMSG_FREE) {
+			fiber.recv_batch.free(buf);
+			return;
+		}
+
+		if(nread < 0) {
+			SPDLOG_ERROR(
+				"Asyncio: Socket: Recv callback error: {}",
+				nread
+			);
+		} else if(nread > 0 && (flags & UV_UDP_PARTIAL)) {
+			SPDLOG_WARN(
+				"Asyncio: Dropping truncated datagram from {}",
+				reinterpret_cast<core::SocketAddress const*>(_addr)->to_string()
+			);
+		} else if(nread > 0) {
+			fiber.did_recv(
+				fiber,
+				UdpRecvBatch::copy(buf, nread),
+				*reinterpret_cast<core::SocketAddress const*>(_addr)
+			);
+		}
+
+		// Chunks are views into the batch buffer, anything else owns it
+		if(!(flags & UV_UDP_MMSG_CHUNK)) {
+			fiber.recv_batch.free(buf);
+		}
+	}
+
 	[[nodiscard]] int listen() {
-		int res = uv_udp_recv_start(
-			udp_handle,
-			naive_alloc_cb,
-			recv_cb
-		);
+		int res = recv_batch_size > 1 ?
+			uv_udp_recv_start(udp_handle, batch_alloc_cb, recv_batch_cb) :
+			uv_udp_recv_start(udp_handle, pooled_alloc_cb<DEFAULT_UDP_RECV_SIZE>, recv_cb);
 		if (res < 0) {
 			SPDLOG_ERROR(
 				"Asyncio: Start recv error: {}",
@@ -149,11 +215,12 @@ public:
 		return 0;
 	}
 
+	template<typename BufferType>
 	static void send_cb(
 		uv_udp_send_t* _req,
 		int status
 	) {
-		auto* req = (uvpp::UdpSendReq<core::Buffer>*)_req;
+		auto* req = (uvpp::UdpSendReq<BufferType>*)_req;
 
 		if(req->data == nullptr) {
 			delete req;
@@ -166,7 +233,7 @@ public:
 				"Asyncio: Socket: Send callback error: {}",
 				status
 			);
-		} else {
+		} else if constexpr (std::is_same_v<BufferType, core::Buffer>) {
 			fiber.did_send(
 				fiber,
 				std::move(req->extra_data)
@@ -177,17 +244,28 @@ public:
 	}
 
 	[[nodiscard]] int send(auto&&, core::Buffer&& buf, core::SocketAddress addr) {
-		auto* req = new uvpp::UdpSendReq<core::Buffer>(std::move(buf));
+		return send_impl(std::move(buf), addr);
+	}
+
+	/// Send a datagram gathered from multiple buffers, completions are not reported
+	[[nodiscard]] int send(auto&&, core::BufferChain&& buf, core::SocketAddress addr) {
+		return send_impl(std::move(buf), addr);
+	}
+
+private:
+	template<typename BufferType>
+	int send_impl(BufferType&& buf, core::SocketAddress const& addr) {
+		auto* req = new uvpp::UdpSendReq<BufferType>(std::move(buf));
 		req->data = this;
 
-		auto uv_buf = uv_buf_init((char*)req->extra_data.data(), req->extra_data.size());
+		auto uv_bufs = to_uv_bufs(req->extra_data);
 		int res = uv_udp_send(
 			req,
 			udp_handle,
-			&uv_buf,
-			1,
+			uv_bufs.data(),
+			uv_bufs.size(),
 			reinterpret_cast<const sockaddr*>(&addr),
-			send_cb
+			send_cb<BufferType>
 		);
 
 		if (res < 0) {
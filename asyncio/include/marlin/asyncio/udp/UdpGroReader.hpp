@@ -0,0 +1,206 @@
+/*! \file UdpGroReader.hpp
+	\brief Receive of UDP GRO coalesced datagrams
+
+	With UDP_GRO enabled the kernel hands a train of datagrams from a single peer
+	to the socket as one super-datagram along with the size of each segment.
+*/
+
+#ifndef MARLIN_ASYNCIO_UDPGROREADER_HPP
+#define MARLIN_ASYNCIO_UDPGROREADER_HPP
+
+#include <uv.h>
+#include <marlin/core/Buffer.hpp>
+#include <marlin/core/SocketAddress.hpp>
+#include "marlin/asyncio/core/RecvBuffer.hpp"
+#include <spdlog/spdlog.h>
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <cerrno>
+#include <climits>
+#endif
+
+namespace marlin {
+namespace asyncio {
+
+/// Smallest segment size the receive buffers are sized to, smaller segments are copied out
+#define MIN_UDP_GRO_SEGMENT_SIZE 512
+
+/// @brief Reads GRO super-datagrams and splits them into one Buffer per datagram
+/// @details The super-datagram is scattered into pooled buffers sized to the expected
+/// segment size, so each segment lands in its own buffer and is handed out without copying.
+/// The expected size follows the segment size reported by the kernel, segments are
+/// copied out only when it changes.
+class UdpGroReader {
+private:
+	/// Expected segment size, each receive buffer holds exactly one segment
+	size_t segment_size = DEFAULT_UDP_RECV_SIZE;
+	/// Receive buffers, together they fit the largest datagram
+	std::vector<core::Buffer> blocks;
+	/// Receive buffers as passed to the kernel
+	std::vector<uv_buf_t> iovs;
+
+	void resize(size_t size);
+	void gather(size_t pos, uint8_t *out, size_t size) const;
+public:
+	/// Enable GRO on the socket
+	/*!
+		\return 0 if successful, negative otherwise
+	*/
+	static int enable(uv_os_fd_t fd);
+
+	/// Read a single super-datagram and call f(addr, packet) for every datagram in it
+	/*!
+		\return bytes read, negative error if nothing was read
+	*/
+	template<typename F>
+	int read(uv_os_fd_t fd, F &&f);
+};
+
+
+// Impl
+
+inline void UdpGroReader::resize(size_t size) {
+	segment_size = size;
+
+	// Enough buffers for a 64KB datagram
+	size_t num_blocks = (UdpRecvBatch::slot_size + size - 1) / size;
+	blocks.clear();
+	iovs.clear();
+	for(size_t i = 0; i < num_blocks; i++) {
+		auto &block = blocks.emplace_back(size);
+		iovs.push_back(uv_buf_init((char*)block.data(), size));
+	}
+}
+
+inline void UdpGroReader::gather(size_t pos, uint8_t *out, size_t size) const {
+	for(size_t i = pos / segment_size; size > 0; i++) {
+		size_t offset = pos % segment_size;
+		size_t length = std::min(segment_size - offset, size);
+		blocks[i].read_unsafe(offset, out, length);
+
+		out += length;
+		pos += length;
+		size -= length;
+	}
+}
+
+#if defined(__linux__) && defined(UDP_GRO)
+
+inline int UdpGroReader::enable(uv_os_fd_t fd) {
+	int one = 1;
+	if(setsockopt(fd, SOL_UDP, UDP_GRO, &one, sizeof(one)) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+template<typename F>
+int UdpGroReader::read(uv_os_fd_t fd, F &&f) {
+	if(blocks.empty()) {
+		resize(segment_size);
+	}
+
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		cmsghdr align;
+	} control;
+
+	core::SocketAddress addr;
+	msghdr msg = {};
+	msg.msg_name = &addr;
+	msg.msg_namelen = sizeof(sockaddr_storage);
+	// uv_buf_t is layout compatible with iovec on unix
+	msg.msg_iov = reinterpret_cast<iovec *>(iovs.data());
+	msg.msg_iovlen = iovs.size();
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ssize_t nread;
+	do {
+		nread = recvmsg(fd, &msg, MSG_DONTWAIT);
+	} while(nread < 0 && errno == EINTR);
+
+	if(nread < 0) {
+		return -errno;
+	}
+
+	if(msg.msg_flags & MSG_TRUNC) {
+		SPDLOG_WARN(
+			"Asyncio: Dropping truncated datagram from {}",
+			addr.to_string()
+		);
+		return nread;
+	}
+
+	// Segment size, absent if the datagram was not coalesced
+	size_t gso_size = nread;
+	for(auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if(cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+			int size;
+			std::memcpy(&size, CMSG_DATA(cmsg), sizeof(int));
+			gso_size = size;
+		}
+	}
+
+	if(nread == 0 || gso_size == 0) {
+		return nread;
+	}
+
+	bool is_single = gso_size >= (size_t)nread;
+	if(gso_size == segment_size || (is_single && (size_t)nread <= segment_size)) {
+		// Segments line up with the buffers, hand them out
+		for(size_t i = 0, pos = 0; pos < (size_t)nread; i++, pos += segment_size) {
+			size_t length = std::min(segment_size, nread - pos);
+
+			auto packet = std::move(blocks[i]);
+			packet.truncate_unsafe(packet.size() - length);
+			blocks[i] = core::Buffer(segment_size);
+			iovs[i].base = (char*)blocks[i].data();
+
+			f(addr, std::move(packet));
+		}
+	} else {
+		// Segments straddle buffers, copy them out
+		for(size_t pos = 0; pos < (size_t)nread; pos += gso_size) {
+			size_t length = std::min(gso_size, nread - pos);
+
+			core::Buffer packet(length);
+			gather(pos, packet.data(), length);
+
+			f(addr, std::move(packet));
+		}
+
+		// Expect the same segment size next time
+		if(!is_single && gso_size >= MIN_UDP_GRO_SEGMENT_SIZE) {
+			resize(gso_size);
+		}
+	}
+
+	return nread;
+}
+
+#else
+
+inline int UdpGroReader::enable(uv_os_fd_t) {
+	return UV_ENOTSUP;
+}
+
+template<typename F>
+int UdpGroReader::read(uv_os_fd_t, F &&) {
+	return UV_ENOTSUP;
+}
+
+#endif
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_UDPGROREADER_HPP
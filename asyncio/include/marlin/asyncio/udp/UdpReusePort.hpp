@@ -0,0 +1,138 @@
+/*! \file UdpReusePort.hpp
+	\brief SO_REUSEPORT groups of UDP sockets, one per event loop shard
+
+	Every shard binds its own socket to the same address. The kernel picks the socket for
+	an incoming datagram using a classic BPF program that hashes the source address the same way
+	as UdpReusePort::shard_of, so a peer always lands on the shard that would dial it.
+*/
+
+#ifndef MARLIN_ASYNCIO_UDPREUSEPORT_HPP
+#define MARLIN_ASYNCIO_UDPREUSEPORT_HPP
+
+#include <uv.h>
+#include <marlin/core/SocketAddress.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <cerrno>
+#endif
+
+namespace marlin {
+namespace asyncio {
+
+/// @brief Membership of a socket in a SO_REUSEPORT group shared by event loop shards
+/// @details Sockets must join the group in shard order since the kernel indexes
+/// the group by join order. Disabled if num_shards is 0.
+struct UdpReusePort {
+	/// Index of the shard owning the socket
+	size_t shard = 0;
+	/// Number of sockets in the group
+	size_t num_shards = 0;
+
+	bool is_enabled() const {
+		return num_shards > 0;
+	}
+
+	/// Shard handling the given peer
+	static size_t shard_of(core::SocketAddress const &addr, size_t num_shards) {
+		uint32_t ip;
+		uint16_t port;
+		if(addr.ss_family == AF_INET) {
+			auto &addr4 = reinterpret_cast<sockaddr_in const &>(addr);
+			ip = ntohl(addr4.sin_addr.s_addr);
+			port = ntohs(addr4.sin_port);
+		} else {
+			// Low 32 bits of the address
+			auto &addr6 = reinterpret_cast<sockaddr_in6 const &>(addr);
+			std::memcpy(&ip, addr6.sin6_addr.s6_addr + 12, 4);
+			ip = ntohl(ip);
+			port = ntohs(addr6.sin6_port);
+		}
+
+		return (ip ^ port) % num_shards;
+	}
+
+	/// Join the group, call before bind
+	int set_reuse_port(uv_os_fd_t fd) const;
+
+	/// Steer datagrams to sockets using shard_of, call after bind.
+	/// Until every socket has joined, datagrams for missing shards are spread by the kernel.
+	int attach_steering(uv_os_fd_t fd, int family) const;
+};
+
+
+// Impl
+
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+
+inline int UdpReusePort::set_reuse_port(uv_os_fd_t fd) const {
+	int one = 1;
+	if(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+inline int UdpReusePort::attach_steering(uv_os_fd_t fd, int family) const {
+	// Returns (src ip ^ src port) % num_shards, loads convert from network byte order.
+	// The program sees the packet past the UDP header, headers are loaded relative to the network header.
+	sock_filter code4[] = {
+		// X = IPv4 header length
+		BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, (uint32_t)SKF_NET_OFF),
+		// A = src port
+		BPF_STMT(BPF_LD | BPF_H | BPF_IND, (uint32_t)SKF_NET_OFF),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		// A = src ip
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)SKF_NET_OFF + 12),
+		BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)num_shards),
+		BPF_STMT(BPF_RET | BPF_A, 0)
+	};
+	sock_filter code6[] = {
+		// A = src port, assumes no extension headers
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS, (uint32_t)SKF_NET_OFF + 40),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		// A = low 32 bits of src ip
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t)SKF_NET_OFF + 20),
+		BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)num_shards),
+		BPF_STMT(BPF_RET | BPF_A, 0)
+	};
+
+	sock_fprog prog;
+	if(family == AF_INET) {
+		prog = {sizeof(code4) / sizeof(code4[0]), code4};
+	} else {
+		prog = {sizeof(code6) / sizeof(code6[0]), code6};
+	}
+
+	if(setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+#else
+
+inline int UdpReusePort::set_reuse_port(uv_os_fd_t) const {
+	return UV_ENOTSUP;
+}
+
+inline int UdpReusePort::attach_steering(uv_os_fd_t, int) const {
+	return UV_ENOTSUP;
+}
+
+#endif
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_UDPREUSEPORT_HPP
@@ -0,0 +1,214 @@
+/*! \file UdpSendBatch.hpp
+	\brief Batched transmit of UDP datagrams to a single peer
+
+	Datagrams are flushed with a single sendmmsg call. Runs of equally sized datagrams
+	are coalesced into UDP GSO super-datagrams where the kernel supports it.
+*/
+
+#ifndef MARLIN_ASYNCIO_UDPSENDBATCH_HPP
+#define MARLIN_ASYNCIO_UDPSENDBATCH_HPP
+
+#include <uv.h>
+#include <marlin/core/SocketAddress.hpp>
+#include "marlin/asyncio/core/SendBuffer.hpp"
+
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <cerrno>
+#include <climits>
+#endif
+
+namespace marlin {
+namespace asyncio {
+
+/// Max datagrams coalesced into a single GSO send
+#define MAX_UDP_GSO_SEGMENTS 64
+/// Max bytes in a single GSO send, leaves room for IP and UDP headers
+#define MAX_UDP_GSO_BYTES 65000
+
+/// @brief Datagrams queued for a single sendmmsg call
+/// @details Only describes the bytes, the owner must keep them alive until send returns.
+class UdpSendBatch {
+private:
+	struct Datagram {
+		/// Index of first entry in iovs
+		size_t iov_idx;
+		/// Number of entries in iovs
+		size_t iov_len;
+		/// Total bytes
+		size_t size;
+	};
+
+	std::vector<uv_buf_t> iovs;
+	std::vector<Datagram> datagrams;
+
+#ifdef __linux__
+	/// Cleared on the first GSO failure, e.g. if the egress device cannot segment
+	bool use_gso = true;
+
+	/// Control message carrying the GSO segment size
+	union GsoControl {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		cmsghdr align;
+	};
+
+	std::vector<mmsghdr> msgs;
+	std::vector<GsoControl> controls;
+	/// Number of datagrams in each message of msgs
+	std::vector<size_t> msg_datagrams;
+
+	void build_msgs(size_t start, core::SocketAddress const &dst);
+#endif
+public:
+	/// Queue a datagram
+	void push(UvBufs const &bufs);
+
+	/// Number of queued datagrams
+	size_t size() const {
+		return datagrams.size();
+	}
+
+	/// Remove all queued datagrams
+	void clear();
+
+	/// Send queued datagrams in order
+	/*!
+		\return number of leading datagrams accepted by the kernel, negative error if none were
+	*/
+	int send(uv_os_fd_t fd, core::SocketAddress const &dst);
+};
+
+
+// Impl
+
+inline void UdpSendBatch::push(UvBufs const &bufs) {
+	size_t size = 0;
+	for(auto &buf : bufs) {
+		size += buf.len;
+	}
+
+	datagrams.push_back({iovs.size(), bufs.size(), size});
+	iovs.insert(iovs.end(), bufs.begin(), bufs.end());
+}
+
+inline void UdpSendBatch::clear() {
+	iovs.clear();
+	datagrams.clear();
+}
+
+#ifdef __linux__
+
+//! builds one message per datagram, or per run of equally sized datagrams if GSO is enabled
+/*!
+	A GSO run can end with a single shorter datagram, the kernel splits it back
+	into the original datagrams at gso_size boundaries
+*/
+inline void UdpSendBatch::build_msgs(size_t start, core::SocketAddress const &dst) {
+	msgs.clear();
+	controls.clear();
+	msg_datagrams.clear();
+
+	socklen_t addr_len = dst.ss_family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+
+	// Reserve up front so control pointers stay valid
+	controls.reserve(datagrams.size() - start);
+
+	for(size_t i = start; i < datagrams.size();) {
+		auto &first = datagrams[i];
+
+		size_t end = i + 1;
+		size_t bytes = first.size;
+		size_t iov_len = first.iov_len;
+#ifdef UDP_SEGMENT
+		if(use_gso) {
+			while(
+				end < datagrams.size() &&
+				end - i < MAX_UDP_GSO_SEGMENTS &&
+				bytes + datagrams[end].size <= MAX_UDP_GSO_BYTES &&
+				iov_len + datagrams[end].iov_len <= IOV_MAX &&
+				datagrams[end].size <= first.size &&
+				// Only the last datagram in a run can be shorter
+				datagrams[end - 1].size == first.size
+			) {
+				bytes += datagrams[end].size;
+				iov_len += datagrams[end].iov_len;
+				end++;
+			}
+		}
+#endif
+
+		mmsghdr msg = {};
+		msg.msg_hdr.msg_name = (void *)&dst;
+		msg.msg_hdr.msg_namelen = addr_len;
+		// uv_buf_t is layout compatible with iovec on unix
+		msg.msg_hdr.msg_iov = reinterpret_cast<iovec *>(&iovs[first.iov_idx]);
+		msg.msg_hdr.msg_iovlen = iov_len;
+
+#ifdef UDP_SEGMENT
+		if(end - i > 1) {
+			auto &control = controls.emplace_back();
+			msg.msg_hdr.msg_control = control.buf;
+			msg.msg_hdr.msg_controllen = sizeof(control.buf);
+
+			auto *cmsg = CMSG_FIRSTHDR(&msg.msg_hdr);
+			cmsg->cmsg_level = SOL_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			*reinterpret_cast<uint16_t *>(CMSG_DATA(cmsg)) = first.size;
+		}
+#endif
+
+		msgs.push_back(msg);
+		msg_datagrams.push_back(end - i);
+		i = end;
+	}
+}
+
+inline int UdpSendBatch::send(uv_os_fd_t fd, core::SocketAddress const &dst) {
+	size_t sent = 0;
+	build_msgs(0, dst);
+
+	size_t msg_idx = 0;
+	while(msg_idx < msgs.size()) {
+		int res = sendmmsg(fd, msgs.data() + msg_idx, msgs.size() - msg_idx, 0);
+		if(res < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+
+			// Egress device or path cannot segment, retry remaining datagrams without GSO
+			if(use_gso && msg_datagrams[msg_idx] > 1 && (errno == EIO || errno == EINVAL)) {
+				use_gso = false;
+				build_msgs(sent, dst);
+				msg_idx = 0;
+				continue;
+			}
+
+			return sent == 0 ? -errno : (int)sent;
+		}
+
+		for(int i = 0; i < res; i++, msg_idx++) {
+			sent += msg_datagrams[msg_idx];
+		}
+	}
+
+	return sent;
+}
+
+#else
+
+inline int UdpSendBatch::send(uv_os_fd_t, core::SocketAddress const &) {
+	// Let the caller fall back to regular sends
+	return 0;
+}
+
+#endif
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_UDPSENDBATCH_HPP
@@ -10,11 +10,26 @@
 #define MARLIN_ASYNCIO_UDPTRANSPORT_HPP
 
 #include <marlin/core/CidrBlock.hpp>
+#include <marlin/core/SharedBuffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 #include <marlin/core/transports/TransportScaffold.hpp>
 #include <uv.h>
 #include <spdlog/spdlog.h>
+#include "marlin/asyncio/core/RecvBuffer.hpp"
+#include "marlin/asyncio/core/SendBuffer.hpp"
+#include "UdpSendBatch.hpp"
 
 #include <list>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#endif
 
 namespace marlin {
 namespace asyncio {
@@ -31,17 +46,42 @@ private:
 	using TransportScaffoldType::base_transport;
 	using TransportScaffoldType::transport_manager;
 
+	template<typename BufferType>
 	static void send_cb(
 		uv_udp_send_t *req,
 		int status
 	);
 
-	struct SendPayload {
-		core::Buffer packet;
+	struct SendPayloadBase {
 		UdpTransport<DelegateType> *transport;
 	};
 
+	template<typename BufferType>
+	struct SendPayload : SendPayloadBase {
+		BufferType packet;
+	};
+
+	template<typename BufferType>
+	int send_impl(BufferType &&packet);
+
+	template<typename BufferType>
+	void did_send_packet(BufferType &&packet);
+
 	std::list<uv_udp_send_t *> pending_req;
+
+	using CorkedPacket = std::variant<core::Buffer, core::SharedBuffer, core::BufferChain>;
+
+	/// Are sends being queued until uncork?
+	bool is_corked = false;
+	/// Packets queued while corked
+	std::vector<CorkedPacket> corked_packets;
+	/// Scratch space to describe corked packets to the kernel
+	UdpSendBatch send_batch;
+	/// Cleared if the transport is closed while uncork is reporting completions
+	bool *is_alive = nullptr;
+
+	/// Result of the route MTU lookup, empty until the first call
+	std::optional<size_t> cached_max_datagram_size;
 public:
 	using MessageType = typename TransportScaffoldType::MessageType;
 	static_assert(std::is_same_v<MessageType, core::BaseMessage>);
@@ -64,6 +104,21 @@ public:
 	bool is_internal();
 
 	int send(core::Buffer &&packet);
+	int send(core::SharedBuffer &&packet);
+	int send(core::BufferChain &&packet);
+
+	/// Queue sends until uncork so that a burst to the peer leaves in as few syscalls as possible
+	void cork();
+	/// Send queued packets, completions are reported per packet
+	void uncork();
+
+	/// Largest datagram the route to the peer carries unfragmented as per IP_MTU, 0 if unknown
+	/// Capped at the receive buffer size, looked up once per transport
+	size_t max_datagram_size();
+
+	/// Hand datagrams received from the peer in a single batch to the delegate in one call, replies are corked meanwhile
+	/// Only used by the factory if the delegate has did_recv_batch
+	void did_recv_batch(uv_udp_t *socket, std::span<core::Buffer> packets);
 };
 
 
@@ -97,11 +152,12 @@ void UdpTransport<DelegateType>::setup(DelegateType *delegate) {
 }
 
 template<typename DelegateType>
+template<typename BufferType>
 void UdpTransport<DelegateType>::send_cb(
 	uv_udp_send_t *req,
 	int status
 ) {
-	auto *data = (SendPayload *)req->data;
+	auto *data = static_cast<SendPayload<BufferType> *>((SendPayloadBase *)req->data);
 
 	if(data->transport == nullptr) {
 		delete data;
@@ -117,37 +173,53 @@ void UdpTransport<DelegateType>::send_cb(
 			status
 		);
 	} else {
-		data->transport->delegate->did_send(
-			*data->transport,
-			std::move(data->packet)
-		);
+		data->transport->did_send_packet(std::move(data->packet));
 	}
 
 	delete data;
 	delete req;
 }
 
-//! called by higher level to send data
-/*!
-	\param packet Marlin::core::Buffer type of packet
-	\return integer, 0 for success, failure otherwise
-*/
 template<typename DelegateType>
-int UdpTransport<DelegateType>::send(core::Buffer &&packet) {
+template<typename BufferType>
+void UdpTransport<DelegateType>::did_send_packet(BufferType &&packet) {
+	if constexpr (std::is_same_v<BufferType, core::Buffer>) {
+		delegate->did_send(*this, std::move(packet));
+	} else {
+		// Shared buffer and chain completions are optional
+		constexpr bool has_shared_did_send = requires(
+			DelegateType& d
+		) {
+			d.did_send(*this, std::move(packet));
+		};
+		if constexpr (has_shared_did_send) {
+			delegate->did_send(*this, std::move(packet));
+		}
+	}
+}
+
+template<typename DelegateType>
+template<typename BufferType>
+int UdpTransport<DelegateType>::send_impl(BufferType &&packet) {
+	if(is_corked) {
+		corked_packets.emplace_back(std::move(packet));
+		return 0;
+	}
+
 	uv_udp_send_t *req = new uv_udp_send_t();
-	auto req_data = new SendPayload{std::move(packet), this};
-	req->data = req_data;
+	auto req_data = new SendPayload<BufferType>{{this}, std::move(packet)};
+	req->data = static_cast<SendPayloadBase *>(req_data);
 
 	pending_req.push_back(req);
 
-	auto buf = uv_buf_init((char*)req_data->packet.data(), req_data->packet.size());
+	auto bufs = to_uv_bufs(req_data->packet);
 	int res = uv_udp_send(
 		req,
 		base_transport,
-		&buf,
-		1,
+		bufs.data(),
+		bufs.size(),
 		reinterpret_cast<const sockaddr *>(&dst_addr),
-		UdpTransport<DelegateType>::send_cb
+		send_cb<BufferType>
 	);
 
 	if (res < 0) {
@@ -163,6 +235,178 @@ int UdpTransport<DelegateType>::send(core::Buffer &&packet) {
 	return 0;
 }
 
+//! called by higher level to send data
+/*!
+	\param packet Marlin::core::Buffer type of packet
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int UdpTransport<DelegateType>::send(core::Buffer &&packet) {
+	return send_impl(std::move(packet));
+}
+
+//! called by higher level to send data shared with other transports, memory is held until the send completes
+/*!
+	\param packet Marlin::core::SharedBuffer type of packet
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int UdpTransport<DelegateType>::send(core::SharedBuffer &&packet) {
+	return send_impl(std::move(packet));
+}
+
+//! called by higher level to send a datagram gathered from multiple buffers, memory is held until the send completes
+/*!
+	\param packet Marlin::core::BufferChain type of packet
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int UdpTransport<DelegateType>::send(core::BufferChain &&packet) {
+	return send_impl(std::move(packet));
+}
+
+//! queue sends until uncork is called
+template<typename DelegateType>
+void UdpTransport<DelegateType>::cork() {
+	is_corked = true;
+}
+
+//! sends packets queued since cork
+/*!
+	\li packets leave in a single sendmmsg call, coalesced using UDP GSO where supported
+	\li packets the kernel does not accept immediately fall back to regular sends
+	\li completions of packets sent in the batch are reported before returning
+*/
+template<typename DelegateType>
+void UdpTransport<DelegateType>::uncork() {
+	is_corked = false;
+	if(corked_packets.empty()) {
+		return;
+	}
+
+	auto packets = std::move(corked_packets);
+	corked_packets.clear();
+
+	send_batch.clear();
+	for(auto &packet : packets) {
+		std::visit([&](auto &bytes) {
+			send_batch.push(to_uv_bufs(bytes));
+		}, packet);
+	}
+
+	int sent = 0;
+	uv_os_fd_t fd;
+	if(uv_fileno((uv_handle_t *)base_transport, &fd) == 0) {
+		sent = send_batch.send(fd, dst_addr);
+	}
+	send_batch.clear();
+
+	if(sent < 0) {
+		SPDLOG_DEBUG(
+			"Asyncio: Socket {}: Batch send error: {}, To: {}",
+			src_addr.to_string(),
+			sent,
+			dst_addr.to_string()
+		);
+		sent = 0;
+	}
+
+	// Remaining packets are queued in libuv, which waits for the socket to be writable
+	for(size_t i = sent; i < packets.size(); i++) {
+		std::visit([&](auto &bytes) {
+			send_impl(std::move(bytes));
+		}, packets[i]);
+	}
+
+	bool alive = true;
+	auto *outer_alive = is_alive;
+	is_alive = &alive;
+	for(int i = 0; i < sent && alive; i++) {
+		std::visit([&](auto &bytes) {
+			did_send_packet(std::move(bytes));
+		}, packets[i]);
+	}
+	if(!alive) {
+		if(outer_alive != nullptr) {
+			*outer_alive = false;
+		}
+		return;
+	}
+	is_alive = outer_alive;
+}
+
+//! hands datagrams received together from the peer to the delegate in one call
+/*!
+	\li packets the delegate sends in reply are corked and leave together once it returns
+*/
+template<typename DelegateType>
+void UdpTransport<DelegateType>::did_recv_batch(uv_udp_t *, std::span<core::Buffer> packets) {
+	bool alive = true;
+	auto *outer_alive = is_alive;
+	is_alive = &alive;
+
+	bool was_corked = is_corked;
+	cork();
+	delegate->did_recv_batch(*this, packets);
+	if(!alive) {
+		if(outer_alive != nullptr) {
+			*outer_alive = false;
+		}
+		return;
+	}
+	is_alive = outer_alive;
+
+	if(!was_corked) {
+		uncork();
+	}
+}
+
+template<typename DelegateType>
+size_t UdpTransport<DelegateType>::max_datagram_size() {
+	if(cached_max_datagram_size.has_value()) {
+		return *cached_max_datagram_size;
+	}
+
+#ifdef __linux__
+	// IP_MTU needs a connected socket, use a throwaway one to look up the route
+	auto family = dst_addr.ss_family;
+	if(family != AF_INET && family != AF_INET6) {
+		cached_max_datagram_size = 0;
+		return 0;
+	}
+
+	int fd = ::socket(family, SOCK_DGRAM, 0);
+	if(fd < 0) {
+		// Out of descriptors maybe, try again next time
+		return 0;
+	}
+
+	size_t size = 0;
+	socklen_t addr_len = family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+	if(::connect(fd, (sockaddr const*)&dst_addr, addr_len) == 0) {
+		int mtu = 0;
+		socklen_t len = sizeof(mtu);
+		if(family == AF_INET && getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) == 0 && mtu > 28) {
+			// IPv4 and UDP headers
+			size = mtu - 28;
+		} else if(family == AF_INET6 && getsockopt(fd, IPPROTO_IPV6, IPV6_MTU, &mtu, &len) == 0 && mtu > 48) {
+			// IPv6 and UDP headers
+			size = mtu - 48;
+		}
+	}
+	::close(fd);
+
+	// Peer could not receive anything larger
+	size = std::min<size_t>(size, DEFAULT_UDP_RECV_SIZE);
+	cached_max_datagram_size = size;
+
+	return size;
+#else
+	cached_max_datagram_size = 0;
+	return 0;
+#endif
+}
+
 template<typename DelegateType>
 int UdpTransport<DelegateType>::send(MessageType &&packet) {
 	return send(std::move(packet).payload_buffer());
@@ -172,8 +416,11 @@ int UdpTransport<DelegateType>::send(MessageType &&packet) {
 template<typename DelegateType>
 void UdpTransport<DelegateType>::close(uint16_t reason) {
 	delegate->did_close(*this, reason);
+	if(is_alive != nullptr) {
+		*is_alive = false;
+	}
 	for (auto *req : pending_req) {
-		auto *data = (SendPayload *)req->data;
+		auto *data = (SendPayloadBase *)req->data;
 		data->transport = nullptr;
 	}
 	transport_manager.erase(dst_addr);
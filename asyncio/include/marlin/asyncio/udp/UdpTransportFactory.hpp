@@ -13,9 +13,19 @@
 #include "marlin/core/Buffer.hpp"
 #include "marlin/core/SocketAddress.hpp"
 #include "UdpTransport.hpp"
+#include "UdpGroReader.hpp"
+#include "UdpReusePort.hpp"
+#include "marlin/asyncio/core/RecvBuffer.hpp"
+#include "marlin/asyncio/core/EventLoop.hpp"
 
 #include <spdlog/spdlog.h>
 
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
 
 namespace marlin {
 namespace asyncio {
@@ -41,15 +51,23 @@ private:
 	using TransportFactoryScaffoldType::base_factory;
 	using TransportFactoryScaffoldType::transport_manager;
 
-	static void naive_alloc_cb(
-		uv_handle_t *,
+	static void close_cb(uv_handle_t *handle);
+
+	static void recv_cb(
+		uv_udp_t *handle,
+		ssize_t nread,
+		uv_buf_t const *buf,
+		sockaddr const *addr,
+		unsigned flags
+	);
+
+	static void batch_alloc_cb(
+		uv_handle_t *handle,
 		size_t suggested_size,
 		uv_buf_t *buf
 	);
 
-	static void close_cb(uv_handle_t *handle);
-
-	static void recv_cb(
+	static void recv_batch_cb(
 		uv_udp_t *handle,
 		ssize_t nread,
 		uv_buf_t const *buf,
@@ -57,8 +75,40 @@ private:
 		unsigned flags
 	);
 
+	static void gro_poll_cb(
+		uv_poll_t *handle,
+		int status,
+		int events
+	);
+
+	int listen_gro();
+
+	SelfTransportType *accept_transport(core::SocketAddress const &addr, ListenDelegate &delegate);
+	void dispatch_batch(ListenDelegate &delegate);
+
 	bool is_listening = false;
 
+	/// Max datagrams per receive call, batching is disabled if 1
+	size_t recv_batch_size;
+	/// Batch receive buffer
+	UdpRecvBatch recv_batch;
+	/// Datagrams received in the current batch, pending dispatch
+	std::vector<std::pair<core::SocketAddress, core::Buffer>> recv_pending;
+	/// Datagrams of the current batch from a single source, handed to its transport at once
+	std::vector<core::Buffer> recv_run;
+
+	/// Is UDP GRO enabled on the socket?
+	bool enable_gro;
+	/// Duplicate of the socket descriptor, polled for reads if GRO is enabled
+	uv_os_fd_t gro_fd = -1;
+	uv_poll_t *gro_poll = nullptr;
+	UdpGroReader gro_reader;
+
+	/// SO_REUSEPORT group the socket joins, if any
+	UdpReusePort reuse_port;
+	/// Loop the socket is created on
+	LoopContext loop;
+
 	struct RecvPayload {
 		UdpTransportFactory<ListenDelegate, TransportDelegate> *factory;
 		ListenDelegate *delegate;
@@ -67,7 +117,17 @@ private:
 public:
 	using TransportFactoryScaffoldType::addr;
 
-	UdpTransportFactory();
+	/// Receives up to recv_batch_size datagrams per syscall using recvmmsg if greater than 1.
+	/// With enable_gro, trains of datagrams from a peer are received as one GRO super-datagram
+	/// where the kernel supports it, up to recv_batch_size of them per wakeup.
+	/// With reuse_port, the socket shares its address with one socket per loop shard.
+	/// The socket is created on the given loop, the calling thread's loop by default.
+	explicit UdpTransportFactory(
+		size_t recv_batch_size = 1,
+		bool enable_gro = false,
+		UdpReusePort reuse_port = {},
+		LoopContext loop = {}
+	);
 	~UdpTransportFactory();
 
 	UdpTransportFactory(UdpTransportFactory const&) = delete;
@@ -87,7 +147,17 @@ public:
 
 template<typename ListenDelegate, typename TransportDelegate>
 UdpTransportFactory<ListenDelegate, TransportDelegate>::
-UdpTransportFactory() {
+UdpTransportFactory(
+	size_t recv_batch_size,
+	bool enable_gro,
+	UdpReusePort reuse_port,
+	LoopContext loop
+) :
+	recv_batch_size(recv_batch_size),
+	recv_batch(recv_batch_size),
+	enable_gro(enable_gro),
+	reuse_port(reuse_port),
+	loop(loop) {
 	base_factory = new uvpp::UdpE();
 }
 
@@ -105,6 +175,13 @@ close_cb(uv_handle_t *handle) {
 template<typename ListenDelegate, typename TransportDelegate>
 UdpTransportFactory<ListenDelegate, TransportDelegate>::
 ~UdpTransportFactory() {
+	if(gro_poll != nullptr) {
+		uv_close((uv_handle_t *)gro_poll, [](uv_handle_t *handle) {
+			delete (uv_poll_t *)handle;
+		});
+		// Closing the poll handle already removed the descriptor from the loop
+		::close(gro_fd);
+	}
 	uv_close(
 		(uv_handle_t *)(uv_udp_t*)base_factory,
 		close_cb
@@ -122,9 +199,16 @@ UdpTransportFactory<ListenDelegate, TransportDelegate>::
 bind(core::SocketAddress const &addr) {
 	this->addr = addr;
 
-	uv_loop_t *loop = uv_default_loop();
+	unsigned int flags = AF_UNSPEC;
+	if(recv_batch_size > 1) {
+		flags |= UV_UDP_RECVMMSG;
+	}
+	if(reuse_port.is_enabled()) {
+		// Create the socket now so it can join the group before bind
+		flags |= addr.ss_family;
+	}
 
-	int res = uv_udp_init(loop, base_factory);
+	int res = uv_udp_init_ex(loop.get(), base_factory, flags);
 	if (res < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: Init error: {}",
@@ -134,6 +218,20 @@ bind(core::SocketAddress const &addr) {
 		return res;
 	}
 
+	uv_os_fd_t fd = -1;
+	if(reuse_port.is_enabled()) {
+		uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+		res = reuse_port.set_reuse_port(fd);
+		if (res < 0) {
+			SPDLOG_ERROR(
+				"Asyncio: Socket {}: Reuse port error: {}",
+				this->addr.to_string(),
+				res
+			);
+			return res;
+		}
+	}
+
 	res = uv_udp_bind(
 		base_factory,
 		reinterpret_cast<sockaddr const *>(&this->addr),
@@ -148,17 +246,33 @@ bind(core::SocketAddress const &addr) {
 		return res;
 	}
 
-	return 0;
-}
+	if(reuse_port.is_enabled()) {
+		res = reuse_port.attach_steering(fd, addr.ss_family);
+		if(res < 0) {
+			SPDLOG_WARN(
+				"Asyncio: Socket {}: Shard steering unavailable, kernel picks shards: {}",
+				this->addr.to_string(),
+				res
+			);
+		}
+	}
 
-template<typename ListenDelegate, typename TransportDelegate>
-void UdpTransportFactory<ListenDelegate, TransportDelegate>::naive_alloc_cb(
-	uv_handle_t *,
-	size_t suggested_size,
-	uv_buf_t *buf
-) {
-	buf->base = new char[suggested_size];
-	buf->len = suggested_size;
+	if(enable_gro) {
+		res = uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+		if(res == 0) {
+			res = UdpGroReader::enable(fd);
+		}
+		if(res < 0) {
+			SPDLOG_WARN(
+				"Asyncio: Socket {}: GRO unavailable: {}",
+				this->addr.to_string(),
+				res
+			);
+			enable_gro = false;
+		}
+	}
+
+	return 0;
 }
 
 //! callback on receiving a message on the socket
@@ -172,7 +286,7 @@ void UdpTransportFactory<ListenDelegate, TransportDelegate>::recv_cb(
 	ssize_t nread,
 	uv_buf_t const *buf,
 	sockaddr const *_addr,
-	unsigned
+	unsigned flags
 ) {
 	// Error
 	if(nread < 0) {
@@ -187,12 +301,22 @@ void UdpTransportFactory<ListenDelegate, TransportDelegate>::recv_cb(
 			nread
 		);
 
-		delete[] buf->base;
+		pooled_free(buf);
 		return;
 	}
 
 	if(nread == 0) {
-		delete[] buf->base;
+		pooled_free(buf);
+		return;
+	}
+
+	// Datagram did not fit in the receive buffer
+	if(flags & UV_UDP_PARTIAL) {
+		SPDLOG_WARN(
+			"Asyncio: Dropping truncated datagram from {}",
+			reinterpret_cast<core::SocketAddress const *>(_addr)->to_string()
+		);
+		pooled_free(buf);
 		return;
 	}
 
@@ -202,28 +326,221 @@ void UdpTransportFactory<ListenDelegate, TransportDelegate>::recv_cb(
 	auto &factory = *(payload->factory);
 	auto &delegate = *static_cast<ListenDelegate *>(payload->delegate);
 
-	auto *transport = factory.transport_manager.get(addr);
+	auto *transport = factory.accept_transport(addr, delegate);
+	if(transport == nullptr) {
+		pooled_free(buf);
+		return;
+	}
+
+	transport->did_recv(
+		handle,
+		pooled_recv_buffer(buf, nread)
+	);
+}
+
+//! finds the transport for the given address, creating one if the delegate accepts the peer
+/*!
+	\return transport, nullptr if the peer is not accepted
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+typename UdpTransportFactory<ListenDelegate, TransportDelegate>::SelfTransportType *
+UdpTransportFactory<ListenDelegate, TransportDelegate>::accept_transport(
+	core::SocketAddress const &addr,
+	ListenDelegate &delegate
+) {
+	auto *transport = transport_manager.get(addr);
 	if(transport == nullptr) {
 		// Create new transport if permitted
 		if(delegate.should_accept(addr)) {
-			transport = factory.transport_manager.get_or_create(
+			transport = transport_manager.get_or_create(
 				addr,
-				factory.addr,
+				this->addr,
 				addr,
-				factory.base_factory,
-				factory.transport_manager
+				base_factory,
+				transport_manager
 			).first;
 			delegate.did_create_transport(*transport);
-		} else {
-			delete[] buf->base;
-			return;
 		}
 	}
 
-	transport->did_recv(
-		handle,
-		core::Buffer((uint8_t*)buf->base, nread)
+	return transport;
+}
+
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::batch_alloc_cb(
+	uv_handle_t *handle,
+	size_t,
+	uv_buf_t *buf
+) {
+	auto payload = (RecvPayload *)handle->data;
+	payload->factory->recv_batch.alloc(buf);
+}
+
+//! callback on receiving a datagram in batched mode
+/*!
+	\li datagrams are copied out of the batch buffer and queued
+	\li queued datagrams are dispatched once libuv is done with the batch buffer
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::recv_batch_cb(
+	uv_udp_t *handle,
+	ssize_t nread,
+	uv_buf_t const *buf,
+	sockaddr const *_addr,
+	unsigned flags
+) {
+	auto payload = (RecvPayload *)handle->data;
+	auto &factory = *(payload->factory);
+	auto &delegate = *static_cast<ListenDelegate *>(payload->delegate);
+
+	// Batch done, buffer can be reused
+	if(flags & UV_UDP_MMSG_FREE) {
+		factory.recv_batch.free(buf);
+		factory.dispatch_batch(delegate);
+		return;
+	}
+
+	// Chunks are views into the batch buffer, anything else owns it
+	bool is_chunk = flags & UV_UDP_MMSG_CHUNK;
+
+	if(nread < 0) {
+		SPDLOG_ERROR(
+			"Asyncio: Socket {}: Recv callback error: {}",
+			factory.addr.to_string(),
+			nread
+		);
+	} else if(nread > 0 && (flags & UV_UDP_PARTIAL)) {
+		SPDLOG_WARN(
+			"Asyncio: Dropping truncated datagram from {}",
+			reinterpret_cast<core::SocketAddress const *>(_addr)->to_string()
+		);
+	} else if(nread > 0) {
+		factory.recv_pending.emplace_back(
+			*reinterpret_cast<core::SocketAddress const *>(_addr),
+			UdpRecvBatch::copy(buf, nread)
+		);
+	}
+
+	if(!is_chunk) {
+		factory.recv_batch.free(buf);
+		factory.dispatch_batch(delegate);
+	}
+}
+
+//! callback when the GRO socket is readable
+/*!
+	\li reads up to recv_batch_size super-datagrams and splits them into datagrams
+	\li queued datagrams are dispatched once the reads are done
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::gro_poll_cb(
+	uv_poll_t *handle,
+	int status,
+	int
+) {
+	auto &factory = *(SelfType *)handle->data;
+	auto payload = (RecvPayload *)factory.base_factory->data;
+	auto &delegate = *static_cast<ListenDelegate *>(payload->delegate);
+
+	if(status < 0) {
+		SPDLOG_ERROR(
+			"Asyncio: Socket {}: Recv callback error: {}",
+			factory.addr.to_string(),
+			status
+		);
+		return;
+	}
+
+	for(size_t i = 0; i < std::max<size_t>(factory.recv_batch_size, 1); i++) {
+		int res = factory.gro_reader.read(
+			factory.gro_fd,
+			[&](core::SocketAddress const &addr, core::Buffer &&packet) {
+				factory.recv_pending.emplace_back(addr, std::move(packet));
+			}
+		);
+		if(res < 0) {
+			if(res != UV_EAGAIN) {
+				SPDLOG_ERROR(
+					"Asyncio: Socket {}: Recv callback error: {}",
+					factory.addr.to_string(),
+					res
+				);
+			}
+			break;
+		}
+	}
+
+	factory.dispatch_batch(delegate);
+}
+
+//! hands the queued datagrams to their transports
+/*!
+	Datagrams are grouped by source so each transport is looked up once per batch,
+	order is preserved within a source.
+	Delegates with did_recv_batch get all datagrams from their peer in a single call.
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::dispatch_batch(
+	ListenDelegate &delegate
+) {
+	std::stable_sort(
+		recv_pending.begin(),
+		recv_pending.end(),
+		[](auto const &a, auto const &b) {
+			return a.first < b.first;
+		}
 	);
+
+	constexpr bool can_recv_batch = requires(
+		TransportDelegate &d,
+		SelfTransportType &t,
+		std::span<core::Buffer> packets
+	) {
+		d.did_recv_batch(t, packets);
+	};
+
+	if constexpr (can_recv_batch) {
+		for(size_t begin = 0, end = 0; begin < recv_pending.size(); begin = end) {
+			auto const &addr = recv_pending[begin].first;
+			for(end = begin + 1; end < recv_pending.size() && recv_pending[end].first == addr; end++) {}
+
+			auto *transport = accept_transport(addr, delegate);
+			if(transport == nullptr) {
+				continue;
+			}
+
+			for(auto i = begin; i < end; i++) {
+				recv_run.push_back(std::move(recv_pending[i].second));
+			}
+			transport->did_recv_batch(base_factory, recv_run);
+			recv_run.clear();
+		}
+	} else {
+		SelfTransportType *transport = nullptr;
+		core::SocketAddress const *transport_addr = nullptr;
+		uint64_t generation = 0;
+
+		for(auto &[addr, packet] : recv_pending) {
+			// Look up again on a new source or if any transport was erased meanwhile
+			if(
+				transport_addr == nullptr ||
+				!(addr == *transport_addr) ||
+				transport_manager.generation() != generation
+			) {
+				transport = accept_transport(addr, delegate);
+				transport_addr = &addr;
+				generation = transport_manager.generation();
+			}
+
+			if(transport == nullptr) {
+				continue;
+			}
+
+			transport->did_recv(base_factory, std::move(packet));
+		}
+	}
+
+	recv_pending.clear();
 }
 
 
@@ -239,11 +556,15 @@ listen(ListenDelegate &delegate) {
 		this,
 		&delegate
 	};
-	int res = uv_udp_recv_start(
-		base_factory,
-		naive_alloc_cb,
-		recv_cb
-	);
+
+	int res;
+	if(enable_gro) {
+		res = listen_gro();
+	} else if(recv_batch_size > 1) {
+		res = uv_udp_recv_start(base_factory, batch_alloc_cb, recv_batch_cb);
+	} else {
+		res = uv_udp_recv_start(base_factory, pooled_alloc_cb<DEFAULT_UDP_RECV_SIZE>, recv_cb);
+	}
 	if (res < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: Start recv error: {}",
@@ -258,6 +579,43 @@ listen(ListenDelegate &delegate) {
 	return 0;
 }
 
+//! starts polling a duplicate of the socket descriptor for GRO reads
+/*!
+	libuv does not deliver the GRO segment size and cannot watch a descriptor from two handles,
+	so reads bypass the udp handle while sends still go through it
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+int
+UdpTransportFactory<ListenDelegate, TransportDelegate>::
+listen_gro() {
+	if(gro_poll != nullptr) {
+		return 0;
+	}
+
+	uv_os_fd_t fd;
+	int res = uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+	if(res < 0) {
+		return res;
+	}
+
+	gro_fd = dup(fd);
+	if(gro_fd < 0) {
+		return -errno;
+	}
+
+	gro_poll = new uv_poll_t();
+	gro_poll->data = this;
+	res = uv_poll_init_socket(loop.get(), gro_poll, gro_fd);
+	if(res < 0) {
+		delete gro_poll;
+		gro_poll = nullptr;
+		::close(gro_fd);
+		return res;
+	}
+
+	return uv_poll_start(gro_poll, UV_READABLE, gro_poll_cb);
+}
+
 template<typename ListenDelegate, typename TransportDelegate>
 template<typename... Args>
 int
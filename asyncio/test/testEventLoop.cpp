@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "marlin/asyncio/core/EventLoop.hpp"
+#include "marlin/asyncio/core/Timer.hpp"
+#include "marlin/asyncio/udp/UdpTransportFactory.hpp"
+
+#include <thread>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+
+struct TimerDelegate {
+	uv_loop_t* fired_on = nullptr;
+	int count = 0;
+
+	void timer_cb() {
+		fired_on = EventLoop::loop();
+		count++;
+	}
+};
+
+TEST(EventLoop, RunsGivenLoop) {
+	uv_loop_t loop;
+	uv_loop_init(&loop);
+
+	{
+		TimerDelegate delegate;
+		Timer timer(&delegate, &loop);
+		timer.start<TimerDelegate, &TimerDelegate::timer_cb>(0, 0);
+
+		// Nothing to do on the default loop
+		EXPECT_EQ(uv_run(uv_default_loop(), UV_RUN_NOWAIT), 0);
+		EXPECT_EQ(delegate.count, 0);
+
+		EXPECT_EQ(EventLoop::run(&loop), 0);
+		EXPECT_EQ(delegate.count, 1);
+		EXPECT_EQ(delegate.fired_on, &loop);
+		EXPECT_EQ(EventLoop::loop(), uv_default_loop());
+	}
+
+	uv_run(&loop, UV_RUN_NOWAIT);
+	EXPECT_EQ(uv_loop_close(&loop), 0);
+}
+
+struct TransportDelegate {};
+
+struct ListenDelegate {
+	bool should_accept(SocketAddress const&) {
+		return true;
+	}
+
+	void did_create_transport(UdpTransport<TransportDelegate>&) {}
+};
+
+TEST(EventLoop, RunsIndependentLoopsOnThreads) {
+	uv_loop_t loops[2];
+	uint64_t fired[2] = {0, 0};
+
+	std::thread threads[2];
+	for(int i = 0; i < 2; i++) {
+		uv_loop_init(&loops[i]);
+		threads[i] = std::thread([&, i]() {
+			// Factory socket keeps the loop alive, stop it once the timer fired
+			uv_timer_t stop;
+			uv_timer_init(&loops[i], &stop);
+			uv_timer_start(&stop, [](uv_timer_t* handle) {
+				uv_stop(handle->loop);
+			}, 50, 0);
+
+			{
+				UdpTransportFactory<ListenDelegate, TransportDelegate> f(1, false, {}, &loops[i]);
+				EXPECT_EQ(f.bind(SocketAddress::loopback_ipv4(8040 + i)), 0);
+
+				TimerDelegate delegate;
+				Timer timer(&delegate, &loops[i]);
+				timer.start<TimerDelegate, &TimerDelegate::timer_cb>(10, 0);
+
+				EventLoop::run(&loops[i]);
+				fired[i] = delegate.count;
+				EXPECT_EQ(delegate.fired_on, &loops[i]);
+			}
+
+			uv_close((uv_handle_t*)&stop, nullptr);
+			uv_run(&loops[i], UV_RUN_NOWAIT);
+		});
+	}
+
+	for(int i = 0; i < 2; i++) {
+		threads[i].join();
+		EXPECT_EQ(fired[i], 1u);
+		EXPECT_EQ(uv_loop_close(&loops[i]), 0);
+	}
+}
@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "marlin/asyncio/core/LoopShards.hpp"
+#include "marlin/asyncio/udp/UdpTransportFactory.hpp"
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <map>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+
+struct TransportDelegate {
+	std::function<void(UdpTransport<TransportDelegate> &, Buffer &&)> did_recv;
+};
+
+struct ListenDelegate {
+	std::function<bool(SocketAddress const &)> should_accept;
+	std::function<void(UdpTransport<TransportDelegate> &)> did_create_transport;
+};
+
+TEST(LoopShards, SetsThreadLoop) {
+	LoopShards shards(2);
+
+	std::vector<uv_loop_t *> loops(2);
+	shards.start([&](size_t idx) {
+		loops[idx] = EventLoop::loop();
+	});
+	shards.stop();
+
+	EXPECT_EQ(loops[0], shards.loop(0));
+	EXPECT_EQ(loops[1], shards.loop(1));
+	EXPECT_EQ(EventLoop::loop(), uv_default_loop());
+}
+
+TEST(LoopShards, RunsPostedTasksInOrder) {
+	LoopShards shards(2);
+	shards.start([](size_t) {
+		EventLoop::run();
+	});
+
+	std::mutex m;
+	std::condition_variable cv;
+	std::vector<int> order;
+	std::thread::id shard_thread;
+
+	for(int i = 0; i < 100; i++) {
+		shards.post(1, [&, i]() {
+			std::lock_guard lock(m);
+			order.push_back(i);
+			shard_thread = std::this_thread::get_id();
+			cv.notify_one();
+		});
+	}
+
+	{
+		std::unique_lock lock(m);
+		EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&] { return order.size() == 100; }));
+	}
+	shards.stop();
+
+	for(int i = 0; i < 100; i++) {
+		EXPECT_EQ(order[i], i);
+	}
+	EXPECT_NE(shard_thread, std::this_thread::get_id());
+}
+
+TEST(LoopShards, SteersPeersToShards) {
+	constexpr size_t num_shards = 3;
+	constexpr size_t num_peers = 12;
+
+	LoopShards shards(num_shards);
+
+	std::mutex m;
+	std::condition_variable cv;
+	std::map<SocketAddress, size_t> peer_shards;
+
+	shards.start([&](size_t idx) {
+		UdpTransportFactory<ListenDelegate, TransportDelegate> f(1, false, UdpReusePort{idx, num_shards});
+		EXPECT_EQ(f.bind(SocketAddress::loopback_ipv4(8020)), 0);
+
+		TransportDelegate td;
+		td.did_recv = [&](UdpTransport<TransportDelegate> &transport, Buffer &&) {
+			std::lock_guard lock(m);
+			peer_shards[transport.dst_addr] = idx;
+			cv.notify_one();
+		};
+
+		ListenDelegate delegate;
+		delegate.should_accept = [](SocketAddress const &) {
+			return true;
+		};
+		delegate.did_create_transport = [&](UdpTransport<TransportDelegate> &t) {
+			t.setup(&td);
+		};
+		EXPECT_EQ(f.listen(delegate), 0);
+
+		EventLoop::run();
+	});
+
+	std::vector<int> fds;
+	auto dst = SocketAddress::loopback_ipv4(8020);
+	for(size_t i = 0; i < num_peers; i++) {
+		int fd = socket(AF_INET, SOCK_DGRAM, 0);
+		auto src = SocketAddress::loopback_ipv4(8030 + i);
+		ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr const *>(&src), sizeof(sockaddr_in)), 0);
+		EXPECT_EQ(sendto(fd, "x", 1, 0, reinterpret_cast<sockaddr const *>(&dst), sizeof(sockaddr_in)), 1);
+		fds.push_back(fd);
+	}
+
+	{
+		std::unique_lock lock(m);
+		EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&] { return peer_shards.size() == num_peers; }));
+	}
+	shards.stop();
+
+	for(auto &[addr, idx] : peer_shards) {
+		EXPECT_EQ(idx, shards.shard_of(addr));
+	}
+	for(auto fd : fds) {
+		close(fd);
+	}
+}
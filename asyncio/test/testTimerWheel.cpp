@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include "marlin/asyncio/core/TimerWheel.hpp"
+#include "marlin/asyncio/core/Timer.hpp"
+
+#include <random>
+#include <algorithm>
+#include <vector>
+
+using namespace marlin::asyncio;
+
+struct TestNode : TimerWheel::Node {
+	uint64_t fired_at = TimerWheel::NEVER;
+};
+
+TEST(TimerWheel, FiresAtExpiry) {
+	std::mt19937_64 rng(1);
+	TimerWheel wheel(1000);
+
+	std::vector<TestNode> nodes(5000);
+	for(size_t i = 0; i < nodes.size(); i++) {
+		uint64_t delay = i % 10 == 0 ? rng() % 5000000000 : rng() % 300000;
+		wheel.insert(nodes[i], 1000 + delay);
+	}
+
+	uint64_t now = 1000;
+	uint64_t last_expiry = 0;
+	while(!wheel.empty()) {
+		uint64_t next = wheel.next_event();
+		for(auto& node : nodes) {
+			if(node.is_linked()) {
+				EXPECT_LE(next, node.expiry);
+			}
+		}
+
+		now = std::max(now + 1 + rng() % 20000, next);
+		wheel.advance(now, [&](TimerWheel::Node& n) {
+			auto& node = static_cast<TestNode&>(n);
+			EXPECT_LE(node.expiry, now);
+			EXPECT_GE(node.expiry, last_expiry);
+			last_expiry = node.expiry;
+			node.fired_at = now;
+		});
+
+		// Anything still pending is not due yet
+		for(auto& node : nodes) {
+			if(node.is_linked()) {
+				EXPECT_GT(node.expiry, now);
+			}
+		}
+	}
+
+	for(auto& node : nodes) {
+		EXPECT_NE(node.fired_at, TimerWheel::NEVER);
+	}
+}
+
+TEST(TimerWheel, RemovesAndReschedules) {
+	TimerWheel wheel(0);
+	TestNode a, b, c;
+
+	wheel.insert(a, 100);
+	wheel.insert(b, 100);
+	wheel.insert(c, 5000);
+	wheel.remove(b);
+	wheel.insert(c, 50);
+	EXPECT_EQ(wheel.next_event(), 50u);
+
+	std::vector<TimerWheel::Node*> fired;
+	wheel.advance(100, [&](TimerWheel::Node& node) {
+		fired.push_back(&node);
+		if(&node == &c) {
+			// Rescheduled into the past, fires on the next advance
+			wheel.insert(c, 10);
+			// Still pending in the same tick
+			wheel.remove(a);
+		}
+	});
+	ASSERT_EQ(fired.size(), 1u);
+	EXPECT_EQ(fired[0], &c);
+	EXPECT_FALSE(a.is_linked());
+	EXPECT_FALSE(b.is_linked());
+	EXPECT_EQ(wheel.next_event(), 0u);
+
+	wheel.advance(100, [&](TimerWheel::Node& node) {
+		fired.push_back(&node);
+	});
+	ASSERT_EQ(fired.size(), 2u);
+	EXPECT_EQ(fired[1], &c);
+	EXPECT_TRUE(wheel.empty());
+	EXPECT_EQ(wheel.next_event(), TimerWheel::NEVER);
+}
+
+struct TimerDelegate {
+	Timer* timer = nullptr;
+	Timer* other = nullptr;
+	int count = 0;
+
+	void timer_cb() {
+		count++;
+		if(count == 3) {
+			timer->stop();
+			other->stop();
+		}
+	}
+
+	void other_cb() {
+		ADD_FAILURE();
+	}
+};
+
+TEST(TimerWheel, DrivesTimers) {
+	uv_loop_t loop;
+	uv_loop_init(&loop);
+
+	{
+		TimerDelegate delegate;
+		Timer timer(&delegate, &loop);
+		Timer other(&delegate, &loop);
+		delegate.timer = &timer;
+		delegate.other = &other;
+
+		uint64_t start = EventLoop::now(&loop);
+		timer.start<TimerDelegate, &TimerDelegate::timer_cb>(5, 5);
+		other.start<TimerDelegate, &TimerDelegate::other_cb>(1000, 0);
+
+		EXPECT_EQ(EventLoop::run(&loop), 0);
+		EXPECT_EQ(delegate.count, 3);
+		EXPECT_GE(EventLoop::now(&loop) - start, 15u);
+		EXPECT_LT(EventLoop::now(&loop) - start, 1000u);
+	}
+
+	uv_run(&loop, UV_RUN_NOWAIT);
+	EXPECT_EQ(uv_loop_close(&loop), 0);
+}
+
+struct CountingDelegate {
+	Timer* timer = nullptr;
+	int count = 0;
+
+	void timer_cb() {
+		count++;
+		if(count == 10) {
+			timer->stop();
+		}
+	}
+};
+
+TEST(TimerWheel, FiresBelowMillisecond) {
+	uv_loop_t loop;
+	uv_loop_init(&loop);
+
+	{
+		CountingDelegate delegate;
+		Timer timer(&delegate, &loop);
+		delegate.timer = &timer;
+
+		uint64_t start = EventLoop::now_us();
+		timer.start_us<CountingDelegate, &CountingDelegate::timer_cb>(200, 200);
+
+		EXPECT_EQ(EventLoop::run(&loop), 0);
+		EXPECT_EQ(delegate.count, 10);
+		EXPECT_GE(EventLoop::now_us() - start, 2000u);
+		EXPECT_LT(EventLoop::now_us() - start, 8000u);
+	}
+
+	uv_run(&loop, UV_RUN_NOWAIT);
+	EXPECT_EQ(uv_loop_close(&loop), 0);
+}
@@ -2,6 +2,9 @@
 #include "marlin/asyncio/udp/UdpTransportFactory.hpp"
 
 #include <functional>
+#include <span>
+#include <map>
+#include <vector>
 
 using namespace marlin::core;
 using namespace marlin::asyncio;
@@ -150,3 +153,225 @@ TEST(UdpTransportFactory, CanDial) {
 	EXPECT_TRUE(did_call_f_delegate);
 	EXPECT_TRUE(did_call_t_delegate);
 }
+
+TEST(UdpTransportFactory, CanRecvBatched) {
+	UdpTransportFactory<ListenDelegate, TransportDelegate> f(8);
+	EXPECT_EQ(f.bind(SocketAddress::loopback_ipv4(8002)), 0);
+
+	std::map<SocketAddress, std::vector<uint8_t>> received;
+	size_t num_received = 0;
+
+	TransportDelegate td;
+	td.did_recv = [&] (UdpTransport<TransportDelegate> &transport, Buffer &&packet) {
+		EXPECT_EQ(packet.size(), 100);
+		received[transport.dst_addr].push_back(packet.read_uint8_unsafe(0));
+		if(++num_received == 20) {
+			uv_stop(uv_default_loop());
+		}
+	};
+
+	ListenDelegate delegate;
+	delegate.should_accept = [] (SocketAddress const &) {
+		return true;
+	};
+	delegate.did_create_transport = [&] (UdpTransport<TransportDelegate> &t) {
+		t.setup(&td);
+	};
+
+	EXPECT_EQ(f.listen(delegate), 0);
+
+	// Interleave datagrams from two sources
+	uv_udp_t senders[2];
+	for(auto &sender : senders) {
+		uv_udp_init(uv_default_loop(), &sender);
+		auto addr = SocketAddress::loopback_ipv4(0);
+		uv_udp_bind(&sender, reinterpret_cast<sockaddr const *>(&addr), 0);
+	}
+	auto dst = SocketAddress::loopback_ipv4(8002);
+	for(uint8_t i = 0; i < 10; i++) {
+		for(auto &sender : senders) {
+			Buffer packet(100);
+			packet.write_uint8_unsafe(0, i);
+			auto buf = uv_buf_init((char*)packet.data(), packet.size());
+			EXPECT_EQ(uv_udp_try_send(&sender, &buf, 1, reinterpret_cast<sockaddr const *>(&dst)), 100);
+		}
+	}
+
+	uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+	EXPECT_EQ(num_received, 20);
+	EXPECT_EQ(received.size(), 2);
+	for(auto &[addr, ids] : received) {
+		EXPECT_EQ(ids, std::vector<uint8_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+	}
+
+	for(auto &sender : senders) {
+		uv_close((uv_handle_t*)&sender, nullptr);
+	}
+	// Finish closing before the handles go out of scope
+	uv_run(uv_default_loop(), UV_RUN_NOWAIT);
+}
+
+TEST(UdpTransportFactory, CanSendCorked) {
+	UdpTransportFactory<ListenDelegate, TransportDelegate> f1, f2;
+	EXPECT_EQ(f1.bind(SocketAddress::loopback_ipv4(8003)), 0);
+	EXPECT_EQ(f2.bind(SocketAddress::loopback_ipv4(8004)), 0);
+
+	std::vector<std::pair<uint8_t, size_t>> received;
+	size_t num_sent = 0;
+
+	TransportDelegate td;
+	td.did_recv = [&] (UdpTransport<TransportDelegate> &, Buffer &&packet) {
+		received.emplace_back(packet.read_uint8_unsafe(0), packet.size());
+		if(received.size() == 31) {
+			uv_stop(uv_default_loop());
+		}
+	};
+	td.did_send = [&] (UdpTransport<TransportDelegate> &, Buffer &&) {
+		num_sent++;
+	};
+	td.did_dial = [&] (UdpTransport<TransportDelegate> &t) {
+		t.cork();
+		for(uint8_t i = 0; i < 31; i++) {
+			Buffer packet(i == 30 ? 300 : 1000);
+			packet.write_uint8_unsafe(0, i);
+			EXPECT_EQ(t.send(std::move(packet)), 0);
+		}
+		EXPECT_EQ(num_sent, 0);
+		t.uncork();
+	};
+
+	ListenDelegate delegate;
+	delegate.should_accept = [] (SocketAddress const &) {
+		return true;
+	};
+	delegate.did_create_transport = [&] (UdpTransport<TransportDelegate> &t) {
+		t.setup(&td);
+	};
+
+	EXPECT_EQ(f1.listen(delegate), 0);
+	EXPECT_EQ(f2.dial(SocketAddress::loopback_ipv4(8003), delegate), 1);
+
+	uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+	EXPECT_EQ(num_sent, 31);
+	EXPECT_EQ(received.size(), 31);
+	for(uint8_t i = 0; i < received.size(); i++) {
+		EXPECT_EQ(received[i].first, i);
+		EXPECT_EQ(received[i].second, i == 30 ? 300 : 1000);
+	}
+}
+
+TEST(UdpTransportFactory, CanRecvGro) {
+	UdpTransportFactory<ListenDelegate, TransportDelegate> f1(1, true), f2;
+	EXPECT_EQ(f1.bind(SocketAddress::loopback_ipv4(8005)), 0);
+	EXPECT_EQ(f2.bind(SocketAddress::loopback_ipv4(8006)), 0);
+
+	std::vector<std::pair<uint8_t, size_t>> received;
+
+	TransportDelegate td;
+	td.did_recv = [&] (UdpTransport<TransportDelegate> &, Buffer &&packet) {
+		received.emplace_back(packet.read_uint8_unsafe(0), packet.size());
+		if(received.size() == 62) {
+			uv_stop(uv_default_loop());
+		}
+	};
+	td.did_send = [&] (UdpTransport<TransportDelegate> &, Buffer &&) {};
+	td.did_dial = [&] (UdpTransport<TransportDelegate> &t) {
+		// Two trains, sent as GSO super-datagrams where supported
+		for(uint8_t train = 0; train < 2; train++) {
+			t.cork();
+			for(uint8_t i = 0; i < 31; i++) {
+				Buffer packet(i == 30 ? 300 : 1000);
+				packet.write_uint8_unsafe(0, train * 31 + i);
+				t.send(std::move(packet));
+			}
+			t.uncork();
+		}
+	};
+
+	ListenDelegate delegate;
+	delegate.should_accept = [] (SocketAddress const &) {
+		return true;
+	};
+	delegate.did_create_transport = [&] (UdpTransport<TransportDelegate> &t) {
+		t.setup(&td);
+	};
+
+	EXPECT_EQ(f1.listen(delegate), 0);
+	EXPECT_EQ(f2.dial(SocketAddress::loopback_ipv4(8005), delegate), 1);
+
+	uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+	EXPECT_EQ(received.size(), 62);
+	for(uint8_t i = 0; i < received.size(); i++) {
+		EXPECT_EQ(received[i].first, i);
+		EXPECT_EQ(received[i].second, i % 31 == 30 ? 300 : 1000);
+	}
+}
+
+struct BatchTransportDelegate {
+	std::function<void(UdpTransport<BatchTransportDelegate> &, std::span<Buffer>)> did_recv_batch;
+	std::function<void(UdpTransport<BatchTransportDelegate> &, Buffer &&)> did_recv;
+	std::function<void(UdpTransport<BatchTransportDelegate> &, Buffer &&)> did_send;
+	std::function<void(UdpTransport<BatchTransportDelegate> &)> did_dial;
+};
+
+struct BatchListenDelegate {
+	std::function<bool(SocketAddress const &)> should_accept;
+	std::function<void(UdpTransport<BatchTransportDelegate> &)> did_create_transport;
+};
+
+TEST(UdpTransportFactory, CanRecvBatchInOneCall) {
+	UdpTransportFactory<BatchListenDelegate, BatchTransportDelegate> f(8);
+	EXPECT_EQ(f.bind(SocketAddress::loopback_ipv4(8007)), 0);
+
+	std::vector<uint8_t> received;
+	size_t num_calls = 0;
+
+	BatchTransportDelegate td;
+	td.did_recv_batch = [&] (UdpTransport<BatchTransportDelegate> &, std::span<Buffer> packets) {
+		num_calls++;
+		for(auto &packet : packets) {
+			received.push_back(packet.read_uint8_unsafe(0));
+		}
+		if(received.size() == 8) {
+			uv_stop(uv_default_loop());
+		}
+	};
+	td.did_recv = [&] (UdpTransport<BatchTransportDelegate> &, Buffer &&) {
+		ADD_FAILURE();
+	};
+
+	BatchListenDelegate delegate;
+	delegate.should_accept = [] (SocketAddress const &) {
+		return true;
+	};
+	delegate.did_create_transport = [&] (UdpTransport<BatchTransportDelegate> &t) {
+		t.setup(&td);
+	};
+
+	EXPECT_EQ(f.listen(delegate), 0);
+
+	uv_udp_t sender;
+	uv_udp_init(uv_default_loop(), &sender);
+	auto src = SocketAddress::loopback_ipv4(0);
+	uv_udp_bind(&sender, reinterpret_cast<sockaddr const *>(&src), 0);
+
+	auto dst = SocketAddress::loopback_ipv4(8007);
+	for(uint8_t i = 0; i < 8; i++) {
+		Buffer packet(100);
+		packet.write_uint8_unsafe(0, i);
+		auto buf = uv_buf_init((char*)packet.data(), packet.size());
+		EXPECT_EQ(uv_udp_try_send(&sender, &buf, 1, reinterpret_cast<sockaddr const *>(&dst)), 100);
+	}
+
+	uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+	// All queued before the socket is read, so one recvmmsg picks them up
+	EXPECT_EQ(num_calls, 1);
+	EXPECT_EQ(received, std::vector<uint8_t>({0, 1, 2, 3, 4, 5, 6, 7}));
+
+	uv_close((uv_handle_t*)&sender, nullptr);
+	uv_run(uv_default_loop(), UV_RUN_NOWAIT);
+}
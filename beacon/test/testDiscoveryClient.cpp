@@ -74,7 +74,7 @@ TEST_F(DefaultNetworkFixture, DiscoversPeers) {
 		EXPECT_EQ(packet.read_uint8(0), 0);  // Version
 		EXPECT_EQ(packet.read_uint8(1), 2);  // DISCPEER
 
-		if(simulator.current_tick() > 100000) {
+		if(simulator.current_tick() > 100000 * simulator.ticks_per_ms) {
 			client.close();
 		}
 	};
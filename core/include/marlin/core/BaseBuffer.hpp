@@ -58,6 +58,16 @@ public:
 		return end_index - start_index;
 	}
 
+	/// Number of bytes that can be uncovered before the start of buffer
+	inline size_t headroom() const {
+		return start_index;
+	}
+
+	/// Number of bytes that can be expanded after the end of buffer
+	inline size_t tailroom() const {
+		return capacity - end_index;
+	}
+
 	/// @name Bounds change
 	/// @{
 
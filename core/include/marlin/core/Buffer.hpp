@@ -5,13 +5,20 @@
 #define MARLIN_CORE_BUFFER_HPP
 
 #include "marlin/core/WeakBuffer.hpp"
+#include "marlin/core/BufferPool.hpp"
 
 namespace marlin {
 namespace core {
 
+class SharedBuffer;
+
 /// @brief Byte buffer implementation with modifiable bounds and memory ownership
 /// @headerfile Buffer.hpp <marlin/core/Buffer.hpp>
 class Buffer : public BaseBuffer<Buffer> {
+	friend class SharedBuffer;
+
+	/// Was the memory obtained from BufferPool?
+	bool is_pooled = false;
 public:
 	using BaseBuffer<Buffer>::BaseBuffer;
 
@@ -27,6 +34,13 @@ public:
 	/// Construct from uint8_t array - unsafe if uint8_t * isn't obtained from new
 	Buffer(uint8_t *buf, size_t size);
 
+	/// Construct from memory obtained from BufferPool::allocate(size), returns it to the pool on destruction
+	static Buffer from_pool(uint8_t *buf, size_t size);
+
+	/// Construct with given size and spare bytes reserved before and after it.
+	/// Lower layers can uncover() the headroom to prepend headers without copying.
+	static Buffer with_headroom(size_t size, size_t headroom, size_t tailroom = 0);
+
 	/// Move contructor
 	Buffer(Buffer &&b) noexcept;
 
@@ -51,14 +65,19 @@ public:
 		return WeakBuffer((uint8_t*)data(), size());
 	}
 
-	/// Release the memory held by the buffer
+	/// Release the memory held by the buffer, caller frees it with delete[]
 	inline uint8_t *release() {
 		uint8_t *_buf = buf;
 
+		if(is_pooled) {
+			BufferPool::disown(capacity);
+		}
+
 		buf = nullptr;
 		capacity = 0;
 		start_index = 0;
 		end_index = 0;
+		is_pooled = false;
 
 		return _buf;
 	}
@@ -0,0 +1,97 @@
+/*! \file BufferChain.hpp
+*/
+
+#ifndef MARLIN_CORE_BUFFERCHAIN_HPP
+#define MARLIN_CORE_BUFFERCHAIN_HPP
+
+#include "marlin/core/SharedBuffer.hpp"
+#include <absl/container/inlined_vector.h>
+
+namespace marlin {
+namespace core {
+
+/// @brief Sequence of buffers sent as one message without gathering them into contiguous memory
+/// @details Each segment holds a reference to its memory, so headers and payloads
+/// can live in separate allocations and be gathered by the kernel on send.
+/// Owned buffers appended to the chain are adopted without copying.
+/// @headerfile BufferChain.hpp <marlin/core/BufferChain.hpp>
+class BufferChain {
+public:
+	/// Number of segments stored without a heap allocation
+	static constexpr size_t inline_segments = 4;
+private:
+	using SegmentsType = absl::InlinedVector<SharedBuffer, inline_segments>;
+
+	/// Segments in order
+	SegmentsType segments;
+	/// Total bytes in all segments
+	size_t total_size = 0;
+public:
+	/// Construct empty chain
+	BufferChain() = default;
+
+	/// Construct with a single segment
+	explicit BufferChain(SharedBuffer &&segment);
+
+	/// Total bytes in all segments
+	size_t size() const {
+		return total_size;
+	}
+
+	/// Number of segments
+	size_t num_segments() const {
+		return segments.size();
+	}
+
+	/// Segment at given index
+	SharedBuffer &segment(size_t idx) {
+		return segments[idx];
+	}
+
+	SharedBuffer const &segment(size_t idx) const {
+		return segments[idx];
+	}
+
+	/// Segment iterators
+	SegmentsType::iterator begin() {
+		return segments.begin();
+	}
+
+	SegmentsType::iterator end() {
+		return segments.end();
+	}
+
+	SegmentsType::const_iterator begin() const {
+		return segments.begin();
+	}
+
+	SegmentsType::const_iterator end() const {
+		return segments.end();
+	}
+
+	/// Add segment at the end
+	BufferChain &append(SharedBuffer &&segment) &;
+	BufferChain &&append(SharedBuffer &&segment) &&;
+
+	/// Add segment at the start
+	BufferChain &prepend(SharedBuffer &&segment) &;
+	BufferChain &&prepend(SharedBuffer &&segment) &&;
+
+	/// Remove and return the first segment
+	SharedBuffer pop_front();
+
+	/// Get a chain for the given byte range, shares memory with this chain
+	BufferChain slice(size_t pos, size_t size) const;
+
+	/// Copy bytes starting at given position without bounds checking
+	void read_unsafe(size_t pos, uint8_t *out, size_t size) const;
+
+	/// Convert to Buffer, consumes the chain.
+	/// Does not copy if the chain has a single segment that is the only copy referencing its memory.
+	Buffer flatten() &&;
+};
+
+} // namespace core
+} // namespace marlin
+
+#endif // MARLIN_CORE_BUFFERCHAIN_HPP
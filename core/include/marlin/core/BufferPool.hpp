@@ -0,0 +1,95 @@
+/*! \file BufferPool.hpp
+*/
+
+#ifndef MARLIN_CORE_BUFFERPOOL_HPP
+#define MARLIN_CORE_BUFFERPOOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <atomic>
+
+namespace marlin {
+namespace core {
+
+/// @brief Size class allocator backing Buffer memory
+/// @details Requests are rounded up to power of two size classes and released blocks
+/// are cached on a free list per class. Each thread (and hence each event loop)
+/// has its own free lists, so no locking is involved.
+/// Every block is a plain new[] allocation, so memory from the pool can always be
+/// released with delete[], on any thread, including after the pool is gone.
+/// Requests larger than the largest class bypass the pool.
+/// @headerfile BufferPool.hpp <marlin/core/BufferPool.hpp>
+class BufferPool {
+public:
+	/// Smallest size class
+	static constexpr size_t min_block_size = 64;
+	/// Largest size class
+	static constexpr size_t max_block_size = 65536;
+	/// Number of size classes
+	static constexpr size_t num_classes = 11;
+	/// Max bytes cached on the free list of a single size class
+	static constexpr size_t max_cached_bytes = 4*1024*1024;
+
+	/// Pool counters, per thread except for in_use_bytes
+	struct Stats {
+		/// Allocations served from a free list
+		uint64_t hits = 0;
+		/// Allocations of a size class that needed fresh memory
+		uint64_t misses = 0;
+		/// Allocations too large for any size class
+		uint64_t oversized = 0;
+		/// Bytes of size class blocks handed out and not yet returned, across all threads
+		/// since blocks are often freed on a different thread than the one they were allocated on
+		int64_t in_use_bytes = 0;
+		/// Bytes of size class blocks cached on free lists
+		int64_t cached_bytes = 0;
+
+		/// Memory held through the pool
+		int64_t footprint() const {
+			return in_use_bytes + cached_bytes;
+		}
+	};
+
+	/// Allocate at least size bytes
+	static uint8_t *allocate(size_t size);
+	/// Release memory obtained from allocate, size must match the one used to allocate
+	static void deallocate(uint8_t *buf, size_t size);
+
+	/// Stop accounting for memory obtained from allocate which is freed with delete[] instead of deallocate
+	static void disown(size_t size);
+
+	/// Size of the block backing an allocation of the given size
+	static size_t block_size(size_t size);
+
+	/// Counters of the calling thread's pool
+	static Stats stats();
+
+	/// Free all cached blocks of the calling thread's pool
+	static void trim();
+
+	~BufferPool();
+private:
+	/// Intrusive free list node, stored in the free block itself
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+
+	std::array<FreeBlock *, num_classes> free_lists = {};
+	std::array<size_t, num_classes> free_counts = {};
+	Stats counters;
+
+	/// Bytes of size class blocks in use, shared by all threads
+	static std::atomic<int64_t> in_use_bytes;
+
+	BufferPool() = default;
+	BufferPool(BufferPool const&) = delete;
+
+	static BufferPool *local();
+	static size_t class_index(size_t size);
+};
+
+} // namespace core
+} // namespace marlin
+
+#endif // MARLIN_CORE_BUFFERPOOL_HPP
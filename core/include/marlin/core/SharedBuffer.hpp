@@ -0,0 +1,85 @@
+/*! \file SharedBuffer.hpp
+*/
+
+#ifndef MARLIN_CORE_SHAREDBUFFER_HPP
+#define MARLIN_CORE_SHAREDBUFFER_HPP
+
+#include "marlin/core/Buffer.hpp"
+#include <atomic>
+
+namespace marlin {
+namespace core {
+
+/// @brief Byte buffer implementation with modifiable bounds and reference counted memory ownership
+/// @details Copies are cheap and share the underlying memory, bounds are per copy.
+/// Covering or truncating a copy never affects the others, writing does.
+/// Call unshare() before writing to get a private copy of the memory if needed.
+/// @headerfile SharedBuffer.hpp <marlin/core/SharedBuffer.hpp>
+class SharedBuffer : public BaseBuffer<SharedBuffer> {
+private:
+	/// Reference count shared by all copies, nullptr if empty
+	std::atomic<uint32_t> *refs;
+	/// Was the memory obtained from BufferPool?
+	bool is_pooled;
+
+	/// Drop reference to the memory, freeing it if this was the last copy
+	void reset();
+public:
+	/// Construct with given size - preferred constructor
+	SharedBuffer(size_t size);
+
+	/// Construct with initializer list and given size - preferred constructor
+	SharedBuffer(std::initializer_list<uint8_t> il, size_t size);
+
+	/// Take ownership of memory held by Buffer, preserves bounds, does not copy
+	SharedBuffer(Buffer &&b);
+
+	/// Copy constructor, shares memory
+	SharedBuffer(SharedBuffer const &b);
+
+	/// Move contructor
+	SharedBuffer(SharedBuffer &&b) noexcept;
+
+	/// Copy assign, shares memory
+	SharedBuffer &operator=(SharedBuffer const &b);
+
+	/// Move assign
+	SharedBuffer &operator=(SharedBuffer &&b) noexcept;
+
+	~SharedBuffer();
+
+	/// Get a copy sharing the same memory
+	SharedBuffer clone() const {
+		return *this;
+	}
+
+	/// Number of copies sharing the memory
+	uint32_t use_count() const;
+
+	/// Is this the only copy referencing the memory?
+	bool is_unique() const {
+		return use_count() == 1;
+	}
+
+	/// Copy the bytes in bounds to memory owned by this copy alone, no-op if already unique
+	SharedBuffer &unshare() &;
+
+	/// Convert to Buffer, consumes the existing object.
+	/// Does not copy if this is the only copy referencing the memory.
+	Buffer to_buffer() &&;
+
+	/// Implicit conversion to WeakBuffer
+	operator WeakBuffer() {
+		return WeakBuffer(data(), size());
+	}
+
+	operator WeakBuffer const() const {
+		// Note: Const stripping, but safe since return value is const
+		return WeakBuffer((uint8_t*)data(), size());
+	}
+};
+
+} // namespace core
+} // namespace marlin
+
+#endif // MARLIN_CORE_SHAREDBUFFER_HPP
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -79,9 +80,33 @@ namespace std {
 	struct hash<marlin::core::SocketAddress>
 	{
 		/// Hash function for SocketAddress so it can be used as a key
+		/// Covers the same fields as equality, IPv6 addresses in full, and mixes every bit of them
 		size_t operator()(const marlin::core::SocketAddress &addr) const
 		{
-			return std::hash<uint32_t>()(reinterpret_cast<const sockaddr_in *>(&addr)->sin_addr.s_addr) ^ std::hash<uint16_t>()(reinterpret_cast<const sockaddr_in *>(&addr)->sin_port);
+			uint64_t hash;
+			if(addr.ss_family == AF_INET6) {
+				auto const &addr6 = reinterpret_cast<const sockaddr_in6 &>(addr);
+				uint64_t high, low;
+				std::memcpy(&high, addr6.sin6_addr.s6_addr, 8);
+				std::memcpy(&low, addr6.sin6_addr.s6_addr + 8, 8);
+				hash = mix(mix(high ^ AF_INET6) ^ low) ^ addr6.sin6_port;
+			} else {
+				auto const &addr4 = reinterpret_cast<const sockaddr_in &>(addr);
+				hash = ((uint64_t)addr4.sin_addr.s_addr << 16) | addr4.sin_port;
+			}
+
+			return mix(hash);
+		}
+
+	private:
+		/// Finalizer of splitmix64, every input bit affects every output bit
+		static uint64_t mix(uint64_t x) {
+			x ^= x >> 30;
+			x *= 0xbf58476d1ce4e5b9ULL;
+			x ^= x >> 27;
+			x *= 0x94d049bb133111ebULL;
+			x ^= x >> 31;
+			return x;
 		}
 	};
 }
@@ -19,6 +19,8 @@ class TransportManager {
 		SocketAddress,
 		std::unique_ptr<TransportType>
 	> transport_map;
+	/// Number of erase calls so far
+	uint64_t erase_count = 0;
 
 	// Prevent copy, causes subtle bugs with objects holding onto different instances because of implicit copy somewhere
 	TransportManager(TransportManager const&) = delete;
@@ -53,8 +55,21 @@ public:
 
 	/// Remove transport with the given destination address
 	void erase(SocketAddress const &addr) {
+		erase_count++;
 		transport_map.erase(addr);
 	}
+
+	/// Exchange the transports stored against two addresses, both must be present
+	void swap(SocketAddress const &addr, SocketAddress const &other) {
+		erase_count++;
+		std::swap(transport_map[addr], transport_map[other]);
+	}
+
+	/// Changes whenever a transport is erased or moved,
+	/// lets callers holding on to a transport pointer detect that it might be gone
+	uint64_t generation() const {
+		return erase_count;
+	}
 };
 
 } // namespace core
@@ -14,6 +14,8 @@ struct BaseMessage {
 
 	/// Construct from size
 	BaseMessage(size_t size);
+	/// Construct from size, reserving headroom for lower layers to prepend headers in place
+	BaseMessage(size_t size, size_t headroom);
 	/// Construct from a buffer
 	BaseMessage(Buffer&& buf);
 	/// Implicit conversion to a buffer
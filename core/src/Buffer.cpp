@@ -8,10 +8,10 @@ namespace marlin {
 namespace core {
 
 Buffer::Buffer(size_t size) :
-BaseBuffer(new uint8_t[size], size) {}
+BaseBuffer(BufferPool::allocate(size), size), is_pooled(true) {}
 
 Buffer::Buffer(std::initializer_list<uint8_t> il, size_t size) :
-BaseBuffer(new uint8_t[size], size) {
+BaseBuffer(BufferPool::allocate(size), size), is_pooled(true) {
 	assert(il.size() <= size);
 	std::copy(il.begin(), il.end(), buf);
 }
@@ -19,34 +19,59 @@ BaseBuffer(new uint8_t[size], size) {
 Buffer::Buffer(uint8_t *buf, size_t size) :
 BaseBuffer(buf, size) {}
 
+Buffer Buffer::from_pool(uint8_t *buf, size_t size) {
+	Buffer b(buf, size);
+	b.is_pooled = true;
+
+	return b;
+}
+
+Buffer Buffer::with_headroom(size_t size, size_t headroom, size_t tailroom) {
+	Buffer b(headroom + size + tailroom);
+	b.cover_unsafe(headroom).truncate_unsafe(tailroom);
+
+	return b;
+}
+
 Buffer::Buffer(Buffer &&b) noexcept :
-BaseBuffer(static_cast<BaseBuffer&&>(std::move(b))) {
+BaseBuffer(static_cast<BaseBuffer&&>(std::move(b))), is_pooled(b.is_pooled) {
 	b.buf = nullptr;
 	b.capacity = 0;
 	b.start_index = 0;
 	b.end_index = 0;
+	b.is_pooled = false;
 }
 
 Buffer &Buffer::operator=(Buffer &&b) noexcept {
 	// Destroy old
-	delete[] buf;
+	if(is_pooled) {
+		BufferPool::deallocate(buf, capacity);
+	} else {
+		delete[] buf;
+	}
 
 	// Assign from new
 	buf = b.buf;
 	capacity = b.capacity;
 	start_index = b.start_index;
 	end_index = b.end_index;
+	is_pooled = b.is_pooled;
 
 	b.buf = nullptr;
 	b.capacity = 0;
 	b.start_index = 0;
 	b.end_index = 0;
+	b.is_pooled = false;
 
 	return *this;
 }
 
 Buffer::~Buffer() {
-	delete[] buf;
+	if(is_pooled) {
+		BufferPool::deallocate(buf, capacity);
+	} else {
+		delete[] buf;
+	}
 }
 
 WeakBuffer Buffer::payload_buffer() & {
@@ -0,0 +1,112 @@
+#include "marlin/core/BufferChain.hpp"
+#include <cassert>
+#include <algorithm>
+
+namespace marlin {
+namespace core {
+
+BufferChain::BufferChain(SharedBuffer &&segment) {
+	append(std::move(segment));
+}
+
+BufferChain &BufferChain::append(SharedBuffer &&segment) & {
+	total_size += segment.size();
+	segments.push_back(std::move(segment));
+
+	return *this;
+}
+
+BufferChain &&BufferChain::append(SharedBuffer &&segment) && {
+	return std::move(append(std::move(segment)));
+}
+
+BufferChain &BufferChain::prepend(SharedBuffer &&segment) & {
+	total_size += segment.size();
+	segments.insert(segments.begin(), std::move(segment));
+
+	return *this;
+}
+
+BufferChain &&BufferChain::prepend(SharedBuffer &&segment) && {
+	return std::move(prepend(std::move(segment)));
+}
+
+SharedBuffer BufferChain::pop_front() {
+	assert(!segments.empty());
+
+	SharedBuffer segment = std::move(segments.front());
+	segments.erase(segments.begin());
+	total_size -= segment.size();
+
+	return segment;
+}
+
+BufferChain BufferChain::slice(size_t pos, size_t size) const {
+	assert(total_size >= size && total_size - size >= pos);
+
+	BufferChain chain;
+	for(auto const &segment : segments) {
+		if(size == 0) {
+			break;
+		}
+
+		if(pos >= segment.size()) {
+			pos -= segment.size();
+			continue;
+		}
+
+		auto length = std::min(segment.size() - pos, size);
+
+		auto piece = segment.clone();
+		piece.truncate_unsafe(segment.size() - pos - length).cover_unsafe(pos);
+		chain.append(std::move(piece));
+
+		pos = 0;
+		size -= length;
+	}
+
+	return chain;
+}
+
+void BufferChain::read_unsafe(size_t pos, uint8_t *out, size_t size) const {
+	assert(total_size >= size && total_size - size >= pos);
+
+	for(auto const &segment : segments) {
+		if(size == 0) {
+			break;
+		}
+
+		if(pos >= segment.size()) {
+			pos -= segment.size();
+			continue;
+		}
+
+		auto length = std::min(segment.size() - pos, size);
+		segment.read_unsafe(pos, out, length);
+
+		out += length;
+		pos = 0;
+		size -= length;
+	}
+}
+
+Buffer BufferChain::flatten() && {
+	if(segments.size() == 1) {
+		total_size = 0;
+		auto segment = std::move(segments.front());
+		segments.clear();
+
+		return std::move(segment).to_buffer();
+	}
+
+	Buffer b(total_size);
+	read_unsafe(0, b.data(), total_size);
+
+	segments.clear();
+	total_size = 0;
+
+	return b;
+}
+
+} // namespace core
+} // namespace marlin
@@ -0,0 +1,157 @@
+#include "marlin/core/BufferPool.hpp"
+#include <bit>
+
+namespace marlin {
+namespace core {
+
+namespace {
+// Trivially destructible, stays valid after the pool is destroyed at thread exit
+thread_local bool pool_destroyed = false;
+}
+
+std::atomic<int64_t> BufferPool::in_use_bytes = 0;
+
+BufferPool *BufferPool::local() {
+	if(pool_destroyed) {
+		return nullptr;
+	}
+
+	thread_local BufferPool pool;
+	return &pool;
+}
+
+BufferPool::~BufferPool() {
+	for(size_t i = 0; i < num_classes; i++) {
+		while(free_lists[i] != nullptr) {
+			auto *block = free_lists[i];
+			free_lists[i] = block->next;
+			delete[] (uint8_t*)block;
+		}
+	}
+
+	pool_destroyed = true;
+}
+
+size_t BufferPool::class_index(size_t size) {
+	if(size <= min_block_size) {
+		return 0;
+	}
+
+	return std::bit_width(size - 1) - std::bit_width(min_block_size - 1);
+}
+
+size_t BufferPool::block_size(size_t size) {
+	if(size > max_block_size) {
+		return size;
+	}
+
+	return min_block_size << class_index(size);
+}
+
+uint8_t *BufferPool::allocate(size_t size) {
+	auto *pool = local();
+
+	if(size > max_block_size) {
+		if(pool != nullptr) {
+			pool->counters.oversized++;
+		}
+		return new uint8_t[size];
+	}
+
+	auto idx = class_index(size);
+	auto bsize = min_block_size << idx;
+
+	in_use_bytes.fetch_add(bsize, std::memory_order_relaxed);
+
+	if(pool == nullptr) {
+		return new uint8_t[bsize];
+	}
+
+	auto *block = pool->free_lists[idx];
+	if(block != nullptr) {
+		pool->free_lists[idx] = block->next;
+		pool->free_counts[idx]--;
+		pool->counters.cached_bytes -= bsize;
+		pool->counters.hits++;
+
+		return (uint8_t*)block;
+	}
+
+	pool->counters.misses++;
+
+	return new uint8_t[bsize];
+}
+
+void BufferPool::deallocate(uint8_t *buf, size_t size) {
+	if(buf == nullptr) {
+		return;
+	}
+
+	if(size > max_block_size) {
+		delete[] buf;
+		return;
+	}
+
+	auto idx = class_index(size);
+	auto bsize = min_block_size << idx;
+
+	in_use_bytes.fetch_sub(bsize, std::memory_order_relaxed);
+
+	auto *pool = local();
+	if(pool == nullptr) {
+		delete[] buf;
+		return;
+	}
+
+	// Bound the cache
+	if((pool->free_counts[idx] + 1) * bsize > max_cached_bytes) {
+		delete[] buf;
+		return;
+	}
+
+	auto *block = (FreeBlock*)buf;
+	block->next = pool->free_lists[idx];
+	pool->free_lists[idx] = block;
+	pool->free_counts[idx]++;
+	pool->counters.cached_bytes += bsize;
+}
+
+void BufferPool::disown(size_t size) {
+	if(size > max_block_size) {
+		return;
+	}
+
+	in_use_bytes.fetch_sub(block_size(size), std::memory_order_relaxed);
+}
+
+BufferPool::Stats BufferPool::stats() {
+	Stats stats;
+
+	auto *pool = local();
+	if(pool != nullptr) {
+		stats = pool->counters;
+	}
+	stats.in_use_bytes = in_use_bytes.load(std::memory_order_relaxed);
+
+	return stats;
+}
+
+void BufferPool::trim() {
+	auto *pool = local();
+	if(pool == nullptr) {
+		return;
+	}
+
+	for(size_t i = 0; i < num_classes; i++) {
+		while(pool->free_lists[i] != nullptr) {
+			auto *block = pool->free_lists[i];
+			pool->free_lists[i] = block->next;
+			delete[] (uint8_t*)block;
+			pool->counters.cached_bytes -= min_block_size << i;
+		}
+		pool->free_counts[i] = 0;
+	}
+}
+
+} // namespace core
+} // namespace marlin
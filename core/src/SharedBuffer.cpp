@@ -0,0 +1,171 @@
+#include "marlin/core/SharedBuffer.hpp"
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+namespace marlin {
+namespace core {
+
+SharedBuffer::SharedBuffer(size_t size) :
+BaseBuffer(BufferPool::allocate(size), size), refs(new std::atomic<uint32_t>(1)), is_pooled(true) {}
+
+SharedBuffer::SharedBuffer(std::initializer_list<uint8_t> il, size_t size) :
+BaseBuffer(BufferPool::allocate(size), size), refs(new std::atomic<uint32_t>(1)), is_pooled(true) {
+	assert(il.size() <= size);
+	std::copy(il.begin(), il.end(), buf);
+}
+
+SharedBuffer::SharedBuffer(Buffer &&b) :
+BaseBuffer(b.buf, b.capacity), refs(nullptr), is_pooled(b.is_pooled) {
+	start_index = b.start_index;
+	end_index = b.end_index;
+
+	// Memory stays with the pool, released without disowning it
+	b.is_pooled = false;
+	b.release();
+
+	if(buf != nullptr) {
+		refs = new std::atomic<uint32_t>(1);
+	}
+}
+
+SharedBuffer::SharedBuffer(SharedBuffer const &b) :
+BaseBuffer(b), refs(b.refs), is_pooled(b.is_pooled) {
+	if(refs != nullptr) {
+		refs->fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+SharedBuffer::SharedBuffer(SharedBuffer &&b) noexcept :
+BaseBuffer(static_cast<BaseBuffer&&>(std::move(b))), refs(b.refs), is_pooled(b.is_pooled) {
+	b.buf = nullptr;
+	b.capacity = 0;
+	b.start_index = 0;
+	b.end_index = 0;
+	b.refs = nullptr;
+	b.is_pooled = false;
+}
+
+SharedBuffer &SharedBuffer::operator=(SharedBuffer const &b) {
+	if(this == &b) {
+		return *this;
+	}
+
+	// Take new reference before dropping old in case both share memory
+	if(b.refs != nullptr) {
+		b.refs->fetch_add(1, std::memory_order_relaxed);
+	}
+	reset();
+
+	buf = b.buf;
+	capacity = b.capacity;
+	start_index = b.start_index;
+	end_index = b.end_index;
+	refs = b.refs;
+	is_pooled = b.is_pooled;
+
+	return *this;
+}
+
+SharedBuffer &SharedBuffer::operator=(SharedBuffer &&b) noexcept {
+	if(this == &b) {
+		return *this;
+	}
+
+	// Destroy old
+	reset();
+
+	// Assign from new
+	buf = b.buf;
+	capacity = b.capacity;
+	start_index = b.start_index;
+	end_index = b.end_index;
+	refs = b.refs;
+	is_pooled = b.is_pooled;
+
+	b.buf = nullptr;
+	b.capacity = 0;
+	b.start_index = 0;
+	b.end_index = 0;
+	b.refs = nullptr;
+	b.is_pooled = false;
+
+	return *this;
+}
+
+SharedBuffer::~SharedBuffer() {
+	reset();
+}
+
+void SharedBuffer::reset() {
+	if(refs != nullptr && refs->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete refs;
+		if(is_pooled) {
+			BufferPool::deallocate(buf, capacity);
+		} else {
+			delete[] buf;
+		}
+	}
+
+	buf = nullptr;
+	capacity = 0;
+	start_index = 0;
+	end_index = 0;
+	refs = nullptr;
+	is_pooled = false;
+}
+
+uint32_t SharedBuffer::use_count() const {
+	if(refs == nullptr) {
+		return 0;
+	}
+
+	return refs->load(std::memory_order_acquire);
+}
+
+SharedBuffer &SharedBuffer::unshare() & {
+	if(refs == nullptr || is_unique()) {
+		return *this;
+	}
+
+	SharedBuffer copy(size());
+	std::memcpy(copy.buf, data(), size());
+
+	*this = std::move(copy);
+
+	return *this;
+}
+
+Buffer SharedBuffer::to_buffer() && {
+	if(refs == nullptr) {
+		return Buffer(nullptr, 0);
+	}
+
+	if(!is_unique()) {
+		Buffer copy(size());
+		copy.write_unsafe(0, data(), size());
+
+		reset();
+
+		return copy;
+	}
+
+	Buffer b(buf, capacity);
+	b.is_pooled = is_pooled;
+	b.cover_unsafe(start_index);
+	b.truncate_unsafe(capacity - end_index);
+
+	delete refs;
+
+	buf = nullptr;
+	capacity = 0;
+	start_index = 0;
+	end_index = 0;
+	refs = nullptr;
+	is_pooled = false;
+
+	return b;
+}
+
+} // namespace core
+} // namespace marlin
@@ -97,10 +97,23 @@ SocketAddress SocketAddress::loopback_ipv4(uint16_t port) {
 	return from_string(std::string("127.0.0.1:").append(std::to_string(port)));
 }
 
-// TODO - Temporary hack - previously used to memcmp bytes directly which wasn't working
-// Possibly because struct isn't zeroed out entirely so "unused" bytes have random data
+// Compares fields instead of bytes since unused bytes are not always zeroed out
 bool SocketAddress::operator==(const SocketAddress &other) const {
-	return this->to_string() == other.to_string();
+	if(this->ss_family != other.ss_family) {
+		return false;
+	}
+
+	if(this->ss_family == AF_INET6) {
+		auto const &addr = reinterpret_cast<const sockaddr_in6 &>(*this);
+		auto const &other_addr = reinterpret_cast<const sockaddr_in6 &>(other);
+		return addr.sin6_port == other_addr.sin6_port &&
+			std::memcmp(&addr.sin6_addr, &other_addr.sin6_addr, sizeof(in6_addr)) == 0;
+	}
+
+	auto const &addr = reinterpret_cast<const sockaddr_in &>(*this);
+	auto const &other_addr = reinterpret_cast<const sockaddr_in &>(other);
+	return addr.sin_port == other_addr.sin_port &&
+		addr.sin_addr.s_addr == other_addr.sin_addr.s_addr;
 }
 
 // TODO - Temporary hack - previously used to memcmp bytes directly which wasn't working
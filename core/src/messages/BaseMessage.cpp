@@ -6,6 +6,8 @@ namespace core {
 
 BaseMessage::BaseMessage(size_t size) : buf(size) {}
 
+BaseMessage::BaseMessage(size_t size, size_t headroom) : buf(Buffer::with_headroom(size, headroom)) {}
+
 BaseMessage::BaseMessage(Buffer&& buf) : buf(std::move(buf)) {}
 
 WeakBuffer BaseMessage::payload_buffer() & {
@@ -34,6 +34,25 @@ TEST(BufferConstruct, RawPtrConstructible) {
 	EXPECT_EQ(buf.size(), 1400);
 }
 
+TEST(BufferConstruct, HeadroomConstructible) {
+	auto buf = Buffer::with_headroom(1400, 8, 16);
+
+	EXPECT_EQ(buf.size(), 1400);
+	EXPECT_EQ(buf.headroom(), 8);
+	EXPECT_EQ(buf.tailroom(), 16);
+}
+
+TEST(BufferConstruct, HeadroomCanBeUncovered) {
+	auto buf = Buffer::with_headroom(1400, 8);
+	uint8_t *raw_ptr = buf.data();
+
+	EXPECT_TRUE(buf.uncover(8));
+	EXPECT_EQ(buf.data(), raw_ptr - 8);
+	EXPECT_EQ(buf.size(), 1408);
+	EXPECT_EQ(buf.headroom(), 0);
+	EXPECT_FALSE(buf.uncover(1));
+}
+
 TEST(BufferConstruct, MoveConstructible) {
 	auto buf = Buffer(1400);
 
@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "marlin/core/BufferChain.hpp"
+
+#include <cstring>
+
+using namespace marlin::core;
+
+TEST(BufferChainConstruct, DefaultConstructible) {
+	BufferChain chain;
+
+	EXPECT_EQ(chain.size(), 0);
+	EXPECT_EQ(chain.num_segments(), 0);
+}
+
+TEST(BufferChainConstruct, BufferConstructibleWithoutCopy) {
+	auto buf = Buffer({'0','1','2','3'}, 4);
+	uint8_t *raw_ptr = buf.data();
+
+	BufferChain chain(std::move(buf));
+
+	EXPECT_EQ(chain.size(), 4);
+	EXPECT_EQ(chain.num_segments(), 1);
+	EXPECT_EQ(chain.segment(0).data(), raw_ptr);
+}
+
+TEST(BufferChainModify, CanAppendAndPrepend) {
+	BufferChain chain(Buffer({'2','3'}, 2));
+	chain.append(Buffer({'4','5','6'}, 3)).prepend(Buffer({'0','1'}, 2));
+
+	EXPECT_EQ(chain.size(), 7);
+	EXPECT_EQ(chain.num_segments(), 3);
+
+	uint8_t out[7];
+	chain.read_unsafe(0, out, 7);
+	EXPECT_TRUE(std::memcmp(out, "0123456", 7) == 0);
+}
+
+TEST(BufferChainModify, CanPopFront) {
+	BufferChain chain(Buffer({'0','1'}, 2));
+	chain.append(Buffer({'2','3','4'}, 3));
+
+	auto front = chain.pop_front();
+
+	EXPECT_EQ(front.size(), 2);
+	EXPECT_EQ(chain.size(), 3);
+	EXPECT_EQ(chain.num_segments(), 1);
+}
+
+TEST(BufferChainModify, CanHoldManySegments) {
+	BufferChain chain;
+	for(uint8_t i = 0; i < 10; i++) {
+		chain.append(Buffer({i}, 1));
+	}
+
+	EXPECT_EQ(chain.size(), 10);
+	EXPECT_EQ(chain.num_segments(), 10);
+
+	uint8_t out[10];
+	chain.read_unsafe(0, out, 10);
+	for(uint8_t i = 0; i < 10; i++) {
+		EXPECT_EQ(out[i], i);
+	}
+}
+
+TEST(BufferChainRead, CanReadAcrossSegments) {
+	BufferChain chain(Buffer({'0','1','2'}, 3));
+	chain.append(Buffer({'3','4','5'}, 3));
+
+	uint8_t out[4];
+	chain.read_unsafe(1, out, 4);
+
+	EXPECT_TRUE(std::memcmp(out, "1234", 4) == 0);
+}
+
+TEST(BufferChainSlice, SliceSharesMemory) {
+	auto buf = Buffer({'0','1','2','3','4','5'}, 6);
+	uint8_t *raw_ptr = buf.data();
+	BufferChain chain(std::move(buf));
+
+	auto slice = chain.slice(2, 3);
+
+	EXPECT_EQ(slice.size(), 3);
+	EXPECT_EQ(slice.num_segments(), 1);
+	EXPECT_EQ(slice.segment(0).data(), raw_ptr + 2);
+	EXPECT_EQ(slice.segment(0).size(), 3);
+	EXPECT_EQ(chain.segment(0).use_count(), 2);
+}
+
+TEST(BufferChainSlice, SliceAcrossSegments) {
+	BufferChain chain(Buffer({'0','1','2'}, 3));
+	chain.append(Buffer({'3','4','5'}, 3)).append(Buffer({'6','7','8'}, 3));
+
+	auto slice = chain.slice(2, 5);
+
+	EXPECT_EQ(slice.size(), 5);
+	EXPECT_EQ(slice.num_segments(), 3);
+
+	uint8_t out[5];
+	slice.read_unsafe(0, out, 5);
+	EXPECT_TRUE(std::memcmp(out, "23456", 5) == 0);
+}
+
+TEST(BufferChainFlatten, SingleUniqueSegmentWithoutCopy) {
+	auto buf = Buffer({'0','1','2','3'}, 4);
+	uint8_t *raw_ptr = buf.data();
+	BufferChain chain(std::move(buf));
+
+	auto flat = std::move(chain).flatten();
+
+	EXPECT_EQ(flat.data(), raw_ptr);
+	EXPECT_EQ(flat.size(), 4);
+	EXPECT_EQ(chain.size(), 0);
+}
+
+TEST(BufferChainFlatten, MultipleSegmentsGathered) {
+	BufferChain chain(Buffer({'0','1'}, 2));
+	chain.append(Buffer({'2','3'}, 2));
+
+	auto flat = std::move(chain).flatten();
+
+	EXPECT_EQ(flat.size(), 4);
+	EXPECT_TRUE(std::memcmp(flat.data(), "0123", 4) == 0);
+	EXPECT_EQ(chain.num_segments(), 0);
+}
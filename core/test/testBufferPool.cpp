@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include "marlin/core/BufferPool.hpp"
+#include "marlin/core/Buffer.hpp"
+
+#include <thread>
+
+using namespace marlin::core;
+
+TEST(BufferPoolSizeClass, RoundsUpToPowerOfTwo) {
+	EXPECT_EQ(BufferPool::block_size(0), 64);
+	EXPECT_EQ(BufferPool::block_size(1), 64);
+	EXPECT_EQ(BufferPool::block_size(64), 64);
+	EXPECT_EQ(BufferPool::block_size(65), 128);
+	EXPECT_EQ(BufferPool::block_size(1500), 2048);
+	EXPECT_EQ(BufferPool::block_size(65536), 65536);
+}
+
+TEST(BufferPoolSizeClass, OversizedIsExact) {
+	EXPECT_EQ(BufferPool::block_size(65537), 65537);
+}
+
+TEST(BufferPoolAllocate, ReusesFreedBlock) {
+	BufferPool::trim();
+
+	auto *first = BufferPool::allocate(1500);
+	BufferPool::deallocate(first, 1500);
+
+	auto hits = BufferPool::stats().hits;
+	auto *second = BufferPool::allocate(1400);
+
+	EXPECT_EQ(second, first);
+	EXPECT_EQ(BufferPool::stats().hits, hits + 1);
+
+	BufferPool::deallocate(second, 1400);
+}
+
+TEST(BufferPoolAllocate, MissesOnEmptyClass) {
+	BufferPool::trim();
+
+	auto misses = BufferPool::stats().misses;
+	auto *buf = BufferPool::allocate(100);
+
+	EXPECT_EQ(BufferPool::stats().misses, misses + 1);
+
+	BufferPool::deallocate(buf, 100);
+}
+
+TEST(BufferPoolAllocate, OversizedBypassesPool) {
+	BufferPool::trim();
+
+	auto stats = BufferPool::stats();
+	auto *buf = BufferPool::allocate(100000);
+
+	EXPECT_EQ(BufferPool::stats().oversized, stats.oversized + 1);
+	EXPECT_EQ(BufferPool::stats().in_use_bytes, stats.in_use_bytes);
+
+	BufferPool::deallocate(buf, 100000);
+
+	EXPECT_EQ(BufferPool::stats().cached_bytes, 0);
+}
+
+TEST(BufferPoolStats, TracksFootprint) {
+	BufferPool::trim();
+
+	auto in_use = BufferPool::stats().in_use_bytes;
+	auto *buf = BufferPool::allocate(1000);
+
+	EXPECT_EQ(BufferPool::stats().in_use_bytes, in_use + 1024);
+	EXPECT_EQ(BufferPool::stats().cached_bytes, 0);
+
+	BufferPool::deallocate(buf, 1000);
+
+	EXPECT_EQ(BufferPool::stats().in_use_bytes, in_use);
+	EXPECT_EQ(BufferPool::stats().cached_bytes, 1024);
+	EXPECT_EQ(BufferPool::stats().footprint(), in_use + 1024);
+}
+
+TEST(BufferPoolStats, CacheIsBounded) {
+	BufferPool::trim();
+
+	constexpr size_t count = BufferPool::max_cached_bytes / 65536 + 4;
+	uint8_t *bufs[count];
+	for(size_t i = 0; i < count; i++) {
+		bufs[i] = BufferPool::allocate(65536);
+	}
+	for(size_t i = 0; i < count; i++) {
+		BufferPool::deallocate(bufs[i], 65536);
+	}
+
+	EXPECT_EQ(BufferPool::stats().cached_bytes, (int64_t)BufferPool::max_cached_bytes);
+}
+
+TEST(BufferPoolStats, TrimReleasesCache) {
+	auto *buf = BufferPool::allocate(1000);
+	BufferPool::deallocate(buf, 1000);
+
+	EXPECT_GT(BufferPool::stats().cached_bytes, 0);
+
+	BufferPool::trim();
+
+	EXPECT_EQ(BufferPool::stats().cached_bytes, 0);
+}
+
+TEST(BufferPoolThreads, BlocksCanMoveAcrossThreads) {
+	auto *buf = BufferPool::allocate(1000);
+
+	std::thread([buf]() {
+		BufferPool::deallocate(buf, 1000);
+		EXPECT_EQ(BufferPool::stats().cached_bytes, 1024);
+	}).join();
+}
+
+TEST(BufferPoolBuffer, ReturnsMemoryOnDestruction) {
+	BufferPool::trim();
+
+	uint8_t *raw_ptr;
+	{
+		Buffer buf(1400);
+		raw_ptr = buf.data();
+	}
+
+	EXPECT_EQ(BufferPool::stats().cached_bytes, 2048);
+
+	Buffer buf(1400);
+	EXPECT_EQ(buf.data(), raw_ptr);
+}
+
+TEST(BufferPoolBuffer, FromPoolReturnsMemoryOnDestruction) {
+	BufferPool::trim();
+
+	auto *raw_ptr = BufferPool::allocate(1500);
+	{
+		auto buf = Buffer::from_pool(raw_ptr, 1500).truncate_unsafe(500);
+		EXPECT_EQ(buf.size(), 1000);
+	}
+
+	EXPECT_EQ(BufferPool::stats().cached_bytes, 2048);
+}
+
+TEST(BufferPoolBuffer, ReleasedMemoryIsDeletable) {
+	Buffer buf(1400);
+	auto *raw_ptr = buf.release();
+
+	// Must be safe to adopt as a plain Buffer
+	Buffer adopted(raw_ptr, 1400);
+	EXPECT_EQ(adopted.data(), raw_ptr);
+}
+
+TEST(BufferPoolStats, ReleaseStopsCounting) {
+	auto in_use = BufferPool::stats().in_use_bytes;
+
+	Buffer buf(1400);
+	EXPECT_EQ(BufferPool::stats().in_use_bytes, in_use + 2048);
+
+	delete[] buf.release();
+	EXPECT_EQ(BufferPool::stats().in_use_bytes, in_use);
+}
+
+TEST(BufferPoolStats, InUseCountsFreesOnOtherThreads) {
+	auto in_use = BufferPool::stats().in_use_bytes;
+	auto *buf = BufferPool::allocate(1000);
+
+	std::thread([buf]() {
+		BufferPool::deallocate(buf, 1000);
+	}).join();
+
+	EXPECT_EQ(BufferPool::stats().in_use_bytes, in_use);
+}
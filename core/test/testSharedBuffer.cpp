@@ -0,0 +1,196 @@
+#include "gtest/gtest.h"
+#include "marlin/core/SharedBuffer.hpp"
+
+#include <cstring>
+
+using namespace marlin::core;
+
+namespace marlin {
+namespace core {
+// Explicit instantiation hack for accurate coverage of templates
+template class BaseBuffer<SharedBuffer>;
+}
+}
+
+TEST(SharedBufferConstruct, SizeConstructible) {
+	auto buf = SharedBuffer(1400);
+
+	EXPECT_EQ(buf.size(), 1400);
+	EXPECT_EQ(buf.use_count(), 1);
+}
+
+TEST(SharedBufferConstruct, InitializerListConstructible) {
+	auto buf = SharedBuffer({'0','1','2','3'}, 1400);
+
+	EXPECT_EQ(buf.size(), 1400);
+	EXPECT_TRUE(std::memcmp(buf.data(), "0123", 4) == 0);
+}
+
+TEST(SharedBufferConstruct, BufferConstructibleWithoutCopy) {
+	auto buf = Buffer({'0','1','2','3'}, 1400);
+	buf.cover_unsafe(1).truncate_unsafe(10);
+	uint8_t *raw_ptr = buf.data();
+
+	SharedBuffer sbuf(std::move(buf));
+
+	EXPECT_EQ(sbuf.data(), raw_ptr);
+	EXPECT_EQ(sbuf.size(), 1389);
+	EXPECT_TRUE(sbuf.uncover(1));
+	EXPECT_TRUE(sbuf.expand(10));
+	EXPECT_EQ(sbuf.size(), 1400);
+
+	EXPECT_EQ(buf.data(), nullptr);
+	EXPECT_EQ(buf.size(), 0);
+}
+
+TEST(SharedBufferConstruct, CopyConstructibleSharesMemory) {
+	auto buf = SharedBuffer(1400);
+	uint8_t *raw_ptr = buf.data();
+
+	auto nbuf(buf);
+
+	EXPECT_EQ(nbuf.data(), raw_ptr);
+	EXPECT_EQ(nbuf.size(), 1400);
+	EXPECT_EQ(buf.data(), raw_ptr);
+	EXPECT_EQ(buf.use_count(), 2);
+	EXPECT_EQ(nbuf.use_count(), 2);
+}
+
+TEST(SharedBufferConstruct, MoveConstructible) {
+	auto buf = SharedBuffer(1400);
+	uint8_t *raw_ptr = buf.data();
+
+	auto nbuf(std::move(buf));
+
+	EXPECT_EQ(nbuf.data(), raw_ptr);
+	EXPECT_EQ(nbuf.size(), 1400);
+	EXPECT_EQ(nbuf.use_count(), 1);
+
+	EXPECT_EQ(buf.data(), nullptr);
+	EXPECT_EQ(buf.size(), 0);
+	EXPECT_EQ(buf.use_count(), 0);
+}
+
+TEST(SharedBufferConstruct, CopyAssignable) {
+	auto buf = SharedBuffer(1400);
+	auto nbuf = SharedBuffer(100);
+	uint8_t *raw_ptr = buf.data();
+
+	nbuf = buf;
+
+	EXPECT_EQ(nbuf.data(), raw_ptr);
+	EXPECT_EQ(nbuf.size(), 1400);
+	EXPECT_EQ(buf.use_count(), 2);
+
+	nbuf = buf;
+
+	EXPECT_EQ(buf.use_count(), 2);
+}
+
+TEST(SharedBufferConstruct, MoveAssignable) {
+	auto buf = SharedBuffer(1400);
+	auto nbuf = SharedBuffer(100);
+	uint8_t *raw_ptr = buf.data();
+
+	nbuf = std::move(buf);
+
+	EXPECT_EQ(nbuf.data(), raw_ptr);
+	EXPECT_EQ(nbuf.size(), 1400);
+	EXPECT_EQ(nbuf.use_count(), 1);
+
+	EXPECT_EQ(buf.data(), nullptr);
+	EXPECT_EQ(buf.size(), 0);
+}
+
+TEST(SharedBufferShare, CloneReleasesOnDestruction) {
+	auto buf = SharedBuffer(1400);
+
+	{
+		auto c1 = buf.clone();
+		auto c2 = c1.clone();
+
+		EXPECT_EQ(buf.use_count(), 3);
+	}
+
+	EXPECT_EQ(buf.use_count(), 1);
+	EXPECT_TRUE(buf.is_unique());
+}
+
+TEST(SharedBufferShare, BoundsArePerCopy) {
+	auto buf = SharedBuffer({'0','1','2','3'}, 4);
+	uint8_t *raw_ptr = buf.data();
+
+	auto nbuf = buf.clone();
+	nbuf.cover_unsafe(1).truncate_unsafe(1);
+
+	EXPECT_EQ(nbuf.data(), raw_ptr + 1);
+	EXPECT_EQ(nbuf.size(), 2);
+	EXPECT_TRUE(std::memcmp(nbuf.data(), "12", 2) == 0);
+
+	EXPECT_EQ(buf.data(), raw_ptr);
+	EXPECT_EQ(buf.size(), 4);
+}
+
+TEST(SharedBufferShare, UnshareCopiesIfShared) {
+	auto buf = SharedBuffer({'0','1','2','3'}, 4);
+	uint8_t *raw_ptr = buf.data();
+
+	auto nbuf = buf.clone();
+	nbuf.cover_unsafe(1);
+	nbuf.unshare().write_uint8_unsafe(0, '9');
+
+	EXPECT_NE(nbuf.data(), raw_ptr + 1);
+	EXPECT_EQ(nbuf.size(), 3);
+	EXPECT_TRUE(std::memcmp(nbuf.data(), "923", 3) == 0);
+	EXPECT_TRUE(std::memcmp(buf.data(), "0123", 4) == 0);
+	EXPECT_TRUE(buf.is_unique());
+	EXPECT_TRUE(nbuf.is_unique());
+}
+
+TEST(SharedBufferShare, UnshareIsNoopIfUnique) {
+	auto buf = SharedBuffer(1400);
+	uint8_t *raw_ptr = buf.data();
+
+	buf.unshare();
+
+	EXPECT_EQ(buf.data(), raw_ptr);
+	EXPECT_EQ(buf.size(), 1400);
+}
+
+TEST(SharedBufferConvert, ToBufferWithoutCopyIfUnique) {
+	auto buf = SharedBuffer({'0','1','2','3'}, 1400);
+	buf.cover_unsafe(1);
+	uint8_t *raw_ptr = buf.data();
+
+	auto nbuf = std::move(buf).to_buffer();
+
+	EXPECT_EQ(nbuf.data(), raw_ptr);
+	EXPECT_EQ(nbuf.size(), 1399);
+	EXPECT_TRUE(nbuf.uncover(1));
+
+	EXPECT_EQ(buf.data(), nullptr);
+	EXPECT_EQ(buf.size(), 0);
+}
+
+TEST(SharedBufferConvert, ToBufferWithCopyIfShared) {
+	auto buf = SharedBuffer({'0','1','2','3'}, 4);
+	auto sbuf = buf.clone();
+	uint8_t *raw_ptr = buf.data();
+
+	auto nbuf = std::move(sbuf).to_buffer();
+
+	EXPECT_NE(nbuf.data(), raw_ptr);
+	EXPECT_EQ(nbuf.size(), 4);
+	EXPECT_TRUE(std::memcmp(nbuf.data(), "0123", 4) == 0);
+	EXPECT_TRUE(buf.is_unique());
+}
+
+TEST(SharedBufferConvert, WeakBufferConvertible) {
+	auto buf = SharedBuffer(1400);
+	buf.cover_unsafe(10);
+
+	WeakBuffer wbuf = buf;
+
+	EXPECT_EQ(wbuf.data(), buf.data());
+	EXPECT_EQ(wbuf.size(), 1390);
+}
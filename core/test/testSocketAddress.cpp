@@ -1,5 +1,7 @@
 #include "gtest/gtest.h"
 #include "marlin/core/SocketAddress.hpp"
+#include <unordered_set>
+#include <arpa/inet.h>
 
 
 using namespace marlin::core;
@@ -51,3 +53,47 @@ TEST(SocketAddressTest, LoopbackConstructible) {
 
 	EXPECT_EQ(addr, SocketAddress::from_string("127.0.0.1:8000"));
 }
+
+TEST(SocketAddressTest, EqualityIgnoresUnusedBytes) {
+	sockaddr_in raw;
+	memset(&raw, 0xff, sizeof(raw));
+	raw.sin_family = AF_INET;
+	raw.sin_port = htons(8000);
+	inet_pton(AF_INET, "192.168.0.1", &raw.sin_addr);
+
+	SocketAddress addr(raw);
+
+	EXPECT_EQ(addr, SocketAddress::from_string("192.168.0.1:8000"));
+	EXPECT_EQ(std::hash<SocketAddress>()(addr), std::hash<SocketAddress>()(SocketAddress::from_string("192.168.0.1:8000")));
+	EXPECT_FALSE(addr == SocketAddress::from_string("192.168.0.1:8001"));
+}
+
+TEST(SocketAddressTest, HashSpreadsAddressAndPort) {
+	// Second octet and low port byte overlap once laid out in memory, must not collide
+	std::unordered_set<size_t> hashes;
+	for(int octet = 0; octet < 256; octet++) {
+		for(int port = 7936; port < 8192; port++) {
+			auto addr = SocketAddress::from_string("10." + std::to_string(octet) + ".0.1:" + std::to_string(port));
+			hashes.insert(std::hash<SocketAddress>()(addr));
+		}
+	}
+
+	EXPECT_EQ(hashes.size(), 65536u);
+}
+
+TEST(SocketAddressTest, HashCoversIpv6) {
+	sockaddr_in6 raw;
+	memset(&raw, 0, sizeof(raw));
+	raw.sin6_family = AF_INET6;
+	raw.sin6_port = htons(8000);
+	inet_pton(AF_INET6, "2001:db8::1", &raw.sin6_addr);
+	SocketAddress addr(raw);
+
+	// Only the last bits differ, beyond what an IPv4 view would see
+	inet_pton(AF_INET6, "2001:db8::2", &raw.sin6_addr);
+	SocketAddress other(raw);
+
+	EXPECT_FALSE(addr == other);
+	EXPECT_NE(std::hash<SocketAddress>()(addr), std::hash<SocketAddress>()(other));
+	EXPECT_EQ(addr, SocketAddress(addr));
+}
@@ -2,6 +2,7 @@
 #define MARLIN_LPF_CTB_HPP
 
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 
 namespace marlin {
 namespace lpf {
@@ -76,6 +77,79 @@ public:
 
 		return 0;
 	}
+
+	/// Contiguous fragments delivered together, message bytes are forwarded
+	/// as a single chain sharing the fragments' memory
+	template<typename Delegate>
+	int did_recv(
+		Delegate &delegate,
+		core::BufferChain &&bytes
+	) {
+		core::BufferChain message;
+
+		for(auto &segment : bytes) {
+			while(segment.size() > 0) {
+				if(cut_through == false) { // Read length
+					auto n = std::min<uint64_t>(8 - size, segment.size());
+					for(size_t i = 0; i < n; i++) {
+						length = (length << 8) | segment.data()[i];
+					}
+					segment.cover_unsafe(n);
+					size += n;
+
+					if(size < 8) { // Partial length
+						break;
+					}
+
+					if(length > 5000000) { // Abort on big message, DoS prevention
+						SPDLOG_ERROR("Message too big: {}", length);
+						return -1;
+					}
+
+					// Prepare to process message
+					delegate.cut_through_recv_start(id, length);
+					cut_through = true;
+					size = 0;
+				} else { // Cut through message
+					auto n = std::min<uint64_t>(length - size, segment.size());
+					size += n;
+					if(n == segment.size()) {
+						// Whole fragment, leaves the segment empty
+						message.append(std::move(segment));
+					} else {
+						auto part = segment.clone();
+						part.truncate_unsafe(segment.size() - n);
+						segment.cover_unsafe(n);
+						message.append(std::move(part));
+					}
+
+					if(size == length) { // Full message
+						auto res = delegate.cut_through_recv_bytes(id, std::move(message));
+						if(res < 0) {
+							return -2;
+						}
+						delegate.cut_through_recv_end(id);
+						message = core::BufferChain();
+
+						// Prepare to process length
+						cut_through = false;
+						size = 0;
+						length = 0;
+					}
+				}
+			}
+		}
+
+		// Partial message
+		if(message.size() > 0) {
+			auto res = delegate.cut_through_recv_bytes(id, std::move(message));
+			if(res < 0) {
+				return -2;
+			}
+		}
+
+		return 0;
+	}
 };
 
 } // namespace lpf
@@ -2,11 +2,14 @@
 #define MARLIN_LPF_LPFTRANSPORT_HPP
 
 #include <list>
+#include <algorithm>
 #include <unordered_set>
 #include <spdlog/spdlog.h>
 
 #include <marlin/core/SocketAddress.hpp>
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/SharedBuffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 #include <marlin/core/TransportManager.hpp>
 
 #include <marlin/lpf/CutThroughBuffer.hpp>
@@ -44,13 +47,36 @@ private:
 	core::TransportManager<Self> &transport_manager;
 
 	std::unordered_map<uint16_t, StoreThenForwardBuffer> stf_buffers;
+
+	/// Feed received bytes, owned buffers or chains of contiguous fragments, to the stream's buffer
+	template<typename BytesType>
+	int did_recv_impl(BytesType &&bytes, uint16_t stream_id);
+	/// Send on the given stream in the given priority class, as far as the base transport supports streams and classes
+	/// A non zero deadline is dropped on base transports that do not abandon data
+	template<typename BufferType>
+	int send_on_stream(BufferType &&bytes, uint16_t stream_id, uint8_t priority, uint64_t deadline = 0);
 public:
+	/// Priority classes of the base transport, 0 is sent first
+	static constexpr uint8_t num_priorities = 4;
+	/// Priority class of messages sent without one
+	static constexpr uint8_t default_priority = 1;
+	/// Store-then-forward stream of each priority class, the default class keeps stream 0
+	static constexpr uint16_t stf_stream_ids[num_priorities] = {1, 0, 2, 3};
+	/// Received bytes are acked to the base transport once handed on or held in a message buffer,
+	/// so that credit for the peer never runs ahead of the delegate
+	static constexpr bool acks_consumption = true;
+
 	int did_recv_stf_message(uint16_t id, core::Buffer &&message);
 
 	// Delegate
 	void did_dial(BaseTransport &transport);
 	int did_recv(BaseTransport &transport, core::Buffer &&bytes, uint16_t stream_id = 0);
+	int did_recv(BaseTransport &transport, core::BufferChain &&bytes, uint16_t stream_id = 0);
 	void did_send(BaseTransport &transport, core::Buffer &&bytes);
+	void did_send(BaseTransport &transport, core::SharedBuffer &&bytes);
+	void did_send(BaseTransport &transport, core::BufferChain &&bytes);
+	void did_drain(BaseTransport &transport);
+	void did_recv_datagram(BaseTransport &transport, core::Buffer &&bytes);
 	void did_close(BaseTransport& transport, uint16_t reason);
 	void did_recv_flush_stream(BaseTransport &transport, uint16_t id, uint64_t offset, uint64_t old_offset);
 	void did_recv_skip_stream(BaseTransport &transport, uint16_t id);
@@ -72,26 +98,37 @@ public:
 
 	void setup(DelegateType *delegate, uint8_t const* keys = nullptr);
 
-	int send(core::Buffer &&message);
+	/// A non zero deadline is a time in milliseconds on the event loop clock, see asyncio::EventLoop::now.
+	/// Messages not delivered by then are abandoned whole if the base transport supports deadlines.
+	int send(core::Buffer &&message, uint8_t priority = default_priority, uint64_t deadline = 0);
+	int send(core::SharedBuffer &&message, uint8_t priority = default_priority, uint64_t deadline = 0);
+	/// Send a single unframed message which may be lost, returns -1 if the base transport has no datagrams or it is too large
+	int send_datagram(core::Buffer &&message);
+	/// Send a liveness probe the peer acks, returns -1 if the base transport has no such probe
+	int send_ping();
 	void close(uint16_t reason = 0);
 
 	bool is_active();
 	double get_rtt();
 
-	int cut_through_send(core::Buffer &&message);
+	/// Abandoned past a non zero deadline like messages sent whole
+	int cut_through_send(core::Buffer &&message, uint8_t priority = default_priority, uint64_t deadline = 0);
+	int cut_through_send(core::SharedBuffer &&message, uint8_t priority = default_priority, uint64_t deadline = 0);
 private:
 	std::unordered_map<uint16_t, CutThroughBuffer> cut_through_buffers;
 	std::list<uint16_t> cut_through_reserve_ids = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
 public:
 	std::unordered_set<uint16_t> cut_through_used_ids;
-	uint16_t cut_through_send_start(uint64_t length);
+	uint16_t cut_through_send_start(uint64_t length, uint8_t priority = default_priority);
 	int cut_through_send_bytes(uint16_t id, core::Buffer &&bytes);
+	int cut_through_send_bytes(uint16_t id, core::SharedBuffer &&bytes);
 	void cut_through_send_end(uint16_t id);
 	void cut_through_send_skip(uint16_t id);
 	void cut_through_send_flush(uint16_t id);
 
 	void cut_through_recv_start(uint16_t id, uint64_t length);
 	int cut_through_recv_bytes(uint16_t id, core::Buffer &&bytes);
+	int cut_through_recv_bytes(uint16_t id, core::BufferChain &&bytes);
 	void cut_through_recv_end(uint16_t id);
 	void cut_through_recv_skip(uint16_t id);
 	void cut_through_recv_flush(uint16_t id);
@@ -154,6 +191,56 @@ int LpfTransport<
 	core::Buffer &&bytes,
 	uint16_t stream_id
 ) {
+	return did_recv_impl(std::move(bytes), stream_id);
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_recv(
+	BaseTransport &,
+	core::BufferChain &&bytes,
+	uint16_t stream_id
+) {
+	return did_recv_impl(std::move(bytes), stream_id);
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+template<typename BytesType>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_recv_impl(
+	BytesType &&bytes,
+	uint16_t stream_id
+) {
+	// Delegate is done with everything once the buffers return, short of a partial message
+	// The partial message is bounded by the message size limit and freed on completion or flush
+	[[maybe_unused]] auto size = bytes.size();
+	// Base transports without flow control have nothing to credit
+	constexpr bool has_consume = requires(
+		BaseTransport& t,
+		uint16_t s,
+		uint64_t n
+	) {
+		t.consume(s, n);
+	};
+
 	if constexpr (should_cut_through) {
 		if(transport.is_internal() && stream_id >= 10 && stream_id < 20) {
 			auto &rbuf = cut_through_buffers[stream_id];
@@ -169,6 +256,9 @@ int LpfTransport<
 				return -1;
 			}
 
+			if constexpr (has_consume) {
+				transport.consume(stream_id, size);
+			}
 			return 0;
 		}
 	}
@@ -185,6 +275,9 @@ int LpfTransport<
 		return -1;
 	}
 
+	if constexpr (has_consume) {
+		transport.consume(stream_id, size);
+	}
 	return 0;
 }
 
@@ -206,6 +299,104 @@ void LpfTransport<
 	delegate->did_send(*this, std::move(bytes).cover_unsafe(8));
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+void LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_send(
+	BaseTransport &,
+	core::SharedBuffer &&bytes
+) {
+	// Shared buffer completions are optional
+	constexpr bool has_shared_did_send = requires(
+		DelegateType& d
+	) {
+		d.did_send(*this, std::move(bytes));
+	};
+	if constexpr (has_shared_did_send) {
+		delegate->did_send(*this, std::move(bytes).cover_unsafe(8));
+	}
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+void LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_send(
+	BaseTransport &,
+	core::BufferChain &&bytes
+) {
+	// Chains only carry a gathered prefix followed by an owned message
+	bytes.pop_front();
+	delegate->did_send(*this, std::move(bytes).flatten());
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+void LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_drain(
+	BaseTransport &
+) {
+	// Drain notifications are optional
+	constexpr bool has_did_drain = requires(
+		DelegateType& d
+	) {
+		d.did_drain(*this);
+	};
+	if constexpr (has_did_drain) {
+		delegate->did_drain(*this);
+	}
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+void LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_recv_datagram(
+	BaseTransport &,
+	core::Buffer &&bytes
+) {
+	// Datagrams bypass framing, delegates without them drop these
+	constexpr bool has_did_recv_datagram = requires(
+		DelegateType& d,
+		core::Buffer&& b
+	) {
+		d.did_recv_datagram(*this, std::move(b));
+	};
+	if constexpr (has_did_recv_datagram) {
+		delegate->did_recv_datagram(*this, std::move(bytes));
+	}
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -237,6 +428,9 @@ void LpfTransport<
 	SHOULD_CUT_THROUGH,
 	PREFIX_LENGTH
 >::did_recv_flush_stream(BaseTransport &, uint16_t id, uint64_t, uint64_t) {
+	// Deadlines abandon whole messages, the stream resumes at the start of a length prefix
+	stf_buffers.erase(id);
+
 	cut_through_recv_flush(id);
 }
 
@@ -339,14 +533,186 @@ int LpfTransport<
 	SHOULD_CUT_THROUGH,
 	PREFIX_LENGTH
 >::send(
+	core::Buffer &&message,
+	uint8_t priority,
+	uint64_t deadline
+) {
+	priority = std::min<uint8_t>(priority, num_priorities - 1);
+	auto size = message.size();
+
+	// Prefix in place if the sender reserved headroom
+	if(message.uncover(8)) {
+		message.write_uint64_be_unsafe(0, size);
+
+		return send_on_stream(std::move(message), stf_stream_ids[priority], priority, deadline);
+	}
+
+	// Let the base transport gather the prefix if it can
+	constexpr bool can_gather = requires(
+		BaseTransport& t,
+		core::BufferChain&& c
+	) {
+		t.send(std::move(c));
+	};
+	if constexpr (can_gather) {
+		core::Buffer prefix(8);
+		prefix.write_uint64_be_unsafe(0, size);
+
+		return transport.send(
+			core::BufferChain(std::move(prefix))
+				.append(std::move(message))
+		);
+	} else {
+		core::Buffer lpf_message(size + 8);
+
+		lpf_message.write_uint64_be_unsafe(0, size);
+		lpf_message.write_unsafe(8, message.data(), size);
+
+		return send_on_stream(std::move(lpf_message), stf_stream_ids[priority], priority, deadline);
+	}
+}
+
+//! sends a message shared with other transports
+/*!
+	The length prefix is written in place if the buffer has enough headroom.
+	Every copy of a shared message has the same length, so copies sent on other
+	transports see identical prefix bytes. Falls back to copying otherwise.
+*/
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::send(
+	core::SharedBuffer &&message,
+	uint8_t priority,
+	uint64_t deadline
+) {
+	priority = std::min<uint8_t>(priority, num_priorities - 1);
+	auto size = message.size();
+	if(!message.uncover(8)) {
+		return send(std::move(message).to_buffer(), priority, deadline);
+	}
+
+	message.write_uint64_be_unsafe(0, size);
+
+	return send_on_stream(std::move(message), stf_stream_ids[priority], priority, deadline);
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::send_datagram(
 	core::Buffer &&message
 ) {
-	core::Buffer lpf_message(message.size() + 8);
+	constexpr bool has_datagrams = requires(
+		BaseTransport& t,
+		core::Buffer&& b
+	) {
+		t.send_datagram(std::move(b));
+	};
+
+	if constexpr (has_datagrams) {
+		// A datagram is a whole message, no length prefix needed
+		return transport.send_datagram(std::move(message));
+	} else {
+		return -1;
+	}
+}
 
-	lpf_message.write_uint64_be_unsafe(0, message.size());
-	lpf_message.write_unsafe(8, message.data(), message.size());
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::send_ping() {
+	constexpr bool has_ping = requires(
+		BaseTransport& t
+	) {
+		t.send_ping();
+	};
+
+	if constexpr (has_ping) {
+		return transport.send_ping();
+	} else {
+		return -1;
+	}
+}
 
-	return transport.send(std::move(lpf_message));
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+template<typename BufferType>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::send_on_stream(
+	BufferType &&bytes,
+	uint16_t stream_id,
+	uint8_t priority,
+	uint64_t deadline
+) {
+	constexpr bool has_deadlines = requires(
+		BaseTransport& t,
+		BufferType&& b,
+		uint16_t s,
+		uint8_t p,
+		uint64_t d
+	) {
+		t.send(std::move(b), s, p, d);
+	};
+	constexpr bool has_priorities = requires(
+		BaseTransport& t,
+		BufferType&& b,
+		uint16_t s,
+		uint8_t p
+	) {
+		t.send(std::move(b), s, p);
+	};
+	constexpr bool has_streams = requires(
+		BaseTransport& t,
+		BufferType&& b,
+		uint16_t s
+	) {
+		t.send(std::move(b), s);
+	};
+
+	if constexpr (has_deadlines) {
+		return transport.send(std::move(bytes), stream_id, priority, deadline);
+	} else if constexpr (has_priorities) {
+		return transport.send(std::move(bytes), stream_id, priority);
+	} else if constexpr (has_streams) {
+		// Streams without scheduling classes
+		return transport.send(std::move(bytes), stream_id);
+	} else {
+		// Single stream transports send everything in order
+		return transport.send(std::move(bytes));
+	}
 }
 
 template<
@@ -361,16 +727,58 @@ int LpfTransport<
 	SHOULD_CUT_THROUGH,
 	PREFIX_LENGTH
 >::cut_through_send(
-	core::Buffer &&message
+	core::Buffer &&message,
+	uint8_t priority,
+	uint64_t deadline
+) {
+	auto id = cut_through_send_start(message.size(), priority);
+	if(id == 0) {
+		return send(std::move(message), priority, deadline);
+	}
+
+	// Deadline of the last bytes covers the length prefix sent before them
+	auto res = send_on_stream(std::move(message), id, std::min<uint8_t>(priority, num_priorities - 1), deadline);
+
+	if(res < 0) {
+		// Length prefix went out alone, the receiver drops it on flush
+		cut_through_send_flush(id);
+		cut_through_send_end(id);
+		return res;
+	}
+
+	cut_through_send_end(id);
+
+	return 0;
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::cut_through_send(
+	core::SharedBuffer &&message,
+	uint8_t priority,
+	uint64_t deadline
 ) {
-	auto id = cut_through_send_start(message.size());
+	auto id = cut_through_send_start(message.size(), priority);
 	if(id == 0) {
-		return send(std::move(message));
+		return send(std::move(message), priority, deadline);
 	}
 
-	auto res = cut_through_send_bytes(id, std::move(message));
+	// Deadline of the last bytes covers the length prefix sent before them
+	auto res = send_on_stream(std::move(message), id, std::min<uint8_t>(priority, num_priorities - 1), deadline);
 
 	if(res < 0) {
+		// Length prefix went out alone, the receiver drops it on flush
+		cut_through_send_flush(id);
+		cut_through_send_end(id);
 		return res;
 	}
 
@@ -435,7 +843,7 @@ uint16_t LpfTransport<
 	StreamTransportType,
 	SHOULD_CUT_THROUGH,
 	PREFIX_LENGTH
->::cut_through_send_start(uint64_t length) {
+>::cut_through_send_start(uint64_t length, uint8_t priority) {
 	if(cut_through_reserve_ids.size() == 0) {
 		SPDLOG_ERROR(
 			"Lpf {} >>>> {}: Exhausted CTR streams",
@@ -456,11 +864,17 @@ uint16_t LpfTransport<
 		id
 	);
 
+	// Stream keeps the class for the rest of the message
 	core::Buffer m(8);
 	m.write_uint64_be_unsafe(0, length);
-	auto res = transport.send(std::move(m), id);
+	auto res = send_on_stream(std::move(m), id, std::min<uint8_t>(priority, num_priorities - 1));
 
-	if(res < 0) return 0;
+	if(res < 0) {
+		// Nothing went out, the stream is free for the next message
+		cut_through_used_ids.erase(id);
+		cut_through_reserve_ids.push_front(id);
+		return 0;
+	}
 
 	return id;
 }
@@ -480,6 +894,21 @@ int LpfTransport<
 	return transport.send(std::move(bytes), id);
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::cut_through_send_bytes(uint16_t id, core::SharedBuffer &&bytes) {
+	return transport.send(std::move(bytes), id);
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -574,6 +1003,37 @@ int LpfTransport<
 	return delegate->cut_through_recv_bytes(*this, id, std::move(bytes));
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::cut_through_recv_bytes(uint16_t id, core::BufferChain &&bytes) {
+	// Chains are optional, fall back to fragments one by one
+	constexpr bool has_chain_recv_bytes = requires(
+		DelegateType& d
+	) {
+		d.cut_through_recv_bytes(*this, id, std::move(bytes));
+	};
+	if constexpr (has_chain_recv_bytes) {
+		return delegate->cut_through_recv_bytes(*this, id, std::move(bytes));
+	} else {
+		for(auto &segment : bytes) {
+			auto res = delegate->cut_through_recv_bytes(*this, id, std::move(segment).to_buffer());
+			if(res < 0) {
+				return res;
+			}
+		}
+		return 0;
+	}
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
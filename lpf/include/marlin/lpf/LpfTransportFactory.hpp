@@ -54,6 +54,13 @@ public:
 	using TransportFactoryScaffoldType::dial;
 
 	using TransportFactoryScaffoldType::get_transport;
+
+	/// Send parity of DATA packets on stream transports created from now on, if the stream layer supports it
+	void set_fec_enabled(bool enabled) {
+		if constexpr (requires { base_factory.set_fec_enabled(enabled); }) {
+			base_factory.set_fec_enabled(enabled);
+		}
+	}
 };
 
 } // namespace lpf
@@ -2,6 +2,7 @@
 #define MARLIN_LPF_STFB_HPP
 
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 
 namespace marlin {
 namespace lpf {
@@ -18,10 +19,10 @@ public:
 
 	uint16_t id = 0;
 
-	template<typename Delegate>
+	template<typename Delegate, typename BufferType>
 	int did_recv(
 		Delegate &delegate,
-		core::Buffer &&bytes
+		BufferType &&bytes
 	) {
 		if(bytes.size() == 0) return 0;
 
@@ -76,6 +77,22 @@ public:
 
 		return 0;
 	}
+
+	/// Contiguous fragments delivered together
+	template<typename Delegate>
+	int did_recv(
+		Delegate &delegate,
+		core::BufferChain &&bytes
+	) {
+		for(auto &segment : bytes) {
+			auto res = did_recv(delegate, std::move(segment));
+			if(res < 0) {
+				return res;
+			}
+		}
+
+		return 0;
+	}
 };
 
 } // namespace lpf
@@ -5,6 +5,7 @@
 #ifndef MARLIN_PUBSUB_PUBSUBNODE_HPP
 #define MARLIN_PUBSUB_PUBSUBNODE_HPP
 
+#include <marlin/core/SharedBuffer.hpp>
 #include <marlin/asyncio/core/Timer.hpp>
 #include <marlin/asyncio/udp/UdpTransportFactory.hpp>
 #include <marlin/asyncio/tcp/TcpTransportFactory.hpp>
@@ -15,6 +16,7 @@
 #include <map>
 #include <string>
 #include <list>
+#include <vector>
 #include <iostream>
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/bin_to_hex.h>
@@ -29,6 +31,7 @@
 #include <rapidjson/document.h>
 
 #include "marlin/pubsub/PubSubTransportSet.hpp"
+#include "marlin/pubsub/PubSubShards.hpp"
 #include "marlin/pubsub/DefaultAbci.hpp"
 #include "marlin/pubsub/attestation/EmptyAttester.hpp"
 #include "marlin/pubsub/witness/EmptyWitnesser.hpp"
@@ -72,7 +75,7 @@ struct StakeRequester {
 		{ "http", http_handler, 0, 0, 0, 0, 0 },
 		{ nullptr, nullptr, 0, 0, 0, 0, 0 }
 	};
-	void* loop = uv_default_loop();
+	void* loop;
 	DelegateType* delegate = nullptr;
 
 	std::string staking_url;
@@ -81,13 +84,20 @@ struct StakeRequester {
 	StakeRequester(StakeRequester const&) = delete;
 	StakeRequester(StakeRequester&&) = delete;
 
-	StakeRequester(std::tuple<std::string, std::string> args) : StakeRequester(std::get<0>(args), std::get<1>(args)) {}
+	StakeRequester(
+		std::tuple<std::string, std::string> args,
+		asyncio::LoopContext loop = {}
+	) : StakeRequester(std::get<0>(args), std::get<1>(args), loop) {}
 
-	StakeRequester(std::string staking_url, std::string network_id) : staking_url(staking_url), network_id(network_id), refresh_timer(this) {
+	StakeRequester(
+		std::string staking_url,
+		std::string network_id,
+		asyncio::LoopContext loop = {}
+	) : loop(loop.get()), staking_url(staking_url), network_id(network_id), refresh_timer(this, loop) {
 		lws_set_log_level(1, NULL);
 
 		std::memset(&info, 0, sizeof(info));  // prevents some issues with garbage values
-		info.foreign_loops = &loop;
+		info.foreign_loops = &this->loop;
 		info.port = CONTEXT_PORT_NO_LISTEN;
 		info.options = LWS_SERVER_OPTION_LIBUV | LWS_SERVER_OPTION_UV_NO_SIGSEGV_SIGFPE_SPIN;
 		info.connect_timeout_secs = 5;
@@ -518,13 +528,11 @@ private:
 	);
 
 	int did_recv_MESSAGE(BaseTransport &transport, core::Buffer &&message);
-	void send_MESSAGE(
+	int send_MESSAGE(
 		BaseTransport &transport,
-		uint16_t channel,
-		uint64_t message_id,
-		const uint8_t *data,
-		uint64_t size,
-		MessageHeaderType prev_header
+		core::SharedBuffer &&message,
+		uint8_t priority = BaseTransport::default_priority,
+		uint64_t deadline = 0
 	);
 
 	void did_recv_HEARTBEAT(BaseTransport &transport, core::Buffer &&message);
@@ -557,6 +565,7 @@ public:
 	int did_recv(BaseTransport &transport, core::Buffer &&message);
 	void did_send(BaseTransport &transport, core::Buffer &&message);
 	void did_close(BaseTransport &transport, uint16_t reason);
+	void did_drain(BaseTransport &transport);
 
 	int dial(core::SocketAddress const &addr, uint8_t const *remote_static_pk);
 
@@ -575,7 +584,9 @@ public:
 		std::tuple<std::string, std::string> req,
 		std::tuple<AttesterArgs...> attester_args = {},
 		std::tuple<WitnesserArgs...> witnesser_args = {},
-		std::tuple<AbciArgs...> abci_args = {}
+		std::tuple<AbciArgs...> abci_args = {},
+		asyncio::UdpReusePort reuse_port = {},
+		asyncio::LoopContext loop = {}
 	);
 	PubSubDelegate *delegate;
 
@@ -605,15 +616,29 @@ public:
 		BaseTransport *transport,
 		uint16_t channel,
 		uint64_t message_id,
-		const uint8_t *data,
-		uint64_t size,
-		MessageHeaderType prev_header = {}
+		core::SharedBuffer &&message
 	);
 
 	void subscribe(ClientKey client_key, core::SocketAddress const &addr, uint8_t const *remote_static_pk);
 	void subscribe(core::SocketAddress const &addr, uint8_t const *remote_static_pk);
 	void unsubscribe(core::SocketAddress const &addr);
+
+	/// Send messages of the channel in the given priority class, 0 is sent first
+	/// Latency critical channels are never held up behind bulk ones
+	void set_channel_priority(uint16_t channel, uint8_t priority);
+	/// Send forward error correction parity on connections made from now on,
+	/// trades bandwidth for fewer retransmissions on lossy paths
+	void set_fec_enabled(bool enabled);
+	/// Give up on messages of the channel not delivered within the given milliseconds of being sent, 0 never does
+	/// Stale blocks then stop taking bandwidth from fresh ones on congested links
+	void set_channel_timeout(uint16_t channel, uint64_t timeout);
 private:
+	std::unordered_map<uint16_t, uint8_t> channel_priorities;
+	uint8_t get_channel_priority(uint16_t channel);
+	std::unordered_map<uint16_t, uint64_t> channel_timeouts;
+	/// Deadline for messages of the channel sent now, 0 if there is none
+	uint64_t get_channel_deadline(uint16_t channel);
+
 	template<
 		typename ...AttesterArgs,
 		typename ...WitnesserArgs,
@@ -631,6 +656,8 @@ private:
 		std::tuple<AttesterArgs...> attester_args,
 		std::tuple<WitnesserArgs...> witnesser_args,
 		std::tuple<AbciArgs...> abci_args,
+		asyncio::UdpReusePort reuse_port,
+		asyncio::LoopContext loop,
 		// Need the below args for tuple destructuring
 		std::index_sequence<AI...>,
 		std::index_sequence<WI...>,
@@ -686,10 +713,27 @@ private:
 		// );
 	}
 
+//---------------- Shards ----------------//
+public:
+	void set_shards(PubSubShards<Self> *shards, size_t shard);
+	void did_recv_shard_message(
+		uint16_t channel,
+		uint64_t message_id,
+		uint8_t const *data,
+		uint64_t size,
+		MessageHeaderType header
+	);
+private:
+	PubSubShards<Self> *shards = nullptr;
+	size_t shard_idx = 0;
+	/// Set while relaying a message posted by another shard, prevents fanning it back out
+	bool is_shard_message = false;
+
 //---------------- Cut through ----------------//
 public:
 	void cut_through_recv_start(BaseTransport &transport, uint16_t id, uint64_t length);
 	int cut_through_recv_bytes(BaseTransport &transport, uint16_t id, core::Buffer &&bytes);
+	int cut_through_recv_bytes(BaseTransport &transport, uint16_t id, core::BufferChain &&bytes);
 	void cut_through_recv_end(BaseTransport &transport, uint16_t id);
 	void cut_through_recv_flush(BaseTransport &transport, uint16_t id);
 	void cut_through_recv_skip(BaseTransport &transport, uint16_t id);
@@ -717,6 +761,30 @@ private:
 		pairhash
 	> cut_through_header_recv;
 
+	/// Message cut through while shards are set, collected whole for the other shards
+	struct ShardCopy {
+		uint16_t channel;
+		uint64_t message_id;
+		uint64_t attestation_size;
+		uint64_t witness_size;
+		/// Attestation, witness and payload, the message less its leading header
+		core::SharedBuffer bytes;
+		/// Bytes of the message received so far, header included
+		uint64_t received;
+	};
+	std::unordered_map<
+		std::pair<BaseTransport *, uint16_t>,
+		ShardCopy,
+		pairhash
+	> cut_through_shard_copies;
+	void shard_copy_bytes(std::pair<BaseTransport *, uint16_t> const &key, uint8_t const *data, uint64_t size);
+
+	/// Peers whose send buffer is full, messages skip them until it drains so that slow peers
+	/// cost bounded memory instead of their connection
+	std::unordered_set<BaseTransport *> congested_conns;
+	/// Skip the peer until its send buffer drains
+	void did_fill_send_buffer(BaseTransport *transport);
+
 	uint8_t const* keys = nullptr;
 };
 
@@ -1177,7 +1245,9 @@ core::Buffer PUBSUBNODETYPE::create_MESSAGE(
 	uint64_t buf_size = 11 + size;
 	buf_size += attester.attestation_size(message_id, channel, data, size, prev_header);
 	buf_size += witnesser.witness_size(prev_header);
-	core::Buffer m({3}, buf_size);
+	// Headroom lets lower layers prefix the message in place
+	auto m = core::Buffer::with_headroom(buf_size, 8);
+	m.write_uint8_unsafe(0, 3);
 	m.write_uint64_be_unsafe(1, message_id);
 	m.write_uint16_be_unsafe(9, channel);
 
@@ -1195,31 +1265,33 @@ core::Buffer PUBSUBNODETYPE::create_MESSAGE(
 }
 
 template<PUBSUBNODE_TEMPLATE>
-void PUBSUBNODETYPE::send_MESSAGE(
+int PUBSUBNODETYPE::send_MESSAGE(
 	BaseTransport &transport,
-	uint16_t channel,
-	uint64_t message_id,
-	const uint8_t *data,
-	uint64_t size,
-	MessageHeaderType prev_header
+	core::SharedBuffer &&message,
+	uint8_t priority,
+	uint64_t deadline
 ) {
-	auto m = create_MESSAGE(
-		channel,
-		message_id,
-		data,
-		size,
-		prev_header
-	);
-	transport.send(std::move(m));
+	return transport.send(std::move(message), priority, deadline);
 }
 
 template<PUBSUBNODE_TEMPLATE>
 void PUBSUBNODETYPE::send_HEARTBEAT(
 	BaseTransport &transport
 ) {
-	core::Buffer m({4}, 1);
+	// Heartbeats have to be acked so that a dead peer times out, a PING is acked
+	// without going through stream data, receivers ignore the heartbeat message otherwise
+	constexpr bool has_ping = requires(
+		BaseTransport& t
+	) {
+		t.send_ping();
+	};
+	if constexpr (has_ping) {
+		if(transport.send_ping() == 0) {
+			return;
+		}
+	}
 
-	transport.send(std::move(m));
+	transport.send(core::Buffer({4}, 1));
 }
 
 //---------------- PubSub functions end ----------------//
@@ -1352,6 +1424,7 @@ void PUBSUBNODETYPE::did_close(BaseTransport &transport, uint16_t reason) {
 	// );
 
 	beacon_map.erase(transport.dst_addr);
+	congested_conns.erase(&transport);
 	for(auto& [client_key, conns] : conn_map) {
 		bool is_sol = remove_conn(conns.sol_conns, transport) || remove_conn(conns.sol_standby_conns, transport);
 		if (is_sol && reason == 1) {
@@ -1368,6 +1441,7 @@ void PUBSUBNODETYPE::did_close(BaseTransport &transport, uint16_t reason) {
 			}
 
 			cut_through_map.erase(std::make_pair(&transport, id));
+			cut_through_shard_copies.erase(std::make_pair(&transport, id));
 		}
 
 		// Call Manage_subscribers to rebalance lists
@@ -1389,6 +1463,14 @@ void PUBSUBNODETYPE::did_close(BaseTransport &transport, uint16_t reason) {
 	}
 }
 
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::did_drain(BaseTransport &transport) {
+	// Peer takes messages again, the ones skipped meanwhile are not resent
+	if(congested_conns.erase(&transport) > 0) {
+		SPDLOG_DEBUG("Send buffer drained: {}", transport.dst_addr.to_string());
+	}
+}
+
 //---------------- Transport delegate functions end ----------------//
 
 template<PUBSUBNODE_TEMPLATE>
@@ -1405,7 +1487,9 @@ PUBSUBNODETYPE::PubSubNode(
 	std::tuple<std::string, std::string> req,
 	std::tuple<AttesterArgs...> attester_args,
 	std::tuple<WitnesserArgs...> witnesser_args,
-	std::tuple<AbciArgs...> abci_args
+	std::tuple<AbciArgs...> abci_args,
+	asyncio::UdpReusePort reuse_port,
+	asyncio::LoopContext loop
 ) : PubSubNode(
 	addr,
 	max_sol,
@@ -1415,6 +1499,8 @@ PUBSUBNODETYPE::PubSubNode(
 	std::move(attester_args),
 	std::move(witnesser_args),
 	std::move(abci_args),
+	reuse_port,
+	loop,
 	std::index_sequence_for<AttesterArgs...>{},
 	std::index_sequence_for<WitnesserArgs...>{},
 	std::index_sequence_for<AbciArgs...>{}
@@ -1438,20 +1524,23 @@ PUBSUBNODETYPE::PubSubNode(
 	std::tuple<AttesterArgs...> attester_args [[maybe_unused]],
 	std::tuple<WitnesserArgs...> witnesser_args [[maybe_unused]],
 	std::tuple<AbciArgs...> abci_args [[maybe_unused]],
+	asyncio::UdpReusePort reuse_port,
+	asyncio::LoopContext loop,
 	std::index_sequence<AI...>,
 	std::index_sequence<WI...>,
 	std::index_sequence<ABI...>
 ) : max_sol_conns(max_sol),
 	max_unsol_conns(max_unsol),
-	streq(std::move(req)),
+	streq(std::move(req), loop),
 	attester(std::get<AI>(attester_args)...),
 	witnesser(std::get<WI>(witnesser_args)...),
 	abci(this, std::get<ABI>(abci_args)...),
-	peer_selection_timer(this),
-	blacklist_timer(this),
+	peer_selection_timer(this, loop),
+	blacklist_timer(this, loop),
+	f(1, false, reuse_port, loop),
 	message_id_gen(std::random_device()()),
 	message_id_events(256),
-	message_id_timer(this),
+	message_id_timer(this, loop),
 	keys(keys)
 {
 	f.bind(addr);
@@ -1465,6 +1554,17 @@ PUBSUBNODETYPE::PubSubNode(
 
 template<PUBSUBNODE_TEMPLATE>
 int PUBSUBNODETYPE::dial(core::SocketAddress const &addr, uint8_t const *remote_static_pk) {
+	// Replies from the peer only reach the socket of the shard serving it, dial from there
+	if(shards != nullptr && shards->shard_of(addr) != shard_idx) {
+		std::array<uint8_t, crypto_box_PUBLICKEYBYTES> pk;
+		std::memcpy(pk.data(), remote_static_pk, pk.size());
+		shards->post(shards->shard_of(addr), [addr, pk](Self &node) {
+			node.dial(addr, pk.data());
+		});
+
+		return 0;
+	}
+
 	SPDLOG_DEBUG(
 		"SENDING DIAL TO: {}",
 		addr.to_string()
@@ -1521,6 +1621,38 @@ void PUBSUBNODETYPE::send_message_on_channel(
 	send_message_on_channel_impl(channel, message_id, data, size, excluded, prev_header);
 }
 
+//! registers the shard set this node belongs to, messages it relays are fanned out to the other shards
+/*!
+	\param shards set of nodes on other loop shards
+	\param shard index of this node's shard
+*/
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_shards(PubSubShards<Self> *shards, size_t shard) {
+	this->shards = shards;
+	this->shard_idx = shard;
+}
+
+//! relays a message posted by the node of another shard to this node's peers
+/*!
+	\param channel channel of the message
+	\param message_id msg id
+	\param data uint8_t* byte sequence of message
+	\param size of the message
+	\param header attestation and witness of the message
+*/
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::did_recv_shard_message(
+	uint16_t channel,
+	uint64_t message_id,
+	uint8_t const *data,
+	uint64_t size,
+	MessageHeaderType header
+) {
+	is_shard_message = true;
+	send_message_on_channel(channel, message_id, data, size, nullptr, header);
+	is_shard_message = false;
+}
+
 template<PUBSUBNODE_TEMPLATE>
 void PUBSUBNODETYPE::send_message_on_channel_impl(
 	uint16_t channel,
@@ -1530,6 +1662,12 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 	core::SocketAddress const *excluded,
 	MessageHeaderType prev_header
 ) {
+	if(shards != nullptr && !is_shard_message) {
+		shards->fan_out(shard_idx, channel, message_id, data, size, prev_header);
+	}
+
+	std::vector<BaseTransport*> targets;
+
 	if(conn_map.size() <= 5) {
 		for(auto& [client_key, conns] : conn_map) {
 			SPDLOG_DEBUG("Sending message {} to 0x{:spn}", message_id, spdlog::to_hex(client_key.data(), client_key.data()+client_key.size()));
@@ -1542,7 +1680,7 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 				// Exclude given address, usually sender tp prevent loops
 				if(excluded != nullptr && (*it)->dst_addr == *excluded)
 					continue;
-				send_message_with_cut_through_check(*it, channel, message_id, data, size, prev_header);
+				targets.push_back(*it);
 			}
 		}
 	} else {
@@ -1559,7 +1697,7 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 				// Exclude given address, usually sender tp prevent loops
 				if(excluded != nullptr && (*it)->dst_addr == *excluded)
 					continue;
-				send_message_with_cut_through_check(*it, channel, message_id, data, size, prev_header);
+				targets.push_back(*it);
 			}
 		}
 	}
@@ -1572,7 +1710,26 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 		// Exclude given address, usually sender tp prevent loops
 		if(excluded != nullptr && (*it)->dst_addr == *excluded)
 			continue;
-		send_message_with_cut_through_check(*it, channel, message_id, data, size, prev_header);
+		targets.push_back(*it);
+	}
+
+	if(targets.empty()) {
+		return;
+	}
+
+	// Attestation and witness do not depend on the peer,
+	// encode once and share the same bytes across every target
+	auto m = create_MESSAGE(
+		channel,
+		message_id,
+		data,
+		size,
+		prev_header
+	);
+
+	core::SharedBuffer shared(std::move(m));
+	for(auto* target : targets) {
+		send_message_with_cut_through_check(target, channel, message_id, shared.clone());
 	}
 }
 
@@ -1582,9 +1739,7 @@ void PUBSUBNODETYPE::send_message_with_cut_through_check(
 	BaseTransport *transport,
 	uint16_t channel,
 	uint64_t message_id,
-	const uint8_t *data,
-	uint64_t size,
-	MessageHeaderType prev_header
+	core::SharedBuffer &&message
 ) {
 	SPDLOG_DEBUG(
 		"Sending message {} on channel {} to {}",
@@ -1593,27 +1748,34 @@ void PUBSUBNODETYPE::send_message_with_cut_through_check(
 		transport->dst_addr.to_string()
 	);
 
-	if(size > 50000) {
-		auto m = create_MESSAGE(
-			channel,
-			message_id,
-			data,
-			size,
-			prev_header
-		);
+	if(congested_conns.contains(transport)) {
+		SPDLOG_DEBUG("Skipping message {} to congested {}", message_id, transport->dst_addr.to_string());
+		return;
+	}
 
-		auto res = transport->cut_through_send(std::move(m));
+	auto priority = get_channel_priority(channel);
+	auto deadline = get_channel_deadline(channel);
 
-		// TODO: Handle better
-		if(res < 0) {
+	if(message.size() > 50000) {
+		auto res = transport->cut_through_send(std::move(message), priority, deadline);
+
+		if(res == -1) {
+			did_fill_send_buffer(transport);
+		} else if(res < 0) {
 			SPDLOG_ERROR("Cut through send failed");
 			transport->close();
 		}
-	} else {
-		send_MESSAGE(*transport, channel, message_id, data, size, prev_header);
+	} else if(send_MESSAGE(*transport, std::move(message), priority, deadline) == -1) {
+		did_fill_send_buffer(transport);
 	}
 }
 
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::did_fill_send_buffer(BaseTransport *transport) {
+	SPDLOG_DEBUG("Send buffer full: {}", transport->dst_addr.to_string());
+	congested_conns.insert(transport);
+}
+
 template<PUBSUBNODE_TEMPLATE>
 void PUBSUBNODETYPE::subscribe(
 	ClientKey client_key,
@@ -1621,6 +1783,17 @@ void PUBSUBNODETYPE::subscribe(
 	uint8_t const *remote_static_pk
 ) {
 	// TODO: written so that relays with full unsol list dont occupy sol/standby lists in clients, and similarly masters with full unsol list dont occupy sol/standby lists in relays
+	// Connection to the peer lives on the shard serving it
+	if(shards != nullptr && shards->shard_of(addr) != shard_idx) {
+		std::array<uint8_t, crypto_box_PUBLICKEYBYTES> pk;
+		std::memcpy(pk.data(), remote_static_pk, pk.size());
+		shards->post(shards->shard_of(addr), [client_key, addr, pk](Self &node) {
+			node.subscribe(client_key, addr, pk.data());
+		});
+
+		return;
+	}
+
 	if (blacklist_addr.find(addr) != blacklist_addr.end())
 		return;
 
@@ -1667,6 +1840,41 @@ void PUBSUBNODETYPE::unsubscribe(core::SocketAddress const &addr) {
 	);
 }
 
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_channel_priority(uint16_t channel, uint8_t priority) {
+	channel_priorities[channel] = priority;
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_fec_enabled(bool enabled) {
+	f.set_fec_enabled(enabled);
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_channel_timeout(uint16_t channel, uint64_t timeout) {
+	channel_timeouts[channel] = timeout;
+}
+
+template<PUBSUBNODE_TEMPLATE>
+uint8_t PUBSUBNODETYPE::get_channel_priority(uint16_t channel) {
+	auto iter = channel_priorities.find(channel);
+	if(iter == channel_priorities.end()) {
+		return BaseTransport::default_priority;
+	}
+
+	return iter->second;
+}
+
+template<PUBSUBNODE_TEMPLATE>
+uint64_t PUBSUBNODETYPE::get_channel_deadline(uint16_t channel) {
+	auto iter = channel_timeouts.find(channel);
+	if(iter == channel_timeouts.end() || iter->second == 0) {
+		return 0;
+	}
+
+	return asyncio::EventLoop::now() + iter->second;
+}
+
 template<PUBSUBNODE_TEMPLATE>
 bool PUBSUBNODETYPE::add_sol_conn(ClientKey client_key, BaseTransport &transport) {
 	SPDLOG_DEBUG("add sol: {}, {}", spdlog::to_hex(client_key.data(), client_key.data()+client_key.size()), transport.dst_addr.to_string());
@@ -1762,6 +1970,31 @@ bool PUBSUBNODETYPE::remove_conn(TransportSet &t_set, BaseTransport &transport)
 	return false;
 }
 
+//! appends bytes of a message being cut through to its copy for the other shards, if any
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::shard_copy_bytes(
+	std::pair<BaseTransport *, uint16_t> const &key,
+	uint8_t const *data,
+	uint64_t size
+) {
+	auto iter = cut_through_shard_copies.find(key);
+	if(iter == cut_through_shard_copies.end()) {
+		return;
+	}
+
+	auto &copy = iter->second;
+	if(copy.received + size > copy.bytes.size() + 11) {
+		// Longer than announced, not relayed to other shards
+		cut_through_shard_copies.erase(iter);
+		return;
+	}
+
+	// Leading header is not copied
+	auto skip = std::min<uint64_t>(size, 11 - std::min<uint64_t>(copy.received, 11));
+	copy.bytes.write_unsafe(copy.received + skip - 11, data + skip, size - skip);
+	copy.received += size;
+}
+
 template<PUBSUBNODE_TEMPLATE>
 void PUBSUBNODETYPE::cut_through_recv_start(
 	BaseTransport &transport,
@@ -1874,12 +2107,13 @@ int PUBSUBNODETYPE::cut_through_recv_bytes(
 		for(auto& [_, conns] : conn_map) {
 			(void)_;
 			for(auto *subscriber : conns.sol_conns) {
-				if(&transport == subscriber) continue;
+				if(&transport == subscriber || congested_conns.contains(subscriber)) continue;
 				bool found = witnesser.contains(header, subscriber->get_remote_static_pk());
 				if (found) continue;
 
 				auto sub_id = subscriber->cut_through_send_start(
-					cut_through_length[std::make_pair(&transport, id)]
+					cut_through_length[std::make_pair(&transport, id)],
+					get_channel_priority(channel)
 				);
 				if(sub_id == 0) {
 					SPDLOG_ERROR("Cannot send to subscriber");
@@ -1893,12 +2127,13 @@ int PUBSUBNODETYPE::cut_through_recv_bytes(
 		}
 
 		for(auto *subscriber : unsol_conns) {
-			if(&transport == subscriber) continue;
+			if(&transport == subscriber || congested_conns.contains(subscriber)) continue;
 			bool found = witnesser.contains(header, subscriber->get_remote_static_pk());
 			if (found) continue;
 
 			auto sub_id = subscriber->cut_through_send_start(
-				cut_through_length[std::make_pair(&transport, id)]
+				cut_through_length[std::make_pair(&transport, id)],
+				get_channel_priority(channel)
 			);
 			if(sub_id == 0) {
 				SPDLOG_ERROR("Cannot send to subscriber");
@@ -1912,25 +2147,110 @@ int PUBSUBNODETYPE::cut_through_recv_bytes(
 
 		witnesser.witness(header, bytes, 11 + header.attestation_size);
 
+		// Other shards relay it once it is received in full
+		auto length = cut_through_length[std::make_pair(&transport, id)];
+		if(shards != nullptr && length >= 11) {
+			cut_through_shard_copies.insert_or_assign(std::make_pair(&transport, id), ShardCopy{
+				channel,
+				message_id,
+				header.attestation_size,
+				header.witness_size,
+				core::SharedBuffer(length - 11),
+				0
+			});
+		}
+
 		return cut_through_recv_bytes(transport, id, std::move(bytes));
 	} else {
-		for(auto [subscriber, sub_id] : cut_through_map[std::make_pair(&transport, id)]) {
-			auto sub_bytes = core::Buffer(bytes.size());
-			sub_bytes.write_unsafe(0, bytes.data(), bytes.size());
-
-			auto res = subscriber->cut_through_send_bytes(sub_id, std::move(sub_bytes));
+		shard_copy_bytes(std::make_pair(&transport, id), bytes.data(), bytes.size());
+
+		core::SharedBuffer shared(std::move(bytes));
+		auto &subscribers = cut_through_map[std::make_pair(&transport, id)];
+		for(auto iter = subscribers.begin(); iter != subscribers.end();) {
+			auto [subscriber, sub_id] = *iter;
+			auto res = subscriber->cut_through_send_bytes(sub_id, shared.clone());
+
+			if(res == -1) {
+				// Abandon the message for this subscriber, the rest of it is not relayed there
+				SPDLOG_DEBUG("Cut through send failed: {}", subscriber->dst_addr.to_string());
+				subscriber->cut_through_send_flush(sub_id);
+				subscriber->cut_through_send_end(sub_id);
+				iter = subscribers.erase(iter);
+				did_fill_send_buffer(subscriber);
+				continue;
+			}
 
-			// TODO: Handle better
 			if(res < 0) {
 				SPDLOG_ERROR("Cut through send failed");
 				subscriber->close();
 			}
+			iter++;
 		}
 	}
 
 	return 0;
 }
 
+template<PUBSUBNODE_TEMPLATE>
+int PUBSUBNODETYPE::cut_through_recv_bytes(
+	BaseTransport &transport,
+	uint16_t id,
+	core::BufferChain &&bytes
+) {
+	auto key = std::make_pair(&transport, id);
+
+	if(!cut_through_header_recv[key]) {
+		// Header is expected in the first fragment
+		auto res = cut_through_recv_bytes(transport, id, bytes.pop_front().to_buffer());
+		if(res < 0 || bytes.num_segments() == 0) {
+			return res;
+		}
+	}
+
+	SPDLOG_DEBUG(
+		"Pubsub {} <<<< {}: CTR recv: {}, {}",
+		transport.src_addr.to_string(),
+		transport.dst_addr.to_string(),
+		id,
+		bytes.size()
+	);
+
+	for(auto &segment : bytes) {
+		shard_copy_bytes(key, segment.data(), segment.size());
+	}
+
+	// Look up subscribers once for all fragments
+	auto &subscribers = cut_through_map[key];
+	for(auto iter = subscribers.begin(); iter != subscribers.end();) {
+		auto [subscriber, sub_id] = *iter;
+		int res = 0;
+		for(auto &segment : bytes) {
+			res = subscriber->cut_through_send_bytes(sub_id, segment.clone());
+			if(res < 0) {
+				break;
+			}
+		}
+
+		if(res == -1) {
+			// Abandon the message for this subscriber, the rest of it is not relayed there
+			SPDLOG_DEBUG("Cut through send failed: {}", subscriber->dst_addr.to_string());
+			subscriber->cut_through_send_flush(sub_id);
+			subscriber->cut_through_send_end(sub_id);
+			iter = subscribers.erase(iter);
+			did_fill_send_buffer(subscriber);
+			continue;
+		}
+
+		if(res < 0) {
+			SPDLOG_ERROR("Cut through send failed");
+			subscriber->close();
+		}
+		iter++;
+	}
+
+	return 0;
+}
+
 template<PUBSUBNODE_TEMPLATE>
 void PUBSUBNODETYPE::cut_through_recv_end(
 	BaseTransport &transport,
@@ -1939,6 +2259,23 @@ void PUBSUBNODETYPE::cut_through_recv_end(
 	for(auto [subscriber, sub_id] : cut_through_map[std::make_pair(&transport, id)]) {
 		subscriber->cut_through_send_end(sub_id);
 	}
+
+	auto iter = cut_through_shard_copies.find(std::make_pair(&transport, id));
+	if(iter != cut_through_shard_copies.end()) {
+		auto &copy = iter->second;
+		if(copy.received == copy.bytes.size() + 11) {
+			shards->fan_out(
+				shard_idx,
+				copy.channel,
+				copy.message_id,
+				std::move(copy.bytes),
+				copy.attestation_size,
+				copy.witness_size
+			);
+		}
+		cut_through_shard_copies.erase(iter);
+	}
+
 	SPDLOG_DEBUG(
 		"Pubsub {} <<<< {}: CTR end: {}",
 		transport.src_addr.to_string(),
@@ -1955,6 +2292,7 @@ void PUBSUBNODETYPE::cut_through_recv_flush(
 	for(auto [subscriber, sub_id] : cut_through_map[std::make_pair(&transport, id)]) {
 		subscriber->cut_through_send_flush(sub_id);
 	}
+	cut_through_shard_copies.erase(std::make_pair(&transport, id));
 	SPDLOG_DEBUG(
 		"Pubsub {} <<<< {}: CTR flush: {}",
 		transport.src_addr.to_string(),
@@ -0,0 +1,130 @@
+/*! \file PubSubShards.hpp
+	\brief Fan-out of pubsub messages between nodes running on different loop shards
+*/
+
+#ifndef MARLIN_PUBSUB_PUBSUBSHARDS_HPP
+#define MARLIN_PUBSUB_PUBSUBSHARDS_HPP
+
+#include <marlin/core/SharedBuffer.hpp>
+#include <marlin/asyncio/core/LoopShards.hpp>
+
+#include <vector>
+
+namespace marlin {
+namespace pubsub {
+
+/// @brief Set of PubSubNodes, one per loop shard, that relay each other's messages
+/// @details Every shard serves its own peers and dials them from its own socket. A message relayed
+/// by one node is copied once and posted to the other shards, whose nodes relay it to their own peers.
+template<typename PubSubNodeType>
+class PubSubShards {
+private:
+	using MessageHeaderType = typename PubSubNodeType::MessageHeaderType;
+
+	asyncio::LoopShards &loops;
+	/// Node of each shard, only accessed from that shard's thread
+	std::vector<PubSubNodeType *> nodes;
+public:
+	explicit PubSubShards(asyncio::LoopShards &loops) : loops(loops), nodes(loops.size(), nullptr) {}
+
+	/// Register the node of the given shard, call from that shard's thread
+	void set_node(size_t shard, PubSubNodeType *node) {
+		nodes[shard] = node;
+		if(node != nullptr) {
+			node->set_shards(this, shard);
+		}
+	}
+
+	/// Shard serving the given peer, dials to it have to be made from that shard's socket
+	size_t shard_of(core::SocketAddress const &addr) const {
+		return loops.shard_of(addr);
+	}
+
+	/// Run f with the node of the given shard, on that shard's thread
+	template<typename F>
+	void post(size_t shard, F &&f) {
+		loops.post(shard, [this, shard, f = std::forward<F>(f)]() mutable {
+			auto *node = nodes[shard];
+			if(node == nullptr) {
+				return;
+			}
+
+			f(*node);
+		});
+	}
+
+	/// Post a message relayed by the node of one shard to the nodes of every other shard
+	void fan_out(
+		size_t from,
+		uint16_t channel,
+		uint64_t message_id,
+		uint8_t const *data,
+		uint64_t size,
+		MessageHeaderType header
+	) {
+		if(loops.size() < 2) {
+			return;
+		}
+
+		// Header fields point into the message, copy them along with it
+		auto attestation_size = header.attestation_size;
+		auto witness_size = header.witness_size;
+		core::SharedBuffer bytes(attestation_size + witness_size + size);
+		if(attestation_size > 0) {
+			bytes.write_unsafe(0, header.attestation_data, attestation_size);
+		}
+		if(witness_size > 0) {
+			bytes.write_unsafe(attestation_size, header.witness_data, witness_size);
+		}
+		bytes.write_unsafe(attestation_size + witness_size, data, size);
+
+		fan_out(from, channel, message_id, std::move(bytes), attestation_size, witness_size);
+	}
+
+	/// Post a message already laid out as attestation, witness and payload to the nodes of every other shard
+	void fan_out(
+		size_t from,
+		uint16_t channel,
+		uint64_t message_id,
+		core::SharedBuffer &&bytes,
+		uint64_t attestation_size,
+		uint64_t witness_size
+	) {
+		if(loops.size() < 2) {
+			return;
+		}
+
+		for(size_t shard = 0; shard < loops.size(); shard++) {
+			if(shard == from) {
+				continue;
+			}
+
+			post(shard, [
+				channel,
+				message_id,
+				attestation_size,
+				witness_size,
+				bytes = bytes.clone()
+			](PubSubNodeType &node) {
+				MessageHeaderType header = {};
+				header.attestation_data = bytes.data();
+				header.attestation_size = attestation_size;
+				header.witness_data = bytes.data() + attestation_size;
+				header.witness_size = witness_size;
+
+				node.did_recv_shard_message(
+					channel,
+					message_id,
+					bytes.data() + attestation_size + witness_size,
+					bytes.size() - attestation_size - witness_size,
+					header
+				);
+			});
+		}
+	}
+};
+
+} // namespace pubsub
+} // namespace marlin
+
+#endif // MARLIN_PUBSUB_PUBSUBSHARDS_HPP
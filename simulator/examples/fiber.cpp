@@ -24,7 +24,7 @@ struct Delegate {
 			addr.to_string(),
 			packet.size()
 		);
-		if(Simulator::default_instance.current_tick() > 10) {
+		if(Simulator::default_instance.current_tick() > 10 * Simulator::ticks_per_ms) {
 			// transport.close();
 		} else {
 			fiber.send(Buffer({0,0,0,0,0,0,0,0,0,0}, 10), addr);
@@ -41,7 +41,7 @@ struct Delegate {
 			packet.size()
 		);
 
-		if(Simulator::default_instance.current_tick() > 9) {
+		if(Simulator::default_instance.current_tick() > 9 * Simulator::ticks_per_ms) {
 			// transport.close();
 		}
 
@@ -20,7 +20,7 @@ struct PingPongNode final : public NetworkListener<NetworkInterfaceType> {
 		taddr.set_port(port);
 		cout<<taddr.to_string()<<": Did recv: "<<Simulator::default_instance.current_tick()<<endl;
 
-		if(Simulator::default_instance.current_tick() >= 10) return;
+		if(Simulator::default_instance.current_tick() >= 10 * Simulator::ticks_per_ms) return;
 
 		interface.send(Simulator::default_instance, taddr, addr, std::move(message));
 	}
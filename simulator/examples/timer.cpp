@@ -12,7 +12,7 @@ public:
 	void timer_cb() {
 		cout<<"Timer tick: "<<Simulator::default_instance.current_tick()<<endl;
 
-		if(Simulator::default_instance.current_tick() >= 10) {
+		if(Simulator::default_instance.current_tick() >= 10 * Simulator::ticks_per_ms) {
 			timer->stop();
 			return;
 		}
@@ -22,7 +22,7 @@ struct Delegate {
 			transport.dst_addr.to_string(),
 			packet.size()
 		);
-		if(Simulator::default_instance.current_tick() > 10) {
+		if(Simulator::default_instance.current_tick() > 10 * Simulator::ticks_per_ms) {
 			transport.close();
 		} else {
 			transport.send(Buffer({0,0,0,0,0,0,0,0,0,0}, 10));
@@ -37,7 +37,7 @@ struct Delegate {
 			packet.size()
 		);
 
-		if(Simulator::default_instance.current_tick() > 9) {
+		if(Simulator::default_instance.current_tick() > 9 * Simulator::ticks_per_ms) {
 			transport.close();
 		}
 	}
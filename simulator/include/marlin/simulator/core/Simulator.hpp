@@ -13,6 +13,9 @@ public:
 	// Intended to be used similar to uv_default_loop()
 	static Simulator default_instance;
 
+	/// Simulated time has microsecond resolution
+	static constexpr uint64_t ticks_per_ms = 1000;
+
 	EventQueue<Simulator> queue;
 	Simulator();
 
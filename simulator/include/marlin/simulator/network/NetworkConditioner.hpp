@@ -2,6 +2,7 @@
 #define MARLIN_SIMULATOR_NETWORK_NETWORKCONDITIONER_HPP
 
 #include "marlin/core/SocketAddress.hpp"
+#include "marlin/simulator/core/Simulator.hpp"
 
 namespace marlin {
 namespace simulator {
@@ -41,7 +42,7 @@ uint64_t NetworkConditioner::get_out_tick(
 	core::SocketAddress const&,
 	uint64_t
 ) {
-	return in_tick + 1;
+	return in_tick + Simulator::ticks_per_ms;
 }
 
 } // namespace simulator
@@ -26,7 +26,7 @@ private:
 		(((DelegateType*)(delegate))->*callback)();
 
 		if(repeat > 0) {
-			start<DelegateType, callback>(repeat, repeat);
+			start_us<DelegateType, callback>(repeat, repeat);
 		}
 	}
 
@@ -36,10 +36,11 @@ private:
 		(((DelegateType*)(delegate))->*callback)(*(DataType*)data);
 
 		if(repeat > 0) {
-			start<DelegateType, DataType, callback>(repeat, repeat);
+			start_us<DelegateType, DataType, callback>(repeat, repeat);
 		}
 	}
 
+	/// Repeat interval in ticks
 	uint64_t repeat = 0;
 	Event<Simulator>* next_event = nullptr;
 public:
@@ -53,8 +54,20 @@ public:
 		this->data = (void*)data;
 	}
 
+	/// Start the timer, timeout and repeat in milliseconds
 	template<typename DelegateType, void (DelegateType::*callback)()>
 	void start(uint64_t timeout, uint64_t repeat) {
+		start_us<DelegateType, callback>(timeout * Simulator::ticks_per_ms, repeat * Simulator::ticks_per_ms);
+	}
+
+	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
+	void start(uint64_t timeout, uint64_t repeat) {
+		start_us<DelegateType, DataType, callback>(timeout * Simulator::ticks_per_ms, repeat * Simulator::ticks_per_ms);
+	}
+
+	/// Start the timer, timeout and repeat in microseconds
+	template<typename DelegateType, void (DelegateType::*callback)()>
+	void start_us(uint64_t timeout, uint64_t repeat) {
 		stop();
 		this->repeat = repeat;
 		next_event = new TimerEvent<
@@ -70,7 +83,7 @@ public:
 	}
 
 	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
-	void start(uint64_t timeout, uint64_t repeat) {
+	void start_us(uint64_t timeout, uint64_t repeat) {
 		stop();
 		this->repeat = repeat;
 		next_event = new TimerEvent<
@@ -2,6 +2,7 @@
 #define MARLIN_STREAM_MESSAGES_HPP
 
 #include <marlin/core/Buffer.hpp>
+#include <utility>
 
 
 namespace marlin {
@@ -399,6 +400,272 @@ struct CLOSECONFWrapper {
 	}
 };
 
+/// REPAIR message template, XOR parity of consecutive DATA packets, acked like them under its own packet number
+template<typename BaseMessageType>
+struct REPAIRWrapper {
+	MARLIN_MESSAGES_BASE(REPAIRWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(packet_number, 10);
+	MARLIN_MESSAGES_UINT64_FIELD(first_packet_number, 18);
+	MARLIN_MESSAGES_UINT16_FIELD(count, 26);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(28);
+
+	/// Construct a REPAIR message with a given payload size
+	REPAIRWrapper(size_t payload_size) : base(28 + payload_size) {
+		base.set_payload({0, 13});
+	}
+
+	/// Validate the REPAIR message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 28 + payload_size;
+	}
+};
+
+/// TICKET message template, session resumption ticket issued by the server
+template<typename BaseMessageType>
+struct TICKETWrapper {
+	MARLIN_MESSAGES_BASE(TICKETWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(10);
+
+	/// Construct a TICKET message to hold the given payload size
+	TICKETWrapper(size_t payload_size) : base(10 + payload_size) {
+		base.set_payload({0, 14});
+	}
+
+	/// Validate the TICKET message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 10 + payload_size;
+	}
+};
+
+/// RESUME message template, dial with a session ticket carrying both connection ids
+template<typename BaseMessageType>
+struct RESUMEWrapper {
+	MARLIN_MESSAGES_BASE(RESUMEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(10);
+
+	/// Construct a RESUME message to hold the given payload size
+	RESUMEWrapper(size_t payload_size) : base(10 + payload_size) {
+		base.set_payload({0, 15});
+	}
+
+	/// Validate the RESUME message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 10 + payload_size;
+	}
+};
+
+/// PMTUPROBE message template, padded to the datagram size being probed
+template<typename BaseMessageType>
+struct PMTUPROBEWrapper {
+	MARLIN_MESSAGES_BASE(PMTUPROBEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT16_FIELD(size, 10);
+	MARLIN_MESSAGES_UINT64_FIELD(token, 12);
+
+	/// Construct a PMTUPROBE message of the given total size
+	PMTUPROBEWrapper(size_t size) : base(size) {
+		base.set_payload({0, 16});
+	}
+
+	/// Validate the PMTUPROBE message, arrived in full
+	[[nodiscard]] bool validate() const {
+		return base.payload_buffer().size() >= 20 &&
+			base.payload_buffer().size() == size();
+	}
+};
+
+/// PMTUACK message template, echoes the size and token of a probe followed by a tag and nonce
+template<typename BaseMessageType>
+struct PMTUACKWrapper {
+	MARLIN_MESSAGES_BASE(PMTUACKWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT16_FIELD(size, 10);
+	MARLIN_MESSAGES_UINT64_FIELD(token, 12);
+
+	/// Construct a PMTUACK message with room for the given trailer
+	PMTUACKWrapper(size_t trailer_size) : base(20 + trailer_size) {
+		base.set_payload({0, 17});
+	}
+
+	/// Validate the PMTUACK message
+	[[nodiscard]] bool validate(size_t trailer_size) const {
+		return base.payload_buffer().size() >= 20 + trailer_size;
+	}
+};
+
+/// WINDOW message template, flow control credit for the connection and for a number of streams
+template<typename BaseMessageType>
+struct WINDOWWrapper {
+	MARLIN_MESSAGES_BASE(WINDOWWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT16_FIELD(size, 10);
+	MARLIN_MESSAGES_UINT64_FIELD(max_data, 12);
+
+private:
+	/// Stream id and the stream offset it can be sent up to
+	struct credit {
+		using value_type = std::pair<uint16_t, uint64_t>;
+
+		static size_t size(core::WeakBuffer const&, uint64_t) {
+			return 10;
+		}
+
+		template<typename It>
+		static size_t size(It&&) {
+			return 10;
+		}
+
+		static value_type read(core::WeakBuffer const& buf, uint64_t offset) {
+			return {buf.read_uint16_le_unsafe(offset), buf.read_uint64_le_unsafe(offset + 2)};
+		}
+
+		static void write(core::WeakBuffer buf, uint64_t offset, value_type val) {
+			buf.write_uint16_le_unsafe(offset, val.first);
+			buf.write_uint64_le_unsafe(offset + 2, val.second);
+		}
+	};
+public:
+	MARLIN_MESSAGES_ARRAY_FIELD(credit, 20, 20 + 10*size())
+
+	/// Construct a WINDOW message to hold a given number of stream credits
+	WINDOWWrapper(size_t num_credits) : base(20 + 10*num_credits) {
+		base.set_payload({0, 18});
+	}
+
+	/// Validate the WINDOW message
+	[[nodiscard]] bool validate() const {
+		if(base.payload_buffer().size() < 20 || base.payload_buffer().size() != 20 + (size_t)size()*10) {
+			return false;
+		}
+		return true;
+	}
+};
+
+/// BLOCKED message template, asks the peer to repeat its flow control credit
+template<typename BaseMessageType>
+struct BLOCKEDWrapper {
+	MARLIN_MESSAGES_BASE(BLOCKEDWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+
+	/// Construct a BLOCKED message
+	BLOCKEDWrapper() : base(10) {
+		base.set_payload({0, 19});
+	}
+
+	/// Validate the BLOCKED message
+	[[nodiscard]] bool validate() const {
+		return base.payload_buffer().size() >= 10;
+	}
+};
+
+/// DATAGRAM message template, unreliable payload which is never retransmitted
+/// Numbered and acked like DATA, so receivers can drop replays and senders count it in flight
+template<typename BaseMessageType>
+struct DATAGRAMWrapper {
+	MARLIN_MESSAGES_BASE(DATAGRAMWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(packet_number, 10);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(18);
+
+	/// Construct a DATAGRAM message with a given payload size
+	DATAGRAMWrapper(size_t payload_size) : base(18 + payload_size) {
+		base.set_payload({0, 20});
+	}
+
+	/// Validate the DATAGRAM message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 18 + payload_size;
+	}
+};
+
+/// ACKCONF message template, confirms receipt of an ACK reporting the packet numbers from smallest to largest
+template<typename BaseMessageType>
+struct ACKCONFWrapper {
+	MARLIN_MESSAGES_BASE(ACKCONFWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(largest, 10);
+	MARLIN_MESSAGES_UINT64_FIELD(smallest, 18);
+
+	/// Construct an ACKCONF message
+	ACKCONFWrapper() : base(26) {
+		base.set_payload({0, 21});
+	}
+
+	/// Validate the ACKCONF message
+	[[nodiscard]] bool validate() const {
+		return base.payload_buffer().size() >= 26;
+	}
+};
+
+/// PING message template, empty packet the peer acks, keeps liveness checks going on idle connections
+template<typename BaseMessageType>
+struct PINGWrapper {
+	MARLIN_MESSAGES_BASE(PINGWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(packet_number, 10);
+
+	/// Construct a PING message with a given trailer size
+	PINGWrapper(size_t trailer_size) : base(18 + trailer_size) {
+		base.set_payload({0, 22});
+	}
+
+	/// Validate the PING message
+	[[nodiscard]] bool validate(size_t trailer_size) const {
+		return base.payload_buffer().size() >= 18 + trailer_size;
+	}
+};
+
+/// PATHCHALLENGE message template, sent to the address a peer seems to have moved to
+template<typename BaseMessageType>
+struct PATHCHALLENGEWrapper {
+	MARLIN_MESSAGES_BASE(PATHCHALLENGEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(token, 10);
+
+	/// Construct a PATHCHALLENGE message with a given trailer size
+	PATHCHALLENGEWrapper(size_t trailer_size) : base(18 + trailer_size) {
+		base.set_payload({0, 23});
+	}
+
+	/// Validate the PATHCHALLENGE message
+	[[nodiscard]] bool validate(size_t trailer_size) const {
+		return base.payload_buffer().size() >= 18 + trailer_size;
+	}
+};
+
+/// PATHRESPONSE message template, echoes the token of a challenge from the address it was sent to
+template<typename BaseMessageType>
+struct PATHRESPONSEWrapper {
+	MARLIN_MESSAGES_BASE(PATHRESPONSEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(token, 10);
+
+	/// Construct a PATHRESPONSE message with a given trailer size
+	PATHRESPONSEWrapper(size_t trailer_size) : base(18 + trailer_size) {
+		base.set_payload({0, 24});
+	}
+
+	/// Validate the PATHRESPONSE message
+	[[nodiscard]] bool validate(size_t trailer_size) const {
+		return base.payload_buffer().size() >= 18 + trailer_size;
+	}
+};
+
 #undef MARLIN_MESSAGES_UINT16_FIELD
 #undef MARLIN_MESSAGES_UINT32_FIELD
 #undef MARLIN_MESSAGES_UINT64_FIELD
@@ -7,11 +7,19 @@
 #include <unordered_map>
 #include <random>
 #include <utility>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <deque>
+#include <map>
+#include <span>
 
 #include <sodium.h>
 
 #include <marlin/core/SocketAddress.hpp>
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 #include <marlin/asyncio/core/EventLoop.hpp>
 #include <marlin/asyncio/core/Timer.hpp>
 #include <marlin/core/TransportManager.hpp>
@@ -19,17 +27,62 @@
 #include "protocol/SendStream.hpp"
 #include "protocol/RecvStream.hpp"
 #include "protocol/AckRanges.hpp"
+#include "protocol/SentPackets.hpp"
+#include "protocol/Fec.hpp"
+#include "protocol/SessionCache.hpp"
+#include "protocol/PmtuSearch.hpp"
+#include "protocol/StreamScheduler.hpp"
+#include "protocol/ConnIdTable.hpp"
+#include "protocol/RttEstimator.hpp"
+#include "congestion/CongestionController.hpp"
 #include "Messages.hpp"
 
 namespace marlin {
 namespace stream {
 
-/// Timeout when no acks are received, used by the TLP timer
-#define DEFAULT_TLP_INTERVAL 1000
-/// Bytes that can be sent in a given batch, used by the packet pacing mechanism
+/// Probe timeout in microseconds when no acks are received, used until an RTT estimate is available
+#define DEFAULT_PTO_INTERVAL 1000000
+/// Probe timeout in microseconds beyond which the connection is considered dead, doubles on every probe
+#define MAX_PTO_INTERVAL 25000000
+/// Consecutive probe timeouts after which everything in flight is considered lost
+#define PERSISTENT_CONGESTION_PTOS 3
+/// Time in microseconds the receiver may hold an ack back, see the ack timer
+#define MAX_ACK_DELAY 25000
+/// Packets declared lost that are remembered for spotting spurious losses
+#define MAX_RECENTLY_LOST 1024
+/// Bytes that can be sent in a given batch before an RTT estimate is available, used by the packet pacing mechanism
 #define DEFAULT_PACING_LIMIT 400000
+/// Interval in microseconds between pacing batches before an RTT estimate is available
+#define DEFAULT_PACING_INTERVAL 1000
 /// Bytes that can be sent in a single packet to prevent fragmentation, accounts for header overheads
+/// Used until path MTU discovery finds a larger size
 #define DEFAULT_FRAGMENT_SIZE 1350
+/// Bytes added around a fragment by the largest packet carrying it, a REPAIR with its parity header, tag and nonce
+#define MAX_FRAGMENT_OVERHEAD 69
+/// Largest datagram probed for by path MTU discovery, a 9000 byte jumbo frame less IPv4 and UDP headers
+#define MAX_PMTU_DATAGRAM_SIZE 8972
+/// Minimum time in microseconds to wait for a path MTU probe to be acked
+#define MIN_PMTU_PROBE_TIMEOUT 10000
+/// Interval in milliseconds after which a finished path MTU search looks for a larger size again
+#define PMTU_RAISE_INTERVAL 600000
+/// Packets that can be sent in a given batch once packets are paced at the estimated rate
+#define DEFAULT_PACING_BURST 10
+/// Ack ranges that fit in a single ACK packet, odd so that every packet ends on a seen range
+#define MAX_ACK_PACKET_RANGES 171
+/// Bytes a stream can receive ahead of its read offset, bounds out of order data buffered per stream
+#define DEFAULT_STREAM_WINDOW 8000000
+/// Bytes all streams together can receive ahead of their read offsets, bounds out of order data buffered per connection
+#define DEFAULT_CONN_WINDOW 16000000
+/// Bytes queued for sending and not yet acked beyond which sends are refused until the queue drains
+#define DEFAULT_SEND_BUFFER_LIMIT 20000000
+/// Stream credits that fit in a single WINDOW packet
+#define MAX_WINDOW_PACKET_CREDITS 128
+/// Scheduling class of streams until set otherwise, leaves a more urgent class free
+#define DEFAULT_STREAM_PRIORITY 1
+/// Datagrams waiting for congestion window or pacing room beyond which the oldest ones are dropped
+#define MAX_DATAGRAM_QUEUE 64
+/// Multiple of the bytes received from an address a peer moved to that can be sent there before the peer answers from it
+#define MIGRATION_AMPLIFICATION_FACTOR 3
 
 /// @brief Transport class which provides stream semantics.
 ///
@@ -42,6 +95,12 @@ namespace stream {
 /// \li Transport layer encryption (disabled by default)
 /// \li Stream multiplexing
 /// \li No head-of-line blocking
+/// \li Stream priorities
+/// \li Forward error correction (disabled by default)
+/// \li 0-RTT session resumption
+/// \li Flow control
+/// \li Unreliable datagrams
+/// \li Partial reliability with delivery deadlines
 template<typename DelegateType, template<typename> class DatagramTransport>
 class StreamTransport {
 private:
@@ -76,9 +135,33 @@ private:
 	using CLOSE = CLOSEWrapper<BaseMessageType>;
 	/// CLOSECONF message type
 	using CLOSECONF = CLOSECONFWrapper<BaseMessageType>;
-
-	/// Base transport instance
-	BaseTransport &transport;
+	/// REPAIR message type
+	using REPAIR = REPAIRWrapper<BaseMessageType>;
+	/// TICKET message type
+	using TICKET = TICKETWrapper<BaseMessageType>;
+	/// RESUME message type
+	using RESUME = RESUMEWrapper<BaseMessageType>;
+	/// PMTUPROBE message type
+	using PMTUPROBE = PMTUPROBEWrapper<BaseMessageType>;
+	/// PMTUACK message type
+	using PMTUACK = PMTUACKWrapper<BaseMessageType>;
+	/// WINDOW message type
+	using WINDOW = WINDOWWrapper<BaseMessageType>;
+	/// BLOCKED message type
+	using BLOCKED = BLOCKEDWrapper<BaseMessageType>;
+	/// DATAGRAM message type
+	using DATAGRAM = DATAGRAMWrapper<BaseMessageType>;
+	/// ACKCONF message type
+	using ACKCONF = ACKCONFWrapper<BaseMessageType>;
+	/// PING message type
+	using PING = PINGWrapper<BaseMessageType>;
+	/// PATHCHALLENGE message type
+	using PATHCHALLENGE = PATHCHALLENGEWrapper<BaseMessageType>;
+	/// PATHRESPONSE message type
+	using PATHRESPONSE = PATHRESPONSEWrapper<BaseMessageType>;
+
+	/// Base transport instance, replaced when the peer migrates to a new address
+	BaseTransport *transport;
 	/// Transport manager of self
 	core::TransportManager<Self> &transport_manager;
 
@@ -110,6 +193,49 @@ private:
 	/// Timer callback for handling DIAL timeouts
 	void dial_timer_cb();
 
+	// Connection migration
+	/// Ids shared with other transports of the factory, migration is disabled if null
+	ConnIdTable<Self> *conn_id_table = nullptr;
+	/// Replace the src connection id with a new one, registered with the table if any
+	void new_src_conn_id();
+	/// Use the src connection id picked by the peer
+	void adopt_src_conn_id(uint32_t conn_id);
+	/// Remove the src connection id from the table
+	void release_src_conn_id();
+	/// Is the DATA packet an authentic and fresh one of this connection?
+	bool is_valid_migration(BaseMessageType &packet);
+	/// Pass DATA from a new address to the established connection it belongs to, which challenges the address,
+	/// and hand the base transport over to that connection once the address answers
+	/// Returns true if the packet was taken, self is closed and gone if it was a PATHRESPONSE
+	bool did_recv_migration(BaseMessageType &packet);
+	/// Is there an address the peer seems to have moved to?
+	/// Its base transport stays with a transport in Listen state until the peer answers a challenge sent there
+	bool has_path_candidate = false;
+	/// Address of the candidate path
+	core::SocketAddress path_candidate_addr;
+	/// Token of the challenge sent on the candidate path
+	uint64_t path_challenge_token = 0;
+	/// Time in microseconds the last challenge was sent
+	uint64_t path_challenge_time = 0;
+	/// Bytes received from the candidate path, bounds bytes sent to it
+	uint64_t path_candidate_bytes_recv = 0;
+	/// Bytes sent to the candidate path
+	uint64_t path_candidate_bytes_sent = 0;
+	/// Note DATA received from a new address and challenge the address
+	void did_recv_path_candidate(BaseTransport &transport, core::SocketAddress const &addr, size_t size);
+
+	// Session resumption
+	/// Tickets shared with other transports of the factory, resumption is disabled if null
+	SessionCache *session_cache = nullptr;
+	/// Ticket presented in RESUME, held until the server confirms the connection
+	std::optional<SessionTicket> resume_ticket;
+	/// Was the delegate told of the dial before the handshake completed?
+	bool is_resumed = false;
+	/// Time in seconds since the epoch, tickets outlive the event loop clock
+	static uint64_t ticket_time();
+	/// Server did not accept the ticket, retry with a full handshake keeping queued data
+	void fall_back_to_dial();
+
 	// Streams
 	/// List of streams on which we send data
 	std::unordered_map<uint16_t, SendStream> send_streams;
@@ -126,35 +252,45 @@ private:
 	/// Strictly increasing, retransmitted packets have different packet number than the original
 	uint64_t last_sent_packet = -1;
 	/// List of sent packets which have not been acked yet
-	std::map<uint64_t, SentPacketInfo> sent_packets;
+	SentPackets sent_packets;
 
 	/// List of packets marked as lost.
 	/// Can happen if packets sent much later were acknowledged.
 	/// Can happen if an ack is not received for a long time.
-	std::map<uint64_t, SentPacketInfo> lost_packets;
+	SentPackets lost_packets;
+	/// Packet recently declared lost by the reordering window
+	struct LostPacket {
+		uint64_t packet_number;
+		uint64_t sent_time;
+		uint64_t length;
+	};
+	/// Packets recently declared lost by the reordering window, in packet number order
+	/// An ack for one of them, even once resent, means the window was too narrow
+	std::deque<LostPacket> recently_lost;
 
 	// RTT estimate
-	/// RTT estimate of connection
-	double rtt = -1;
+	/// RTT estimate of connection in microseconds, also sets the loss detection timeouts
+	RttEstimator rtt;
 
 	// Congestion control
 	uint64_t bytes_in_flight = 0;
-	uint64_t k = 0;
-	uint64_t w_max = 0;
-	uint64_t congestion_window = 100000;
-	uint64_t ssthresh = -1;
-	uint64_t congestion_start = 0;
+	/// Congestion control policy, sets the window and the pacing rate
+	CongestionController congestion_controller;
+	/// Bytes delivered to the peer so far
+	uint64_t delivered = 0;
+	/// Time in microseconds of the latest delivery
+	uint64_t delivered_time = 0;
 	uint64_t largest_acked = 0;
-	uint64_t largest_sent_time = 0;
 
 	// Send
-	/// List of stream ids with data ready to be sent
-	std::unordered_set<uint16_t> send_queue_ids;
-	/// List of send streams with data ready to be sent
-	std::list<SendStream *> send_queue;
+	/// Send streams with data ready to be sent, by priority and then round robin
+	StreamScheduler<SendStream> send_scheduler;
 
 	/// Add the given stream to the list of streams with data ready to be sent
 	bool register_send_intent(SendStream &stream);
+	/// Queue owned or shared data on the given stream, abandoned if not acked by the deadline unless it is 0
+	template<typename BufferType>
+	int send_impl(BufferType &&bytes, uint16_t stream_id, uint64_t deadline);
 
 	/// Send any pending data that needs to be sent.
 	/// Main entry point which keeps the transmission moving forward.
@@ -165,26 +301,45 @@ private:
 	int send_lost_data(uint64_t initial_bytes_in_flight);
 	/// Send any new data if possible
 	int send_new_data(SendStream &stream, uint64_t initial_bytes_in_flight);
+	/// Send the parity of the current group if it is full, or of a partial group too if flush is set
+	int send_repair(uint64_t initial_bytes_in_flight, bool flush);
+	/// Take a packet out of flight, its stream data is queued to be resent
+	void mark_lost(uint64_t packet_number, SentPacketInfo &sent_packet);
 
 	// Pacing
 	/// Timer to enforce packet pacing
 	asyncio::Timer pacing_timer;
 	/// Is the pacing timer active?
 	bool is_pacing_timer_active = false;
+	/// Earliest time in microseconds the next batch can be sent at
+	uint64_t next_pacing_time = 0;
+	/// Bytes that can be sent in the current batch
+	uint64_t pacing_batch_limit();
+	/// Time in microseconds needed to drain the given bytes at the pacing rate
+	uint64_t pacing_interval(uint64_t bytes);
 	/// Pacing timer callback to send a new batch of packets
 	void pacing_timer_cb();
-
-	// TLP (Tail Loss Probe)
-	/// Timer to detect no acks for a long time
-	asyncio::Timer tlp_timer;
-	/// Timer interval for the tlp timer
-	uint64_t tlp_interval = DEFAULT_TLP_INTERVAL;
-	/// Timer callback for handling tlp timeouts
-	void tlp_timer_cb();
+	/// Send the packets of a single pacing batch
+	void send_paced_batch();
+
+	// Loss detection
+	/// Timer for packets still within their reordering window, or else the probe timeout
+	asyncio::Timer loss_timer;
+	/// Consecutive probe timeouts without an ack
+	uint64_t pto_count = 0;
+	/// Timer callback for handling reordering window expiry and probe timeouts
+	void loss_timer_cb();
+	/// Start the loss timer for the earliest packet that is not yet lost, or else for the probe timeout
+	void set_loss_timer();
+	/// Move packets sent before the largest acked one and older than the RTT plus the reordering window to lost,
+	/// returns the bytes lost
+	uint64_t detect_lost_packets(uint64_t now);
 
 	// ACKs
 	/// Stores ranges of packet numbers that have and haven't been seen
 	AckRanges ack_ranges;
+	/// Scratch space for encoding ack ranges
+	std::vector<uint64_t> ack_encoded;
 	/// Timer to batch acks for multiple packets
 	asyncio::Timer ack_timer;
 	/// Is the ack timer active?
@@ -192,6 +347,88 @@ private:
 	/// Timer callback for sending an ack
 	void ack_timer_cb();
 
+	/// Cleared if the transport is destroyed while a batch of packets is being processed
+	bool *is_alive = nullptr;
+
+	// FEC (Forward Error Correction)
+	/// Do we send parity of DATA packets?
+	/// Parity received from the peer is always used.
+	bool is_fec_enabled = false;
+	/// Parity of the DATA packets sent since the last REPAIR
+	FecEncoder fec_encoder;
+	/// Recent DATA packets received, used to rebuild lost ones from REPAIR
+	FecDecoder fec_decoder;
+
+	// PMTU (Path MTU discovery)
+	/// Payload bytes in a single DATA packet
+	uint16_t fragment_size = DEFAULT_FRAGMENT_SIZE;
+	/// Search for the largest datagram reaching the peer, empty until data is sent
+	/// or if the base transport does not know its MTU
+	std::optional<PmtuSearch> pmtu_search;
+	/// Timer to detect lost probes and to restart finished searches
+	asyncio::Timer pmtu_timer;
+	/// Random token of the probes of the current size, PMTUACK has to echo it
+	uint64_t pmtu_token = 0;
+	/// Probe size the token was picked for
+	size_t pmtu_token_size = 0;
+	/// Start searching if the base transport allows datagrams larger than the default
+	void start_pmtu_search();
+	/// Time in microseconds to wait for a probe to be acked
+	uint64_t pmtu_probe_timeout();
+	/// Timer callback for handling probe timeouts
+	void pmtu_timer_cb();
+
+	// Flow control
+	/// Bytes of new data sent on all streams
+	uint64_t data_sent = 0;
+	/// Credit from the peer, data_sent can grow up to this
+	uint64_t max_data = DEFAULT_CONN_WINDOW;
+	/// Was the last batch held back by the peer's credit?
+	bool is_flow_blocked = false;
+	/// Sum of the highest offsets received on all streams
+	uint64_t data_recv = 0;
+	/// Sum of the read offsets of all streams
+	uint64_t data_read = 0;
+	/// Bytes handed to the delegate on all streams that it has not acked with consume yet
+	uint64_t data_unconsumed = 0;
+	/// Credit last advertised to the peer
+	uint64_t advertised_max_data = DEFAULT_CONN_WINDOW;
+	/// Scratch space for the stream credits of a WINDOW
+	std::vector<std::pair<uint16_t, uint64_t>> window_credits;
+	/// Move the read offset of the stream forward past bytes handed to the delegate,
+	/// freeing credit unless the delegate acks consumption itself
+	void advance_read_offset(RecvStream &stream, uint64_t offset);
+	/// Move the read offset of the stream forward past bytes skipped without being handed over, freeing credit
+	void skip_read_offset(RecvStream &stream, uint64_t offset);
+
+	// Send buffer
+	/// Bytes queued on all streams which have not been acked or flushed yet
+	uint64_t send_buffer_bytes = 0;
+	/// Was a send refused since the send buffer last drained?
+	bool is_send_buffer_full = false;
+	/// Release acked or flushed bytes and tell the delegate once the send buffer drains
+	void release_send_buffer(uint64_t bytes);
+
+	// Datagrams
+	/// Datagrams waiting to be sent, oldest first
+	std::deque<core::Buffer> datagram_queue;
+	/// Send queued datagrams ahead of stream data if possible
+	int send_datagrams(uint64_t initial_bytes_in_flight);
+
+	// Deadlines
+	/// Stream id and end offset of queued data keyed by its deadline in milliseconds, earliest first
+	std::multimap<uint64_t, std::pair<uint16_t, uint64_t>> send_deadlines;
+	/// Timer to abandon data once its deadline passes
+	asyncio::Timer deadline_timer;
+	/// Timer callback for abandoning data past its deadline
+	void deadline_timer_cb();
+	/// Stop sending data of the stream below the given offset and tell the peer to skip over it
+	void abandon_data(SendStream &stream, uint64_t offset);
+	/// Forget sent and lost packets of the stream below the given offset
+	void purge_packets(SendStream &stream, uint64_t offset);
+	/// Fold outstanding acks into the acked offset and free fully acked data items
+	void release_acked_data(SendStream &stream);
+
 	// Protocol
 	void send_DIAL();
 	void did_recv_DIAL(DIAL &&packet);
@@ -211,11 +448,34 @@ private:
 		uint64_t offset,
 		uint16_t length
 	);
+	void send_DATA_copy(
+		SendStream &stream,
+		DataItem &data_item,
+		uint64_t offset,
+		uint16_t length,
+		bool is_fin
+	);
 	void did_recv_DATA(DATA &&packet);
+	/// Add a received packet to the ack ranges and make sure an ACK follows
+	void schedule_ack(uint64_t packet_number);
+	/// Process a DATA packet rebuilt from parity
+	void did_recv_recovered(FecRecoveredPacket &&recovered);
+	/// Process the payload of a DATA packet, received or rebuilt from parity
+	void did_recv_fragment(
+		uint64_t packet_number,
+		uint16_t stream_id,
+		uint64_t offset,
+		uint16_t length,
+		bool is_fin,
+		core::Buffer &&payload
+	);
 
 	void send_ACK();
 	void did_recv_ACK(ACK &&packet);
 
+	void send_ACKCONF(uint64_t largest, uint64_t smallest);
+	void did_recv_ACKCONF(ACKCONF &&packet);
+
 	void send_SKIPSTREAM(uint16_t stream_id, uint64_t offset);
 	void did_recv_SKIPSTREAM(SKIPSTREAM &&packet);
 
@@ -231,11 +491,48 @@ private:
 	void send_CLOSECONF(uint32_t src_conn_id, uint32_t dst_conn_id);
 	void did_recv_CLOSECONF(CLOSECONF &&packet);
 
+	void send_REPAIR();
+	void did_recv_REPAIR(REPAIR &&packet);
+
+	void send_TICKET();
+	void did_recv_TICKET(TICKET &&packet);
+
+	void send_RESUME();
+	void did_recv_RESUME(RESUME &&packet);
+
+	void send_PMTUPROBE();
+	void did_recv_PMTUPROBE(PMTUPROBE &&packet);
+
+	void send_PMTUACK(uint16_t size, uint64_t token);
+	void did_recv_PMTUACK(PMTUACK &&packet);
+
+	/// Advertise credit that moved by at least half a window, or all credit if forced
+	void send_WINDOW(bool force);
+	void did_recv_WINDOW(WINDOW &&packet);
+
+	void send_BLOCKED();
+	void did_recv_BLOCKED(BLOCKED &&packet);
+
+	void send_DATAGRAM(core::Buffer &&bytes);
+	void did_recv_DATAGRAM(DATAGRAM &&packet);
+
+	void send_PING();
+	void did_recv_PING(PING &&packet);
+
+	void send_PATHCHALLENGE(BaseTransport &transport);
+	void did_recv_PATHCHALLENGE(PATHCHALLENGE &&packet);
+
+	void send_PATHRESPONSE(uint64_t token);
+	/// Only reaches connections through did_recv_migration, from the transport of the candidate path
+	bool did_recv_PATHRESPONSE(PATHRESPONSE &&packet, core::SocketAddress const &addr);
+
 public:
 	/// Delegate calls from base transport
 	void did_dial(BaseTransport &transport, uint8_t const* remote_static_pk);
 	/// Delegate calls from base transport
 	void did_recv(BaseTransport &transport, BaseMessageType &&packet);
+	/// Delegate calls from base transport, packets received together from the peer
+	void did_recv_batch(BaseTransport &transport, std::span<core::Buffer> packets);
 	/// Delegate calls from base transport
 	void did_send(BaseTransport &transport, core::Buffer &&packet);
 	/// Delegate calls from base transport
@@ -256,11 +553,39 @@ public:
 		BaseTransport &transport,
 		core::TransportManager<Self> &transport_manager
 	);
+	~StreamTransport();
 
 	/// Setup function that can be called to set the delegate and the private key
 	void setup(DelegateType *delegate, uint8_t const* static_sk);
 	/// Queues the given buffer for transmission
+	/// Returns -1 while the send buffer is full, the delegate's did_drain is called once it drains
 	int send(core::Buffer &&bytes, uint16_t stream_id = 0);
+	/// Queues the given shared buffer for transmission, memory is held until acked
+	int send(core::SharedBuffer &&bytes, uint16_t stream_id = 0);
+	/// Queues the given buffer for transmission, the stream keeps the given priority for later sends
+	/// A non zero deadline is a time in milliseconds on the event loop clock, see asyncio::EventLoop::now.
+	/// Data not acked by then is no longer retransmitted and the peer skips over it,
+	/// its did_recv_flush_stream is called with the offset it resumes from.
+	int send(core::Buffer &&bytes, uint16_t stream_id, uint8_t priority, uint64_t deadline = 0);
+	/// Queues the given shared buffer for transmission, the stream keeps the given priority for later sends
+	/// Abandoned past a non zero deadline like owned buffers
+	int send(core::SharedBuffer &&bytes, uint16_t stream_id, uint8_t priority, uint64_t deadline = 0);
+	/// Set the scheduling class of the stream, lower classes are always sent first
+	void set_stream_priority(uint16_t stream_id, uint8_t priority);
+	/// Set the share of its class the stream gets relative to other streams with data to send
+	void set_stream_weight(uint16_t stream_id, uint16_t weight);
+	/// Ack bytes of the stream handed to the delegate that it is done with, credit for the peer follows them
+	/// Only needed if the delegate declares a static constexpr bool acks_consumption, credit follows
+	/// handing data over otherwise. Bytes of streams read fully still free connection credit.
+	void consume(uint16_t stream_id, uint64_t bytes);
+	/// Queues the given buffer as a single datagram which is paced and congestion controlled but never retransmitted
+	/// Returns -1 if it does not fit in a packet, see get_fragment_size, and -2 if the connection is not established
+	/// Received datagrams are passed to the optional did_recv_datagram of the delegate
+	int send_datagram(core::Buffer &&bytes);
+	/// Sends a PING the peer acks, it is in flight like DATA but never resent
+	/// Keeps probe timeouts running on an otherwise idle connection so that a dead peer is closed
+	/// Returns -2 if the connection is not established
+	int send_ping();
 
 	/// Close reason
 	uint16_t close_reason = 0;
@@ -271,8 +596,19 @@ public:
 
 	/// Is the transport ready to send data?
 	bool is_active();
-	/// Get the RTT estimate of the connection
+	/// Get the RTT estimate of the connection in milliseconds, negative if not available yet
 	double get_rtt();
+	/// Get the payload bytes sent in a single DATA packet, grows as path MTU discovery progresses
+	uint16_t get_fragment_size();
+	/// Set the congestion control policy, resets congestion state
+	void set_congestion_controller(CongestionController const& controller);
+	/// Send parity of DATA packets so that the peer can rebuild lost ones without retransmission
+	void set_fec_enabled(bool enabled);
+	/// Issue tickets to clients and resume with tickets from servers, null disables resumption
+	void set_session_cache(SessionCache *session_cache);
+	/// Register connection ids so that connections follow peers to new addresses once those answer a challenge,
+	/// null disables migration, as does the lack of encryption
+	void set_conn_id_table(ConnIdTable<Self> *conn_id_table);
 
 	/// Timer callback for SKIPSTREAM timeout
 	void skip_timer_cb(RecvStream& stream);
@@ -321,12 +657,16 @@ template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::reset() {
 	// Reset transport
 	conn_state = ConnectionState::Listen;
+	release_src_conn_id();
 	src_conn_id = 0;
 	dst_conn_id = 0;
 	dialled = false;
 	state_timer.stop();
 	state_timer_interval = 0;
 
+	resume_ticket.reset();
+	is_resumed = false;
+
 	for(auto& [_, stream] : send_streams) {
 		(void)_;
 		stream.state_timer.stop();
@@ -341,30 +681,59 @@ void StreamTransport<DelegateType, DatagramTransport>::reset() {
 	last_sent_packet = -1;
 	sent_packets.clear();
 	lost_packets.clear();
+	recently_lost.clear();
 
-	rtt = -1;
+	rtt = RttEstimator();
 
 	bytes_in_flight = 0;
-	k = 0;
-	w_max = 0;
-	congestion_window = 100000;
-	ssthresh = -1;
-	congestion_start = 0;
+	congestion_controller.reset();
+	delivered = 0;
+	delivered_time = 0;
 	largest_acked = 0;
-	largest_sent_time = 0;
 
-	send_queue_ids.clear();
-	send_queue.clear();
+	send_scheduler.clear();
 
 	pacing_timer.stop();
 	is_pacing_timer_active = false;
+	next_pacing_time = 0;
 
-	tlp_timer.stop();
-	tlp_interval = DEFAULT_TLP_INTERVAL;
+	loss_timer.stop();
+	pto_count = 0;
 
 	ack_ranges = AckRanges();
 	ack_timer.stop();
 	ack_timer_active = false;
+
+	fec_encoder.reset();
+	fec_decoder.reset();
+
+	fragment_size = DEFAULT_FRAGMENT_SIZE;
+	pmtu_search.reset();
+	pmtu_timer.stop();
+	pmtu_token = 0;
+	pmtu_token_size = 0;
+
+	data_sent = 0;
+	max_data = DEFAULT_CONN_WINDOW;
+	is_flow_blocked = false;
+	data_recv = 0;
+	data_read = 0;
+	data_unconsumed = 0;
+	advertised_max_data = DEFAULT_CONN_WINDOW;
+
+	send_buffer_bytes = 0;
+	is_send_buffer_full = false;
+
+	datagram_queue.clear();
+
+	send_deadlines.clear();
+	deadline_timer.stop();
+
+	has_path_candidate = false;
+	path_challenge_token = 0;
+	path_challenge_time = 0;
+	path_candidate_bytes_recv = 0;
+	path_candidate_bytes_sent = 0;
 }
 
 // Impl
@@ -379,11 +748,15 @@ void StreamTransport<DelegateType, DatagramTransport>::dial_timer_cb() {
 			this->dst_addr.to_string()
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
-	this->send_DIAL();
+	if(this->resume_ticket.has_value()) {
+		this->send_RESUME();
+	} else {
+		this->send_DIAL();
+	}
 	this->state_timer_interval *= 2;
 	this->state_timer.template start<Self, &Self::dial_timer_cb>(
 		this->state_timer_interval,
@@ -398,11 +771,15 @@ template<typename DelegateType, template<typename> class DatagramTransport>
 SendStream &StreamTransport<DelegateType, DatagramTransport>::get_or_create_send_stream(
 	uint16_t stream_id
 ) {
-	auto iter = send_streams.try_emplace(
+	auto [iter, inserted] = send_streams.try_emplace(
 		stream_id,
 		stream_id,
 		this
-	).first;
+	);
+	if(inserted) {
+		iter->second.max_offset = DEFAULT_STREAM_WINDOW;
+		iter->second.priority = DEFAULT_STREAM_PRIORITY;
+	}
 
 	return iter->second;
 }
@@ -412,11 +789,14 @@ template<typename DelegateType, template<typename> class DatagramTransport>
 RecvStream &StreamTransport<DelegateType, DatagramTransport>::get_or_create_recv_stream(
 	uint16_t stream_id
 ) {
-	auto iter = recv_streams.try_emplace(
+	auto [iter, inserted] = recv_streams.try_emplace(
 		stream_id,
 		stream_id,
 		this
-	).first;
+	);
+	if(inserted) {
+		iter->second.max_offset = DEFAULT_STREAM_WINDOW;
+	}
 
 	return iter->second;
 }
@@ -431,56 +811,78 @@ template<typename DelegateType, template<typename> class DatagramTransport>
 bool StreamTransport<DelegateType, DatagramTransport>::register_send_intent(
 	SendStream &stream
 ) {
-	if(send_queue_ids.find(stream.stream_id) != send_queue_ids.end()) {
-		return false;
-	}
-
-	send_queue.push_back(&stream);
-	send_queue_ids.insert(stream.stream_id);
-
-	return true;
+	return send_scheduler.schedule(stream, fragment_size);
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::send_pending_data() {
 	if(is_pacing_timer_active == false) {
 		is_pacing_timer_active = true;
-		pacing_timer.template start<Self, &Self::pacing_timer_cb>(0, 0);
+		auto now = asyncio::EventLoop::now_us();
+		pacing_timer.template start_us<Self, &Self::pacing_timer_cb>(
+			next_pacing_time > now ? next_pacing_time - now : 0,
+			0
+		);
 	}
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
-int StreamTransport<DelegateType, DatagramTransport>::send_lost_data(
+int StreamTransport<DelegateType, DatagramTransport>::send_datagrams(
 	uint64_t initial_bytes_in_flight
 ) {
-	for(
-		auto iter = lost_packets.begin();
-		iter != lost_packets.end();
-		iter = lost_packets.erase(iter)
-	) {
-		if(bytes_in_flight - initial_bytes_in_flight >= DEFAULT_PACING_LIMIT) {
-			// Pacing limit hit, reschedule timer
-			is_pacing_timer_active = true;
-			pacing_timer.template start<Self, &Self::pacing_timer_cb>(1, 0);
+	while(!datagram_queue.empty()) {
+		if(bytes_in_flight - initial_bytes_in_flight >= pacing_batch_limit()) {
 			return -1;
 		}
 
-		auto &sent_packet = iter->second;
-		if(bytes_in_flight > congestion_window - sent_packet.length) {
+		auto size = datagram_queue.front().size();
+		if(bytes_in_flight > congestion_controller.cwnd() - size) {
 			return -2;
 		}
 
-		send_DATA(
-			*sent_packet.stream,
-			*sent_packet.data_item,
-			sent_packet.offset,
-			sent_packet.length
-		);
+		send_DATAGRAM(std::move(datagram_queue.front()));
+		datagram_queue.pop_front();
+	}
+
+	return 0;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+int StreamTransport<DelegateType, DatagramTransport>::send_lost_data(
+	uint64_t initial_bytes_in_flight
+) {
+	while(!lost_packets.empty()) {
+		if(bytes_in_flight - initial_bytes_in_flight >= pacing_batch_limit()) {
+			return -1;
+		}
+
+		auto packet_number = lost_packets.begin_number();
+		// Copy out, resending inserts into sent packets
+		auto sent_packet = *lost_packets.find(packet_number);
+		if(bytes_in_flight > congestion_controller.cwnd() - sent_packet.length) {
+			return -2;
+		}
+		lost_packets.erase(packet_number);
+
+		// Fragment size might have shrunk since, resend in pieces that fit
+		for(uint64_t i = 0; i < sent_packet.length; i += fragment_size) {
+			send_DATA(
+				*sent_packet.stream,
+				*sent_packet.data_item,
+				sent_packet.offset + i,
+				std::min<uint64_t>(fragment_size, sent_packet.length - i)
+			);
+		}
 
 		sent_packet.stream->bytes_in_flight += sent_packet.length;
 		bytes_in_flight += sent_packet.length;
 
 		SPDLOG_DEBUG("Lost packet sent: {}, {}", sent_packet.offset, last_sent_packet);
+
+		auto res = send_repair(initial_bytes_in_flight, false);
+		if(res < 0) {
+			return res;
+		}
 	}
 
 	return 0;
@@ -498,33 +900,76 @@ int StreamTransport<DelegateType, DatagramTransport>::send_new_data(
 	) {
 		auto &data_item = *stream.next_item_iterator;
 
-		for(
-			uint64_t i = data_item.sent_offset;
-			i < data_item.data.size();
-			i+=DEFAULT_FRAGMENT_SIZE
-		) {
+		while(data_item.sent_offset < data_item.data.size()) {
 			auto remaining_bytes = data_item.data.size() - data_item.sent_offset;
-			uint16_t dsize = remaining_bytes > DEFAULT_FRAGMENT_SIZE ? DEFAULT_FRAGMENT_SIZE : remaining_bytes;
+			uint16_t dsize = remaining_bytes > fragment_size ? fragment_size : remaining_bytes;
+
+			// Stay within the credit of the peer, the stream waits for WINDOW otherwise
+			if(stream.sent_offset >= stream.max_offset) {
+				return -3;
+			}
+			if(this->data_sent >= this->max_data) {
+				return -4;
+			}
+			dsize = std::min<uint64_t>({
+				dsize,
+				stream.max_offset - stream.sent_offset,
+				this->max_data - this->data_sent
+			});
+
+			// Used up its turn, other streams of its class go next
+			if(stream.deficit < dsize) {
+				return -5;
+			}
 
-			if(this->bytes_in_flight > this->congestion_window - dsize)
+			if(this->bytes_in_flight > congestion_controller.cwnd() - dsize)
 				return -2;
 
-			if(this->bytes_in_flight - initial_bytes_in_flight > DEFAULT_PACING_LIMIT) {
+			if(this->bytes_in_flight - initial_bytes_in_flight >= pacing_batch_limit()) {
 				return -1;
 			}
 
-			send_DATA(stream, data_item, i, dsize);
+			send_DATA(stream, data_item, data_item.sent_offset, dsize);
 
 			stream.bytes_in_flight += dsize;
 			stream.sent_offset += dsize;
 			this->bytes_in_flight += dsize;
+			this->data_sent += dsize;
+			stream.deficit -= dsize;
 			data_item.sent_offset += dsize;
+
+			auto res = send_repair(initial_bytes_in_flight, false);
+			if(res < 0) {
+				return res;
+			}
 		}
 	}
 
 	return 0;
 }
 
+template<typename DelegateType, template<typename> class DatagramTransport>
+int StreamTransport<DelegateType, DatagramTransport>::send_repair(
+	uint64_t initial_bytes_in_flight,
+	bool flush
+) {
+	if(!is_fec_enabled || fec_encoder.empty() || (!flush && !fec_encoder.is_full())) {
+		return 0;
+	}
+
+	if(bytes_in_flight - initial_bytes_in_flight >= pacing_batch_limit()) {
+		return -1;
+	}
+
+	if(bytes_in_flight > congestion_controller.cwnd() - fec_encoder.payload_length()) {
+		return -2;
+	}
+
+	send_REPAIR();
+
+	return 0;
+}
+
 //---------------- Send functions end ----------------//
 
 
@@ -534,230 +979,733 @@ template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::pacing_timer_cb() {
 	this->is_pacing_timer_active = false;
 
+	// Flush the whole batch in as few syscalls as the base transport allows
+	constexpr bool can_cork = requires(
+		BaseTransport& t
+	) {
+		t.cork();
+		t.uncork();
+	};
+
+	if constexpr (can_cork) {
+		transport->cork();
+		send_paced_batch();
+		transport->uncork();
+	} else {
+		send_paced_batch();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_paced_batch() {
 	auto initial_bytes_in_flight = this->bytes_in_flight;
 
-	auto res = this->send_lost_data(initial_bytes_in_flight);
-	if(res < 0) {
-		return;
+	// Datagrams are latency sensitive and never wait behind stream data
+	auto res = this->send_datagrams(initial_bytes_in_flight);
+	if(res == 0) {
+		// Parity of a group filled up by the last batch
+		res = this->send_repair(initial_bytes_in_flight, false);
 	}
+	if(res == 0) {
+		res = this->send_lost_data(initial_bytes_in_flight);
+	}
+	this->is_flow_blocked = false;
 
-	// New packets
+	// New packets, most urgent streams first
 	for(
-		auto iter = this->send_queue.begin();
-		iter != this->send_queue.end();
-		// Empty
+		auto *stream = this->send_scheduler.front();
+		res == 0 && stream != nullptr;
+		stream = this->send_scheduler.front()
 	) {
-		auto &stream = **iter;
-
-		int res = this->send_new_data(stream, initial_bytes_in_flight);
+		res = this->send_new_data(*stream, initial_bytes_in_flight);
 		if(res == 0) { // Idle stream, move to next stream
-			this->send_queue_ids.erase(stream.stream_id);
-			iter = this->send_queue.erase(iter);
-		} else if(res == -1) { // Pacing limit hit, reschedule timer
-			// Pacing limit hit, reschedule timer
-			this->is_pacing_timer_active = true;
-			pacing_timer.template start<Self, &Self::pacing_timer_cb>(1, 0);
-			return;
-		} else { // Congestion window exhausted, break
-			return;
+			this->send_scheduler.pop();
+		} else if(res == -5) { // Turn over, next stream of the class
+			this->send_scheduler.rotate(this->fragment_size);
+			res = 0;
+		} else if(res == -3) { // Stream out of credit, keep it queued for WINDOW
+			this->is_flow_blocked = true;
+			this->send_scheduler.park();
+			res = 0;
+		} else if(res == -4) { // Connection out of credit, WINDOW restarts transmission
+			this->is_flow_blocked = true;
 		}
 	}
+	this->send_scheduler.unpark();
+
+	if(res == 0) {
+		// Nothing left to send, protect the tail with a partial group
+		res = this->send_repair(initial_bytes_in_flight, true);
+	}
+
+	// Hold the next batch back until this one drains at the pacing rate
+	this->next_pacing_time = asyncio::EventLoop::now_us() +
+		pacing_interval(this->bytes_in_flight - initial_bytes_in_flight);
+
+	if(res == -1) { // Pacing limit hit, reschedule timer
+		send_pending_data();
+	}
+	// Congestion window exhausted or nothing to send, acks restart transmission
+	// Credit exhausted, WINDOW restarts transmission
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+uint64_t StreamTransport<DelegateType, DatagramTransport>::pacing_batch_limit() {
+	return !rtt.has_sample() ? DEFAULT_PACING_LIMIT : DEFAULT_PACING_BURST * fragment_size;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+uint64_t StreamTransport<DelegateType, DatagramTransport>::pacing_interval(uint64_t bytes) {
+	if(!rtt.has_sample()) {
+		return bytes * DEFAULT_PACING_INTERVAL / DEFAULT_PACING_LIMIT;
+	}
+
+	return bytes / congestion_controller.pacing_rate(rtt.smoothed());
 }
 
 //---------------- Pacing functions end ----------------//
 
 
-//---------------- TLP functions begin ----------------//
+//---------------- Loss detection functions begin ----------------//
 
 template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::tlp_timer_cb() {
-	if(this->sent_packets.size() == 0 && this->lost_packets.size() == 0 && this->send_queue.size() == 0) {
+void StreamTransport<DelegateType, DatagramTransport>::loss_timer_cb() {
+	if(
+		this->sent_packets.size() == 0 &&
+		this->lost_packets.size() == 0 &&
+		this->send_scheduler.empty() &&
+		this->datagram_queue.empty()
+	) {
 		// Idle connection, stop timer
-		tlp_timer.stop();
-		this->tlp_interval = DEFAULT_TLP_INTERVAL;
+		// Probe timeouts only reset on an ack, unanswered PINGs keep backing off until the peer is given up
+		loss_timer.stop();
 		return;
 	}
 
-	SPDLOG_DEBUG("TLP timer: {}, {}, {}", this->sent_packets.size(), this->lost_packets.size(), this->send_queue.size() == 0);
-
-	auto sent_iter = this->sent_packets.cbegin();
+	SPDLOG_DEBUG("Loss timer: {}, {}, {}, {}", this->sent_packets.size(), this->lost_packets.size(), this->send_scheduler.empty(), this->pto_count);
 
-	// Retry lost packets
-	// No condition necessary, all are considered lost if tail probe fails
-	while(sent_iter != this->sent_packets.cend()) {
-		this->bytes_in_flight -= sent_iter->second.length;
-		sent_iter->second.stream->bytes_in_flight -= sent_iter->second.length;
-		this->lost_packets[sent_iter->first] = sent_iter->second;
+	if(this->sent_packets.size() == 0 && this->lost_packets.size() == 0 && this->is_flow_blocked) {
+		// Waiting on credit with nothing in flight, WINDOW might have been lost
+		// The peer answers with its credit, proving it is still around
+		this->send_BLOCKED();
+	}
 
-		sent_iter++;
+	// Reordering window of some packet ran out
+	if(detect_lost_packets(asyncio::EventLoop::now_us()) > 0) {
+		this->send_pending_data();
+		set_loss_timer();
+		return;
 	}
 
-	if(sent_iter == this->sent_packets.cbegin()) {
-		// No lost packets, ignore
-	} else {
-		// Lost packets, congestion event
-		auto last_iter = std::prev(sent_iter);
-		auto &sent_packet = last_iter->second;
-		if(sent_packet.sent_time > this->congestion_start) {
-			// New congestion event
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: Timer congestion event: {}",
-				this->src_addr.to_string(),
-				this->dst_addr.to_string(),
-				this->congestion_window
-			);
-			this->congestion_start = asyncio::EventLoop::now();
+	// Probe timeout, no acks for a while
+	this->pto_count++;
 
-			if(this->congestion_window < this->w_max) {
-				// Fast convergence
-				this->w_max = this->congestion_window;
-				this->congestion_window *= 0.6;
-			} else {
-				this->w_max = this->congestion_window;
-				this->congestion_window *= 0.75;
-			}
+	if(this->pto_count < PERSISTENT_CONGESTION_PTOS) {
+		// Probe with the oldest packet in flight, an ack for it or anything else resumes transmission
+		// Not a congestion event, the tail might just be slow to be acked
+		if(!this->sent_packets.empty()) {
+			auto packet_number = this->sent_packets.begin_number();
+			auto &sent_packet = *this->sent_packets.find(packet_number);
 
-			if(this->congestion_window < 10000) {
-				this->congestion_window = 10000;
+			mark_lost(packet_number, sent_packet);
+			this->sent_packets.erase(packet_number);
+		}
+	} else if(!this->sent_packets.empty()) {
+		// Persistent congestion, everything in flight is lost
+		uint64_t lost_bytes = 0;
+		for(
+			auto packet_number = this->sent_packets.begin_number();
+			packet_number < this->sent_packets.end_number();
+			packet_number++
+		) {
+			auto *sent_packet = this->sent_packets.find(packet_number);
+			if(sent_packet == nullptr) {
+				continue;
 			}
 
-			this->ssthresh = this->congestion_window;
+			mark_lost(packet_number, *sent_packet);
+			lost_bytes += sent_packet->length;
+		}
 
-			this->k = std::cbrt(this->w_max / 16)*1000;
+		// Lost packets, congestion event
+		auto &sent_packet = *this->sent_packets.find(this->sent_packets.end_number() - 1);
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: Timer congestion event: {}",
+			this->src_addr.to_string(),
+			this->dst_addr.to_string(),
+			congestion_controller.cwnd()
+		);
+		congestion_controller.on_loss({
+			asyncio::EventLoop::now_us(),
+			sent_packet.sent_time,
+			lost_bytes,
+			this->bytes_in_flight
+		});
+		fec_encoder.on_loss();
+		rtt.on_loss(asyncio::EventLoop::now_us());
+
+		if(this->fragment_size > DEFAULT_FRAGMENT_SIZE) {
+			// Tail loss with enlarged packets, the path might no longer carry them
+			// Cheap to search again if it still does
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: PMTU black hole: {}",
+				this->src_addr.to_string(),
+				this->dst_addr.to_string(),
+				this->fragment_size
+			);
+			this->fragment_size = DEFAULT_FRAGMENT_SIZE;
+			this->pmtu_search->on_black_hole();
+			this->pmtu_timer.template start_us<Self, &Self::pmtu_timer_cb>(pmtu_probe_timeout(), 0);
 		}
 
 		// Pop lost packets from sent
-		this->sent_packets.erase(this->sent_packets.cbegin(), sent_iter);
+		this->sent_packets.clear();
 	}
 
 	// New packets
 	this->send_pending_data();
 
 	// Next timer interval
-	if(this->tlp_interval < 25000) {
-		this->tlp_interval *= 2;
-		this->tlp_timer.template start<Self, &Self::tlp_timer_cb>(this->tlp_interval, 0);
+	auto interval = (rtt.has_sample() ? rtt.pto(MAX_ACK_DELAY) : DEFAULT_PTO_INTERVAL) << this->pto_count;
+	if(interval < MAX_PTO_INTERVAL) {
+		this->loss_timer.template start_us<Self, &Self::loss_timer_cb>(interval, 0);
 	} else {
 		// Abort on too many retries
 		SPDLOG_DEBUG("Lost peer: {}", this->dst_addr.to_string());
 		reset();
-		transport.close();
+		transport->close();
 	}
 }
 
-//---------------- TLP functions end ----------------//
-
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::set_loss_timer() {
+	// Oldest packet is the first to run out of its reordering window
+	if(!sent_packets.empty() && sent_packets.begin_number() < largest_acked) {
+		auto loss_time = sent_packets.find(sent_packets.begin_number())->sent_time + rtt.loss_delay();
+		auto now = asyncio::EventLoop::now_us();
+		loss_timer.template start_us<Self, &Self::loss_timer_cb>(loss_time > now ? loss_time - now : 0, 0);
+		return;
+	}
 
-//---------------- ACK functions begin ----------------//
+	auto interval = rtt.has_sample() ? rtt.pto(MAX_ACK_DELAY) : DEFAULT_PTO_INTERVAL;
+	loss_timer.template start_us<Self, &Self::loss_timer_cb>(interval << pto_count, 0);
+}
 
 template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::ack_timer_cb() {
-	send_ACK();
+void StreamTransport<DelegateType, DatagramTransport>::mark_lost(
+	uint64_t packet_number,
+	SentPacketInfo &sent_packet
+) {
+	bytes_in_flight -= sent_packet.length;
+	if(sent_packet.stream == nullptr) {
+		// REPAIR, DATAGRAM or PING, nothing to resend
+		return;
+	}
 
-	ack_timer_active = false;
+	sent_packet.stream->bytes_in_flight -= sent_packet.length;
+	lost_packets.emplace(packet_number, sent_packet);
 }
 
-//---------------- ACK functions end ----------------//
+template<typename DelegateType, template<typename> class DatagramTransport>
+uint64_t StreamTransport<DelegateType, DatagramTransport>::detect_lost_packets(uint64_t now) {
+	if(!rtt.has_sample()) {
+		return 0;
+	}
 
+	uint64_t lost_bytes = 0;
+	uint64_t last_lost = -1;
+	uint64_t last_lost_time = 0;
+	auto loss_delay = rtt.loss_delay();
+	while(!sent_packets.empty()) {
+		auto packet_number = sent_packets.begin_number();
+		auto &sent_packet = *sent_packets.find(packet_number);
 
-//---------------- Protocol functions begin ----------------//
+		// Condition for packet in flight to be considered lost
+		// 1. sent before the largest acked packet
+		// 2. older than the RTT plus the reordering window
+		// Packets are sent in packet number order, later ones are not lost either
+		if(packet_number >= largest_acked || now < sent_packet.sent_time + loss_delay) {
+			break;
+		}
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_DIAL() {
-	SPDLOG_DEBUG(
-		"Stream transport {{ Src: {}, Dst: {} }}: DIAL >>>> {:spn}",
-		src_addr.to_string(),
-		dst_addr.to_string(),
-		spdlog::to_hex(remote_static_pk, remote_static_pk+crypto_box_PUBLICKEYBYTES)
-	);
+		SPDLOG_TRACE(
+			"Stream transport {{ Src: {}, Dst: {} }}: Lost packet: {}, {}, {}",
+			transport->src_addr.to_string(),
+			transport->dst_addr.to_string(),
+			packet_number,
+			now,
+			sent_packet.sent_time
+		);
 
-	constexpr size_t pt_len = crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES;
-	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
+		mark_lost(packet_number, sent_packet);
+		recently_lost.push_back({packet_number, sent_packet.sent_time, sent_packet.length});
+		if(recently_lost.size() > MAX_RECENTLY_LOST) {
+			recently_lost.pop_front();
+		}
 
-	uint8_t buf[ct_len];
-	std::memcpy(buf, static_pk, crypto_box_PUBLICKEYBYTES);
-	std::memcpy(buf + crypto_box_PUBLICKEYBYTES, ephemeral_pk, crypto_kx_PUBLICKEYBYTES);
-	crypto_box_seal(buf, buf, pt_len, remote_static_pk);
+		lost_bytes += sent_packet.length;
+		last_lost = packet_number;
+		last_lost_time = sent_packet.sent_time;
 
-	transport.send(
-		DIAL(ct_len)
-		.set_src_conn_id(this->src_conn_id)
-		.set_dst_conn_id(this->dst_conn_id)
-		.set_payload(buf, ct_len)
-	);
+		// Pop lost packet from sent
+		sent_packets.erase(packet_number);
+	}
+
+	if(last_lost == (uint64_t)-1) {
+		// No lost packets, ignore
+	} else {
+		// Lost packets, congestion event
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: Congestion event: {}, {}",
+			transport->src_addr.to_string(),
+			transport->dst_addr.to_string(),
+			congestion_controller.cwnd(),
+			last_lost
+		);
+		congestion_controller.on_loss({
+			now,
+			last_lost_time,
+			lost_bytes,
+			bytes_in_flight
+		});
+		// Parity did not save these, add redundancy
+		fec_encoder.on_loss();
+		rtt.on_loss(now);
+	}
+
+	return lost_bytes;
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIAL(
-	DIAL &&packet
-) {
-	constexpr size_t pt_len = (crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES);
-	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
+//---------------- Loss detection functions end ----------------//
 
-	if(!packet.validate(ct_len)) {
-		return;
-	}
 
-	switch(conn_state) {
-	case ConnectionState::Listen: {
-		if(packet.src_conn_id() != 0) { // Should have empty source
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: DIAL: Should have empty src: {}",
-				src_addr.to_string(),
-				dst_addr.to_string(),
-				packet.src_conn_id()
-			);
-			return;
-		}
+//---------------- PMTU functions begin ----------------//
 
-		SPDLOG_DEBUG(
-			"Stream transport {{ Src: {}, Dst: {} }}: DIAL <<<< {:spn}",
-			src_addr.to_string(),
-			dst_addr.to_string(),
-			spdlog::to_hex(static_pk, static_pk+crypto_box_PUBLICKEYBYTES)
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::start_pmtu_search() {
+	constexpr bool has_max_datagram_size = requires(
+		BaseTransport& t
+	) {
+		t.max_datagram_size();
+	};
+
+	if constexpr (has_max_datagram_size) {
+		// Nothing to search for if the local MTU is not larger than the default
+		pmtu_search.emplace(
+			DEFAULT_FRAGMENT_SIZE + MAX_FRAGMENT_OVERHEAD,
+			std::min<size_t>(transport->max_datagram_size(), MAX_PMTU_DATAGRAM_SIZE)
 		);
-
-		uint8_t pt[pt_len];
-		auto res = crypto_box_seal_open(pt, packet.payload(), ct_len, static_pk, static_sk);
-		if (res < 0) {
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: DIAL: Unseal failure: {}",
-				src_addr.to_string(),
-				dst_addr.to_string(),
-				res
-			);
-			return;
+		if(!pmtu_search->is_done()) {
+			send_PMTUPROBE();
 		}
+	}
+}
 
-		std::memcpy(remote_static_pk, pt, crypto_box_PUBLICKEYBYTES);
-		std::memcpy(remote_ephemeral_pk, pt + crypto_box_PUBLICKEYBYTES, crypto_kx_PUBLICKEYBYTES);
+template<typename DelegateType, template<typename> class DatagramTransport>
+uint64_t StreamTransport<DelegateType, DatagramTransport>::pmtu_probe_timeout() {
+	if(!rtt.has_sample()) {
+		return DEFAULT_PTO_INTERVAL;
+	}
 
-		auto *kdf = (std::memcmp(ephemeral_pk, remote_ephemeral_pk, crypto_box_PUBLICKEYBYTES) > 0) ? &crypto_kx_server_session_keys : &crypto_kx_client_session_keys;
+	return std::max<uint64_t>((uint64_t)(3 * rtt.smoothed()), MIN_PMTU_PROBE_TIMEOUT);
+}
 
-		if ((*kdf)(rx, tx, ephemeral_pk, ephemeral_sk, remote_ephemeral_pk) != 0) {
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: DIAL: Key derivation failure",
-				src_addr.to_string(),
-				dst_addr.to_string()
-			);
-			return;
-		}
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::pmtu_timer_cb() {
+	if(pmtu_search->is_done()) {
+		// Path might have changed since
+		pmtu_search->restart();
+	} else {
+		// Not counted as congestion, probes are expected to be dropped
+		pmtu_search->on_probe_lost();
+	}
 
-		randombytes_buf(nonce, crypto_aead_aes256gcm_NPUBBYTES);
-		crypto_aead_aes256gcm_beforenm(&rx_ctx, rx);
-		crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
+	send_PMTUPROBE();
+}
 
-		this->dst_conn_id = packet.dst_conn_id();
-		this->src_conn_id = (uint32_t)std::random_device()();
+//---------------- PMTU functions end ----------------//
 
-		send_DIALCONF();
 
-		conn_state = ConnectionState::DialRcvd;
+//---------------- Flow control functions begin ----------------//
 
-		break;
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::advance_read_offset(
+	RecvStream &stream,
+	uint64_t offset
+) {
+	// Delegates queueing received data for later free credit with consume once done with it
+	constexpr bool acks_consumption = requires {
+		requires DelegateType::acks_consumption;
+	};
+	if constexpr (acks_consumption) {
+		stream.unconsumed += offset - stream.read_offset;
+		data_unconsumed += offset - stream.read_offset;
 	}
 
-	case ConnectionState::DialSent: {
+	skip_read_offset(stream, offset);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::skip_read_offset(
+	RecvStream &stream,
+	uint64_t offset
+) {
+	data_read += offset - stream.read_offset;
+	stream.read_offset = offset;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::consume(
+	uint16_t stream_id,
+	uint64_t bytes
+) {
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	bytes = std::min(bytes, data_unconsumed);
+	data_unconsumed -= bytes;
+
+	// Stream is gone once read fully, only the connection credit is left to free then
+	auto iter = recv_streams.find(stream_id);
+	if(iter != recv_streams.end()) {
+		iter->second.unconsumed -= std::min(bytes, iter->second.unconsumed);
+	}
+
+	send_WINDOW(false);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::release_send_buffer(
+	uint64_t bytes
+) {
+	send_buffer_bytes -= bytes;
+
+	// Leave room for more than a single message before telling the delegate
+	if(!is_send_buffer_full || send_buffer_bytes > DEFAULT_SEND_BUFFER_LIMIT / 2) {
+		return;
+	}
+	is_send_buffer_full = false;
+
+	// Drain notifications are optional
+	constexpr bool has_did_drain = requires(
+		DelegateType& d,
+		Self& t
+	) {
+		d.did_drain(t);
+	};
+	if constexpr (has_did_drain) {
+		delegate->did_drain(*this);
+	}
+}
+
+//---------------- Flow control functions end ----------------//
+
+
+//---------------- Deadline functions begin ----------------//
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::deadline_timer_cb() {
+	auto now = asyncio::EventLoop::now();
+	bool abandoned = false;
+
+	while(!send_deadlines.empty() && send_deadlines.begin()->first <= now) {
+		auto [stream_id, offset] = send_deadlines.begin()->second;
+		send_deadlines.erase(send_deadlines.begin());
+
+		// Stream might be gone by now, nothing left to abandon then
+		auto iter = send_streams.find(stream_id);
+		if(iter == send_streams.end() || offset <= iter->second.acked_offset) {
+			continue;
+		}
+
+		abandon_data(iter->second, offset);
+		abandoned = true;
+	}
+
+	if(!send_deadlines.empty()) {
+		deadline_timer.template start<Self, &Self::deadline_timer_cb>(send_deadlines.begin()->first - now, 0);
+	}
+
+	if(abandoned) {
+		// Freed up congestion window, move on to fresh data
+		send_pending_data();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::abandon_data(
+	SendStream &stream,
+	uint64_t offset
+) {
+	SPDLOG_DEBUG(
+		"Stream transport {{ Src: {}, Dst: {} }}: Deadline passed: {}, {}, {}",
+		src_addr.to_string(),
+		dst_addr.to_string(),
+		stream.stream_id,
+		stream.acked_offset,
+		offset
+	);
+
+	purge_packets(stream, offset);
+
+	// Free the abandoned data items, offset is always at the end of one
+	uint64_t released_bytes = 0;
+	bool is_next_item_abandoned = false;
+	while(
+		!stream.data_queue.empty() &&
+		stream.data_queue.front().stream_offset + stream.data_queue.front().data.size() <= offset
+	) {
+		if(stream.next_item_iterator == stream.data_queue.begin()) {
+			is_next_item_abandoned = true;
+		}
+		released_bytes += stream.data_queue.front().data.size();
+		stream.data_queue.pop_front();
+	}
+	if(is_next_item_abandoned) {
+		stream.next_item_iterator = stream.data_queue.begin();
+	}
+
+	// Unsent data is skipped over, the peer counts it against credit all the same
+	if(stream.sent_offset < offset) {
+		data_sent += offset - stream.sent_offset;
+		stream.sent_offset = offset;
+	}
+
+	// Data after the abandoned range might be acked already
+	stream.acked_offset = offset;
+	release_acked_data(stream);
+
+	stream.flush_offset = offset;
+	send_FLUSHSTREAM(stream.stream_id, offset);
+
+	stream.state_timer_interval = 1000;
+	stream.state_timer.template start<Self, SendStream, &Self::flush_timer_cb>(stream.state_timer_interval, 0);
+
+	release_send_buffer(released_bytes);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::purge_packets(
+	SendStream &stream,
+	uint64_t offset
+) {
+	for(
+		auto packet_number = sent_packets.begin_number();
+		packet_number < sent_packets.end_number();
+		packet_number++
+	) {
+		auto *sent_packet = sent_packets.find(packet_number);
+		if(
+			sent_packet == nullptr ||
+			sent_packet->stream != &stream ||
+			sent_packet->data_item->stream_offset + sent_packet->offset >= offset
+		) {
+			continue;
+		}
+
+		stream.bytes_in_flight -= sent_packet->length;
+		bytes_in_flight -= sent_packet->length;
+		sent_packets.erase(packet_number);
+	}
+
+	// Lost packets are no longer in flight
+	for(
+		auto packet_number = lost_packets.begin_number();
+		packet_number < lost_packets.end_number();
+		packet_number++
+	) {
+		auto *lost_packet = lost_packets.find(packet_number);
+		if(
+			lost_packet == nullptr ||
+			lost_packet->stream != &stream ||
+			lost_packet->data_item->stream_offset + lost_packet->offset >= offset
+		) {
+			continue;
+		}
+
+		lost_packets.erase(packet_number);
+	}
+}
+
+//---------------- Deadline functions end ----------------//
+
+
+//---------------- ACK functions begin ----------------//
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::release_acked_data(
+	SendStream &stream
+) {
+	// Process outstanding acks if possible
+	for(
+		auto iter = stream.outstanding_acks.begin();
+		iter != stream.outstanding_acks.end();
+		iter = stream.outstanding_acks.erase(iter)
+	) {
+		if(iter->first > stream.acked_offset) {
+			// Out of order, abort
+			break;
+		}
+
+		uint64_t new_acked_offset = iter->first + iter->second;
+		if(stream.acked_offset < new_acked_offset) {
+			stream.acked_offset = new_acked_offset;
+		}
+	}
+
+	bool fully_acked = true;
+	uint64_t released_bytes = 0;
+	// Cleanup acked data items
+	for(
+		auto iter = stream.data_queue.begin();
+		iter != stream.data_queue.end();
+		iter = stream.data_queue.erase(iter)
+	) {
+		if(stream.acked_offset < iter->stream_offset + iter->data.size()) {
+			// Still not fully acked, skip erase and abort
+			fully_acked = false;
+			break;
+		}
+		released_bytes += iter->data.size();
+
+		if(iter->is_shared) {
+			// Shared buffer completions are optional
+			constexpr bool has_shared_did_send = requires(
+				DelegateType& d
+			) {
+				d.did_send(*this, std::move(iter->data));
+			};
+			if constexpr (has_shared_did_send) {
+				delegate->did_send(
+					*this,
+					std::move(iter->data)
+				);
+			}
+		} else {
+			delegate->did_send(
+				*this,
+				std::move(iter->data).to_buffer()
+			);
+		}
+	}
+
+	if(fully_acked) {
+		stream.next_item_iterator = stream.data_queue.end();
+	}
+
+	release_send_buffer(released_bytes);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::ack_timer_cb() {
+	send_ACK();
+	send_WINDOW(false);
+
+	ack_timer_active = false;
+}
+
+//---------------- ACK functions end ----------------//
+
+
+//---------------- Protocol functions begin ----------------//
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_DIAL() {
+	SPDLOG_DEBUG(
+		"Stream transport {{ Src: {}, Dst: {} }}: DIAL >>>> {:spn}",
+		src_addr.to_string(),
+		dst_addr.to_string(),
+		spdlog::to_hex(remote_static_pk, remote_static_pk+crypto_box_PUBLICKEYBYTES)
+	);
+
+	constexpr size_t pt_len = crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES;
+	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
+
+	uint8_t buf[ct_len];
+	std::memcpy(buf, static_pk, crypto_box_PUBLICKEYBYTES);
+	std::memcpy(buf + crypto_box_PUBLICKEYBYTES, ephemeral_pk, crypto_kx_PUBLICKEYBYTES);
+	crypto_box_seal(buf, buf, pt_len, remote_static_pk);
+
+	transport->send(
+		DIAL(ct_len)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_payload(buf, ct_len)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIAL(
+	DIAL &&packet
+) {
+	constexpr size_t pt_len = (crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES);
+	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
+
+	if(!packet.validate(ct_len)) {
+		return;
+	}
+
+	switch(conn_state) {
+	case ConnectionState::Listen: {
+		if(packet.src_conn_id() != 0) { // Should have empty source
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: DIAL: Should have empty src: {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				packet.src_conn_id()
+			);
+			return;
+		}
+
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: DIAL <<<< {:spn}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			spdlog::to_hex(static_pk, static_pk+crypto_box_PUBLICKEYBYTES)
+		);
+
+		uint8_t pt[pt_len];
+		auto res = crypto_box_seal_open(pt, packet.payload(), ct_len, static_pk, static_sk);
+		if (res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: DIAL: Unseal failure: {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				res
+			);
+			return;
+		}
+
+		std::memcpy(remote_static_pk, pt, crypto_box_PUBLICKEYBYTES);
+		std::memcpy(remote_ephemeral_pk, pt + crypto_box_PUBLICKEYBYTES, crypto_kx_PUBLICKEYBYTES);
+
+		auto *kdf = (std::memcmp(ephemeral_pk, remote_ephemeral_pk, crypto_box_PUBLICKEYBYTES) > 0) ? &crypto_kx_server_session_keys : &crypto_kx_client_session_keys;
+
+		if ((*kdf)(rx, tx, ephemeral_pk, ephemeral_sk, remote_ephemeral_pk) != 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: DIAL: Key derivation failure",
+				src_addr.to_string(),
+				dst_addr.to_string()
+			);
+			return;
+		}
+
+		randombytes_buf(nonce, crypto_aead_aes256gcm_NPUBBYTES);
+		crypto_aead_aes256gcm_beforenm(&rx_ctx, rx);
+		crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
+
+		this->dst_conn_id = packet.dst_conn_id();
+		new_src_conn_id();
+
+		send_DIALCONF();
+
+		conn_state = ConnectionState::DialRcvd;
+
+		break;
+	}
+
+	case ConnectionState::DialSent: {
 		if(packet.src_conn_id() != 0) { // Should have empty source
 			SPDLOG_DEBUG(
 				"Stream transport {{ Src: {}, Dst: {} }}: DIAL: Should have empty src: {}",
@@ -834,7 +1782,7 @@ void StreamTransport<DelegateType, DatagramTransport>::send_DIALCONF() {
 	uint8_t buf[ct_len];
 	crypto_box_seal(buf, ephemeral_pk, pt_len, remote_static_pk);
 
-	transport.send(
+	transport->send(
 		DIALCONF(ct_len)
 		.set_src_conn_id(this->src_conn_id)
 		.set_dst_conn_id(this->dst_conn_id)
@@ -904,7 +1852,11 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
 
 		conn_state = ConnectionState::Established;
 
-		if(dialled) {
+		if(is_resumed) {
+			// Delegate already knows, resend whatever the server dropped
+			send_pending_data();
+			set_loss_timer();
+		} else if(dialled) {
 			delegate->did_dial(*this);
 		}
 
@@ -963,6 +1915,13 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
 			return;
 		}
 
+		if(resume_ticket.has_value()) {
+			// Server accepted the ticket
+			resume_ticket.reset();
+			state_timer.stop();
+			state_timer_interval = 0;
+		}
+
 		send_CONF();
 
 		break;
@@ -989,7 +1948,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::send_CONF() {
-	transport.send(
+	transport->send(
 		CONF()
 		.set_src_conn_id(this->src_conn_id)
 		.set_dst_conn_id(this->dst_conn_id)
@@ -1027,6 +1986,8 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CONF(
 
 		if(dialled) {
 			delegate->did_dial(*this);
+		} else {
+			send_TICKET();
 		}
 
 		break;
@@ -1078,7 +2039,7 @@ void StreamTransport<DelegateType, DatagramTransport>::send_RST(
 	uint32_t src_conn_id,
 	uint32_t dst_conn_id
 ) {
-	transport.send(
+	transport->send(
 		RST()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1101,12 +2062,17 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_RST(
 			src_addr.to_string(),
 			dst_addr.to_string()
 		);
+		if(resume_ticket.has_value()) {
+			// Ticket refused, not a reason to drop the connection
+			fall_back_to_dial();
+			return;
+		}
 		reset();
-		transport.close();
+		transport->close();
 	} else if (conn_state == ConnectionState::Listen) {
 		// Remove idle connection, usually happens if multiple RST are sent
 		reset();
-		transport.close();
+		transport->close();
 	}
 }
 
@@ -1122,6 +2088,85 @@ void StreamTransport<DelegateType, DatagramTransport>::send_DATA(
 	bool is_fin = (stream.done_queueing &&
 		data_item.stream_offset + offset + length >= stream.queue_offset);
 
+	auto now = asyncio::EventLoop::now_us();
+	if(this->bytes_in_flight == 0) {
+		// Nothing in flight, do not count idle time against the delivery rate
+		this->delivered_time = now;
+	}
+
+	auto &sent_packet = this->sent_packets.emplace(
+		this->last_sent_packet,
+		now,
+		&stream,
+		&data_item,
+		offset,
+		length
+	);
+	sent_packet.delivered = this->delivered;
+	sent_packet.delivered_time = this->delivered_time;
+	congestion_controller.on_packet_sent(now, length, this->bytes_in_flight);
+
+	// Gather header and trailer around the payload instead of copying it into the packet
+	constexpr bool can_gather = !is_encrypted && requires(
+		BaseTransport& t,
+		core::BufferChain&& c
+	) {
+		t.send(std::move(c));
+	};
+
+	if constexpr (can_gather) {
+		// Header and trailer share a single allocation
+		core::SharedBuffer frame = DATA(crypto_aead_aes256gcm_ABYTES + 12, is_fin)
+						.set_src_conn_id(src_conn_id)
+						.set_dst_conn_id(dst_conn_id)
+						.set_packet_number(this->last_sent_packet)
+						.set_stream_id(stream.stream_id)
+						.set_offset(data_item.stream_offset + offset)
+						.set_length(length)
+						.payload_buffer()
+						.uncover_unsafe(30);
+		frame.write_unsafe(30 + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+		auto header = frame.clone();
+		header.truncate_unsafe(crypto_aead_aes256gcm_ABYTES + 12);
+		frame.cover_unsafe(30);
+
+		auto payload = data_item.data.clone();
+		payload.truncate_unsafe(payload.size() - offset - length).cover_unsafe(offset);
+
+		transport->send(
+			core::BufferChain(std::move(header))
+				.append(std::move(payload))
+				.append(std::move(frame))
+		);
+	} else {
+		send_DATA_copy(stream, data_item, offset, length, is_fin);
+	}
+
+	if(is_fec_enabled) {
+		fec_encoder.add(
+			this->last_sent_packet,
+			stream.stream_id,
+			data_item.stream_offset + offset,
+			length,
+			is_fin,
+			data_item.data.data() + offset
+		);
+	}
+
+	if(is_fin && stream.state != SendStream::State::Acked) {
+		stream.state = SendStream::State::Sent;
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_DATA_copy(
+	SendStream &stream,
+	DataItem &data_item,
+	uint64_t offset,
+	uint16_t length,
+	bool is_fin
+) {
 	auto packet = DATA(12 + length + crypto_aead_aes256gcm_ABYTES, is_fin)
 					.set_src_conn_id(src_conn_id)
 					.set_dst_conn_id(dst_conn_id)
@@ -1151,23 +2196,7 @@ void StreamTransport<DelegateType, DatagramTransport>::send_DATA(
 		sodium_increment(nonce, 12);
 	}
 
-	this->sent_packets.emplace(
-		std::piecewise_construct,
-		std::forward_as_tuple(this->last_sent_packet),
-		std::forward_as_tuple(
-			asyncio::EventLoop::now(),
-			&stream,
-			&data_item,
-			offset,
-			length
-		)
-	);
-
-	transport.send(std::move(packet));
-
-	if(is_fin && stream.state != SendStream::State::Acked) {
-		stream.state = SendStream::State::Sent;
-	}
+	transport->send(std::move(packet));
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
@@ -1227,6 +2256,8 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 
 		if(dialled) {
 			delegate->did_dial(*this);
+		} else {
+			send_TICKET();
 		}
 	} else if(conn_state != ConnectionState::Established) {
 		return;
@@ -1235,8 +2266,67 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 	auto offset = packet.offset();
 	auto length = packet.length();
 	auto packet_number = packet.packet_number();
+	auto stream_id = packet.stream_id();
+	auto is_fin = packet.is_fin_set();
+
+	auto p = std::move(packet).payload_buffer();
+	p.truncate_unsafe(crypto_aead_aes256gcm_ABYTES + 12);
+
+	// Check if length matches packet
+	// FIXME: Why even have length? Can just set from the packet
+	if(p.size() != length) {
+		return;
+	}
+
+	if(fec_decoder.is_active()) {
+		fec_decoder.add(packet_number, stream_id, offset, length, is_fin, p.data());
+	}
+
+	did_recv_fragment(packet_number, stream_id, offset, length, is_fin, std::move(p));
+
+	// Rebuild lost packets whose group is now complete enough
+	fec_decoder.did_add([this](FecRecoveredPacket &&recovered) {
+		did_recv_recovered(std::move(recovered));
+	});
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_recovered(
+	FecRecoveredPacket &&recovered
+) {
+	SPDLOG_DEBUG("Recovered packet: {}, {}, {}", recovered.packet_number, recovered.offset, recovered.length);
+	did_recv_fragment(
+		recovered.packet_number,
+		recovered.stream_id,
+		recovered.offset,
+		recovered.length,
+		recovered.is_fin,
+		std::move(recovered.payload)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::schedule_ack(uint64_t packet_number) {
+	// Add to ack range
+	ack_ranges.add_packet_number(packet_number);
+
+	// Start ack delay timer if not already active
+	if(!ack_timer_active) {
+		ack_timer_active = true;
+		ack_timer.template start<Self, &Self::ack_timer_cb>(MAX_ACK_DELAY / 1000, 0);
+	}
+}
 
-	auto &stream = get_or_create_recv_stream(packet.stream_id());
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_fragment(
+	uint64_t packet_number,
+	uint16_t stream_id,
+	uint64_t offset,
+	uint16_t length,
+	bool is_fin,
+	core::Buffer &&p
+) {
+	auto &stream = get_or_create_recv_stream(stream_id);
 
 	// Short circuit once stream has been received fully.
 	if(stream.state == RecvStream::State::AllRecv ||
@@ -1249,29 +2339,33 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 		return;
 	}
 
+	// Drop data beyond the credit without acking, bounds the out of order data buffered
+	if(offset + length > stream.highest_offset) {
+		auto new_bytes = offset + length - stream.highest_offset;
+		if(offset + length > stream.read_offset - stream.unconsumed + DEFAULT_STREAM_WINDOW ||
+			data_recv + new_bytes > data_read - data_unconsumed + DEFAULT_CONN_WINDOW) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: Flow control violation: {}, {}, {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				stream_id,
+				offset,
+				length
+			);
+			return;
+		}
+
+		stream.highest_offset = offset + length;
+		data_recv += new_bytes;
+	}
+
 	// Set stream size if fin bit set
-	if(packet.is_fin_set() && stream.state == RecvStream::State::Recv) {
+	if(is_fin && stream.state == RecvStream::State::Recv) {
 		stream.size = offset + length;
 		stream.state = RecvStream::State::SizeKnown;
 	}
 
-	auto p = std::move(packet).payload_buffer();
-	p.truncate_unsafe(crypto_aead_aes256gcm_ABYTES + 12);
-
-	// Check if length matches packet
-	// FIXME: Why even have length? Can just set from the packet
-	if(p.size() != length) {
-		return;
-	}
-
-	// Add to ack range
-	ack_ranges.add_packet_number(packet_number);
-
-	// Start ack delay timer if not already active
-	if(!ack_timer_active) {
-		ack_timer_active = true;
-		ack_timer.template start<Self, &Self::ack_timer_cb>(25, 0);
-	}
+	schedule_ack(packet_number);
 
 	// Short circuit on no new data
 	if(offset + length <= stream.read_offset) {
@@ -1283,41 +2377,87 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 		// Cover bytes which have already been read
 		p.cover_unsafe(stream.read_offset - offset);
 
-		// Read bytes and update offset
+		// Deliver contiguous fragments together if the delegate takes chains
+		constexpr bool can_recv_chain = requires(
+			DelegateType& d,
+			Self& t,
+			core::BufferChain&& c
+		) {
+			d.did_recv(t, std::move(c), stream_id);
+		};
+
+		if constexpr (can_recv_chain) {
+			if(!stream.recv_packets.empty() && stream.recv_packets.front().offset <= offset + length) {
+				core::BufferChain chain{core::SharedBuffer(std::move(p))};
+				advance_read_offset(stream, offset + length);
+
+				// Append any out of order data
+				while(!stream.recv_packets.empty() && stream.recv_packets.front().offset <= stream.read_offset) {
+					auto &packet = stream.recv_packets.front();
+
+					// Check new data
+					if(packet.offset + packet.length > stream.read_offset) {
+						// Cover bytes which have already been read
+						packet.packet.cover_unsafe(stream.read_offset - packet.offset);
+						SPDLOG_DEBUG("Out of order: {}, {}", packet.offset, packet.length);
+
+						advance_read_offset(stream, packet.offset + packet.length);
+						chain.append(core::SharedBuffer(std::move(packet.packet)));
+					}
+
+					stream.recv_packets.pop_front();
+				}
+
+				auto res = delegate->did_recv(*this, std::move(chain), stream.stream_id);
+				if(res < 0) {
+					return;
+				}
+
+				// Check all data read
+				if(stream.check_read()) {
+					stream.state = RecvStream::State::Read;
+					recv_streams.erase(stream.stream_id);
+				}
+
+				return;
+			}
+		}
+
+		// Update offset and read bytes, the delegate might ack them right away
+		advance_read_offset(stream, offset + length);
 		auto res = delegate->did_recv(*this, std::move(p), stream.stream_id);
 		if(res < 0) {
 			return;
 		}
-		stream.read_offset = offset + length;
 
 		// Read any out of order data
-		auto iter = stream.recv_packets.begin();
-		while(iter != stream.recv_packets.end()) {
+		while(!stream.recv_packets.empty()) {
+			auto &packet = stream.recv_packets.front();
+
 			// Short circuit if data can't be read immediately
-			if(iter->second.offset > stream.read_offset) {
+			if(packet.offset > stream.read_offset) {
 				break;
 			}
 
-			auto offset = iter->second.offset;
-			auto length = iter->second.length;
+			auto offset = packet.offset;
+			auto length = packet.length;
 
 			// Check new data
 			if(offset + length > stream.read_offset) {
 				// Cover bytes which have already been read
-				iter->second.packet.cover_unsafe(stream.read_offset - offset);
+				packet.packet.cover_unsafe(stream.read_offset - offset);
 
-				// Read bytes and update offset
-				SPDLOG_DEBUG("Out of order: {}, {}, {:spn}", offset, length, spdlog::to_hex(iter->second.packet.data(), iter->second.packet.data() + iter->second.packet.size()));
-				auto res = delegate->did_recv(*this, std::move(iter->second).packet, stream.stream_id);
+				// Update offset and read bytes
+				SPDLOG_DEBUG("Out of order: {}, {}, {:spn}", offset, length, spdlog::to_hex(packet.packet.data(), packet.packet.data() + packet.packet.size()));
+				advance_read_offset(stream, offset + length);
+				auto res = delegate->did_recv(*this, std::move(packet.packet), stream.stream_id);
 				if(res < 0) {
 					return;
 				}
-
-				stream.read_offset = offset + length;
 			}
 
-			// Next iter
-			iter = stream.recv_packets.erase(iter);
+			// Next packet
+			stream.recv_packets.pop_front();
 		}
 
 		// Check all data read
@@ -1328,8 +2468,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 	} else {
 		// Queue packet for later processing
 		SPDLOG_DEBUG("Queue for later: {}, {}, {:spn}", offset, length, spdlog::to_hex(p.data(), p.data() + p.size()));
-		stream.recv_packets.try_emplace(
-			offset,
+		stream.recv_packets.insert(
 			asyncio::EventLoop::now(),
 			offset,
 			length,
@@ -1345,16 +2484,25 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::send_ACK() {
-	size_t size = ack_ranges.ranges.size() > 171 ? 171 : ack_ranges.ranges.size();
+	if(ack_ranges.empty()) {
+		return;
+	}
 
-	transport.send(
-		ACK(size)
-		.set_src_conn_id(src_conn_id)
-		.set_dst_conn_id(dst_conn_id)
-		.set_packet_number(ack_ranges.largest)
-		.set_size(size)
-		.set_ranges(ack_ranges.ranges.begin(), ack_ranges.ranges.end())
-	);
+	// Split ranges across as many packets as needed, each acks from its own largest
+	auto num_seen = (ack_ranges.size() + 1) / 2;
+	for(size_t from = 0; from < num_seen;) {
+		auto largest = ack_ranges.high(from);
+		from += ack_ranges.encode(from, MAX_ACK_PACKET_RANGES, ack_encoded);
+
+		transport->send(
+			ACK(ack_encoded.size())
+			.set_src_conn_id(src_conn_id)
+			.set_dst_conn_id(dst_conn_id)
+			.set_packet_number(largest)
+			.set_size(ack_encoded.size())
+			.set_ranges(ack_encoded.begin(), ack_encoded.end())
+		);
+	}
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
@@ -1385,29 +2533,43 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 		return;
 	}
 
-	auto now = asyncio::EventLoop::now();
+	auto now = asyncio::EventLoop::now_us();
 
 	uint64_t largest = packet.packet_number();
 
-	// New largest acked packet
-	if(largest > largest_acked && sent_packets.find(largest) != sent_packets.end()) {
-		auto &sent_packet = sent_packets[largest];
+	// Confirm the ranges reported so that the peer stops reporting them
+	uint64_t reported = 0;
+	for(auto iter = packet.ranges_begin(); iter != packet.ranges_end(); ++iter) {
+		reported += *iter;
+	}
+	if(reported > 0 && reported <= largest + 1) {
+		send_ACKCONF(largest, largest + 1 - reported);
+	}
 
+	// New largest acked packet, DATAGRAMs are not tracked in flight but still count
+	auto *largest_packet = sent_packets.find(largest);
+	if(largest > largest_acked && largest <= last_sent_packet) {
 		// Update largest packet details
 		largest_acked = largest;
-		largest_sent_time = sent_packet.sent_time;
 
 		// Update RTT estimate
-		if(rtt < 0) {
-			rtt = now - sent_packet.sent_time;
-		} else {
-			rtt = 0.875 * rtt + 0.125 * (now - sent_packet.sent_time);
+		if(largest_packet != nullptr) {
+			rtt.add_sample(now - largest_packet->sent_time);
 		}
 	}
 
+	// Packets declared lost but not resent yet can still be acked
+	uint64_t begin_number = sent_packets.empty() ? -1 : sent_packets.begin_number();
+	uint64_t end_number = sent_packets.empty() ? 0 : sent_packets.end_number();
+	if(!lost_packets.empty()) {
+		begin_number = std::min(begin_number, lost_packets.begin_number());
+		end_number = std::max(end_number, lost_packets.end_number());
+	}
+	bool is_spurious_loss = false;
+
 	uint64_t high = largest;
 	bool gap = false;
-	bool is_app_limited = (bytes_in_flight < 0.8 * congestion_window);
+	bool is_app_limited = (bytes_in_flight < 0.8 * congestion_controller.cwnd());
 
 	for(
 		auto iter = packet.ranges_begin();
@@ -1424,17 +2586,65 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 			continue;
 		}
 
-		// Get packets within range [low+1, high]
-		auto low_iter = sent_packets.lower_bound(low + 1);
-		auto high_iter = sent_packets.upper_bound(high);
+		// Acked packets declared lost were only reordered
+		auto lost_begin = std::ranges::lower_bound(recently_lost, low + 1, {}, &LostPacket::packet_number);
+		auto lost_end = std::ranges::upper_bound(lost_begin, recently_lost.end(), high, {}, &LostPacket::packet_number);
+		for(auto iter = lost_begin; iter != lost_end; iter++) {
+			is_spurious_loss = true;
+			congestion_controller.on_spurious_loss({
+				now,
+				iter->sent_time,
+				iter->length,
+				bytes_in_flight
+			});
+		}
+		recently_lost.erase(lost_begin, lost_end);
 
-		// Iterate acked packets
+		// Iterate acked packets within range [low+1, high]
 		for(
-			;
-			low_iter != high_iter;
-			low_iter = sent_packets.erase(low_iter)
+			auto packet_number = std::max(low + 1, begin_number);
+			packet_number <= high && packet_number < end_number;
+			packet_number++
 		) {
-			auto &sent_packet = low_iter->second;
+			auto *acked_packet = sent_packets.find(packet_number);
+			bool is_lost = false;
+			if(acked_packet == nullptr) {
+				acked_packet = lost_packets.find(packet_number);
+				if(acked_packet == nullptr) {
+					continue;
+				}
+				// Acked before it was resent, no need to resend
+				is_lost = true;
+			}
+
+			// Copy out, delegate callbacks below can send new packets
+			auto sent_packet = *acked_packet;
+			if(is_lost) {
+				lost_packets.erase(packet_number);
+			} else {
+				sent_packets.erase(packet_number);
+			}
+
+			if(sent_packet.stream == nullptr) {
+				// REPAIR, DATAGRAM or PING, only counts towards congestion control, PINGs carry nothing
+				if(sent_packet.length == 0) {
+					continue;
+				}
+				bytes_in_flight -= sent_packet.length;
+				delivered += sent_packet.length;
+				delivered_time = now;
+				congestion_controller.on_ack({
+					now,
+					sent_packet.sent_time,
+					sent_packet.length,
+					bytes_in_flight,
+					delivered,
+					sent_packet.delivered,
+					0,
+					is_app_limited
+				});
+				continue;
+			}
 			auto &stream = *sent_packet.stream;
 
 			auto sent_offset = sent_packet.data_item->stream_offset + sent_packet.offset;
@@ -1446,75 +2656,37 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 				// In order ack
 				stream.acked_offset = sent_offset + sent_packet.length;
 
-				// Process outstanding acks if possible
-				for(
-					auto iter = stream.outstanding_acks.begin();
-					iter != stream.outstanding_acks.end();
-					iter = stream.outstanding_acks.erase(iter)
-				) {
-					if(iter->first > stream.acked_offset) {
-						// Out of order, abort
-						break;
-					}
-
-					uint64_t new_acked_offset = iter->first + iter->second;
-					if(stream.acked_offset < new_acked_offset) {
-						stream.acked_offset = new_acked_offset;
-					}
-				}
-
-				bool fully_acked = true;
-				// Cleanup acked data items
-				for(
-					auto iter = stream.data_queue.begin();
-					iter != stream.data_queue.end();
-					iter = stream.data_queue.erase(iter)
-				) {
-					if(stream.acked_offset < iter->stream_offset + iter->data.size()) {
-						// Still not fully acked, skip erase and abort
-						fully_acked = false;
-						break;
-					}
-
-					delegate->did_send(
-						*this,
-						std::move(iter->data)
-					);
-				}
-
-				if(fully_acked) {
-					stream.next_item_iterator = stream.data_queue.end();
-				}
+				release_acked_data(stream);
 			} else {
 				// Already acked range, ignore
 			}
 
-			// Cleanup
-			stream.bytes_in_flight -= sent_packet.length;
-			bytes_in_flight -= sent_packet.length;
+			// Cleanup, lost packets are out of flight already
+			if(!is_lost) {
+				stream.bytes_in_flight -= sent_packet.length;
+				bytes_in_flight -= sent_packet.length;
+			}
 
-			SPDLOG_TRACE("Times: {}, {}", sent_packet.sent_time, congestion_start);
+			// Delivery rate over the lifetime of the packet
+			delivered += sent_packet.length;
+			delivered_time = now;
+			double delivery_rate = 0;
+			if(now > sent_packet.delivered_time) {
+				delivery_rate = double(delivered - sent_packet.delivered) / (now - sent_packet.delivered_time);
+			}
 
 			// Congestion control
-			// Check if not in congestion recovery and not application limited
-			if(sent_packet.sent_time > congestion_start && !is_app_limited) {
-				if(congestion_window < ssthresh) {
-					// Slow start, exponential increase
-					congestion_window += sent_packet.length;
-				} else {
-					// Congestion avoidance, CUBIC
-					// auto k = k;
-					// auto t = now - congestion_start;
-					// congestion_window = w_max + 4 * std::pow(0.001 * (t - k), 3);
-
-					// if(congestion_window < 10000) {
-					// 	congestion_window = 10000;
-					// }
-
-					// Congestion avoidance, NEW RENO
-					congestion_window += 1500 * sent_packet.length / congestion_window;
-				}
-			}
+			congestion_controller.on_ack({
+				now,
+				sent_packet.sent_time,
+				sent_packet.length,
+				bytes_in_flight,
+				delivered,
+				sent_packet.delivered,
+				delivery_rate,
+				is_app_limited
+			});
+			fec_encoder.on_ack(1);
 
 			// Check stream finish
 			if (stream.state == SendStream::State::Sent &&
@@ -1534,77 +2706,59 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 		high = low;
 	}
 
-	auto sent_iter = sent_packets.begin();
+	if(is_spurious_loss) {
+		rtt.on_spurious_loss();
+	}
 
 	// Determine lost packets
-	while(sent_iter != sent_packets.end()) {
-		// Condition for packet in flight to be considered lost
-		// 1. more than 20 packets before largest acked - disabled for now
-		// 2. more than 25ms before before largest acked
-		if (/*sent_iter->first + 20 < largest_acked ||*/
-			largest_sent_time > sent_iter->second.sent_time + 50) {
-			SPDLOG_TRACE(
-				"Stream transport {{ Src: {}, Dst: {} }}: Lost packet: {}, {}, {}",
-				transport.src_addr.to_string(),
-				transport.dst_addr.to_string(),
-				sent_iter->first,
-				largest_sent_time,
-				sent_iter->second.sent_time
-			);
-
-			bytes_in_flight -= sent_iter->second.length;
-			sent_iter->second.stream->bytes_in_flight -= sent_iter->second.length;
-			lost_packets[sent_iter->first] = sent_iter->second;
+	detect_lost_packets(now);
 
-			sent_iter++;
-		} else {
-			break;
-		}
-	}
-
-	if(sent_iter == sent_packets.begin()) {
-		// No lost packets, ignore
-	} else {
-		// Lost packets, congestion event
-		auto last_iter = std::prev(sent_iter);
-		auto &sent_packet = last_iter->second;
+	// New packets
+	send_pending_data();
 
-		if(sent_packet.sent_time > congestion_start) {
-			// New congestion event
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: Congestion event: {}, {}",
-				transport.src_addr.to_string(),
-				transport.dst_addr.to_string(),
-				congestion_window,
-				last_iter->first
-			);
-			congestion_start = now;
+	pto_count = 0;
+	set_loss_timer();
+}
 
-			if(congestion_window < w_max) {
-				// Fast convergence
-				w_max = congestion_window;
-				congestion_window *= 0.6;
-			} else {
-				w_max = congestion_window;
-				congestion_window *= 0.75;
-			}
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_ACKCONF(
+	uint64_t largest,
+	uint64_t smallest
+) {
+	transport->send(
+		ACKCONF()
+		.set_src_conn_id(src_conn_id)
+		.set_dst_conn_id(dst_conn_id)
+		.set_largest(largest)
+		.set_smallest(smallest)
+	);
+}
 
-			if(congestion_window < 10000) {
-				congestion_window = 10000;
-			}
-			ssthresh = congestion_window;
-			k = std::cbrt(w_max / 16)*1000;
-		}
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACKCONF(
+	ACKCONF &&packet
+) {
+	if(!packet.validate()) {
+		return;
+	}
 
-		// Pop lost packets from sent
-		sent_packets.erase(sent_packets.begin(), sent_iter);
+	if(conn_state != ConnectionState::Established) {
+		return;
 	}
 
-	// New packets
-	send_pending_data();
+	if(packet.src_conn_id() != src_conn_id || packet.dst_conn_id() != dst_conn_id) {
+		return;
+	}
 
-	tlp_interval = DEFAULT_TLP_INTERVAL;
-	tlp_timer.template start<Self, &Self::tlp_timer_cb>(tlp_interval, 0);
+	// The peer knows every packet number the ACK reported as seen. Older ones only stop being
+	// reported if it reached down to the oldest tracked range, split ACKs are confirmed bottom up.
+	if(
+		!ack_ranges.empty() &&
+		packet.smallest() <= ack_ranges.smallest() &&
+		packet.largest() <= ack_ranges.largest()
+	) {
+		ack_ranges.prune_below(packet.largest());
+	}
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
@@ -1612,7 +2766,7 @@ void StreamTransport<DelegateType, DatagramTransport>::send_SKIPSTREAM(
 	uint16_t stream_id,
 	uint64_t offset
 ) {
-	transport.send(
+	transport->send(
 		SKIPSTREAM()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1671,7 +2825,7 @@ void StreamTransport<DelegateType, DatagramTransport>::send_FLUSHSTREAM(
 	uint16_t stream_id,
 	uint64_t offset
 ) {
-	transport.send(
+	transport->send(
 		FLUSHSTREAM()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1724,24 +2878,52 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_FLUSHSTREAM(
 			dst_addr.to_string(),
 			stream_id
 		);
+		// Confirmation might have been lost, the sender retries until it gets one
+		send_FLUSHCONF(stream_id);
 		return;
 	}
 
 	stream.state_timer.stop();
 
-	stream.read_offset = offset;
+	// Data skipped over counts as received and read
+	if(offset > stream.highest_offset) {
+		data_recv += offset - stream.highest_offset;
+		stream.highest_offset = offset;
+	}
+	skip_read_offset(stream, offset);
 	stream.wait_flush = false;
 
 	delegate->did_recv_flush_stream(*this, stream_id, offset, old_offset);
 
 	send_FLUSHCONF(stream_id);
+	// Sender might be waiting on credit for data after the flush
+	send_WINDOW(false);
+
+	// Flushes on a deadline keep the stream going, drop what was skipped and read data after it that arrived early
+	while(!stream.recv_packets.empty() && stream.recv_packets.front().offset <= stream.read_offset) {
+		auto &packet = stream.recv_packets.front();
+
+		// Check new data
+		if(packet.offset + packet.length > stream.read_offset) {
+			// Cover bytes which have already been skipped
+			packet.packet.cover_unsafe(stream.read_offset - packet.offset);
+
+			advance_read_offset(stream, packet.offset + packet.length);
+			auto res = delegate->did_recv(*this, std::move(packet.packet), stream_id);
+			if(res < 0) {
+				return;
+			}
+		}
+
+		stream.recv_packets.pop_front();
+	}
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::send_FLUSHCONF(
 	uint16_t stream_id
 ) {
-	transport.send(
+	transport->send(
 		FLUSHCONF()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1789,7 +2971,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_FLUSHCONF(
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::send_CLOSE(uint16_t reason) {
-	transport.send(
+	transport->send(
 		CLOSE()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1825,7 +3007,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSE(
 		if(conn_state == ConnectionState::Listen) {
 			// Close idle connections
 			reset();
-			transport.close();
+			transport->close();
 		}
 		return;
 	}
@@ -1835,11 +3017,11 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSE(
 	if(conn_state == ConnectionState::Established || conn_state == ConnectionState::Closing) {
 		send_CLOSECONF(src_conn_id, dst_conn_id);
 		reset();
-		transport.close(packet.reason());
+		transport->close(packet.reason());
 	} else if(conn_state == ConnectionState::Listen) {
 		// Close idle connections
 		reset();
-		transport.close();
+		transport->close();
 	} else {
 		// Ignore in other states
 	}
@@ -1850,7 +3032,7 @@ void StreamTransport<DelegateType, DatagramTransport>::send_CLOSECONF(
 	uint32_t src_conn_id,
 	uint32_t dst_conn_id
 ) {
-	transport.send(
+	transport->send(
 		CLOSECONF()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1886,88 +3068,1255 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSECONF(
 	}
 
 	reset();
-	transport.close();
+	transport->close();
 }
 
-//---------------- Protocol functions end ----------------//
-
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_REPAIR() {
+	size_t parity_size = FecParity::header_size + fec_encoder.payload_length();
 
-//---------------- Delegate functions begin ----------------//
+	// In flight like DATA so that it is paced and congestion controlled, but never resent
+	this->last_sent_packet++;
 
-//! Callback function when trying to establish a connection with a peer. Sends a DIAL packet to initiate the handshake
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_dial(
-	BaseTransport &,
-	uint8_t const* remote_static_pk
-) {
-	if(conn_state != ConnectionState::Listen) {
-		return;
+	auto now = asyncio::EventLoop::now_us();
+	if(this->bytes_in_flight == 0) {
+		this->delivered_time = now;
 	}
 
-	if (remote_static_pk != nullptr) {
-		std::memcpy(this->remote_static_pk, remote_static_pk, crypto_box_PUBLICKEYBYTES);
-	}
+	auto &sent_packet = this->sent_packets.emplace(
+		this->last_sent_packet,
+		now,
+		nullptr,
+		nullptr,
+		0,
+		parity_size
+	);
+	sent_packet.delivered = this->delivered;
+	sent_packet.delivered_time = this->delivered_time;
+	congestion_controller.on_packet_sent(now, parity_size, this->bytes_in_flight);
+	this->bytes_in_flight += parity_size;
 
-	// Begin handshake
-	dialled = true;
+	auto packet = REPAIR(parity_size + crypto_aead_aes256gcm_ABYTES + 12)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.set_packet_number(this->last_sent_packet)
+					.set_first_packet_number(fec_encoder.first_packet_number())
+					.set_count(fec_encoder.size())
+					.set_payload(fec_encoder.data(), parity_size)
+					.payload_buffer();
 
-	state_timer_interval = 1000;
-	state_timer.template start<Self, &Self::dial_timer_cb>(state_timer_interval, 0);
+	packet.uncover_unsafe(28);
+	packet.write_unsafe(28 + parity_size + crypto_aead_aes256gcm_ABYTES, nonce, 12);
 
-	src_conn_id = (uint32_t)std::random_device()();
-	send_DIAL();
-	conn_state = ConnectionState::DialSent;
-}
+	if constexpr (is_encrypted) {
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 26,
+			nullptr,
+			packet.data() + 26,
+			2 + parity_size,
+			packet.data() + 2,
+			24,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_close(
-	BaseTransport &,
-	uint16_t reason
-) {
-	delegate->did_close(*this, reason);
-	transport_manager.erase(dst_addr);
-}
+	transport->send(std::move(packet));
 
-//! Receives the packet and processes them
-/*!
-	Determines the type of packet by reading the first byte and redirects the packet to appropriate function for further processing
+	fec_encoder.clear();
+}
 
-	\li \b byte :	\b type
-	\li 0		:	DATA
-	\li 1		:	DATA + FIN
-	\li 2		:	ACK
-	\li 3		:	DIAL
-	\li 4		:	DIALCONF
-	\li 5		:	CONF
-	\li 6		:	RST
-*/
 template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv(
-	BaseTransport &,
-	BaseMessageType &&packet
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_REPAIR(
+	REPAIR &&packet
 ) {
-	auto type = packet.payload_buffer().read_uint8(1);
-	if(type == std::nullopt || packet.payload_buffer().read_uint8_unsafe(0) != 0) {
+	if(!packet.validate(FecParity::header_size + crypto_aead_aes256gcm_ABYTES + 12)) {
 		return;
 	}
 
-	switch(type.value()) {
-		// DATA
-		case 0:
-		// DATA + FIN
-		case 1: did_recv_DATA(std::move(packet));
-		break;
-		// ACK
-		case 2: did_recv_ACK(std::move(packet));
-		break;
-		// DIAL
-		case 3: did_recv_DIAL(std::move(packet));
-		break;
-		// DIALCONF
-		case 4: did_recv_DIALCONF(std::move(packet));
-		break;
-		// CONF
-		case 5: did_recv_CONF(std::move(packet));
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: REPAIR: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
+	}
+
+	if constexpr (is_encrypted) {
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			packet.payload() - 2,
+			nullptr,
+			nullptr,
+			packet.payload() - 2,
+			packet.payload_buffer().size() - 10,
+			packet.payload() - 26,
+			24,
+			packet.payload() + packet.payload_buffer().size() - 12,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: REPAIR: Decryption failure: {}, {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				this->src_conn_id,
+				this->dst_conn_id
+			);
+			send_RST(src_conn_id, dst_conn_id);
+			return;
+		}
+	}
+
+	SPDLOG_TRACE("REPAIR <<< {}: {}, {}", dst_addr.to_string(), packet.first_packet_number(), packet.count());
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	schedule_ack(packet.packet_number());
+
+	fec_decoder.add_parity(
+		packet.first_packet_number(),
+		packet.count(),
+		packet.payload(),
+		packet.payload_buffer().size() - crypto_aead_aes256gcm_ABYTES - 12,
+		[this](FecRecoveredPacket &&recovered) {
+			did_recv_recovered(std::move(recovered));
+		}
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_TICKET() {
+	if(session_cache == nullptr) {
+		return;
+	}
+
+	constexpr size_t pt_len = SessionTicket::secret_size + SessionTicket::blob_size;
+	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
+
+	auto ticket = session_cache->issue(remote_static_pk, ticket_time());
+
+	uint8_t buf[ct_len];
+	std::memcpy(buf, ticket.secret, SessionTicket::secret_size);
+	std::memcpy(buf + SessionTicket::secret_size, ticket.blob, SessionTicket::blob_size);
+	crypto_box_seal(buf, buf, pt_len, remote_static_pk);
+	sodium_memzero(ticket.secret, SessionTicket::secret_size);
+
+	transport->send(
+		TICKET(ct_len)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_payload(buf, ct_len)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_TICKET(
+	TICKET &&packet
+) {
+	constexpr size_t pt_len = SessionTicket::secret_size + SessionTicket::blob_size;
+	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
+
+	if(!packet.validate(ct_len)) {
+		return;
+	}
+
+	SPDLOG_TRACE("TICKET <<< {}", dst_addr.to_string());
+
+	if(conn_state != ConnectionState::Established || session_cache == nullptr) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale ticket, ignore
+		return;
+	}
+
+	uint8_t pt[pt_len];
+	if(crypto_box_seal_open(pt, packet.payload(), ct_len, static_pk, static_sk) != 0) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: TICKET: Unseal failure",
+			src_addr.to_string(),
+			dst_addr.to_string()
+		);
+		return;
+	}
+
+	SessionTicket ticket;
+	std::memcpy(ticket.secret, pt, SessionTicket::secret_size);
+	std::memcpy(ticket.blob, pt + SessionTicket::secret_size, SessionTicket::blob_size);
+	// Expire a little early so that the server does not see it expired
+	ticket.expiry = ticket_time() + SessionCache::ticket_lifetime - 10;
+	sodium_memzero(pt, pt_len);
+
+	session_cache->store(remote_static_pk, ticket);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_RESUME() {
+	constexpr size_t len = crypto_kx_PUBLICKEYBYTES + SessionTicket::blob_size + SessionCache::auth_size;
+
+	uint8_t buf[len];
+	std::memcpy(buf, ephemeral_pk, crypto_kx_PUBLICKEYBYTES);
+	std::memcpy(buf + crypto_kx_PUBLICKEYBYTES, resume_ticket->blob, SessionTicket::blob_size);
+	SessionCache::authenticate(
+		buf + crypto_kx_PUBLICKEYBYTES + SessionTicket::blob_size,
+		this->src_conn_id,
+		this->dst_conn_id,
+		ephemeral_pk,
+		resume_ticket->secret
+	);
+
+	transport->send(
+		RESUME(len)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_payload(buf, len)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_RESUME(
+	RESUME &&packet
+) {
+	constexpr size_t len = crypto_kx_PUBLICKEYBYTES + SessionTicket::blob_size + SessionCache::auth_size;
+
+	if(!packet.validate(len)) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+
+	switch(conn_state) {
+	case ConnectionState::Listen: {
+		if(src_conn_id == 0 || dst_conn_id == 0) {
+			return;
+		}
+
+		// Tag is checked before the ticket is used up or any state is touched
+		uint8_t secret[SessionTicket::secret_size];
+		if(session_cache == nullptr || !session_cache->redeem(
+			packet.payload() + crypto_kx_PUBLICKEYBYTES,
+			packet.payload() + crypto_kx_PUBLICKEYBYTES + SessionTicket::blob_size,
+			dst_conn_id,
+			src_conn_id,
+			packet.payload(),
+			ticket_time(),
+			remote_static_pk,
+			secret
+		)) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: RESUME: Ticket refused",
+				src_addr.to_string(),
+				dst_addr.to_string()
+			);
+			// Client falls back to a full handshake
+			send_RST(src_conn_id, dst_conn_id);
+			return;
+		}
+
+		std::memcpy(remote_ephemeral_pk, packet.payload(), crypto_kx_PUBLICKEYBYTES);
+		SessionCache::derive_keys(secret, remote_ephemeral_pk, false, rx, tx);
+		sodium_memzero(secret, SessionTicket::secret_size);
+
+		randombytes_buf(nonce, crypto_aead_aes256gcm_NPUBBYTES);
+		crypto_aead_aes256gcm_beforenm(&rx_ctx, rx);
+		crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
+
+		// Ids picked by the client, DATA sent along with RESUME uses them
+		adopt_src_conn_id(src_conn_id);
+		this->dst_conn_id = dst_conn_id;
+
+		send_DIALCONF();
+
+		conn_state = ConnectionState::DialRcvd;
+
+		break;
+	}
+
+	case ConnectionState::DialRcvd:
+	case ConnectionState::Established: {
+		if(src_conn_id == this->src_conn_id && dst_conn_id == this->dst_conn_id) {
+			// Retransmitted RESUME, DIALCONF was lost
+			send_DIALCONF();
+		}
+
+		break;
+	}
+
+	case ConnectionState::DialSent:
+	case ConnectionState::Closing: {
+		// Ignore
+		break;
+	}
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_PMTUPROBE() {
+	auto size = pmtu_search->next_probe();
+	if(size == 0) {
+		// Search done, look again later
+		pmtu_timer.template start<Self, &Self::pmtu_timer_cb>(PMTU_RAISE_INTERVAL, 0);
+		return;
+	}
+
+	if(size != pmtu_token_size) {
+		// Retries of a size share the token so that late acks still count
+		randombytes_buf(&pmtu_token, sizeof(pmtu_token));
+		pmtu_token_size = size;
+	}
+
+	auto packet = PMTUPROBE(size)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_size(size)
+		.set_token(pmtu_token);
+	// Padding
+	std::memset(packet.base.payload_buffer().data() + 20, 0, size - 20);
+
+	transport->send(std::move(packet));
+
+	pmtu_timer.template start_us<Self, &Self::pmtu_timer_cb>(pmtu_probe_timeout(), 0);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_PMTUPROBE(
+	PMTUPROBE &&packet
+) {
+	if(!packet.validate()) {
+		// Truncated on the way, do not confirm the size
+		return;
+	}
+
+	SPDLOG_TRACE("PMTUPROBE <<< {}: {}", dst_addr.to_string(), packet.size());
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale probe, ignore
+		return;
+	}
+
+	send_PMTUACK(packet.size(), packet.token());
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_PMTUACK(uint16_t size, uint64_t token) {
+	auto packet = PMTUACK(crypto_aead_aes256gcm_ABYTES + 12)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_size(size)
+		.set_token(token)
+		.base.payload_buffer();
+
+	packet.write_unsafe(20 + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	if constexpr (is_encrypted) {
+		// Tag only, covers the ids, size and token
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 20,
+			nullptr,
+			packet.data() + 20,
+			0,
+			packet.data() + 2,
+			18,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_PMTUACK(
+	PMTUACK &&packet
+) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	SPDLOG_TRACE("PMTUACK <<< {}: {}", dst_addr.to_string(), packet.size());
+
+	if(conn_state != ConnectionState::Established || !pmtu_search.has_value()) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale ack, ignore
+		return;
+	}
+
+	if constexpr (is_encrypted) {
+		auto bytes = packet.base.payload_buffer();
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			bytes.data() + 20,
+			nullptr,
+			nullptr,
+			bytes.data() + 20,
+			crypto_aead_aes256gcm_ABYTES,
+			bytes.data() + 2,
+			18,
+			bytes.data() + 20 + crypto_aead_aes256gcm_ABYTES,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: PMTUACK: Decryption failure",
+				src_addr.to_string(),
+				dst_addr.to_string()
+			);
+			return;
+		}
+	}
+
+	// Only the probe in flight with its token proves a size, anyone can claim others
+	if(packet.token() != pmtu_token || !pmtu_search->on_probe_acked(packet.size())) {
+		return;
+	}
+	fragment_size = pmtu_search->current() - MAX_FRAGMENT_OVERHEAD;
+
+	// Probe the next size right away
+	pmtu_timer.stop();
+	send_PMTUPROBE();
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_WINDOW(bool force) {
+	// Streams whose credit moved enough to be worth a packet
+	window_credits.clear();
+	for(auto& [stream_id, stream] : recv_streams) {
+		auto max_offset = stream.read_offset - stream.unconsumed + DEFAULT_STREAM_WINDOW;
+		if(force || max_offset >= stream.max_offset + DEFAULT_STREAM_WINDOW / 2) {
+			stream.max_offset = max_offset;
+			window_credits.emplace_back(stream_id, max_offset);
+		}
+	}
+
+	auto max_data = data_read - data_unconsumed + DEFAULT_CONN_WINDOW;
+	if(!force && window_credits.empty() && max_data < advertised_max_data + DEFAULT_CONN_WINDOW / 2) {
+		return;
+	}
+	advertised_max_data = max_data;
+
+	// Split credits across as many packets as needed, each carries the connection credit
+	size_t from = 0;
+	do {
+		auto num_credits = std::min<size_t>(window_credits.size() - from, MAX_WINDOW_PACKET_CREDITS);
+
+		transport->send(
+			WINDOW(num_credits)
+			.set_src_conn_id(src_conn_id)
+			.set_dst_conn_id(dst_conn_id)
+			.set_size(num_credits)
+			.set_max_data(max_data)
+			.set_credits(window_credits.begin() + from, window_credits.begin() + from + num_credits)
+		);
+
+		from += num_credits;
+	} while(from < window_credits.size());
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_WINDOW(
+	WINDOW &&packet
+) {
+	if(!packet.validate()) {
+		return;
+	}
+
+	SPDLOG_TRACE("WINDOW <<< {}: {}, {}", dst_addr.to_string(), packet.max_data(), packet.size());
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale credit, ignore
+		return;
+	}
+
+	// Credit only ever grows, WINDOW can arrive reordered
+	bool is_raised = false;
+	if(packet.max_data() > max_data) {
+		max_data = packet.max_data();
+		is_raised = true;
+	}
+
+	for(
+		auto iter = packet.credits_begin();
+		iter != packet.credits_end();
+		++iter
+	) {
+		auto [stream_id, max_offset] = *iter;
+
+		// Streams not sending anymore start afresh with the default credit
+		auto stream_iter = send_streams.find(stream_id);
+		if(stream_iter == send_streams.end()) {
+			continue;
+		}
+
+		auto &stream = stream_iter->second;
+		if(max_offset > stream.max_offset) {
+			stream.max_offset = max_offset;
+			is_raised = true;
+		}
+	}
+
+	if(sent_packets.size() == 0 && lost_packets.size() == 0 && !send_scheduler.empty()) {
+		// Waiting on credit, the peer is still around
+		pto_count = 0;
+		set_loss_timer();
+	}
+
+	if(is_raised) {
+		send_pending_data();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_BLOCKED() {
+	transport->send(
+		BLOCKED()
+		.set_src_conn_id(src_conn_id)
+		.set_dst_conn_id(dst_conn_id)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_BLOCKED(
+	BLOCKED &&packet
+) {
+	if(!packet.validate()) {
+		return;
+	}
+
+	SPDLOG_TRACE("BLOCKED <<< {}", dst_addr.to_string());
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale request, ignore
+		return;
+	}
+
+	// Repeat all credit, whatever was lost
+	send_WINDOW(true);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_DATAGRAM(
+	core::Buffer &&bytes
+) {
+	auto length = bytes.size();
+
+	// In flight like REPAIR so that acks and losses reach congestion control, but never resent
+	this->last_sent_packet++;
+
+	auto now = asyncio::EventLoop::now_us();
+	if(this->bytes_in_flight == 0) {
+		this->delivered_time = now;
+	}
+
+	auto &sent_packet = this->sent_packets.emplace(
+		this->last_sent_packet,
+		now,
+		nullptr,
+		nullptr,
+		0,
+		length
+	);
+	sent_packet.delivered = this->delivered;
+	sent_packet.delivered_time = this->delivered_time;
+	congestion_controller.on_packet_sent(now, length, this->bytes_in_flight);
+	this->bytes_in_flight += length;
+
+	auto packet = DATAGRAM(length + crypto_aead_aes256gcm_ABYTES + 12)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.set_packet_number(this->last_sent_packet)
+					.set_payload(bytes.data(), length)
+					.payload_buffer();
+
+	packet.uncover_unsafe(18);
+	packet.write_unsafe(18 + length + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	if constexpr (is_encrypted) {
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 18,
+			nullptr,
+			packet.data() + 18,
+			length,
+			packet.data() + 2,
+			16,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATAGRAM(
+	DATAGRAM &&packet
+) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: DATAGRAM: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
+	}
+
+	if constexpr (is_encrypted) {
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			packet.payload(),
+			nullptr,
+			nullptr,
+			packet.payload(),
+			packet.payload_buffer().size() - 12,
+			packet.payload() - 16,
+			16,
+			packet.payload() + packet.payload_buffer().size() - 12,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: DATAGRAM: Decryption failure: {}, {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				this->src_conn_id,
+				this->dst_conn_id
+			);
+			send_RST(src_conn_id, dst_conn_id);
+			return;
+		}
+	}
+
+	SPDLOG_TRACE("DATAGRAM <<< {}", dst_addr.to_string());
+
+	// Datagrams only ride on established connections, the dialer waits for the handshake to finish
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	// Replayed or too old to tell
+	auto packet_number = packet.packet_number();
+	if(ack_ranges.contains(packet_number)) {
+		return;
+	}
+	schedule_ack(packet_number);
+
+	auto p = std::move(packet).payload_buffer();
+	p.truncate_unsafe(crypto_aead_aes256gcm_ABYTES + 12);
+
+	// Datagrams are optional, delegates without them drop these
+	constexpr bool has_did_recv_datagram = requires(
+		DelegateType& d,
+		Self& t,
+		core::Buffer&& b
+	) {
+		d.did_recv_datagram(t, std::move(b));
+	};
+	if constexpr (has_did_recv_datagram) {
+		delegate->did_recv_datagram(*this, std::move(p));
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_PING() {
+	// In flight so that the probe timeout covers it, carries nothing to resend or count
+	this->last_sent_packet++;
+
+	auto now = asyncio::EventLoop::now_us();
+	if(this->bytes_in_flight == 0) {
+		this->delivered_time = now;
+	}
+
+	auto &sent_packet = this->sent_packets.emplace(
+		this->last_sent_packet,
+		now,
+		nullptr,
+		nullptr,
+		0,
+		0
+	);
+	sent_packet.delivered = this->delivered;
+	sent_packet.delivered_time = this->delivered_time;
+
+	auto packet = PING(crypto_aead_aes256gcm_ABYTES + 12)
+		.set_src_conn_id(src_conn_id)
+		.set_dst_conn_id(dst_conn_id)
+		.set_packet_number(this->last_sent_packet)
+		.base.payload_buffer();
+
+	packet.write_unsafe(18 + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	if constexpr (is_encrypted) {
+		// Tag only, covers the ids and packet number
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 18,
+			nullptr,
+			packet.data() + 18,
+			0,
+			packet.data() + 2,
+			16,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_PING(
+	PING &&packet
+) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	SPDLOG_TRACE("PING <<< {}", dst_addr.to_string());
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale ping, ignore
+		return;
+	}
+
+	if constexpr (is_encrypted) {
+		auto bytes = packet.base.payload_buffer();
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			bytes.data() + 18,
+			nullptr,
+			nullptr,
+			bytes.data() + 18,
+			crypto_aead_aes256gcm_ABYTES,
+			bytes.data() + 2,
+			16,
+			bytes.data() + 18 + crypto_aead_aes256gcm_ABYTES,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: PING: Decryption failure",
+				src_addr.to_string(),
+				dst_addr.to_string()
+			);
+			return;
+		}
+	}
+
+	schedule_ack(packet.packet_number());
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_PATHCHALLENGE(BaseTransport &transport) {
+	auto packet = PATHCHALLENGE(crypto_aead_aes256gcm_ABYTES + 12)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_token(path_challenge_token)
+		.base.payload_buffer();
+
+	packet.write_unsafe(18 + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	if constexpr (is_encrypted) {
+		// Tag only, covers the ids and token
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 18,
+			nullptr,
+			packet.data() + 18,
+			0,
+			packet.data() + 2,
+			16,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
+
+	path_challenge_time = asyncio::EventLoop::now_us();
+	path_candidate_bytes_sent += packet.size();
+
+	// Candidate path, not the one of the connection
+	transport.send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_PATHCHALLENGE(
+	PATHCHALLENGE &&packet
+) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	SPDLOG_TRACE("PATHCHALLENGE <<< {}", dst_addr.to_string());
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale challenge, ignore
+		return;
+	}
+
+	if constexpr (is_encrypted) {
+		auto bytes = packet.base.payload_buffer();
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			bytes.data() + 18,
+			nullptr,
+			nullptr,
+			bytes.data() + 18,
+			crypto_aead_aes256gcm_ABYTES,
+			bytes.data() + 2,
+			16,
+			bytes.data() + 18 + crypto_aead_aes256gcm_ABYTES,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: PATHCHALLENGE: Decryption failure",
+				src_addr.to_string(),
+				dst_addr.to_string()
+			);
+			return;
+		}
+	}
+
+	send_PATHRESPONSE(packet.token());
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::send_PATHRESPONSE(uint64_t token) {
+	auto packet = PATHRESPONSE(crypto_aead_aes256gcm_ABYTES + 12)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_token(token)
+		.base.payload_buffer();
+
+	packet.write_unsafe(18 + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	if constexpr (is_encrypted) {
+		// Tag only, covers the ids and token
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 18,
+			nullptr,
+			packet.data() + 18,
+			0,
+			packet.data() + 2,
+			16,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+bool StreamTransport<DelegateType, DatagramTransport>::did_recv_PATHRESPONSE(
+	PATHRESPONSE &&packet,
+	core::SocketAddress const &addr
+) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
+		return false;
+	}
+
+	SPDLOG_TRACE("PATHRESPONSE <<< {}", addr.to_string());
+
+	if(conn_state != ConnectionState::Established || !has_path_candidate || addr != path_candidate_addr) {
+		return false;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		// Stale response, ignore
+		return false;
+	}
+
+	if constexpr (is_encrypted) {
+		auto bytes = packet.base.payload_buffer();
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			bytes.data() + 18,
+			nullptr,
+			nullptr,
+			bytes.data() + 18,
+			crypto_aead_aes256gcm_ABYTES,
+			bytes.data() + 2,
+			16,
+			bytes.data() + 18 + crypto_aead_aes256gcm_ABYTES,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: PATHRESPONSE: Decryption failure",
+				src_addr.to_string(),
+				dst_addr.to_string()
+			);
+			return false;
+		}
+	}
+
+	// Only the latest challenge proves the peer is reachable there
+	return path_challenge_time != 0 && packet.token() == path_challenge_token;
+}
+
+//---------------- Protocol functions end ----------------//
+
+
+//---------------- Delegate functions begin ----------------//
+
+//! Callback function when trying to establish a connection with a peer. Sends a DIAL packet to initiate the handshake
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_dial(
+	BaseTransport &,
+	uint8_t const* remote_static_pk
+) {
+	if(conn_state != ConnectionState::Listen) {
+		return;
+	}
+
+	if (remote_static_pk != nullptr) {
+		std::memcpy(this->remote_static_pk, remote_static_pk, crypto_box_PUBLICKEYBYTES);
+	}
+
+	// Begin handshake
+	dialled = true;
+
+	state_timer_interval = 1000;
+	state_timer.template start<Self, &Self::dial_timer_cb>(state_timer_interval, 0);
+
+	new_src_conn_id();
+
+	if(session_cache != nullptr) {
+		resume_ticket = session_cache->take(this->remote_static_pk, ticket_time());
+	}
+	if(!resume_ticket.has_value()) {
+		send_DIAL();
+		conn_state = ConnectionState::DialSent;
+		return;
+	}
+
+	// Resume, we pick both connection ids so that data can follow right away
+	do {
+		dst_conn_id = (uint32_t)std::random_device()();
+	} while(dst_conn_id == 0);
+
+	SessionCache::derive_keys(resume_ticket->secret, ephemeral_pk, true, rx, tx);
+	randombytes_buf(nonce, crypto_aead_aes256gcm_NPUBBYTES);
+	crypto_aead_aes256gcm_beforenm(&rx_ctx, rx);
+	crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
+
+	send_RESUME();
+	conn_state = ConnectionState::Established;
+	is_resumed = true;
+
+	delegate->did_dial(*this);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_close(
+	BaseTransport &,
+	uint16_t reason
+) {
+	release_src_conn_id();
+	delegate->did_close(*this, reason);
+	transport_manager.erase(dst_addr);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::new_src_conn_id() {
+	release_src_conn_id();
+
+	src_conn_id = conn_id_table == nullptr ? 0 : conn_id_table->allocate(this);
+	if(src_conn_id == 0) {
+		// No table or table full, connection can not migrate
+		src_conn_id = (uint32_t)std::random_device()();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::adopt_src_conn_id(uint32_t conn_id) {
+	release_src_conn_id();
+
+	src_conn_id = conn_id;
+	if(conn_id_table != nullptr) {
+		// Fails if another connection holds the id, this one can not migrate then
+		conn_id_table->insert(conn_id, this);
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::release_src_conn_id() {
+	if(conn_id_table != nullptr) {
+		conn_id_table->release(src_conn_id, this);
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+bool StreamTransport<DelegateType, DatagramTransport>::is_valid_migration(BaseMessageType &packet) {
+	if(conn_state != ConnectionState::Established) {
+		return false;
+	}
+
+	// Laid out as DATA, see did_recv_DATA
+	auto const &bytes = packet.payload_buffer();
+	if(bytes.size() < 30 + 12 + crypto_aead_aes256gcm_ABYTES) {
+		return false;
+	}
+
+	if(bytes.read_uint32_le_unsafe(6) != src_conn_id || bytes.read_uint32_le_unsafe(2) != dst_conn_id) {
+		return false;
+	}
+
+	// Replayed packets must not move the connection
+	if(!ack_ranges.empty() && bytes.read_uint64_le_unsafe(10) <= ack_ranges.largest()) {
+		return false;
+	}
+
+	if constexpr (is_encrypted) {
+		// Decrypt a copy, the packet itself is processed by did_recv_DATA afterwards
+		core::Buffer copy(bytes.size());
+		std::memcpy(copy.data(), bytes.data(), bytes.size());
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			copy.data() + 18,
+			nullptr,
+			nullptr,
+			copy.data() + 18,
+			copy.size() - 30,
+			copy.data() + 2,
+			16,
+			copy.data() + copy.size() - 12,
+			&rx_ctx
+		);
+		if(res < 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_path_candidate(
+	BaseTransport &transport,
+	core::SocketAddress const &addr,
+	size_t size
+) {
+	if(!has_path_candidate || addr != path_candidate_addr) {
+		// New candidate, earlier challenges are void
+		has_path_candidate = true;
+		path_candidate_addr = addr;
+		randombytes_buf(&path_challenge_token, sizeof(path_challenge_token));
+		path_challenge_time = 0;
+		path_candidate_bytes_recv = 0;
+		path_candidate_bytes_sent = 0;
+	}
+	path_candidate_bytes_recv += size;
+
+	// Challenge again only once the last one should have been answered
+	auto timeout = rtt.has_sample() ? rtt.pto(MAX_ACK_DELAY) : DEFAULT_PTO_INTERVAL;
+	if(path_challenge_time != 0 && asyncio::EventLoop::now_us() < path_challenge_time + timeout) {
+		return;
+	}
+
+	// Address is not known to be the peer's, do not let it be flooded on behalf of a spoofer
+	if(
+		path_candidate_bytes_sent + 18 + crypto_aead_aes256gcm_ABYTES + 12 >
+		MIGRATION_AMPLIFICATION_FACTOR * path_candidate_bytes_recv
+	) {
+		return;
+	}
+
+	send_PATHCHALLENGE(transport);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+bool StreamTransport<DelegateType, DatagramTransport>::did_recv_migration(BaseMessageType &packet) {
+	if constexpr (!is_encrypted) {
+		// Anyone could claim to be the peer and move the connection to any address
+		return false;
+	}
+
+	auto conn_id = packet.payload_buffer().read_uint32_le(6);
+	if(conn_id == std::nullopt) {
+		return false;
+	}
+
+	auto *conn = conn_id_table->find(conn_id.value());
+	if(conn == nullptr || conn == this) {
+		return false;
+	}
+
+	if(packet.payload_buffer().read_uint8_unsafe(1) != 24) {
+		if(!conn->is_valid_migration(packet)) {
+			return false;
+		}
+
+		// Connection stays on the old path until the new one answers a challenge,
+		// the data is authentic and is processed right away
+		conn->did_recv_path_candidate(*transport, dst_addr, packet.payload_buffer().size());
+		conn->did_recv(*conn->transport, std::move(packet));
+
+		return true;
+	}
+
+	if(!conn->did_recv_PATHRESPONSE(std::move(packet), dst_addr)) {
+		return true;
+	}
+
+	SPDLOG_INFO(
+		"Stream transport {{ Src: {}, Dst: {} }}: Migrated from {}",
+		src_addr.to_string(),
+		dst_addr.to_string(),
+		conn->dst_addr.to_string()
+	);
+
+	// Connection takes over the new path, self takes the old one
+	std::swap(transport, conn->transport);
+	std::swap(dst_addr, conn->dst_addr);
+	transport->setup(this);
+	conn->transport->setup(conn);
+	transport_manager.swap(dst_addr, conn->dst_addr);
+
+	conn->has_path_candidate = false;
+	conn->path_challenge_time = 0;
+
+	// Old path closes along with self
+	transport->close();
+
+	return true;
+}
+
+//! Receives the packet and processes them
+/*!
+	Determines the type of packet by reading the first byte and redirects the packet to appropriate function for further processing
+
+	\li \b byte :	\b type
+	\li 0		:	DATA
+	\li 1		:	DATA + FIN
+	\li 2		:	ACK
+	\li 3		:	DIAL
+	\li 4		:	DIALCONF
+	\li 5		:	CONF
+	\li 6		:	RST
+	\li 13		:	REPAIR
+	\li 14		:	TICKET
+	\li 15		:	RESUME
+	\li 16		:	PMTUPROBE
+	\li 17		:	PMTUACK
+	\li 18		:	WINDOW
+	\li 19		:	BLOCKED
+	\li 20		:	DATAGRAM
+	\li 21		:	ACKCONF
+	\li 22		:	PING
+	\li 23		:	PATHCHALLENGE
+	\li 24		:	PATHRESPONSE
+*/
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv(
+	BaseTransport &,
+	BaseMessageType &&packet
+) {
+	auto type = packet.payload_buffer().read_uint8(1);
+	if(type == std::nullopt || packet.payload_buffer().read_uint8_unsafe(0) != 0) {
+		return;
+	}
+
+	// DATA of an established connection on a fresh transport, the peer moved to a new address
+	// Peers only sending acks move once they send data, and answer the challenge sent there
+	if(
+		(type.value() == 0 || type.value() == 1 || type.value() == 24) &&
+		conn_state == ConnectionState::Listen &&
+		conn_id_table != nullptr &&
+		did_recv_migration(packet)
+	) {
+		// Taken by the connection, self is gone if that moved to this path
+		return;
+	}
+
+	switch(type.value()) {
+		// DATA
+		case 0:
+		// DATA + FIN
+		case 1: did_recv_DATA(std::move(packet));
+		break;
+		// ACK
+		case 2: did_recv_ACK(std::move(packet));
+		break;
+		// DIAL
+		case 3: did_recv_DIAL(std::move(packet));
+		break;
+		// DIALCONF
+		case 4: did_recv_DIALCONF(std::move(packet));
+		break;
+		// CONF
+		case 5: did_recv_CONF(std::move(packet));
 		break;
 		// RST
 		case 6: did_recv_RST(std::move(packet));
@@ -1981,12 +4330,67 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv(
 		// FLUSHCONF
 		case 9: did_recv_FLUSHCONF(std::move(packet));
 		break;
+		// REPAIR
+		case 13: did_recv_REPAIR(std::move(packet));
+		break;
+		// TICKET
+		case 14: did_recv_TICKET(std::move(packet));
+		break;
+		// RESUME
+		case 15: did_recv_RESUME(std::move(packet));
+		break;
+		// PMTUPROBE
+		case 16: did_recv_PMTUPROBE(std::move(packet));
+		break;
+		// PMTUACK
+		case 17: did_recv_PMTUACK(std::move(packet));
+		break;
+		// WINDOW
+		case 18: did_recv_WINDOW(std::move(packet));
+		break;
+		// BLOCKED
+		case 19: did_recv_BLOCKED(std::move(packet));
+		break;
+		// DATAGRAM
+		case 20: did_recv_DATAGRAM(std::move(packet));
+		break;
+		// ACKCONF
+		case 21: did_recv_ACKCONF(std::move(packet));
+		break;
+		// PING
+		case 22: did_recv_PING(std::move(packet));
+		break;
+		// PATHCHALLENGE
+		case 23: did_recv_PATHCHALLENGE(std::move(packet));
+		break;
+		// PATHRESPONSE, only counts from the candidate path, see did_recv_migration
+		case 24: SPDLOG_TRACE("PATHRESPONSE <<< {}", dst_addr.to_string());
+		break;
 		// UNKNOWN
 		default: SPDLOG_TRACE("UNKNOWN <<< {}", dst_addr.to_string());
 		break;
 	}
 }
 
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::did_recv_batch(
+	BaseTransport &transport,
+	std::span<core::Buffer> packets
+) {
+	bool alive = true;
+	is_alive = &alive;
+
+	for(auto &packet : packets) {
+		did_recv(transport, std::move(packet));
+		if(!alive) {
+			// Closed or migrated, the rest of the batch is dropped and retransmitted by the peer
+			return;
+		}
+	}
+
+	is_alive = nullptr;
+}
+
 template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::did_send(
 	BaseTransport &,
@@ -2028,6 +4432,33 @@ void StreamTransport<DelegateType, DatagramTransport>::did_send(
 		// FLUSHCONF
 		case 9: SPDLOG_TRACE("FLUSHCONF >>> {}", dst_addr.to_string());
 		break;
+		// REPAIR
+		case 13: SPDLOG_TRACE("REPAIR >>> {}", dst_addr.to_string());
+		break;
+		// TICKET
+		case 14: SPDLOG_TRACE("TICKET >>> {}", dst_addr.to_string());
+		break;
+		// RESUME
+		case 15: SPDLOG_TRACE("RESUME >>> {}", dst_addr.to_string());
+		break;
+		// PMTUPROBE
+		case 16: SPDLOG_TRACE("PMTUPROBE >>> {}", dst_addr.to_string());
+		break;
+		// PMTUACK
+		case 17: SPDLOG_TRACE("PMTUACK >>> {}", dst_addr.to_string());
+		break;
+		// WINDOW
+		case 18: SPDLOG_TRACE("WINDOW >>> {}", dst_addr.to_string());
+		break;
+		// BLOCKED
+		case 19: SPDLOG_TRACE("BLOCKED >>> {}", dst_addr.to_string());
+		break;
+		// DATAGRAM
+		case 20: SPDLOG_TRACE("DATAGRAM >>> {}", dst_addr.to_string());
+		break;
+		// ACKCONF
+		case 21: SPDLOG_TRACE("ACKCONF >>> {}", dst_addr.to_string());
+		break;
 		// UNKNOWN
 		default: SPDLOG_TRACE("UNKNOWN >>> {}", dst_addr.to_string());
 		break;
@@ -2042,12 +4473,14 @@ StreamTransport<DelegateType, DatagramTransport>::StreamTransport(
 	core::SocketAddress const &dst_addr,
 	BaseTransport &transport,
 	core::TransportManager<StreamTransport<DelegateType, DatagramTransport>> &transport_manager
-) : transport(transport),
+) : transport(&transport),
 	transport_manager(transport_manager),
 	state_timer(this),
 	pacing_timer(this),
-	tlp_timer(this),
+	loss_timer(this),
 	ack_timer(this),
+	pmtu_timer(this),
+	deadline_timer(this),
 	src_addr(src_addr),
 	dst_addr(dst_addr),
 	delegate(nullptr) {
@@ -2056,6 +4489,13 @@ StreamTransport<DelegateType, DatagramTransport>::StreamTransport(
 	}
 }
 
+template<typename DelegateType, template<typename> class DatagramTransport>
+StreamTransport<DelegateType, DatagramTransport>::~StreamTransport() {
+	if(is_alive != nullptr) {
+		*is_alive = false;
+	}
+}
+
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 void StreamTransport<DelegateType, DatagramTransport>::setup(
@@ -2069,7 +4509,7 @@ void StreamTransport<DelegateType, DatagramTransport>::setup(
 
 	crypto_kx_keypair(this->ephemeral_pk, this->ephemeral_sk);
 
-	transport.setup(this);
+	transport->setup(this);
 }
 
 
@@ -2077,6 +4517,112 @@ template<typename DelegateType, template<typename> class DatagramTransport>
 int StreamTransport<DelegateType, DatagramTransport>::send(
 	core::Buffer &&bytes,
 	uint16_t stream_id
+) {
+	return send_impl(std::move(bytes), stream_id, 0);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+int StreamTransport<DelegateType, DatagramTransport>::send(
+	core::SharedBuffer &&bytes,
+	uint16_t stream_id
+) {
+	return send_impl(std::move(bytes), stream_id, 0);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+int StreamTransport<DelegateType, DatagramTransport>::send(
+	core::Buffer &&bytes,
+	uint16_t stream_id,
+	uint8_t priority,
+	uint64_t deadline
+) {
+	set_stream_priority(stream_id, priority);
+	return send_impl(std::move(bytes), stream_id, deadline);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+int StreamTransport<DelegateType, DatagramTransport>::send(
+	core::SharedBuffer &&bytes,
+	uint16_t stream_id,
+	uint8_t priority,
+	uint64_t deadline
+) {
+	set_stream_priority(stream_id, priority);
+	return send_impl(std::move(bytes), stream_id, deadline);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::set_stream_priority(
+	uint16_t stream_id,
+	uint8_t priority
+) {
+	send_scheduler.set_priority(get_or_create_send_stream(stream_id), priority);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::set_stream_weight(
+	uint16_t stream_id,
+	uint16_t weight
+) {
+	get_or_create_send_stream(stream_id).weight = std::max<uint16_t>(weight, 1);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+int StreamTransport<DelegateType, DatagramTransport>::send_datagram(
+	core::Buffer &&bytes
+) {
+	if(conn_state != ConnectionState::Established) {
+		return -2;
+	}
+
+	// Never fragmented, same bound as the payload of a DATA packet
+	if(bytes.size() > fragment_size) {
+		return -1;
+	}
+
+	// Handle idle connection
+	bool idle = sent_packets.size() == 0 && lost_packets.size() == 0 && send_scheduler.empty() && datagram_queue.empty();
+
+	// Stale datagrams are worth less than fresh ones, drop the oldest when backed up
+	if(datagram_queue.size() >= MAX_DATAGRAM_QUEUE) {
+		SPDLOG_DEBUG("Datagram queue overflow");
+		datagram_queue.pop_front();
+	}
+	datagram_queue.push_back(std::move(bytes));
+
+	if(idle) {
+		set_loss_timer();
+	}
+
+	send_pending_data();
+
+	return 0;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+int StreamTransport<DelegateType, DatagramTransport>::send_ping() {
+	if(conn_state != ConnectionState::Established) {
+		return -2;
+	}
+
+	// Handle idle connection
+	bool idle = sent_packets.size() == 0 && lost_packets.size() == 0 && send_scheduler.empty();
+
+	send_PING();
+
+	if(idle) {
+		set_loss_timer();
+	}
+
+	return 0;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+template<typename BufferType>
+int StreamTransport<DelegateType, DatagramTransport>::send_impl(
+	BufferType &&bytes,
+	uint16_t stream_id,
+	uint64_t deadline
 ) {
 	if (conn_state != ConnectionState::Established) {
 		return -2;
@@ -2087,13 +4633,15 @@ int StreamTransport<DelegateType, DatagramTransport>::send(
 		stream.state = SendStream::State::Send;
 	}
 
-	// Abort if data queue is too big
-	if(stream.queue_offset - stream.acked_offset > 20000000) {
+	// Back-pressure once the send buffer is full, did_drain tells the delegate when to resume
+	if(send_buffer_bytes >= DEFAULT_SEND_BUFFER_LIMIT) {
 		SPDLOG_DEBUG("Data queue overflow");
+		is_send_buffer_full = true;
 		return -1;
 	}
 
 	auto size = bytes.size();
+	send_buffer_bytes += size;
 
 	// Check idle stream
 	bool idle = stream.next_item_iterator == stream.data_queue.end();
@@ -2106,14 +4654,28 @@ int StreamTransport<DelegateType, DatagramTransport>::send(
 
 	stream.queue_offset += size;
 
+	if(deadline != 0) {
+		auto iter = send_deadlines.emplace(deadline, std::make_pair(stream_id, stream.queue_offset));
+		if(iter == send_deadlines.begin()) {
+			// Earliest deadline, move the timer up
+			auto now = asyncio::EventLoop::now();
+			deadline_timer.template start<Self, &Self::deadline_timer_cb>(deadline > now ? deadline - now : 0, 0);
+		}
+	}
+
 	// Handle idle stream
 	if(idle) {
 		stream.next_item_iterator = std::prev(stream.data_queue.end());
 	}
 
 	// Handle idle connection
-	if(sent_packets.size() == 0 && lost_packets.size() == 0 && send_queue.size() == 0) {
-		tlp_timer.template start<Self, &Self::tlp_timer_cb>(tlp_interval, 0);
+	if(sent_packets.size() == 0 && lost_packets.size() == 0 && send_scheduler.empty()) {
+		set_loss_timer();
+	}
+
+	// Larger packets only help the sending side, search once there is data
+	if(!pmtu_search.has_value()) {
+		start_pmtu_search();
 	}
 
 	register_send_intent(stream);
@@ -2149,7 +4711,7 @@ void StreamTransport<DelegateType, DatagramTransport>::close_timer_cb() {
 			this->dst_addr.to_string()
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
@@ -2170,7 +4732,85 @@ bool StreamTransport<DelegateType, DatagramTransport>::is_active() {
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 double StreamTransport<DelegateType, DatagramTransport>::get_rtt() {
-	return rtt;
+	return !rtt.has_sample() ? -1 : rtt.smoothed() / 1000;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+uint16_t StreamTransport<DelegateType, DatagramTransport>::get_fragment_size() {
+	return fragment_size;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::set_congestion_controller(
+	CongestionController const& controller
+) {
+	congestion_controller = controller;
+	congestion_controller.reset();
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::set_fec_enabled(bool enabled) {
+	// A partial group is dropped, its packets are resent on loss like any other
+	is_fec_enabled = enabled;
+	fec_encoder.clear();
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::set_session_cache(SessionCache *session_cache) {
+	this->session_cache = session_cache;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::set_conn_id_table(ConnIdTable<Self> *conn_id_table) {
+	this->conn_id_table = conn_id_table;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+uint64_t StreamTransport<DelegateType, DatagramTransport>::ticket_time() {
+	return std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()
+	).count();
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport>
+void StreamTransport<DelegateType, DatagramTransport>::fall_back_to_dial() {
+	SPDLOG_DEBUG(
+		"Stream transport {{ Src: {}, Dst: {} }}: Resumption refused, dialling",
+		src_addr.to_string(),
+		dst_addr.to_string()
+	);
+
+	resume_ticket.reset();
+
+	// Server never saw the early data, send it again once established
+	for(
+		auto packet_number = sent_packets.begin_number();
+		packet_number < sent_packets.end_number();
+		packet_number++
+	) {
+		auto *sent_packet = sent_packets.find(packet_number);
+		if(sent_packet == nullptr) {
+			continue;
+		}
+
+		mark_lost(packet_number, *sent_packet);
+	}
+	sent_packets.clear();
+
+	pacing_timer.stop();
+	is_pacing_timer_active = false;
+	loss_timer.stop();
+	ack_timer.stop();
+	ack_timer_active = false;
+	ack_ranges = AckRanges();
+
+	conn_state = ConnectionState::DialSent;
+	new_src_conn_id();
+	dst_conn_id = 0;
+
+	state_timer_interval = 1000;
+	state_timer.template start<Self, &Self::dial_timer_cb>(state_timer_interval, 0);
+	send_DIAL();
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
@@ -2184,14 +4824,14 @@ void StreamTransport<DelegateType, DatagramTransport>::skip_timer_cb(RecvStream&
 			stream.stream_id
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
 	uint64_t offset;
 
 	if(stream.recv_packets.size() > 0) {
-		auto &packet = stream.recv_packets.rbegin()->second;
+		auto &packet = stream.recv_packets.back();
 		offset = packet.offset + packet.length;
 	} else {
 		offset = stream.read_offset;
@@ -2213,7 +4853,7 @@ void StreamTransport<DelegateType, DatagramTransport>::skip_stream(
 	uint64_t offset;
 
 	if(stream.recv_packets.size() > 0) {
-		auto &packet = stream.recv_packets.rbegin()->second;
+		auto &packet = stream.recv_packets.back();
 		offset = packet.offset + packet.length;
 	} else {
 		offset = stream.read_offset;
@@ -2236,11 +4876,11 @@ void StreamTransport<DelegateType, DatagramTransport>::flush_timer_cb(SendStream
 			stream.stream_id
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
-	this->send_FLUSHSTREAM(stream.stream_id, stream.sent_offset);
+	this->send_FLUSHSTREAM(stream.stream_id, stream.flush_offset);
 
 	stream.state_timer_interval *= 2;
 	stream.state_timer.template start<Self, SendStream, &Self::flush_timer_cb>(stream.state_timer_interval, 0);
@@ -2252,30 +4892,13 @@ void StreamTransport<DelegateType, DatagramTransport>::flush_stream(
 ) {
 	auto &stream = get_or_create_send_stream(stream_id);
 
-	// Remove previously sent packets
-	auto sent_iter = sent_packets.cbegin();
-	while(sent_iter != sent_packets.cend()) {
-		if(sent_iter->second.stream->stream_id != stream.stream_id) {
-			sent_iter++;
-			continue;
-		}
-
-		bytes_in_flight -= sent_iter->second.length;
-		sent_iter = sent_packets.erase(sent_iter);
-	}
-
-	// Remove lost packets
-	auto lost_iter = lost_packets.cbegin();
-	while(lost_iter != lost_packets.cend()) {
-		if(lost_iter->second.stream->stream_id != stream.stream_id) {
-			lost_iter++;
-			continue;
-		}
+	// Remove previously sent and lost packets
+	purge_packets(stream, -1);
 
-		bytes_in_flight -= lost_iter->second.length;
-		lost_iter = lost_packets.erase(lost_iter);
+	uint64_t released_bytes = 0;
+	for(auto &data_item : stream.data_queue) {
+		released_bytes += data_item.data.size();
 	}
-
 	stream.data_queue.clear();
 	stream.queue_offset = stream.sent_offset;
 	stream.next_item_iterator = stream.data_queue.end();
@@ -2283,15 +4906,18 @@ void StreamTransport<DelegateType, DatagramTransport>::flush_stream(
 	stream.acked_offset = stream.sent_offset;
 	stream.outstanding_acks.clear();
 
+	stream.flush_offset = stream.sent_offset;
 	send_FLUSHSTREAM(stream_id, stream.sent_offset);
 
 	stream.state_timer_interval = 1000;
 	stream.state_timer.template start<Self, SendStream, &Self::flush_timer_cb>(stream.state_timer_interval, 0);
+
+	release_send_buffer(released_bytes);
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
 bool StreamTransport<DelegateType, DatagramTransport>::is_internal() {
-	return transport.is_internal();
+	return transport->is_internal();
 }
 
 template<typename DelegateType, template<typename> class DatagramTransport>
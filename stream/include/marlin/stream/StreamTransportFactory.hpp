@@ -4,6 +4,8 @@
 #include <marlin/core/transports/TransportFactoryScaffold.hpp>
 #include "StreamTransport.hpp"
 
+#include <type_traits>
+
 namespace marlin {
 namespace stream {
 
@@ -11,6 +13,12 @@ namespace stream {
 ///
 /// Wraps around a base transport factory providing datagram semantics.
 /// Exposes functions to bind to a socket, listening to incoming connections and dialing to a peer.
+/// Transports created by the factory share its congestion control policy, CUBIC by default,
+/// and whether they send forward error correction parity, off by default.
+/// They also share session tickets, so that dialing a server seen before skips the key exchange.
+/// Resumed connections are not forward secret, see SessionCache.
+/// Connection ids come from a table shared by the transports, so that a connection whose peer
+/// changes address, say on NAT rebinding, carries on over the new address without a new handshake.
 template<
 	typename ListenDelegate,
 	typename TransportDelegate,
@@ -37,17 +45,64 @@ public:
 private:
 	using TransportFactoryScaffoldType::base_factory;
 	using TransportFactoryScaffoldType::transport_manager;
+	using TransportFactoryScaffoldType::delegate;
+
+	using BaseTransportType = DatagramTransport<StreamTransport<TransportDelegate, DatagramTransport>>;
+
+	/// Policy copied into every new transport
+	CongestionController congestion_controller;
+	/// Do new transports send parity of their DATA packets?
+	bool is_fec_enabled = false;
+	/// Tickets issued to clients and received from servers
+	SessionCache session_cache;
+	/// Connection ids of the transports
+	ConnIdTable<StreamTransport<TransportDelegate, DatagramTransport>> conn_id_table;
 
 public:
 	using TransportFactoryScaffoldType::addr;
 
 	using TransportFactoryScaffoldType::TransportFactoryScaffoldType;
 
+	/// Constructor with a congestion control policy, remaining arguments go to the base factory
+	template<typename ControllerType, typename... Args>
+	requires std::is_constructible_v<CongestionController, ControllerType>
+	StreamTransportFactory(ControllerType&& controller, Args&&... args) :
+		TransportFactoryScaffoldType(std::forward<Args>(args)...),
+		congestion_controller(std::forward<ControllerType>(controller)) {}
+
+	// Base factory delegate
+	void did_create_transport(BaseTransportType& base_transport) {
+		auto [transport, is_new] = transport_manager.get_or_create(
+			base_transport.dst_addr,
+			base_transport.src_addr,
+			base_transport.dst_addr,
+			base_transport,
+			transport_manager
+		);
+		if(is_new) {
+			transport->set_congestion_controller(congestion_controller);
+			transport->set_fec_enabled(is_fec_enabled);
+			transport->set_session_cache(&session_cache);
+			transport->set_conn_id_table(&conn_id_table);
+		}
+		delegate->did_create_transport(*transport);
+	}
+
 	using TransportFactoryScaffoldType::bind;
 	using TransportFactoryScaffoldType::listen;
 	using TransportFactoryScaffoldType::dial;
 
 	using TransportFactoryScaffoldType::get_transport;
+
+	/// Send parity of DATA packets on transports created from now on, off by default
+	void set_fec_enabled(bool enabled) {
+		is_fec_enabled = enabled;
+	}
+
+	/// Session tickets of the factory, the ticket key never leaves it so tickets die with the process
+	SessionCache& get_session_cache() {
+		return session_cache;
+	}
 };
 
 } // namespace stream
@@ -0,0 +1,286 @@
+#ifndef MARLIN_STREAM_CONGESTION_BBRCONGESTIONCONTROLLER_HPP
+#define MARLIN_STREAM_CONGESTION_BBRCONGESTIONCONTROLLER_HPP
+
+#include <algorithm>
+#include <iterator>
+
+#include "CongestionEvents.hpp"
+
+namespace marlin {
+namespace stream {
+
+/// @brief Model based congestion control after BBRv2
+/// @details Paces at the bottleneck bandwidth estimate, the windowed max delivery rate,
+/// and caps the window at a multiple of the bandwidth delay product using the windowed min RTT.
+/// Loss only bounds the window (inflight_hi) when a round loses more than 2% of its bytes,
+/// so random loss on long paths does not collapse the sending rate.
+class BbrCongestionController {
+public:
+	enum class State {
+		Startup,
+		Drain,
+		ProbeBw,
+		ProbeRtt
+	};
+
+	/// Rounds the max bandwidth filter spans
+	static constexpr size_t bw_window_rounds = 10;
+	/// Time in microseconds the min RTT filter spans
+	static constexpr uint64_t min_rtt_window = 10000000;
+	/// Time in microseconds spent with a minimal window to refresh the min RTT
+	static constexpr uint64_t probe_rtt_duration = 200000;
+	/// Smallest window in bytes
+	static constexpr uint64_t min_window = 4 * 1500;
+	/// Window used until a bandwidth estimate is available
+	static constexpr uint64_t initial_window = 100000;
+	/// Fraction of bytes lost in a round beyond which the window is bounded
+	static constexpr double loss_threshold = 0.02;
+	/// Multiplicative decrease of inflight_hi on excessive loss
+	static constexpr double beta = 0.7;
+	static constexpr double startup_gain = 2.885;
+	static constexpr double cwnd_gain = 2;
+	/// Pacing gains of the ProbeBw phases, each lasting one min RTT
+	static constexpr double probe_bw_gains[] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+private:
+	State state = State::Startup;
+
+	/// Max delivery rate of each of the last few rounds in bytes per microsecond
+	double round_bw[bw_window_rounds] = {};
+	/// Bottleneck bandwidth estimate in bytes per microsecond
+	double max_bw = 0;
+
+	/// Smallest RTT sample in the filter window in microseconds
+	uint64_t min_rtt = -1;
+	/// Time the min RTT was last refreshed
+	uint64_t min_rtt_stamp = 0;
+
+	/// Round trips so far, a round ends once a packet sent after it started is acked
+	uint64_t round_count = 0;
+	/// Delivered bytes at which the current round ends
+	uint64_t next_round_delivered = 0;
+	/// Bytes delivered and lost in the current round
+	uint64_t round_delivered = 0;
+	uint64_t round_lost = 0;
+	/// Has the window been bounded for loss in the current round?
+	bool is_round_loss_handled = false;
+
+	/// Bandwidth plateau detection during startup
+	double full_bw = 0;
+	uint64_t full_bw_rounds = 0;
+	bool is_pipe_full = false;
+
+	/// Upper bound on bytes in flight from loss, unbounded until excessive loss is seen
+	uint64_t inflight_hi = -1;
+
+	size_t cycle_idx = 0;
+	uint64_t cycle_stamp = 0;
+
+	uint64_t probe_rtt_done_stamp = 0;
+	bool is_probe_rtt_round_done = false;
+
+	uint64_t congestion_window = initial_window;
+	double pacing_gain = startup_gain;
+
+	uint64_t bdp(double gain) const {
+		if(max_bw == 0 || min_rtt == (uint64_t)-1) {
+			return initial_window;
+		}
+
+		return gain * max_bw * min_rtt;
+	}
+
+	void update_round(AckEvent const& event) {
+		if(event.packet_delivered < next_round_delivered) {
+			return;
+		}
+
+		next_round_delivered = event.delivered;
+		round_count++;
+		round_delivered = 0;
+		round_lost = 0;
+		is_round_loss_handled = false;
+		is_probe_rtt_round_done = state == State::ProbeRtt;
+
+		round_bw[round_count % bw_window_rounds] = 0;
+		max_bw = *std::max_element(std::begin(round_bw), std::end(round_bw));
+
+		if(state == State::Startup && !is_pipe_full) {
+			// Full pipe once bandwidth grows less than 25% for three rounds
+			if(max_bw >= full_bw * 1.25) {
+				full_bw = max_bw;
+				full_bw_rounds = 0;
+			} else if(++full_bw_rounds >= 3) {
+				is_pipe_full = true;
+			}
+		}
+	}
+
+	void update_bw(AckEvent const& event) {
+		if(event.delivery_rate <= 0) {
+			return;
+		}
+
+		// App limited samples underestimate, only use them if they raise the estimate
+		if(event.is_app_limited && event.delivery_rate < max_bw) {
+			return;
+		}
+
+		auto &bw = round_bw[round_count % bw_window_rounds];
+		bw = std::max(bw, event.delivery_rate);
+		max_bw = std::max(max_bw, bw);
+	}
+
+	void enter_probe_bw(uint64_t now) {
+		state = State::ProbeBw;
+		// Start probing down so that a queue built in startup drains first
+		cycle_idx = 1;
+		cycle_stamp = now;
+		pacing_gain = probe_bw_gains[cycle_idx];
+	}
+
+	void update_state(AckEvent const& event) {
+		auto now = event.now;
+
+		if(state == State::Startup && is_pipe_full) {
+			state = State::Drain;
+			pacing_gain = 1 / startup_gain;
+		}
+
+		if(state == State::Drain && event.bytes_in_flight <= bdp(1)) {
+			enter_probe_bw(now);
+		}
+
+		if(state == State::ProbeBw && now - cycle_stamp > min_rtt) {
+			cycle_idx = (cycle_idx + 1) % std::size(probe_bw_gains);
+			cycle_stamp = now;
+			pacing_gain = probe_bw_gains[cycle_idx];
+
+			// Probing up without excessive loss, let the bound grow
+			if(cycle_idx == 0 && inflight_hi != (uint64_t)-1) {
+				inflight_hi += inflight_hi / 4;
+				if(inflight_hi >= 2 * bdp(cwnd_gain)) {
+					inflight_hi = -1;
+				}
+			}
+		}
+
+		// Min RTT has not been refreshed in a while, drain the queue to sample it
+		if(state != State::ProbeRtt && now > min_rtt_stamp + min_rtt_window) {
+			state = State::ProbeRtt;
+			pacing_gain = 1;
+			// Sample afresh with the queue drained
+			min_rtt = -1;
+			probe_rtt_done_stamp = 0;
+			is_probe_rtt_round_done = false;
+		}
+
+		if(state == State::ProbeRtt) {
+			if(probe_rtt_done_stamp == 0 && event.bytes_in_flight <= min_window) {
+				probe_rtt_done_stamp = now + probe_rtt_duration;
+				is_probe_rtt_round_done = false;
+			} else if(probe_rtt_done_stamp != 0 && is_probe_rtt_round_done && now > probe_rtt_done_stamp) {
+				min_rtt_stamp = now;
+				if(is_pipe_full) {
+					enter_probe_bw(now);
+				} else {
+					state = State::Startup;
+					pacing_gain = startup_gain;
+				}
+			}
+		}
+	}
+
+	void update_window(AckEvent const& event) {
+		if(state == State::ProbeRtt) {
+			congestion_window = min_window;
+			return;
+		}
+
+		auto target = bdp(cwnd_gain);
+		if(is_pipe_full) {
+			congestion_window = std::min(congestion_window + event.length, target);
+		} else if(congestion_window < target || event.delivered < initial_window) {
+			congestion_window += event.length;
+		}
+
+		congestion_window = std::clamp(congestion_window, min_window, std::max(inflight_hi, min_window));
+	}
+public:
+	/// Restore the initial state
+	void reset() {
+		*this = BbrCongestionController();
+	}
+
+	void on_packet_sent(uint64_t now, uint64_t, uint64_t bytes_in_flight) {
+		if(bytes_in_flight == 0 && state == State::ProbeBw) {
+			// Restarting from idle, no queue to drain
+			cycle_stamp = now;
+		}
+	}
+
+	void on_ack(AckEvent const& event) {
+		update_round(event);
+		update_bw(event);
+
+		auto rtt = event.now - event.sent_time;
+		if(rtt <= min_rtt) {
+			min_rtt = rtt;
+			if(state != State::ProbeRtt) {
+				min_rtt_stamp = event.now;
+			}
+		}
+
+		round_delivered += event.length;
+
+		update_state(event);
+		update_window(event);
+	}
+
+	void on_loss(LossEvent const& event) {
+		round_lost += event.length;
+		if(is_round_loss_handled || round_lost <= loss_threshold * (round_lost + round_delivered)) {
+			// Random loss, keep the model
+			return;
+		}
+
+		// Excessive loss, the path cannot hold what is in flight
+		is_round_loss_handled = true;
+		inflight_hi = std::max<uint64_t>(beta * std::max(event.bytes_in_flight + event.length, bdp(1)), min_window);
+		congestion_window = std::min(congestion_window, inflight_hi);
+
+		if(state == State::Startup) {
+			is_pipe_full = true;
+		}
+	}
+
+	void on_spurious_loss(LossEvent const& event) {
+		// Delivered after all, no longer counts towards the loss rate of the round
+		round_lost -= std::min(round_lost, event.length);
+	}
+
+	uint64_t cwnd() const {
+		return congestion_window;
+	}
+
+	double pacing_rate(double rtt) const {
+		if(max_bw == 0) {
+			return pacing_gain * congestion_window / std::max(rtt, 1.0);
+		}
+
+		return pacing_gain * max_bw;
+	}
+
+	State get_state() const {
+		return state;
+	}
+
+	/// Bottleneck bandwidth estimate in bytes per microsecond
+	double get_bw() const {
+		return max_bw;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_BBRCONGESTIONCONTROLLER_HPP
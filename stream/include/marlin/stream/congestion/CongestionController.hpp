@@ -0,0 +1,69 @@
+#ifndef MARLIN_STREAM_CONGESTION_CONGESTIONCONTROLLER_HPP
+#define MARLIN_STREAM_CONGESTION_CONGESTIONCONTROLLER_HPP
+
+#include <variant>
+
+#include "CongestionEvents.hpp"
+#include "CubicCongestionController.hpp"
+#include "BbrCongestionController.hpp"
+#include "FixedRateCongestionController.hpp"
+
+namespace marlin {
+namespace stream {
+
+/// @brief Congestion control policy of a stream transport, chosen at runtime
+/// @details Every policy exposes the same interface, times are in microseconds:
+/// \li on_packet_sent(now, length, bytes_in_flight)
+/// \li on_ack(AckEvent), once per acked packet
+/// \li on_loss(LossEvent), once per batch of packets declared lost
+/// \li on_spurious_loss(LossEvent), once per packet declared lost that was acked after all
+/// \li cwnd(), congestion window in bytes
+/// \li pacing_rate(rtt), in bytes per microsecond given the smoothed RTT
+class CongestionController {
+private:
+	std::variant<
+		CubicCongestionController,
+		BbrCongestionController,
+		FixedRateCongestionController
+	> controller;
+public:
+	/// Defaults to CUBIC
+	CongestionController() = default;
+	CongestionController(CubicCongestionController const& controller) : controller(controller) {}
+	CongestionController(BbrCongestionController const& controller) : controller(controller) {}
+	CongestionController(FixedRateCongestionController const& controller) : controller(controller) {}
+
+	/// Restore the initial state, keeping the policy and its configuration
+	void reset() {
+		std::visit([](auto& c) { c.reset(); }, controller);
+	}
+
+	void on_packet_sent(uint64_t now, uint64_t length, uint64_t bytes_in_flight) {
+		std::visit([&](auto& c) { c.on_packet_sent(now, length, bytes_in_flight); }, controller);
+	}
+
+	void on_ack(AckEvent const& event) {
+		std::visit([&](auto& c) { c.on_ack(event); }, controller);
+	}
+
+	void on_loss(LossEvent const& event) {
+		std::visit([&](auto& c) { c.on_loss(event); }, controller);
+	}
+
+	void on_spurious_loss(LossEvent const& event) {
+		std::visit([&](auto& c) { c.on_spurious_loss(event); }, controller);
+	}
+
+	uint64_t cwnd() const {
+		return std::visit([](auto const& c) { return c.cwnd(); }, controller);
+	}
+
+	double pacing_rate(double rtt) const {
+		return std::visit([&](auto const& c) { return c.pacing_rate(rtt); }, controller);
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_CONGESTIONCONTROLLER_HPP
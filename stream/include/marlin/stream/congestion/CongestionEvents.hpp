@@ -0,0 +1,44 @@
+#ifndef MARLIN_STREAM_CONGESTION_CONGESTIONEVENTS_HPP
+#define MARLIN_STREAM_CONGESTION_CONGESTIONEVENTS_HPP
+
+#include <cstdint>
+
+namespace marlin {
+namespace stream {
+
+/// Signals from a single acked packet, times in microseconds
+struct AckEvent {
+	/// Time the ack was received
+	uint64_t now;
+	/// Time the packet was sent
+	uint64_t sent_time;
+	/// Bytes in the packet
+	uint64_t length;
+	/// Bytes still in flight, not counting the packet
+	uint64_t bytes_in_flight;
+	/// Total bytes delivered to the peer, counting the packet
+	uint64_t delivered;
+	/// Total bytes delivered when the packet was sent
+	uint64_t packet_delivered;
+	/// Delivery rate sampled over the lifetime of the packet in bytes per microsecond, 0 if unknown
+	double delivery_rate;
+	/// Was the sender not using the full window when the ack arrived?
+	bool is_app_limited;
+};
+
+/// Signals from a batch of packets declared lost together, times in microseconds
+struct LossEvent {
+	/// Time the loss was detected
+	uint64_t now;
+	/// Time the newest lost packet was sent
+	uint64_t sent_time;
+	/// Bytes in the lost packets
+	uint64_t length;
+	/// Bytes still in flight, not counting the lost packets
+	uint64_t bytes_in_flight;
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_CONGESTIONEVENTS_HPP
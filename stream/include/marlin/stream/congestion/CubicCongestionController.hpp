@@ -0,0 +1,151 @@
+#ifndef MARLIN_STREAM_CONGESTION_CUBICCONGESTIONCONTROLLER_HPP
+#define MARLIN_STREAM_CONGESTION_CUBICCONGESTIONCONTROLLER_HPP
+
+#include <cmath>
+#include <algorithm>
+
+#include "CongestionEvents.hpp"
+
+namespace marlin {
+namespace stream {
+
+/// @brief Loss based CUBIC congestion control
+/// @details Slow start, then the window follows the cubic function of the time since the last
+/// congestion event, plateauing around the window the event happened at. Never grows slower than NEW RENO would.
+/// Backs off by 0.75 on a congestion event and by 0.6 if still below the previous maximum.
+/// The back off is undone if every loss of the recovery period turns out to be spurious.
+class CubicCongestionController {
+private:
+	/// Scaling constant of the cubic function in segments per second cubed
+	static constexpr double c = 0.4;
+	static constexpr uint64_t mss = 1500;
+
+	/// Time in microseconds from the congestion event for the cubic function to reach w_max again
+	uint64_t k = 0;
+	/// Window at the last congestion event
+	uint64_t w_max = 0;
+	uint64_t congestion_window = 100000;
+	/// Window NEW RENO would have grown to since the last congestion event
+	uint64_t reno_window = 0;
+	uint64_t ssthresh = -1;
+	/// Time in microseconds the current recovery period started
+	uint64_t congestion_start = 0;
+
+	/// Bytes lost in the current recovery period not found to be spurious yet
+	uint64_t recovery_lost = 0;
+	/// Is the state before the current recovery period still restorable?
+	bool can_undo = false;
+	uint64_t prior_k = 0;
+	uint64_t prior_w_max = 0;
+	uint64_t prior_congestion_window = 0;
+	uint64_t prior_reno_window = 0;
+	uint64_t prior_ssthresh = 0;
+	uint64_t prior_congestion_start = 0;
+public:
+	/// Restore the initial state
+	void reset() {
+		*this = CubicCongestionController();
+	}
+
+	void on_packet_sent(uint64_t, uint64_t, uint64_t) {}
+
+	void on_ack(AckEvent const& event) {
+		// Check if not in congestion recovery and not application limited
+		if(event.sent_time <= congestion_start || event.is_app_limited) {
+			return;
+		}
+
+		if(congestion_window < ssthresh) {
+			// Slow start, exponential increase
+			congestion_window += event.length;
+		} else {
+			// Congestion avoidance, CUBIC
+			// Grow towards the value of the cubic function one rtt from now, by at most half the window per rtt
+			auto rtt = event.now - event.sent_time;
+			double t = (double(event.now + rtt - congestion_start) - double(k)) * 0.000001;
+			double target = w_max + c * mss * t * t * t;
+			target = std::clamp(target, double(congestion_window), 1.5 * congestion_window);
+			uint64_t cubic_window = congestion_window + (target - congestion_window) * event.length / congestion_window;
+
+			// NEW RENO friendly region
+			reno_window += mss * event.length / reno_window;
+
+			congestion_window = std::max(cubic_window, reno_window);
+		}
+	}
+
+	void on_loss(LossEvent const& event) {
+		if(event.sent_time <= congestion_start) {
+			// Sent before the current recovery period, already reacted to
+			recovery_lost += event.length;
+			return;
+		}
+
+		// New congestion event
+		can_undo = true;
+		prior_k = k;
+		prior_w_max = w_max;
+		prior_congestion_window = congestion_window;
+		prior_reno_window = reno_window;
+		prior_ssthresh = ssthresh;
+		prior_congestion_start = congestion_start;
+		recovery_lost = event.length;
+
+		congestion_start = event.now;
+
+		if(congestion_window < w_max) {
+			// Fast convergence
+			w_max = congestion_window;
+			congestion_window *= 0.6;
+		} else {
+			w_max = congestion_window;
+			congestion_window *= 0.75;
+		}
+
+		if(congestion_window < 10000) {
+			congestion_window = 10000;
+		}
+		ssthresh = congestion_window;
+		reno_window = congestion_window;
+
+		// Solve w_max + c * (0 - k)^3 = congestion_window, in segments and seconds
+		double drop = w_max > congestion_window ? double(w_max - congestion_window) / mss : 0;
+		k = std::cbrt(drop / c) * 1000000;
+	}
+
+	void on_spurious_loss(LossEvent const& event) {
+		if(!can_undo || event.sent_time <= prior_congestion_start) {
+			// Lost in an earlier recovery period
+			return;
+		}
+
+		recovery_lost -= std::min(recovery_lost, event.length);
+		if(recovery_lost > 0) {
+			return;
+		}
+
+		// Nothing was lost after all, restore the state before the back off
+		can_undo = false;
+		k = prior_k;
+		w_max = prior_w_max;
+		congestion_window = std::max(congestion_window, prior_congestion_window);
+		reno_window = std::max(reno_window, prior_reno_window);
+		ssthresh = prior_ssthresh;
+		congestion_start = prior_congestion_start;
+	}
+
+	uint64_t cwnd() const {
+		return congestion_window;
+	}
+
+	double pacing_rate(double rtt) const {
+		// Pace faster than cwnd/rtt so that the window can grow, more so in slow start
+		double gain = congestion_window < ssthresh ? 2 : 1.25;
+		return gain * congestion_window / std::max(rtt, 1.0);
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_CUBICCONGESTIONCONTROLLER_HPP
@@ -0,0 +1,58 @@
+#ifndef MARLIN_STREAM_CONGESTION_FIXEDRATECONGESTIONCONTROLLER_HPP
+#define MARLIN_STREAM_CONGESTION_FIXEDRATECONGESTIONCONTROLLER_HPP
+
+#include <algorithm>
+
+#include "CongestionEvents.hpp"
+
+namespace marlin {
+namespace stream {
+
+/// @brief Sends at a configured rate regardless of loss
+/// @details Meant for trusted private links with known capacity.
+/// The window is twice the bandwidth delay product at the smallest RTT seen.
+class FixedRateCongestionController {
+private:
+	/// Configured rate in bytes per second
+	uint64_t rate;
+	/// Smallest RTT sample in microseconds
+	uint64_t min_rtt = -1;
+public:
+	/// Window used until an RTT sample is available, never shrinks below it
+	static constexpr uint64_t initial_window = 100000;
+
+	/// Send at the given rate in bytes per second
+	explicit FixedRateCongestionController(uint64_t rate) : rate(rate) {}
+
+	/// Restore the initial state
+	void reset() {
+		min_rtt = -1;
+	}
+
+	void on_packet_sent(uint64_t, uint64_t, uint64_t) {}
+
+	void on_ack(AckEvent const& event) {
+		min_rtt = std::min(min_rtt, event.now - event.sent_time);
+	}
+
+	void on_loss(LossEvent const&) {}
+
+	void on_spurious_loss(LossEvent const&) {}
+
+	uint64_t cwnd() const {
+		if(min_rtt == (uint64_t)-1) {
+			return initial_window;
+		}
+
+		return std::max(initial_window, 2 * rate * min_rtt / 1000000);
+	}
+
+	double pacing_rate(double) const {
+		return rate / 1000000.0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_FIXEDRATECONGESTIONCONTROLLER_HPP
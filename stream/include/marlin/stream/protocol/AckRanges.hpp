@@ -1,105 +1,168 @@
 #ifndef MARLIN_STREAM_ACK_RANGES_HPP
 #define MARLIN_STREAM_ACK_RANGES_HPP
 
-#include <list>
+#include <vector>
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
+/// Upper bound on seen intervals tracked, the oldest are dropped beyond it
+#define MAX_ACK_INTERVALS 4096
+
 namespace marlin {
 namespace stream {
 
-/// Stores ranges of packet numbers that have and haven't been seen
+/// @brief Stores ranges of packet numbers that have and haven't been seen
+/// @details Seen packet numbers are kept as sorted disjoint intervals. In-order packets
+/// extend the newest interval in O(1), reordered packets are located by binary search.
+/// Packet numbers below the pruned floor are no longer tracked.
 class AckRanges {
+private:
+	/// Inclusive interval of seen packet numbers
+	struct Interval {
+		uint64_t low;
+		uint64_t high;
+	};
+
+	/// Seen intervals in ascending order, separated by at least one unseen packet number
+	std::vector<Interval> intervals;
+	/// Packet numbers below the floor are ignored
+	uint64_t floor = 0;
 public:
-	/// Alternating ranges of seen and not seen packet numbers
-	std::list<uint64_t> ranges;
+	/// Have no packet numbers been seen?
+	bool empty() const {
+		return intervals.empty();
+	}
+
 	/// Largest seen packet number
-	uint64_t largest;
+	uint64_t largest() const {
+		return intervals.back().high;
+	}
 
-	/// Mark a packet number as seen
-	void add_packet_number(uint64_t num) {
-		// Initial
-		if(ranges.size() == 0) {
-			ranges.push_back(1);
+	/// Smallest seen packet number still tracked
+	uint64_t smallest() const {
+		return intervals.front().low;
+	}
 
-			largest = num;
-			return;
+	/// Number of alternating seen and not seen ranges
+	size_t size() const {
+		return intervals.empty() ? 0 : 2 * intervals.size() - 1;
+	}
+
+	/// Has the packet number been seen? Packet numbers below the floor count as seen,
+	/// they can no longer be told apart from ones that were
+	bool contains(uint64_t num) const {
+		if(num < floor) {
+			return true;
 		}
 
-		// Check beginning
-		if(num > largest) {
-			if(num == largest + 1) {
-				ranges.front()++;
-			} else {
-				ranges.push_front(num - largest - 1);
-				ranges.push_front(1);
+		auto next = std::upper_bound(
+			intervals.begin(),
+			intervals.end(),
+			num,
+			[](uint64_t num, Interval const& interval) {
+				return num < interval.low;
 			}
+		);
 
-			largest = num;
+		return next != intervals.begin() && num <= std::prev(next)->high;
+	}
+
+	/// Mark a packet number as seen
+	void add_packet_number(uint64_t num) {
+		if(num < floor) {
 			return;
 		}
 
-		uint64_t high = largest;
-		bool gap = false;
-		for(auto iter = ranges.begin(); iter != ranges.end(); iter++) {
-			uint64_t low = high - *iter;
-			// Check if contained in range (low,high]
-			if(high >= num && num >= low + 1) {
-				if(!gap) {
-					// Already in range, ignore
-					return;
-				}
-
-				auto next_iter = std::next(iter);
-				auto prev_iter = std::prev(iter);
-
-				if(num == high) {
-					// End of previous range
-					(*prev_iter)++;
-					(*iter)--;
-
-					// Merge if possible
-					if(*iter == 0) {
-						*prev_iter += *next_iter;
-						ranges.erase(next_iter);
-						ranges.erase(iter);
-					}
-				} else if(num == low + 1) {
-					// Start of next range
-					(*next_iter)++;
-					(*iter)--;
-
-					// Merge if possible
-					if(*iter == 0) {
-						*prev_iter += *next_iter;
-						ranges.erase(next_iter);
-						ranges.erase(iter);
-					}
-				} else {
-					// Middle of gap, create new range and gap
-					*iter = num - (low + 1);
-					ranges.insert(iter, high-num);
-					ranges.insert(iter, 1);
+		// Initial or newest, the common case
+		if(intervals.empty() || num > intervals.back().high + 1) {
+			intervals.push_back({num, num});
+		} else if(num == intervals.back().high + 1) {
+			intervals.back().high = num;
+			return;
+		} else {
+			// First interval starting after num
+			auto next = std::upper_bound(
+				intervals.begin(),
+				intervals.end(),
+				num,
+				[](uint64_t num, Interval const& interval) {
+					return num < interval.low;
 				}
+			);
+			auto prev = next == intervals.begin() ? intervals.end() : std::prev(next);
 
+			if(prev != intervals.end() && num <= prev->high) {
+				// Already in range, ignore
 				return;
 			}
 
-			high = low;
-			gap = !gap;
+			bool extends_prev = prev != intervals.end() && prev->high + 1 == num;
+			bool extends_next = next != intervals.end() && next->low == num + 1;
+
+			if(extends_prev && extends_next) {
+				// Fills gap, merge
+				prev->high = next->high;
+				intervals.erase(next);
+			} else if(extends_prev) {
+				prev->high = num;
+			} else if(extends_next) {
+				next->low = num;
+			} else {
+				intervals.insert(next, {num, num});
+			}
 		}
 
-		// At end
-		if(high == num) {
-			ranges.back()++;
-		} else {
-			ranges.push_back(high - num);
-			ranges.push_back(1);
+		if(intervals.size() > MAX_ACK_INTERVALS) {
+			SPDLOG_ERROR("AckRange resized: {}", num);
+			floor = intervals[intervals.size() - MAX_ACK_INTERVALS].low;
+			intervals.erase(intervals.begin(), intervals.end() - MAX_ACK_INTERVALS);
 		}
+	}
 
-		if(ranges.size() > 1001) {
-			SPDLOG_ERROR("AckRange resized: {}", num);
-			ranges.resize(1001);
+	/// Stop tracking packet numbers below the given floor.
+	/// Intervals straddling the floor are kept whole.
+	void prune_below(uint64_t new_floor) {
+		if(new_floor <= floor) {
+			return;
 		}
+		floor = new_floor;
+
+		auto iter = std::find_if(
+			intervals.begin(),
+			intervals.end(),
+			[&](Interval const& interval) {
+				return interval.high >= floor;
+			}
+		);
+		intervals.erase(intervals.begin(), iter);
+	}
+
+	/// Largest packet number of the seen range at the given index, counted from the newest
+	uint64_t high(size_t from) const {
+		return intervals[intervals.size() - 1 - from].high;
+	}
+
+	/// Write alternating seen and not seen run lengths going down from the seen range at
+	/// the given index, counted from the newest, ending on a seen run and writing at most
+	/// max_ranges runs. Returns the number of seen ranges written.
+	size_t encode(size_t from, size_t max_ranges, std::vector<uint64_t> &ranges) const {
+		ranges.clear();
+
+		size_t count = 0;
+		for(
+			auto idx = intervals.size() - from;
+			idx > 0 && ranges.size() + (count > 0 ? 2 : 1) <= max_ranges;
+			idx--, count++
+		) {
+			auto &interval = intervals[idx - 1];
+			if(count > 0) {
+				// Gap down from the previous seen range
+				ranges.push_back(intervals[idx].low - interval.high - 1);
+			}
+			ranges.push_back(interval.high - interval.low + 1);
+		}
+
+		return count;
 	}
 };
 
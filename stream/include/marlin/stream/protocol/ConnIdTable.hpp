@@ -0,0 +1,120 @@
+#ifndef MARLIN_STREAM_CONNIDTABLE_HPP
+#define MARLIN_STREAM_CONNIDTABLE_HPP
+
+#include <sodium.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+namespace marlin {
+namespace stream {
+
+/// @brief Connection ids of the transports of a factory, for finding a connection independent of its address
+/// @details Ids handed out by the table carry their slot in the low bits and random bits above,
+/// so lookups are a single index into a dense array and stale or guessed ids fail the comparison.
+/// Slots are reused as soon as they are released, with fresh random bits.
+/// Ids chosen by the peer, such as on session resumption, cannot be placed by slot and go into a map instead.
+template<typename TransportType>
+class ConnIdTable {
+public:
+	/// Low bits of an id which index the table
+	static constexpr uint32_t index_bits = 20;
+	static constexpr uint32_t index_mask = (1u << index_bits) - 1;
+private:
+	struct Slot {
+		/// Id currently held, 0 if free
+		uint32_t conn_id = 0;
+		TransportType *transport = nullptr;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> free_slots;
+	/// Ids chosen by peers
+	std::unordered_map<uint32_t, TransportType*> foreign_ids;
+	size_t count = 0;
+public:
+	/// Number of registered ids
+	size_t size() const {
+		return count;
+	}
+
+	/// Hand out a new id for the transport, 0 if the table is full
+	uint32_t allocate(TransportType *transport) {
+		uint32_t index;
+		if(!free_slots.empty()) {
+			index = free_slots.back();
+			free_slots.pop_back();
+		} else if(slots.size() <= index_mask) {
+			index = slots.size();
+			slots.emplace_back();
+		} else {
+			return 0;
+		}
+
+		uint32_t conn_id;
+		do {
+			conn_id = (randombytes_random() & ~index_mask) | index;
+		} while(conn_id == 0 || foreign_ids.contains(conn_id));
+
+		slots[index] = {conn_id, transport};
+		count++;
+
+		return conn_id;
+	}
+
+	/// Register an id chosen by the peer, false if it is 0 or already taken
+	bool insert(uint32_t conn_id, TransportType *transport) {
+		if(conn_id == 0 || find(conn_id) != nullptr) {
+			return false;
+		}
+
+		foreign_ids[conn_id] = transport;
+		count++;
+
+		return true;
+	}
+
+	/// Transport holding the id, null if none
+	TransportType *find(uint32_t conn_id) const {
+		if(conn_id == 0) {
+			return nullptr;
+		}
+
+		auto index = conn_id & index_mask;
+		if(index < slots.size() && slots[index].conn_id == conn_id) {
+			return slots[index].transport;
+		}
+
+		auto iter = foreign_ids.find(conn_id);
+		return iter == foreign_ids.end() ? nullptr : iter->second;
+	}
+
+	/// Forget the id, only if the transport still holds it
+	void release(uint32_t conn_id, TransportType *transport) {
+		if(conn_id == 0) {
+			return;
+		}
+
+		auto index = conn_id & index_mask;
+		if(index < slots.size() && slots[index].conn_id == conn_id) {
+			if(slots[index].transport == transport) {
+				slots[index] = {};
+				free_slots.push_back(index);
+				count--;
+			}
+			return;
+		}
+
+		auto iter = foreign_ids.find(conn_id);
+		if(iter != foreign_ids.end() && iter->second == transport) {
+			foreign_ids.erase(iter);
+			count--;
+		}
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONNIDTABLE_HPP
@@ -0,0 +1,337 @@
+#ifndef MARLIN_STREAM_FEC_HPP
+#define MARLIN_STREAM_FEC_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <marlin/core/Buffer.hpp>
+
+namespace marlin {
+namespace stream {
+
+/// @brief XOR parity of a group of consecutive DATA packets
+/// @details Every packet contributes a unit made of its header fields followed by its payload,
+/// zero padded to the longest payload in the group. Given the parity and all but one unit of
+/// the group, the missing unit is the XOR of the parity with the others.
+struct FecParity {
+	/// Bytes of header fields at the start of a unit
+	static constexpr size_t header_size = 13;
+
+	/// XOR a packet into the given parity bytes, which must fit header_size + length
+	static void add(
+		uint8_t *parity,
+		uint16_t stream_id,
+		uint64_t offset,
+		uint16_t length,
+		bool is_fin,
+		uint8_t const *data
+	) {
+		for(size_t i = 0; i < 2; i++) {
+			parity[i] ^= stream_id >> (8 * i);
+		}
+		for(size_t i = 0; i < 8; i++) {
+			parity[2 + i] ^= offset >> (8 * i);
+		}
+		for(size_t i = 0; i < 2; i++) {
+			parity[10 + i] ^= length >> (8 * i);
+		}
+		parity[12] ^= is_fin;
+
+		for(size_t i = 0; i < length; i++) {
+			parity[header_size + i] ^= data[i];
+		}
+	}
+};
+
+/// @brief Builds parity over groups of consecutive DATA packets on the send side
+/// @details Group size adapts to residual loss, loss not repaired by parity. It halves
+/// when packets are declared lost and grows by one after a run of acks without loss.
+class FecEncoder {
+private:
+	std::vector<uint8_t> parity;
+	uint64_t first = 0;
+	uint16_t count = 0;
+	uint16_t max_length = 0;
+
+	size_t group_size = max_group_size / 2;
+	uint64_t acked_since_loss = 0;
+public:
+	static constexpr size_t min_group_size = 4;
+	static constexpr size_t max_group_size = 32;
+	/// Acks without loss, in multiples of the group size, before the group grows
+	static constexpr size_t growth_groups = 16;
+
+	/// XOR the given packet into the current group, packet numbers must be consecutive
+	void add(
+		uint64_t packet_number,
+		uint16_t stream_id,
+		uint64_t offset,
+		uint16_t length,
+		bool is_fin,
+		uint8_t const *data
+	) {
+		if(count == 0) {
+			first = packet_number;
+		}
+		if(parity.size() < FecParity::header_size + length) {
+			parity.resize(FecParity::header_size + length, 0);
+		}
+
+		FecParity::add(parity.data(), stream_id, offset, length, is_fin, data);
+		count++;
+		max_length = std::max(max_length, length);
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	/// Should the parity of the current group be sent?
+	bool is_full() const {
+		return count >= group_size;
+	}
+
+	/// Packet number of the first packet in the current group
+	uint64_t first_packet_number() const {
+		return first;
+	}
+
+	/// Number of packets in the current group
+	uint16_t size() const {
+		return count;
+	}
+
+	/// Longest payload in the current group
+	uint16_t payload_length() const {
+		return max_length;
+	}
+
+	/// Parity bytes of the current group, FecParity::header_size + payload_length() long
+	uint8_t const *data() const {
+		return parity.data();
+	}
+
+	/// Start a new group
+	void clear() {
+		std::fill(parity.begin(), parity.end(), 0);
+		count = 0;
+		max_length = 0;
+	}
+
+	/// Packets were declared lost despite parity, add redundancy
+	void on_loss() {
+		group_size = std::max(min_group_size, group_size / 2);
+		acked_since_loss = 0;
+	}
+
+	/// Packets were acked, remove redundancy after a while without loss
+	void on_ack(uint64_t packets) {
+		acked_since_loss += packets;
+		if(acked_since_loss >= growth_groups * group_size) {
+			group_size = std::min(max_group_size, group_size + 1);
+			acked_since_loss = 0;
+		}
+	}
+
+	size_t get_group_size() const {
+		return group_size;
+	}
+
+	/// Restore the initial state
+	void reset() {
+		*this = FecEncoder();
+	}
+};
+
+/// Packet rebuilt from parity
+struct FecRecoveredPacket {
+	uint64_t packet_number;
+	uint16_t stream_id;
+	uint64_t offset;
+	uint16_t length;
+	bool is_fin;
+	core::Buffer payload;
+};
+
+/// @brief Rebuilds single missing DATA packets of a group from its parity on the recv side
+/// @details Keeps copies of the last few received packets once the peer has sent parity.
+/// Parity waits for late packets of its group until it is too old to be useful.
+class FecDecoder {
+private:
+	struct Slot {
+		uint64_t packet_number = -1;
+		uint16_t stream_id = 0;
+		uint64_t offset = 0;
+		uint16_t length = 0;
+		bool is_fin = false;
+		std::vector<uint8_t> payload;
+	};
+
+	struct Repair {
+		uint64_t first;
+		uint16_t count;
+		std::vector<uint8_t> parity;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<Repair> pending;
+	uint64_t largest = 0;
+
+	/// @return -1 if more packets are needed, 0 if the group is done, 1 if a packet was rebuilt
+	int try_repair(Repair &repair, FecRecoveredPacket &recovered) {
+		uint64_t missing = -1;
+		for(uint64_t packet_number = repair.first; packet_number < repair.first + repair.count; packet_number++) {
+			auto &slot = slots[packet_number % window];
+			if(slot.packet_number == packet_number) {
+				continue;
+			}
+			if(missing != (uint64_t)-1) {
+				// More than one missing, wait for more packets
+				return -1;
+			}
+			missing = packet_number;
+		}
+
+		if(missing == (uint64_t)-1) {
+			// Nothing to repair
+			return 0;
+		}
+
+		auto &parity = repair.parity;
+		for(uint64_t packet_number = repair.first; packet_number < repair.first + repair.count; packet_number++) {
+			auto &slot = slots[packet_number % window];
+			if(packet_number == missing) {
+				continue;
+			}
+			if(FecParity::header_size + slot.length > parity.size()) {
+				// Inconsistent with the parity, give up
+				return 0;
+			}
+			FecParity::add(parity.data(), slot.stream_id, slot.offset, slot.length, slot.is_fin, slot.payload.data());
+		}
+
+		auto read = [&](size_t idx, size_t size) {
+			uint64_t val = 0;
+			for(size_t i = 0; i < size; i++) {
+				val |= (uint64_t)parity[idx + i] << (8 * i);
+			}
+			return val;
+		};
+
+		recovered.packet_number = missing;
+		recovered.stream_id = read(0, 2);
+		recovered.offset = read(2, 8);
+		recovered.length = read(10, 2);
+		recovered.is_fin = parity[12] != 0;
+		if(FecParity::header_size + recovered.length > parity.size()) {
+			return 0;
+		}
+
+		recovered.payload = core::Buffer(recovered.length);
+		recovered.payload.write_unsafe(0, parity.data() + FecParity::header_size, recovered.length);
+
+		// Treat as received so that later parity does not rebuild it again
+		add(missing, recovered.stream_id, recovered.offset, recovered.length, recovered.is_fin, parity.data() + FecParity::header_size);
+		return 1;
+	}
+
+	template<typename F>
+	void repair_pending(F &&f) {
+		for(auto iter = pending.begin(); iter != pending.end();) {
+			FecRecoveredPacket recovered = {0, 0, 0, 0, false, core::Buffer(nullptr, 0)};
+			auto res = try_repair(*iter, recovered);
+			if(res >= 0) {
+				iter = pending.erase(iter);
+				if(res == 1) {
+					f(std::move(recovered));
+					// Callback might have added packets, start over
+					iter = pending.begin();
+				}
+			} else if(iter->first + iter->count + window / 2 < largest) {
+				// Too old, slots are being reused
+				iter = pending.erase(iter);
+			} else {
+				iter++;
+			}
+		}
+	}
+public:
+	/// Received packets kept for repair
+	static constexpr size_t window = 128;
+	/// Parity packets waiting for more of their group
+	static constexpr size_t max_pending = 16;
+
+	/// Has the peer sent parity? Packets are only kept if so.
+	bool is_active() const {
+		return !slots.empty();
+	}
+
+	/// Keep a copy of a received packet
+	void add(
+		uint64_t packet_number,
+		uint16_t stream_id,
+		uint64_t offset,
+		uint16_t length,
+		bool is_fin,
+		uint8_t const *data
+	) {
+		if(slots.empty()) {
+			return;
+		}
+
+		auto &slot = slots[packet_number % window];
+		slot.packet_number = packet_number;
+		slot.stream_id = stream_id;
+		slot.offset = offset;
+		slot.length = length;
+		slot.is_fin = is_fin;
+		slot.payload.assign(data, data + length);
+
+		largest = std::max(largest, packet_number);
+	}
+
+	/// Process parity for the given group, calls f with every packet that could be rebuilt
+	template<typename F>
+	void add_parity(
+		uint64_t first,
+		uint16_t count,
+		uint8_t const *parity,
+		size_t size,
+		F &&f
+	) {
+		if(slots.empty()) {
+			slots.resize(window);
+		}
+		if(count == 0 || count > window / 2) {
+			return;
+		}
+
+		if(pending.size() >= max_pending) {
+			pending.erase(pending.begin());
+		}
+		pending.push_back({first, count, std::vector<uint8_t>(parity, parity + size)});
+		largest = std::max(largest, first + count - 1);
+
+		repair_pending(std::forward<F>(f));
+	}
+
+	/// Retry pending parity after packets were received
+	template<typename F>
+	void did_add(F &&f) {
+		if(!pending.empty()) {
+			repair_pending(std::forward<F>(f));
+		}
+	}
+
+	/// Restore the initial state
+	void reset() {
+		slots.clear();
+		pending.clear();
+		largest = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_FEC_HPP
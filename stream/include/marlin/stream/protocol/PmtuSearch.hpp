@@ -0,0 +1,107 @@
+#ifndef MARLIN_STREAM_PMTUSEARCH_HPP
+#define MARLIN_STREAM_PMTUSEARCH_HPP
+
+#include <cstddef>
+#include <algorithm>
+
+namespace marlin {
+namespace stream {
+
+/// @brief Packetization layer path MTU search after DPLPMTUD (RFC 8899)
+/// @details Sizes are datagram sizes. Binary searches between a confirmed size and the largest
+/// size not yet ruled out. A probe size is ruled out after max_probes probes of it go unacked.
+/// Black holes, losing everything at the confirmed size, fall back to the base size.
+class PmtuSearch {
+private:
+	/// Size known to work, never below base
+	size_t base;
+	/// Largest size the local interface allows
+	size_t max;
+
+	size_t search_low;
+	size_t search_high;
+
+	/// Size of the probe in flight, 0 if none
+	size_t probe_size = 0;
+	/// Unacked probes of the current probe size
+	size_t probe_count = 0;
+public:
+	/// Probes of a single size before it is ruled out
+	static constexpr size_t max_probes = 3;
+	/// Search stops once the range is narrower than this
+	static constexpr size_t granularity = 64;
+
+	PmtuSearch(size_t base, size_t max) :
+		base(base),
+		max(std::max(base, max)),
+		search_low(base),
+		search_high(std::max(base, max)) {}
+
+	/// Largest datagram size confirmed to reach the peer
+	size_t current() const {
+		return search_low;
+	}
+
+	/// Is the search over until restarted?
+	bool is_done() const {
+		return search_high < search_low + granularity;
+	}
+
+	/// Size of the next probe to send, 0 if the search is done
+	size_t next_probe() {
+		if(is_done()) {
+			probe_size = 0;
+			return 0;
+		}
+
+		if(probe_size == 0) {
+			probe_size = search_high == max ? max : (search_low + search_high + 1) / 2;
+		}
+
+		return probe_size;
+	}
+
+	/// Peer received a probe of the given size
+	/// @return false if no probe of that size is in flight, the ack is then ignored
+	bool on_probe_acked(size_t size) {
+		if(probe_size == 0 || size != probe_size) {
+			return false;
+		}
+
+		search_low = size;
+		probe_size = 0;
+		probe_count = 0;
+		return true;
+	}
+
+	/// Probe in flight was not acked in time
+	void on_probe_lost() {
+		if(probe_size == 0) {
+			return;
+		}
+
+		if(++probe_count >= max_probes) {
+			search_high = probe_size - 1;
+			probe_size = 0;
+			probe_count = 0;
+		}
+	}
+
+	/// Packets of the current size are not getting through, fall back and search again
+	void on_black_hole() {
+		search_low = base;
+		restart();
+	}
+
+	/// Search again above the current size, the path might have changed
+	void restart() {
+		search_high = max;
+		probe_size = 0;
+		probe_count = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_PMTUSEARCH_HPP
@@ -0,0 +1,185 @@
+#ifndef MARLIN_STREAM_RECV_PACKETS_HPP
+#define MARLIN_STREAM_RECV_PACKETS_HPP
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include <marlin/core/Buffer.hpp>
+
+namespace marlin {
+namespace stream {
+
+/// Store a received packet with a few header fields
+struct RecvPacketInfo {
+	/// Time it was received (relative to arbitrary epoch)
+	uint64_t recv_time;
+	/// Offset of data in stream
+	uint64_t offset;
+	/// Length of length
+	uint16_t length;
+	/// Data that was received
+	core::Buffer packet;
+
+	/// Constructor
+	RecvPacketInfo(
+		uint64_t recv_time,
+		uint64_t offset,
+		uint64_t length,
+		core::Buffer &&_packet
+	) : packet(std::move(_packet)) {
+		this->recv_time = recv_time;
+		this->offset = offset;
+		this->length = length;
+	}
+
+	/// Default constructor
+	RecvPacketInfo() : packet(nullptr, 0) {
+		recv_time = 0;
+		offset = 0;
+		length = 0;
+	}
+
+	/// Delete copy constructor
+	RecvPacketInfo(const RecvPacketInfo &) = delete;
+
+	/// Move constructor
+	RecvPacketInfo(RecvPacketInfo &&info) : packet(std::move(info.packet)) {
+		this->recv_time = info.recv_time;
+		this->offset = info.offset;
+		this->length = info.length;
+	};
+
+	/// Move assign
+	RecvPacketInfo &operator=(RecvPacketInfo &&info) {
+		this->recv_time = info.recv_time;
+		this->offset = info.offset;
+		this->length = info.length;
+		this->packet = std::move(info.packet);
+
+		return *this;
+	};
+};
+
+/// @brief Packets received ahead of the read offset, stored inline in a circular array ordered by offset
+/// @details Fragment sizes vary across packets, so slots are ordered rather than indexed by offset.
+/// Packets mostly arrive in increasing offset order and are appended, retransmissions filling
+/// holes are placed by binary search. Reads consume from the front. Capacity grows to the
+/// largest number of packets held and is reused afterwards without allocation.
+class RecvPackets {
+private:
+	/// Circular array, size is always a power of two
+	std::vector<RecvPacketInfo> slots = std::vector<RecvPacketInfo>(16);
+	/// Index of the slot holding the lowest offset
+	size_t head = 0;
+	/// Number of packets
+	size_t count = 0;
+
+	RecvPacketInfo &slot(size_t idx) {
+		return slots[(head + idx) & (slots.size() - 1)];
+	}
+
+	RecvPacketInfo const &slot(size_t idx) const {
+		return slots[(head + idx) & (slots.size() - 1)];
+	}
+
+	void grow() {
+		std::vector<RecvPacketInfo> grown(slots.size() * 2);
+		for(size_t i = 0; i < count; i++) {
+			grown[i] = std::move(slot(i));
+		}
+
+		slots = std::move(grown);
+		head = 0;
+	}
+public:
+	/// Number of packets
+	size_t size() const {
+		return count;
+	}
+
+	/// Are there no packets?
+	bool empty() const {
+		return count == 0;
+	}
+
+	/// Packet at the given position in offset order
+	RecvPacketInfo &operator[](size_t idx) {
+		return slot(idx);
+	}
+
+	RecvPacketInfo const &operator[](size_t idx) const {
+		return slot(idx);
+	}
+
+	/// Packet with the lowest offset
+	RecvPacketInfo &front() {
+		return slot(0);
+	}
+
+	/// Packet with the highest offset
+	RecvPacketInfo &back() {
+		return slot(count - 1);
+	}
+
+	/// Insert a packet in offset order, no-op if a packet with the same offset is present
+	/// @return Was the packet inserted?
+	bool insert(
+		uint64_t recv_time,
+		uint64_t offset,
+		uint64_t length,
+		core::Buffer &&packet
+	) {
+		// Find the first packet not below the offset, usually the end
+		size_t low = 0;
+		size_t high = count;
+		if(count > 0 && slot(count - 1).offset < offset) {
+			low = count;
+		}
+		while(low < high) {
+			auto mid = (low + high) / 2;
+			if(slot(mid).offset < offset) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+
+		if(low < count && slot(low).offset == offset) {
+			return false;
+		}
+
+		if(count == slots.size()) {
+			grow();
+		}
+
+		// Shift later packets up to make room
+		for(size_t i = count; i > low; i--) {
+			slot(i) = std::move(slot(i - 1));
+		}
+		slot(low) = RecvPacketInfo(recv_time, offset, length, std::move(packet));
+		count++;
+
+		return true;
+	}
+
+	/// Remove the packet with the lowest offset
+	void pop_front() {
+		slot(0) = RecvPacketInfo();
+		head = (head + 1) & (slots.size() - 1);
+		count--;
+	}
+
+	/// Remove all packets
+	void clear() {
+		while(count > 0) {
+			pop_front();
+		}
+		head = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_RECV_PACKETS_HPP
@@ -3,63 +3,14 @@
 
 #include <marlin/asyncio/core/Timer.hpp>
 
+#include "RecvPackets.hpp"
+
 #include <ctime>
 #include <memory>
 
 namespace marlin {
 namespace stream {
 
-/// Store a received packet with a few header fields
-struct RecvPacketInfo {
-	/// Time it was received (relative to arbitrary epoch)
-	uint64_t recv_time;
-	/// Offset of data in stream
-	uint64_t offset;
-	/// Length of length
-	uint16_t length;
-	/// Data that was received
-	core::Buffer packet;
-
-	/// Constructor
-	RecvPacketInfo(
-		uint64_t recv_time,
-		uint64_t offset,
-		uint64_t length,
-		core::Buffer &&_packet
-	) : packet(std::move(_packet)) {
-		this->recv_time = recv_time;
-		this->offset = offset;
-		this->length = length;
-	}
-
-	/// Default constructor
-	RecvPacketInfo() : packet(nullptr, 0) {
-		recv_time = 0;
-		offset = 0;
-		length = 0;
-	}
-
-	/// Delete copy constructor
-	RecvPacketInfo(const RecvPacketInfo &) = delete;
-
-	/// Move constructor
-	RecvPacketInfo(RecvPacketInfo &&info) : packet(std::move(info.packet)) {
-		this->recv_time = info.recv_time;
-		this->offset = info.offset;
-		this->length = info.length;
-	};
-
-	/// Move assign
-	RecvPacketInfo &operator=(RecvPacketInfo &&info) {
-		this->recv_time = info.recv_time;
-		this->offset = info.offset;
-		this->length = info.length;
-		this->packet = std::move(info.packet);
-
-		return *this;
-	};
-};
-
 /// A recv stream which handles incoming data
 struct RecvStream {
 	/// Stream id
@@ -89,8 +40,8 @@ struct RecvStream {
 		state_timer.set_data(this);
 	}
 
-	/// List of received packets
-	std::map<uint64_t, RecvPacketInfo> recv_packets;
+	/// Packets received ahead of the read offset
+	RecvPackets recv_packets;
 
 	/// Check if entire data on stream has been received
 	bool check_finish() const {
@@ -102,14 +53,16 @@ struct RecvStream {
 		}
 
 		uint64_t offset = read_offset;  // Expected offset
-		for (auto iter = this->recv_packets.begin(); iter != this->recv_packets.end(); iter++) {
+		for (size_t idx = 0; idx < this->recv_packets.size(); idx++) {
+			auto &packet = this->recv_packets[idx];
+
 			// Packet should start at or before expected offset
-			if (offset < iter->second.offset) {
+			if (offset < packet.offset) {
 				return false;
 			}
 
 			// Update expected offset
-			offset = std::max(offset, iter->second.offset + iter->second.length);
+			offset = std::max(offset, packet.offset + packet.length);
 		}
 
 		return offset == this->size;
@@ -117,6 +70,12 @@ struct RecvStream {
 
 	/// Offset marking application read position on the stream
 	uint64_t read_offset = 0;
+	/// Offset of end of the furthest data received on the stream
+	uint64_t highest_offset = 0;
+	/// Offset up to which the peer was last allowed to send
+	uint64_t max_offset = 0;
+	/// Bytes before the read offset the delegate has not acked as consumed yet, they hold back credit
+	uint64_t unconsumed = 0;
 
 	/// Check if all data on stream has been read by application
 	bool check_read() const {
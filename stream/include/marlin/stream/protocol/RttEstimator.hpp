@@ -0,0 +1,117 @@
+#ifndef MARLIN_STREAM_RTTESTIMATOR_HPP
+#define MARLIN_STREAM_RTTESTIMATOR_HPP
+
+#include <cstdint>
+#include <algorithm>
+
+namespace marlin {
+namespace stream {
+
+/// @brief RTT estimate and the loss detection timeouts derived from it, after RFC 9002 and RACK (RFC 8985)
+/// @details Times are in microseconds. Keeps the smoothed RTT and its mean deviation, the min RTT and the latest sample.
+/// A packet sent before an acked one is lost once it is older than the RTT plus a reordering window,
+/// an eighth of the RTT to start with. Every loss found to be spurious widens the window by another eighth,
+/// up to a full RTT, and it shrinks back after losses in reorder_persist round trips without spurious ones.
+class RttEstimator {
+public:
+	/// Timer granularity, lower bound for timeouts computed from the estimate
+	static constexpr uint64_t granularity = 1000;
+	/// Round trips with losses a widened reordering window is kept for
+	static constexpr uint8_t reorder_persist = 16;
+	/// Widest reordering window in eighths of the RTT
+	static constexpr uint8_t max_reorder_mult = 8;
+private:
+	/// Smoothed RTT, negative until the first sample
+	double srtt = -1;
+	/// Mean deviation of the RTT
+	double rttvar = 0;
+	uint64_t min = 0;
+	uint64_t latest = 0;
+
+	/// Reordering window in eighths of the RTT
+	uint8_t reorder_mult = 1;
+	/// Round trips with losses left before the reordering window shrinks back
+	uint8_t reorder_left = 0;
+	/// Time of the latest loss counted towards shrinking the window
+	uint64_t reorder_loss_time = 0;
+public:
+	/// Is there an estimate yet?
+	bool has_sample() const {
+		return srtt >= 0;
+	}
+
+	/// Add an RTT sample
+	void add_sample(uint64_t sample) {
+		latest = sample;
+		if(srtt < 0) {
+			srtt = sample;
+			rttvar = sample / 2.0;
+			min = sample;
+			return;
+		}
+
+		min = std::min(min, sample);
+		rttvar = 0.75 * rttvar + 0.25 * (srtt > sample ? srtt - sample : sample - srtt);
+		srtt = 0.875 * srtt + 0.125 * sample;
+	}
+
+	/// Smoothed RTT, negative until the first sample
+	double smoothed() const {
+		return srtt;
+	}
+
+	/// Mean deviation of the RTT
+	double variance() const {
+		return rttvar;
+	}
+
+	/// Smallest RTT sampled
+	uint64_t min_rtt() const {
+		return min;
+	}
+
+	/// Latest RTT sample
+	uint64_t latest_rtt() const {
+		return latest;
+	}
+
+	/// Extra time a packet is given for reordering before it is considered lost
+	uint64_t reorder_window() const {
+		return std::max<double>(srtt, latest) * reorder_mult / 8;
+	}
+
+	/// Age at which a packet sent before an acked one is lost
+	uint64_t loss_delay() const {
+		return std::max<uint64_t>(std::max<double>(srtt, latest) + reorder_window(), granularity);
+	}
+
+	/// Probe timeout, the smoothed RTT plus four deviations and the time the peer may hold its ack back
+	uint64_t pto(uint64_t max_ack_delay) const {
+		return srtt + std::max<double>(4 * rttvar, granularity) + max_ack_delay;
+	}
+
+	/// A packet declared lost was acked after all
+	void on_spurious_loss() {
+		if(reorder_mult < max_reorder_mult) {
+			reorder_mult++;
+		}
+		reorder_left = reorder_persist;
+	}
+
+	/// Packets were declared lost, counts once per round trip
+	void on_loss(uint64_t now) {
+		if(reorder_left == 0 || now < reorder_loss_time + srtt) {
+			return;
+		}
+
+		reorder_loss_time = now;
+		if(--reorder_left == 0) {
+			reorder_mult = 1;
+		}
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_RTTESTIMATOR_HPP
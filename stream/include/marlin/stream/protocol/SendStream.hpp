@@ -9,6 +9,7 @@
 #include <list>
 #include <ctime>
 #include <map>
+#include <marlin/core/SharedBuffer.hpp>
 #include <marlin/asyncio/core/Timer.hpp>
 
 namespace marlin {
@@ -16,8 +17,10 @@ namespace stream {
 
 /// Struct to store data (and its params) which is queued to the output/send stream
 struct DataItem {
-	/// Data buffer which is to be sent
-	core::Buffer data;
+	/// Data buffer which is to be sent, owned buffers are adopted without copying
+	core::SharedBuffer data;
+	/// Was the data queued as a shared buffer?
+	bool is_shared;
 	/// Offset in buffer which has already been sent at least once
 	uint64_t sent_offset = 0;
 	/// Offset of the start of the data buffer in the stream
@@ -27,16 +30,22 @@ struct DataItem {
 	DataItem(
 		core::Buffer &&_data,
 		uint64_t _stream_offset
-	) : data(std::move(_data)), stream_offset(_stream_offset) {}
+	) : data(std::move(_data)), is_shared(false), stream_offset(_stream_offset) {}
+
+	/// Constructor
+	DataItem(
+		core::SharedBuffer &&_data,
+		uint64_t _stream_offset
+	) : data(std::move(_data)), is_shared(true), stream_offset(_stream_offset) {}
 };
 
 struct SendStream;
 
 /// Information about a sent packet
 struct SentPacketInfo {
-	/// Time it was sent (relative to arbitrary epoch)
+	/// Time it was sent in microseconds (relative to arbitrary epoch)
 	uint64_t sent_time;
-	/// Stream it was sent on
+	/// Stream it was sent on, null for REPAIR, DATAGRAM and PING packets which carry no stream data
 	SendStream *stream;
 	/// Data item whose data was sent
 	DataItem *data_item;
@@ -44,6 +53,10 @@ struct SentPacketInfo {
 	uint64_t offset;
 	/// Length of the data sent
 	uint16_t length;
+	/// Bytes delivered to the peer when it was sent, for delivery rate sampling
+	uint64_t delivered = 0;
+	/// Time in microseconds of the latest delivery when it was sent
+	uint64_t delivered_time = 0;
 
 	/// Constructor
 	SentPacketInfo(
@@ -112,6 +125,8 @@ struct SendStream {
 
 	/// Offset of end of sent data in the stream
 	uint64_t sent_offset = 0;
+	/// Offset up to which the peer allows data to be sent, raised by WINDOW
+	uint64_t max_offset = 0;
 	/// Next item which is to be sent
 	std::list<DataItem>::iterator next_item_iterator;
 
@@ -126,6 +141,17 @@ struct SendStream {
 	/// Acks which have not been processed yet, usually due to having unacked data in front
 	std::map<uint64_t, uint16_t> outstanding_acks;
 
+	/// Scheduling class, lower classes are sent first
+	uint8_t priority = 0;
+	/// Share of its class the stream gets relative to other backlogged streams
+	uint16_t weight = 1;
+	/// Bytes the stream can still send in its current scheduling turn
+	uint64_t deficit = 0;
+	/// Is the stream waiting to be scheduled?
+	bool is_scheduled = false;
+
+	/// Offset of the last FLUSHSTREAM, repeated until confirmed
+	uint64_t flush_offset = 0;
 	/// Timer interval for the state timer
 	uint64_t state_timer_interval = 1000;
 	/// Timer to retry SKIPSTREAM
@@ -0,0 +1,147 @@
+#ifndef MARLIN_STREAM_SENT_PACKETS_HPP
+#define MARLIN_STREAM_SENT_PACKETS_HPP
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "SendStream.hpp"
+
+namespace marlin {
+namespace stream {
+
+/// @brief Packets in flight indexed by packet number, stored inline in a circular array
+/// @details Packet numbers are inserted in increasing order, possibly with gaps, and can
+/// be erased in any order. Slots between the oldest and newest packet are kept so that
+/// lookups are an index computation and scans are contiguous. Capacity grows to the
+/// largest span of packet numbers in flight and is reused afterwards without allocation.
+class SentPackets {
+private:
+	struct Slot {
+		SentPacketInfo info;
+		bool is_live = false;
+	};
+
+	/// Circular array, size is always a power of two
+	std::vector<Slot> slots = std::vector<Slot>(64);
+	/// Index of the slot holding base
+	size_t head = 0;
+	/// Packet number of the oldest slot, live unless empty
+	uint64_t base = 0;
+	/// Number of slots from base to the newest live packet
+	uint64_t span = 0;
+	/// Number of live packets
+	size_t count = 0;
+
+	Slot &slot(uint64_t packet_number) {
+		return slots[(head + (packet_number - base)) & (slots.size() - 1)];
+	}
+
+	void grow(uint64_t needed) {
+		auto capacity = slots.size();
+		while(capacity < needed) {
+			capacity *= 2;
+		}
+
+		std::vector<Slot> grown(capacity);
+		for(uint64_t i = 0; i < span; i++) {
+			grown[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+		}
+
+		slots = std::move(grown);
+		head = 0;
+	}
+public:
+	/// Number of packets
+	size_t size() const {
+		return count;
+	}
+
+	/// Are there no packets?
+	bool empty() const {
+		return count == 0;
+	}
+
+	/// Packet number of the oldest packet
+	uint64_t begin_number() const {
+		return base;
+	}
+
+	/// One past the packet number of the newest packet
+	uint64_t end_number() const {
+		return base + span;
+	}
+
+	/// Get the packet with the given packet number, nullptr if not present
+	SentPacketInfo *find(uint64_t packet_number) {
+		if(packet_number < base || packet_number >= base + span) {
+			return nullptr;
+		}
+
+		auto &s = slot(packet_number);
+		return s.is_live ? &s.info : nullptr;
+	}
+
+	/// Insert a packet, packet number must be at least end_number()
+	template<typename... Args>
+	SentPacketInfo &emplace(uint64_t packet_number, Args&&... args) {
+		if(count == 0) {
+			base = packet_number;
+			span = 0;
+		}
+
+		auto needed = packet_number - base + 1;
+		if(needed > slots.size()) {
+			grow(needed);
+		}
+		span = needed;
+		count++;
+
+		auto &s = slot(packet_number);
+		s.info = SentPacketInfo(std::forward<Args>(args)...);
+		s.is_live = true;
+		return s.info;
+	}
+
+	/// Remove the packet with the given packet number, no-op if not present
+	void erase(uint64_t packet_number) {
+		if(find(packet_number) == nullptr) {
+			return;
+		}
+
+		slot(packet_number).is_live = false;
+		count--;
+
+		if(count == 0) {
+			head = 0;
+			span = 0;
+			return;
+		}
+
+		// Trim free slots at either end so that base and the newest packet stay live
+		while(!slots[head].is_live) {
+			head = (head + 1) & (slots.size() - 1);
+			base++;
+			span--;
+		}
+		while(!slot(base + span - 1).is_live) {
+			span--;
+		}
+	}
+
+	/// Remove all packets
+	void clear() {
+		for(uint64_t i = 0; i < span; i++) {
+			slots[(head + i) & (slots.size() - 1)].is_live = false;
+		}
+
+		head = 0;
+		span = 0;
+		count = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_SENT_PACKETS_HPP
@@ -0,0 +1,214 @@
+#ifndef MARLIN_STREAM_SESSIONCACHE_HPP
+#define MARLIN_STREAM_SESSIONCACHE_HPP
+
+#include <sodium.h>
+#include <cstring>
+#include <string>
+#include <optional>
+#include <unordered_map>
+
+namespace marlin {
+namespace stream {
+
+/// Resumption secret and the opaque ticket the server recovers it from
+struct SessionTicket {
+	static constexpr size_t secret_size = 32;
+	/// Ticket nonce, plus sealed client static key, secret and expiry
+	static constexpr size_t blob_size = crypto_secretbox_NONCEBYTES
+		+ crypto_box_PUBLICKEYBYTES + secret_size + 8 + crypto_secretbox_MACBYTES;
+
+	uint8_t secret[secret_size];
+	uint8_t blob[blob_size];
+	/// Time in seconds since the epoch the ticket stops being accepted
+	uint64_t expiry;
+};
+
+/// @brief Session resumption state shared by the transports of a factory
+/// @details Servers seal a resumption secret into a ticket with a key only they know and
+/// send both to the client once a connection is established. Clients cache the latest ticket
+/// per remote static key and present it on the next dial to skip the key exchange.
+/// Tickets are single use, servers remember the tickets seen until they expire
+/// so that a replayed first flight is rejected. The record only lives in memory, so the ticket key is
+/// random and never leaves the cache, tickets issued before a restart or by another server are refused.
+///
+/// Resumed sessions derive their keys from the resumption secret and the client ephemeral key alone.
+/// They are not forward secret, anyone who later learns the ticket key can recover the secret from a
+/// recorded ticket and decrypt the session, early data included. A full handshake is needed for that.
+class SessionCache {
+private:
+	uint8_t ticket_key[crypto_secretbox_KEYBYTES];
+
+	/// Client side, latest ticket for each remote static key
+	std::unordered_map<std::string, SessionTicket> tickets;
+	/// Server side, expiry of every ticket accepted so far, by ticket nonce
+	std::unordered_map<std::string, uint64_t> seen_tickets;
+
+	static std::string to_key(uint8_t const* bytes, size_t size) {
+		return std::string((char const*)bytes, size);
+	}
+public:
+	/// Time in seconds a ticket is accepted for
+	static constexpr uint64_t ticket_lifetime = 600;
+	/// Tickets cached on the client
+	static constexpr size_t max_tickets = 1024;
+	/// Accepted tickets remembered on the server, resumption is refused beyond this
+	static constexpr size_t max_seen_tickets = 65536;
+
+	/// Bytes of the tag proving possession of the resumption secret
+	static constexpr size_t auth_size = crypto_auth_BYTES;
+
+	/// Random ticket key, tickets do not survive the factory
+	SessionCache() {
+		crypto_secretbox_keygen(ticket_key);
+	}
+
+	~SessionCache() {
+		sodium_memzero(ticket_key, sizeof(ticket_key));
+	}
+
+	/// Client side, cache the ticket received from the given server
+	void store(uint8_t const* remote_static_pk, SessionTicket const& ticket) {
+		if(tickets.size() >= max_tickets) {
+			tickets.erase(tickets.begin());
+		}
+		tickets[to_key(remote_static_pk, crypto_box_PUBLICKEYBYTES)] = ticket;
+	}
+
+	/// Client side, remove and return an unexpired ticket for the given server if any
+	std::optional<SessionTicket> take(uint8_t const* remote_static_pk, uint64_t now) {
+		auto iter = tickets.find(to_key(remote_static_pk, crypto_box_PUBLICKEYBYTES));
+		if(iter == tickets.end()) {
+			return std::nullopt;
+		}
+
+		auto ticket = iter->second;
+		tickets.erase(iter);
+		if(ticket.expiry <= now) {
+			return std::nullopt;
+		}
+
+		return ticket;
+	}
+
+	/// Server side, issue a new ticket for the given client
+	SessionTicket issue(uint8_t const* remote_static_pk, uint64_t now) {
+		SessionTicket ticket;
+		randombytes_buf(ticket.secret, SessionTicket::secret_size);
+		ticket.expiry = now + ticket_lifetime;
+
+		uint8_t pt[crypto_box_PUBLICKEYBYTES + SessionTicket::secret_size + 8];
+		std::memcpy(pt, remote_static_pk, crypto_box_PUBLICKEYBYTES);
+		std::memcpy(pt + crypto_box_PUBLICKEYBYTES, ticket.secret, SessionTicket::secret_size);
+		for(size_t i = 0; i < 8; i++) {
+			pt[crypto_box_PUBLICKEYBYTES + SessionTicket::secret_size + i] = ticket.expiry >> (8 * i);
+		}
+
+		randombytes_buf(ticket.blob, crypto_secretbox_NONCEBYTES);
+		crypto_secretbox_easy(ticket.blob + crypto_secretbox_NONCEBYTES, pt, sizeof(pt), ticket.blob, ticket_key);
+		sodium_memzero(pt, sizeof(pt));
+
+		return ticket;
+	}
+
+	/// Server side, recover the client static key and resumption secret from a ticket presented with the given tag
+	/// Fails on forged, expired, unauthenticated or already used tickets, outputs are only written on success
+	/// and a ticket is only used up once the tag proves the client holds its secret
+	bool redeem(
+		uint8_t const* blob,
+		uint8_t const* tag,
+		uint32_t client_conn_id,
+		uint32_t server_conn_id,
+		uint8_t const* ephemeral_pk,
+		uint64_t now,
+		uint8_t* remote_static_pk,
+		uint8_t* secret
+	) {
+		uint8_t pt[crypto_box_PUBLICKEYBYTES + SessionTicket::secret_size + 8];
+		if(crypto_secretbox_open_easy(
+			pt,
+			blob + crypto_secretbox_NONCEBYTES,
+			SessionTicket::blob_size - crypto_secretbox_NONCEBYTES,
+			blob,
+			ticket_key
+		) != 0) {
+			return false;
+		}
+
+		uint64_t expiry = 0;
+		for(size_t i = 0; i < 8; i++) {
+			expiry |= (uint64_t)pt[crypto_box_PUBLICKEYBYTES + SessionTicket::secret_size + i] << (8 * i);
+		}
+		if(expiry <= now) {
+			sodium_memzero(pt, sizeof(pt));
+			return false;
+		}
+
+		uint8_t expected[auth_size];
+		authenticate(expected, client_conn_id, server_conn_id, ephemeral_pk, pt + crypto_box_PUBLICKEYBYTES);
+		if(sodium_memcmp(expected, tag, auth_size) != 0) {
+			// Not the holder of the ticket, leave it usable
+			sodium_memzero(pt, sizeof(pt));
+			return false;
+		}
+
+		// Forget expired tickets, they are rejected above anyway
+		if(seen_tickets.size() >= max_seen_tickets) {
+			std::erase_if(seen_tickets, [&](auto const& item) { return item.second <= now; });
+			if(seen_tickets.size() >= max_seen_tickets) {
+				// Cannot detect replays anymore, fall back to full handshakes
+				sodium_memzero(pt, sizeof(pt));
+				return false;
+			}
+		}
+		if(!seen_tickets.try_emplace(to_key(blob, crypto_secretbox_NONCEBYTES), expiry).second) {
+			// Replay
+			sodium_memzero(pt, sizeof(pt));
+			return false;
+		}
+
+		std::memcpy(remote_static_pk, pt, crypto_box_PUBLICKEYBYTES);
+		std::memcpy(secret, pt + crypto_box_PUBLICKEYBYTES, SessionTicket::secret_size);
+		sodium_memzero(pt, sizeof(pt));
+
+		return true;
+	}
+
+	/// Tag binding the connection ids and client ephemeral key to the resumption secret
+	static void authenticate(
+		uint8_t* tag,
+		uint32_t client_conn_id,
+		uint32_t server_conn_id,
+		uint8_t const* ephemeral_pk,
+		uint8_t const* secret
+	) {
+		uint8_t msg[8 + crypto_kx_PUBLICKEYBYTES];
+		for(size_t i = 0; i < 4; i++) {
+			msg[i] = client_conn_id >> (8 * i);
+			msg[4 + i] = server_conn_id >> (8 * i);
+		}
+		std::memcpy(msg + 8, ephemeral_pk, crypto_kx_PUBLICKEYBYTES);
+
+		crypto_auth(tag, msg, sizeof(msg), secret);
+	}
+
+	/// Session keys of a resumed connection from the resumption secret and client ephemeral key, not forward secret
+	static void derive_keys(
+		uint8_t const* secret,
+		uint8_t const* ephemeral_pk,
+		bool is_client,
+		uint8_t* rx,
+		uint8_t* tx
+	) {
+		uint8_t key[crypto_kdf_KEYBYTES];
+		crypto_generichash(key, sizeof(key), ephemeral_pk, crypto_kx_PUBLICKEYBYTES, secret, SessionTicket::secret_size);
+
+		crypto_kdf_derive_from_key(is_client ? tx : rx, crypto_kx_SESSIONKEYBYTES, 1, "mresumpt", key);
+		crypto_kdf_derive_from_key(is_client ? rx : tx, crypto_kx_SESSIONKEYBYTES, 2, "mresumpt", key);
+		sodium_memzero(key, sizeof(key));
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_SESSIONCACHE_HPP
@@ -0,0 +1,141 @@
+#ifndef MARLIN_STREAM_STREAMSCHEDULER_HPP
+#define MARLIN_STREAM_STREAMSCHEDULER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+namespace marlin {
+namespace stream {
+
+/// @brief Picks the stream to send from next
+/// @details Strict priority between classes, a class is only served once every class below it is idle.
+/// Deficit round robin between the streams of a class, every turn a stream earns quantum times its weight
+/// in bytes and unused bytes carry over while it stays backlogged.
+/// Intrusive, streams carry their own priority, weight, deficit and scheduled flag.
+/// Priorities are below num_priorities, set_priority clamps them.
+template<typename StreamType>
+class StreamScheduler {
+public:
+	/// Number of priority classes, 0 is served first
+	static constexpr uint8_t num_priorities = 4;
+private:
+	/// Backlogged streams of each class in round robin order
+	std::deque<StreamType*> classes[num_priorities];
+	/// Streams set aside until the end of the batch
+	std::vector<StreamType*> parked;
+	/// Scheduled streams, parked ones included
+	size_t count = 0;
+
+	std::deque<StreamType*> *front_class() {
+		for(auto &streams : classes) {
+			if(!streams.empty()) {
+				return &streams;
+			}
+		}
+		return nullptr;
+	}
+
+	void push(StreamType &stream) {
+		classes[stream.priority].push_back(&stream);
+	}
+public:
+	/// Is any stream scheduled?
+	bool empty() const {
+		return count == 0;
+	}
+
+	/// Number of scheduled streams
+	size_t size() const {
+		return count;
+	}
+
+	/// Add a backlogged stream, starting its turn with the given quantum
+	bool schedule(StreamType &stream, uint64_t quantum) {
+		if(stream.is_scheduled) {
+			return false;
+		}
+
+		stream.is_scheduled = true;
+		stream.deficit += quantum * stream.weight;
+		push(stream);
+		count++;
+
+		return true;
+	}
+
+	/// Move the stream to the given class, scheduled streams keep their deficit
+	void set_priority(StreamType &stream, uint8_t priority) {
+		priority = std::min<uint8_t>(priority, num_priorities - 1);
+		if(stream.is_scheduled && stream.priority != priority) {
+			auto &streams = classes[stream.priority];
+			auto iter = std::find(streams.begin(), streams.end(), &stream);
+			if(iter != streams.end()) {
+				// Parked streams move over once unparked
+				streams.erase(iter);
+				stream.priority = priority;
+				push(stream);
+			}
+		}
+		stream.priority = priority;
+	}
+
+	/// Stream to send from next, null if none
+	StreamType *front() {
+		auto *streams = front_class();
+		return streams == nullptr ? nullptr : streams->front();
+	}
+
+	/// Front stream used up its deficit, move it behind the rest of its class with a new quantum
+	/// Moves it to a new class if its priority changed
+	void rotate(uint64_t quantum) {
+		auto *streams = front_class();
+		auto *stream = streams->front();
+		streams->pop_front();
+
+		stream->deficit += quantum * stream->weight;
+		push(*stream);
+	}
+
+	/// Front stream has nothing left to send
+	void pop() {
+		auto *streams = front_class();
+		auto *stream = streams->front();
+		streams->pop_front();
+
+		stream->is_scheduled = false;
+		stream->deficit = 0;
+		count--;
+	}
+
+	/// Front stream cannot send for now, skip it until unpark
+	void park() {
+		auto *streams = front_class();
+		parked.push_back(streams->front());
+		streams->pop_front();
+	}
+
+	/// Return parked streams to their classes
+	void unpark() {
+		for(auto *stream : parked) {
+			push(*stream);
+		}
+		parked.clear();
+	}
+
+	/// Forget all streams, meant for when the streams themselves go away
+	void clear() {
+		for(auto &streams : classes) {
+			streams.clear();
+		}
+		parked.clear();
+		count = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_STREAMSCHEDULER_HPP
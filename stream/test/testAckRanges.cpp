@@ -4,98 +4,159 @@
 
 using namespace marlin::stream;
 
+static std::vector<uint64_t> encoded(AckRanges const& ranges) {
+	std::vector<uint64_t> runs;
+	ranges.encode(0, -1, runs);
+	return runs;
+}
+
+// Seen packet numbers in (low, high] for every pair
+static AckRanges make_ranges(std::vector<std::pair<uint64_t, uint64_t>> seen) {
+	AckRanges ranges;
+	for(auto [low, high] : seen) {
+		for(auto num = low + 1; num <= high; num++) {
+			ranges.add_packet_number(num);
+		}
+	}
+	return ranges;
+}
+
 TEST(AckRangesTest, First) {
 	AckRanges ranges;
 
 	ranges.add_packet_number(10);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1}));
 }
 
 TEST(AckRangesTest, Largest) {
-	AckRanges ranges;
-	ranges.largest = 4;
-	ranges.ranges.push_back(5);
+	auto ranges = make_ranges({{-1, 4}});
 
 	ranges.add_packet_number(10);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 5, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1, 5, 5}));
 }
 
 TEST(AckRangesTest, Existing) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = make_ranges({{-1, 4}, {9, 10}});
 
 	ranges.add_packet_number(3);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 5, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1, 5, 5}));
 }
 
 TEST(AckRangesTest, BeginningOfGap) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = make_ranges({{-1, 4}, {9, 10}});
 
 	ranges.add_packet_number(9);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({2, 4, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({2, 4, 5}));
 }
 
 TEST(AckRangesTest, EndOfGap) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = make_ranges({{-1, 4}, {9, 10}});
 
 	ranges.add_packet_number(5);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 4, 6}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1, 4, 6}));
 }
 
 TEST(AckRangesTest, MiddleOfGap) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = make_ranges({{-1, 4}, {9, 10}});
 
 	ranges.add_packet_number(7);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 2, 1, 2, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1, 2, 1, 2, 5}));
 }
 
 TEST(AckRangesTest, FillGap) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
+	auto ranges = make_ranges({{-1, 4}, {5, 10}});
 
 	ranges.add_packet_number(5);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({11}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({11}));
 }
 
 TEST(AckRangesTest, Last) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(5);
+	auto ranges = make_ranges({{5, 10}});
 
 	ranges.add_packet_number(3);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({5, 2, 1}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({5, 2, 1}));
+}
+
+TEST(AckRangesTest, SplitsAcrossPackets) {
+	AckRanges ranges;
+	// Every other packet number seen, 200 seen ranges
+	for(uint64_t num = 0; num < 400; num += 2) {
+		ranges.add_packet_number(num);
+	}
+	EXPECT_EQ(ranges.size(), 399u);
+
+	std::vector<uint64_t> runs;
+	size_t from = 0;
+	std::vector<uint64_t> highs;
+	while(from < 200) {
+		highs.push_back(ranges.high(from));
+		auto count = ranges.encode(from, 171, runs);
+		EXPECT_LE(runs.size(), 171u);
+		EXPECT_EQ(runs.size() % 2, 1u);
+		EXPECT_EQ(runs.size(), 2 * count - 1);
+		from += count;
+	}
+
+	EXPECT_EQ(highs, std::vector<uint64_t>({398, 226, 54}));
+	EXPECT_EQ(runs.size(), 55u);
+	EXPECT_EQ(runs.back(), 1u);
+}
+
+TEST(AckRangesTest, PrunesBelowFloor) {
+	auto ranges = make_ranges({{-1, 4}, {9, 10}, {19, 20}});
+
+	ranges.prune_below(10);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1, 9, 1}));
+
+	// Packet numbers below the floor are ignored
+	ranges.add_packet_number(2);
+	ranges.add_packet_number(8);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1, 9, 1}));
+
+	ranges.add_packet_number(15);
+	EXPECT_EQ(encoded(ranges), std::vector<uint64_t>({1, 4, 1, 4, 1}));
+}
+
+TEST(AckRangesTest, Smallest) {
+	auto ranges = make_ranges({{2, 4}, {9, 10}, {19, 20}});
+	EXPECT_EQ(ranges.smallest(), 3u);
+
+	ranges.prune_below(10);
+	EXPECT_EQ(ranges.smallest(), 10u);
+
+	ranges.add_packet_number(12);
+	EXPECT_EQ(ranges.smallest(), 10u);
+}
+
+TEST(AckRangesTest, Contains) {
+	auto ranges = make_ranges({{2, 4}, {9, 10}, {19, 20}});
+
+	EXPECT_FALSE(ranges.contains(2));
+	EXPECT_TRUE(ranges.contains(3));
+	EXPECT_TRUE(ranges.contains(4));
+	EXPECT_FALSE(ranges.contains(5));
+	EXPECT_TRUE(ranges.contains(10));
+	EXPECT_TRUE(ranges.contains(20));
+	EXPECT_FALSE(ranges.contains(21));
+
+	// Packet numbers below the floor count as seen
+	ranges.prune_below(10);
+	EXPECT_TRUE(ranges.contains(5));
+	EXPECT_FALSE(ranges.contains(15));
 }
@@ -0,0 +1,165 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/congestion/CongestionController.hpp>
+
+
+using namespace marlin::stream;
+
+// Ack a window of 1000 byte packets every rtt at the given rate in bytes per microsecond,
+// losing every nth packet if loss_every is not 0
+template<typename ControllerType>
+static void run_rounds(
+	ControllerType& cc,
+	uint64_t& now,
+	uint64_t& delivered,
+	size_t rounds,
+	double rate,
+	uint64_t rtt,
+	size_t loss_every = 0
+) {
+	size_t packet = 0;
+	for(size_t round = 0; round < rounds; round++) {
+		auto window = cc.cwnd();
+		auto packets = std::min<uint64_t>(window / 1000, rate * rtt / 1000);
+		auto sent_time = now;
+		auto packet_delivered = delivered;
+		now += rtt;
+
+		for(uint64_t i = 0; i < packets; i++, packet++) {
+			if(loss_every != 0 && packet % loss_every == 0) {
+				cc.on_loss({now, sent_time, 1000, (packets - i - 1) * 1000});
+				continue;
+			}
+
+			delivered += 1000;
+			cc.on_ack({
+				now,
+				sent_time,
+				1000,
+				(packets - i - 1) * 1000,
+				delivered,
+				packet_delivered,
+				double(delivered - packet_delivered) / rtt,
+				false
+			});
+		}
+	}
+}
+
+TEST(CongestionControllerTest, DefaultsToCubic) {
+	CongestionController cc;
+	EXPECT_EQ(cc.cwnd(), 100000u);
+
+	// Slow start, one packet per ack
+	cc.on_ack({1000, 500, 1000, 0, 1000, 0, 0, false});
+	EXPECT_EQ(cc.cwnd(), 101000u);
+
+	// Back off once per recovery period
+	cc.on_loss({2000, 600, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 75750u);
+	cc.on_loss({2100, 700, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 75750u);
+
+	// Packets sent during recovery do not grow the window
+	cc.on_ack({2200, 1500, 1000, 0, 2000, 0, 0, false});
+	EXPECT_EQ(cc.cwnd(), 75750u);
+
+	// Congestion avoidance after recovery
+	cc.on_ack({3000, 2500, 1000, 0, 3000, 0, 0, false});
+	EXPECT_EQ(cc.cwnd(), 75750u + 1500 * 1000 / 75750);
+
+	cc.reset();
+	EXPECT_EQ(cc.cwnd(), 100000u);
+}
+
+TEST(CongestionControllerTest, CubicUndoesSpuriousBackoff) {
+	CongestionController cc;
+
+	cc.on_loss({2000, 600, 1000, 0});
+	cc.on_loss({2100, 700, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 75000u);
+
+	// Restored only once every loss of the period is found spurious
+	cc.on_spurious_loss({2200, 600, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 75000u);
+	cc.on_spurious_loss({2300, 700, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 100000u);
+
+	// Genuine loss in the next period stays
+	cc.on_loss({3000, 2500, 1000, 0});
+	cc.on_loss({3100, 2600, 1000, 0});
+	cc.on_spurious_loss({3200, 2500, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 75000u);
+
+	// Losses of an earlier period are not counted against the next one
+	cc.on_loss({4000, 3500, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 45000u);
+	cc.on_spurious_loss({4100, 2600, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 45000u);
+	cc.on_spurious_loss({4200, 3500, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), 75000u);
+}
+
+TEST(CongestionControllerTest, CubicPlateausAroundPreviousMax) {
+	CubicCongestionController cc;
+	uint64_t now = 1000000, delivered = 0;
+
+	// 1000 bytes per microsecond, 100ms rtt, slow start past 10MB
+	while(cc.cwnd() < 10000000) {
+		run_rounds(cc, now, delivered, 1, 1000, 100000);
+	}
+	auto w_max = cc.cwnd();
+	cc.on_loss({now, now - 1, 1000, 0});
+	EXPECT_EQ(cc.cwnd(), uint64_t(w_max * 0.75));
+
+	// Concave growth, most of the drop recovered halfway to the plateau at about 17s
+	run_rounds(cc, now, delivered, 80, 1000, 100000);
+	EXPECT_GT(cc.cwnd(), w_max * 0.9);
+	EXPECT_LT(cc.cwnd(), w_max);
+
+	// Plateau
+	run_rounds(cc, now, delivered, 90, 1000, 100000);
+	EXPECT_NEAR(cc.cwnd(), w_max, w_max * 0.01);
+
+	// Convex growth probing beyond
+	run_rounds(cc, now, delivered, 150, 1000, 100000);
+	EXPECT_GT(cc.cwnd(), w_max * 1.1);
+}
+
+TEST(CongestionControllerTest, BbrIgnoresRandomLoss) {
+	BbrCongestionController cc;
+	uint64_t now = 1000000, delivered = 0;
+
+	// 100 bytes per microsecond, 10ms rtt, bdp 1MB
+	run_rounds(cc, now, delivered, 30, 100, 10000);
+	EXPECT_NE(cc.get_state(), BbrCongestionController::State::Startup);
+	EXPECT_NEAR(cc.get_bw(), 100, 1);
+	EXPECT_GE(cc.cwnd(), 1000000u);
+	auto window = cc.cwnd();
+
+	// 1% loss keeps the model
+	run_rounds(cc, now, delivered, 30, 100, 10000, 100);
+	EXPECT_NEAR(cc.get_bw(), 100, 1);
+	EXPECT_GE(cc.cwnd(), window * 0.9);
+
+	// 20% loss bounds the window
+	run_rounds(cc, now, delivered, 5, 100, 10000, 5);
+	EXPECT_LT(cc.cwnd(), window * 0.8);
+
+	CongestionController policy(cc);
+	policy.reset();
+	EXPECT_EQ(policy.cwnd(), BbrCongestionController::initial_window);
+}
+
+TEST(CongestionControllerTest, FixedRateIgnoresLoss) {
+	CongestionController cc(FixedRateCongestionController(100000000));
+	EXPECT_EQ(cc.cwnd(), FixedRateCongestionController::initial_window);
+	EXPECT_DOUBLE_EQ(cc.pacing_rate(1000), 100);
+
+	// Window is twice the bdp at the min rtt
+	cc.on_ack({30000, 10000, 1000, 0, 1000, 0, 0, false});
+	EXPECT_EQ(cc.cwnd(), 4000000u);
+
+	cc.on_loss({40000, 35000, 100000, 0});
+	EXPECT_EQ(cc.cwnd(), 4000000u);
+	EXPECT_DOUBLE_EQ(cc.pacing_rate(1000), 100);
+}
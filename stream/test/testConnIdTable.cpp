@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/ConnIdTable.hpp>
+#include <unordered_set>
+
+
+using namespace marlin::stream;
+
+struct TestTransport {};
+
+TEST(ConnIdTableTest, AllocatesDistinctIds) {
+	ConnIdTable<TestTransport> table;
+	TestTransport transports[1000];
+
+	std::unordered_set<uint32_t> ids;
+	for(auto &transport : transports) {
+		auto conn_id = table.allocate(&transport);
+		EXPECT_NE(conn_id, 0u);
+		ids.insert(conn_id);
+	}
+	EXPECT_EQ(ids.size(), 1000u);
+	EXPECT_EQ(table.size(), 1000u);
+
+	for(auto conn_id : ids) {
+		auto *transport = table.find(conn_id);
+		ASSERT_NE(transport, nullptr);
+		EXPECT_EQ(table.find(conn_id ^ (1u << 31)), nullptr);
+	}
+	EXPECT_EQ(table.find(0), nullptr);
+}
+
+TEST(ConnIdTableTest, ReleaseAndReuse) {
+	ConnIdTable<TestTransport> table;
+	TestTransport a, b;
+
+	auto id_a = table.allocate(&a);
+	auto id_b = table.allocate(&b);
+
+	// Only the holder releases
+	table.release(id_a, &b);
+	EXPECT_EQ(table.find(id_a), &a);
+	table.release(id_a, &a);
+	EXPECT_EQ(table.find(id_a), nullptr);
+	EXPECT_EQ(table.size(), 1u);
+
+	// Slot is reused, the old id stays dead
+	auto id_c = table.allocate(&a);
+	EXPECT_EQ(id_c & ConnIdTable<TestTransport>::index_mask, id_a & ConnIdTable<TestTransport>::index_mask);
+	EXPECT_EQ(table.find(id_c), &a);
+	if(id_c != id_a) {
+		EXPECT_EQ(table.find(id_a), nullptr);
+	}
+	EXPECT_EQ(table.find(id_b), &b);
+}
+
+TEST(ConnIdTableTest, ForeignIds) {
+	ConnIdTable<TestTransport> table;
+	TestTransport a, b;
+
+	auto id_a = table.allocate(&a);
+	EXPECT_FALSE(table.insert(id_a, &b));
+	EXPECT_FALSE(table.insert(0, &b));
+
+	auto foreign = id_a ^ 0x80000000u;
+	EXPECT_TRUE(table.insert(foreign, &b));
+	EXPECT_EQ(table.find(foreign), &b);
+	EXPECT_EQ(table.find(id_a), &a);
+	EXPECT_EQ(table.size(), 2u);
+
+	table.release(foreign, &a);
+	EXPECT_EQ(table.find(foreign), &b);
+	table.release(foreign, &b);
+	EXPECT_EQ(table.find(foreign), nullptr);
+	EXPECT_EQ(table.size(), 1u);
+}
@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/Fec.hpp>
+
+#include <vector>
+
+
+using namespace marlin::stream;
+
+namespace {
+
+std::vector<uint8_t> make_payload(uint64_t packet_number) {
+	std::vector<uint8_t> payload(100 + packet_number % 7);
+	for(size_t i = 0; i < payload.size(); i++) {
+		payload[i] = packet_number * 31 + i;
+	}
+	return payload;
+}
+
+void encode(FecEncoder &encoder, uint64_t packet_number) {
+	auto payload = make_payload(packet_number);
+	encoder.add(packet_number, 3, packet_number * 1000, payload.size(), packet_number == 7, payload.data());
+}
+
+void decode(FecDecoder &decoder, uint64_t packet_number) {
+	auto payload = make_payload(packet_number);
+	decoder.add(packet_number, 3, packet_number * 1000, payload.size(), packet_number == 7, payload.data());
+}
+
+}
+
+TEST(FecTest, RebuildsSingleLoss) {
+	FecEncoder encoder;
+	for(uint64_t i = 0; i < 8; i++) {
+		encode(encoder, i);
+	}
+	EXPECT_EQ(encoder.first_packet_number(), 0u);
+	EXPECT_EQ(encoder.size(), 8u);
+
+	FecDecoder decoder;
+	std::vector<FecRecoveredPacket> recovered;
+	auto cb = [&](FecRecoveredPacket &&packet) {
+		recovered.push_back(std::move(packet));
+	};
+
+	// Activated by the first parity, a group of one is a copy of its packet
+	FecEncoder single;
+	encode(single, 100);
+	decoder.add_parity(100, 1, single.data(), FecParity::header_size + single.payload_length(), cb);
+	EXPECT_TRUE(decoder.is_active());
+	ASSERT_EQ(recovered.size(), 1u);
+	EXPECT_EQ(recovered[0].packet_number, 100u);
+	EXPECT_EQ(recovered[0].length, make_payload(100).size());
+	recovered.clear();
+
+	for(uint64_t i = 0; i < 8; i++) {
+		if(i != 7) {
+			decode(decoder, i);
+		}
+	}
+	decoder.add_parity(0, 8, encoder.data(), FecParity::header_size + encoder.payload_length(), cb);
+
+	ASSERT_EQ(recovered.size(), 1u);
+	auto expected = make_payload(7);
+	EXPECT_EQ(recovered[0].packet_number, 7u);
+	EXPECT_EQ(recovered[0].stream_id, 3u);
+	EXPECT_EQ(recovered[0].offset, 7000u);
+	EXPECT_TRUE(recovered[0].is_fin);
+	ASSERT_EQ(recovered[0].length, expected.size());
+	EXPECT_EQ(
+		std::vector<uint8_t>(recovered[0].payload.data(), recovered[0].payload.data() + recovered[0].payload.size()),
+		expected
+	);
+}
+
+TEST(FecTest, WaitsForLatePackets) {
+	FecEncoder encoder;
+	for(uint64_t i = 10; i < 14; i++) {
+		encode(encoder, i);
+	}
+
+	FecDecoder decoder;
+	std::vector<FecRecoveredPacket> recovered;
+	auto cb = [&](FecRecoveredPacket &&packet) {
+		recovered.push_back(std::move(packet));
+	};
+
+	// Parity arrives first with two packets of the group missing
+	decode(decoder, 10);
+	decoder.add_parity(10, 4, encoder.data(), FecParity::header_size + encoder.payload_length(), cb);
+	decode(decoder, 10);
+	decode(decoder, 11);
+	decoder.did_add(cb);
+	EXPECT_TRUE(recovered.empty());
+
+	// Reordered packet completes enough of the group
+	decode(decoder, 13);
+	decoder.did_add(cb);
+	ASSERT_EQ(recovered.size(), 1u);
+	EXPECT_EQ(recovered[0].packet_number, 12u);
+	EXPECT_EQ(recovered[0].offset, 12000u);
+
+	// Parity is consumed
+	decoder.did_add(cb);
+	EXPECT_EQ(recovered.size(), 1u);
+}
+
+TEST(FecTest, AdaptsGroupSize) {
+	FecEncoder encoder;
+	auto initial = encoder.get_group_size();
+
+	encoder.on_loss();
+	EXPECT_EQ(encoder.get_group_size(), initial / 2);
+	for(size_t i = 0; i < 10; i++) {
+		encoder.on_loss();
+	}
+	EXPECT_EQ(encoder.get_group_size(), FecEncoder::min_group_size);
+
+	encoder.on_ack(FecEncoder::growth_groups * FecEncoder::min_group_size);
+	EXPECT_EQ(encoder.get_group_size(), FecEncoder::min_group_size + 1);
+	for(size_t i = 0; i < 10000; i++) {
+		encoder.on_ack(1);
+	}
+	EXPECT_EQ(encoder.get_group_size(), FecEncoder::max_group_size);
+
+	for(uint64_t i = 0; i < FecEncoder::max_group_size; i++) {
+		EXPECT_FALSE(encoder.is_full());
+		encode(encoder, i);
+	}
+	EXPECT_TRUE(encoder.is_full());
+	encoder.clear();
+	EXPECT_TRUE(encoder.empty());
+}
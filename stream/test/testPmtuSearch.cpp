@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/PmtuSearch.hpp>
+
+
+using namespace marlin::stream;
+
+TEST(PmtuSearchTest, ConvergesOnPathSize) {
+	PmtuSearch search(1411, 8972);
+	size_t path = 4000;
+
+	EXPECT_EQ(search.current(), 1411u);
+
+	size_t probes = 0;
+	while(auto size = search.next_probe()) {
+		ASSERT_LT(++probes, 100u);
+		if(size <= path) {
+			search.on_probe_acked(size);
+		} else {
+			search.on_probe_lost();
+		}
+	}
+
+	EXPECT_TRUE(search.is_done());
+	EXPECT_LE(search.current(), path);
+	EXPECT_GT(search.current() + PmtuSearch::granularity, path);
+}
+
+TEST(PmtuSearchTest, MaxFirstAndRetries) {
+	PmtuSearch search(1411, 8972);
+
+	// Jumbo paths confirm in a single probe
+	EXPECT_EQ(search.next_probe(), 8972u);
+	search.on_probe_acked(8972);
+	EXPECT_EQ(search.current(), 8972u);
+	EXPECT_TRUE(search.is_done());
+	EXPECT_EQ(search.next_probe(), 0u);
+
+	search.on_black_hole();
+	EXPECT_EQ(search.current(), 1411u);
+
+	// Single losses retry the same size
+	EXPECT_EQ(search.next_probe(), 8972u);
+	for(size_t i = 1; i < PmtuSearch::max_probes; i++) {
+		search.on_probe_lost();
+		EXPECT_EQ(search.next_probe(), 8972u);
+	}
+	search.on_probe_lost();
+	EXPECT_LT(search.next_probe(), 8972u);
+}
+
+TEST(PmtuSearchTest, OnlyOutstandingProbeCounts) {
+	PmtuSearch search(1411, 8972);
+
+	// Nothing in flight yet
+	EXPECT_FALSE(search.on_probe_acked(8972));
+	EXPECT_EQ(search.current(), 1411u);
+
+	EXPECT_EQ(search.next_probe(), 8972u);
+	search.on_probe_lost();
+	search.on_probe_lost();
+	search.on_probe_lost();
+
+	// Sizes other than the one probed do not move the search
+	auto size = search.next_probe();
+	EXPECT_FALSE(search.on_probe_acked(8972));
+	EXPECT_FALSE(search.on_probe_acked(size - 1));
+	EXPECT_EQ(search.current(), 1411u);
+
+	EXPECT_TRUE(search.on_probe_acked(size));
+	EXPECT_EQ(search.current(), size);
+	EXPECT_FALSE(search.on_probe_acked(size));
+}
+
+TEST(PmtuSearchTest, NothingToSearch) {
+	PmtuSearch search(1411, 1472);
+
+	EXPECT_TRUE(search.is_done());
+	EXPECT_EQ(search.next_probe(), 0u);
+	EXPECT_EQ(search.current(), 1411u);
+}
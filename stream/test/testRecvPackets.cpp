@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/RecvPackets.hpp>
+
+
+using namespace marlin::stream;
+using marlin::core::Buffer;
+
+TEST(RecvPacketsTest, OrdersByOffset) {
+	RecvPackets packets;
+
+	// Mostly in order with holes filled later
+	for(uint64_t offset : {1000, 3000, 4000, 2000, 6000, 0, 5000}) {
+		EXPECT_TRUE(packets.insert(0, offset, 1000, Buffer(1000)));
+	}
+	EXPECT_FALSE(packets.insert(0, 3000, 1000, Buffer(1000)));
+	EXPECT_EQ(packets.size(), 7u);
+
+	for(size_t i = 0; i < packets.size(); i++) {
+		EXPECT_EQ(packets[i].offset, i * 1000);
+	}
+	EXPECT_EQ(packets.back().offset, 6000u);
+
+	packets.pop_front();
+	packets.pop_front();
+	EXPECT_EQ(packets.front().offset, 2000u);
+	EXPECT_EQ(packets.size(), 5u);
+
+	packets.clear();
+	EXPECT_TRUE(packets.empty());
+}
+
+TEST(RecvPacketsTest, WrapsAndGrows) {
+	RecvPackets packets;
+	uint64_t next = 0;
+
+	// Keep a window sliding through the ring, wrapping several times
+	for(uint64_t offset = 0; offset < 100; offset++) {
+		packets.insert(offset, offset * 10, 10, Buffer(10));
+		if(packets.size() > 10) {
+			EXPECT_EQ(packets.front().offset, next * 10);
+			packets.pop_front();
+			next++;
+		}
+	}
+
+	// Grow while wrapped, inserting in reverse
+	for(uint64_t offset = 200; offset > 100; offset--) {
+		packets.insert(offset, offset * 10, 10, Buffer(10));
+	}
+	EXPECT_EQ(packets.size(), 110u);
+	for(size_t i = 0; i + 1 < packets.size(); i++) {
+		EXPECT_LT(packets[i].offset, packets[i + 1].offset);
+	}
+	EXPECT_EQ(packets.front().offset, next * 10);
+	EXPECT_EQ(packets.back().offset, 2000u);
+}
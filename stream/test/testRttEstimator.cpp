@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/RttEstimator.hpp>
+
+
+using namespace marlin::stream;
+
+TEST(RttEstimatorTest, SmoothsSamples) {
+	RttEstimator rtt;
+	EXPECT_FALSE(rtt.has_sample());
+
+	rtt.add_sample(100000);
+	EXPECT_TRUE(rtt.has_sample());
+	EXPECT_DOUBLE_EQ(rtt.smoothed(), 100000);
+	EXPECT_DOUBLE_EQ(rtt.variance(), 50000);
+	EXPECT_EQ(rtt.pto(25000), 100000u + 200000u + 25000u);
+
+	rtt.add_sample(60000);
+	EXPECT_DOUBLE_EQ(rtt.smoothed(), 95000);
+	EXPECT_DOUBLE_EQ(rtt.variance(), 47500);
+	EXPECT_EQ(rtt.min_rtt(), 60000u);
+	EXPECT_EQ(rtt.latest_rtt(), 60000u);
+
+	// Steady path, deviation decays and the timeout tightens
+	for(int i = 0; i < 100; i++) {
+		rtt.add_sample(80000);
+	}
+	EXPECT_NEAR(rtt.smoothed(), 80000, 1);
+	EXPECT_LT(rtt.variance(), 1);
+	EXPECT_EQ(rtt.pto(0), 80000u + RttEstimator::granularity);
+	EXPECT_EQ(rtt.min_rtt(), 60000u);
+}
+
+TEST(RttEstimatorTest, ReorderWindowAdapts) {
+	RttEstimator rtt;
+	rtt.add_sample(80000);
+	rtt.add_sample(80000);
+
+	// An eighth of the RTT on top of the RTT
+	EXPECT_EQ(rtt.reorder_window(), 10000u);
+	EXPECT_EQ(rtt.loss_delay(), 90000u);
+
+	// A larger latest sample counts
+	rtt.add_sample(160000);
+	EXPECT_EQ(rtt.loss_delay(), 180000u);
+	rtt.add_sample(80000);
+
+	// Spurious losses widen it up to a full RTT
+	rtt.on_spurious_loss();
+	EXPECT_EQ(rtt.reorder_window(), (uint64_t)(rtt.smoothed() * 2 / 8));
+	for(int i = 0; i < 10; i++) {
+		rtt.on_spurious_loss();
+	}
+	EXPECT_EQ(rtt.reorder_window(), (uint64_t)rtt.smoothed());
+
+	// Shrinks back after losses in enough round trips, once per round trip
+	uint64_t now = 1000000;
+	for(int i = 0; i + 1 < RttEstimator::reorder_persist; i++) {
+		now += rtt.smoothed();
+		rtt.on_loss(now);
+		rtt.on_loss(now + 1);
+	}
+	EXPECT_EQ(rtt.reorder_window(), (uint64_t)rtt.smoothed());
+	rtt.on_loss(now + rtt.smoothed());
+	EXPECT_EQ(rtt.reorder_window(), (uint64_t)(rtt.smoothed() / 8));
+}
+
+TEST(RttEstimatorTest, LossDelayFloor) {
+	RttEstimator rtt;
+	rtt.add_sample(100);
+
+	EXPECT_EQ(rtt.loss_delay(), RttEstimator::granularity);
+}
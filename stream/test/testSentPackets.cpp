@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/SentPackets.hpp>
+
+
+using namespace marlin::stream;
+
+TEST(SentPacketsTest, FindsAndErases) {
+	SentPackets packets;
+
+	for(uint64_t i = 10; i < 20; i++) {
+		packets.emplace(i, i * 100, nullptr, nullptr, 0, i);
+	}
+	EXPECT_EQ(packets.size(), 10u);
+	EXPECT_EQ(packets.begin_number(), 10u);
+	EXPECT_EQ(packets.end_number(), 20u);
+
+	ASSERT_NE(packets.find(15), nullptr);
+	EXPECT_EQ(packets.find(15)->sent_time, 1500u);
+	EXPECT_EQ(packets.find(9), nullptr);
+	EXPECT_EQ(packets.find(20), nullptr);
+
+	packets.erase(15);
+	EXPECT_EQ(packets.find(15), nullptr);
+	EXPECT_EQ(packets.size(), 9u);
+
+	// Erasing the ends trims to the live packets
+	packets.erase(10);
+	packets.erase(11);
+	packets.erase(19);
+	EXPECT_EQ(packets.begin_number(), 12u);
+	EXPECT_EQ(packets.end_number(), 19u);
+
+	packets.clear();
+	EXPECT_TRUE(packets.empty());
+	EXPECT_EQ(packets.find(12), nullptr);
+}
+
+TEST(SentPacketsTest, WrapsAndGrows) {
+	SentPackets packets;
+
+	// Sliding window wraps around the initial capacity several times
+	for(uint64_t i = 0; i < 1000; i++) {
+		packets.emplace(i, i, nullptr, nullptr, 0, 0);
+		if(i >= 40) {
+			packets.erase(i - 40);
+		}
+	}
+	EXPECT_EQ(packets.size(), 40u);
+	EXPECT_EQ(packets.begin_number(), 960u);
+
+	// Gaps and a window larger than the capacity
+	for(uint64_t i = 1000; i < 3000; i += 2) {
+		packets.emplace(i, i, nullptr, nullptr, 0, 0);
+	}
+	EXPECT_EQ(packets.size(), 1040u);
+	for(uint64_t i = 960; i < 3000; i++) {
+		auto *packet = packets.find(i);
+		if(i < 1000 || i % 2 == 0) {
+			ASSERT_NE(packet, nullptr);
+			EXPECT_EQ(packet->sent_time, i);
+		} else {
+			EXPECT_EQ(packet, nullptr);
+		}
+	}
+
+	// Empty ring restarts at the next packet number
+	for(uint64_t i = 960; i < 3000; i++) {
+		packets.erase(i);
+	}
+	EXPECT_TRUE(packets.empty());
+	packets.emplace(5000, 1, nullptr, nullptr, 0, 0);
+	EXPECT_EQ(packets.begin_number(), 5000u);
+	EXPECT_EQ(packets.end_number(), 5001u);
+}
@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/SessionCache.hpp>
+
+
+using namespace marlin::stream;
+
+// Redeem a ticket the way a client holding it would present it
+static bool redeem(
+	SessionCache &server,
+	SessionTicket const &ticket,
+	uint64_t now,
+	uint8_t *pk,
+	uint8_t *secret
+) {
+	uint8_t ephemeral_pk[crypto_kx_PUBLICKEYBYTES] = {3};
+	uint8_t tag[SessionCache::auth_size];
+	SessionCache::authenticate(tag, 1, 2, ephemeral_pk, ticket.secret);
+
+	return server.redeem(ticket.blob, tag, 1, 2, ephemeral_pk, now, pk, secret);
+}
+
+TEST(SessionCacheTest, RedeemsTicketOnce) {
+	ASSERT_GE(sodium_init(), 0);
+
+	SessionCache server;
+	uint8_t client_pk[crypto_box_PUBLICKEYBYTES];
+	randombytes_buf(client_pk, sizeof(client_pk));
+
+	auto ticket = server.issue(client_pk, 1000);
+	EXPECT_EQ(ticket.expiry, 1000 + SessionCache::ticket_lifetime);
+
+	uint8_t pk[crypto_box_PUBLICKEYBYTES];
+	uint8_t secret[SessionTicket::secret_size];
+	ASSERT_TRUE(redeem(server, ticket, 1001, pk, secret));
+	EXPECT_EQ(std::memcmp(pk, client_pk, sizeof(pk)), 0);
+	EXPECT_EQ(std::memcmp(secret, ticket.secret, sizeof(secret)), 0);
+
+	// Replayed
+	EXPECT_FALSE(redeem(server, ticket, 1002, pk, secret));
+}
+
+TEST(SessionCacheTest, ChecksTagBeforeUsingUpTicket) {
+	ASSERT_GE(sodium_init(), 0);
+
+	SessionCache server;
+	uint8_t client_pk[crypto_box_PUBLICKEYBYTES] = {1};
+	auto ticket = server.issue(client_pk, 1000);
+
+	// Captured ticket with a tag made up without the secret
+	uint8_t ephemeral_pk[crypto_kx_PUBLICKEYBYTES] = {3};
+	uint8_t tag[SessionCache::auth_size] = {};
+	uint8_t pk[crypto_box_PUBLICKEYBYTES] = {};
+	uint8_t secret[SessionTicket::secret_size] = {};
+	EXPECT_FALSE(server.redeem(ticket.blob, tag, 1, 2, ephemeral_pk, 1001, pk, secret));
+	uint8_t zero[crypto_box_PUBLICKEYBYTES] = {};
+	EXPECT_EQ(std::memcmp(pk, zero, sizeof(pk)), 0);
+
+	// Tag bound to other connection ids
+	SessionCache::authenticate(tag, 2, 1, ephemeral_pk, ticket.secret);
+	EXPECT_FALSE(server.redeem(ticket.blob, tag, 1, 2, ephemeral_pk, 1001, pk, secret));
+
+	// Still usable by its holder
+	EXPECT_TRUE(redeem(server, ticket, 1001, pk, secret));
+	EXPECT_EQ(std::memcmp(pk, client_pk, sizeof(pk)), 0);
+}
+
+TEST(SessionCacheTest, RefusesExpiredAndForgedTickets) {
+	ASSERT_GE(sodium_init(), 0);
+
+	SessionCache server;
+	uint8_t client_pk[crypto_box_PUBLICKEYBYTES] = {};
+	uint8_t pk[crypto_box_PUBLICKEYBYTES];
+	uint8_t secret[SessionTicket::secret_size];
+
+	auto expired = server.issue(client_pk, 1000);
+	EXPECT_FALSE(redeem(server, expired, 1000 + SessionCache::ticket_lifetime, pk, secret));
+
+	auto forged = server.issue(client_pk, 1000);
+	forged.blob[SessionTicket::blob_size - 1] ^= 1;
+	EXPECT_FALSE(redeem(server, forged, 1001, pk, secret));
+
+	// Other servers, or the same one after a restart, know nothing of the ticket
+	auto ticket = server.issue(client_pk, 1000);
+	SessionCache other;
+	EXPECT_FALSE(redeem(other, ticket, 1001, pk, secret));
+	EXPECT_TRUE(redeem(server, ticket, 1001, pk, secret));
+}
+
+TEST(SessionCacheTest, TakesTicketOnce) {
+	ASSERT_GE(sodium_init(), 0);
+
+	SessionCache client;
+	uint8_t server_pk[crypto_box_PUBLICKEYBYTES] = {1};
+	uint8_t other_pk[crypto_box_PUBLICKEYBYTES] = {2};
+
+	SessionTicket ticket;
+	randombytes_buf(ticket.secret, SessionTicket::secret_size);
+	ticket.expiry = 2000;
+	client.store(server_pk, ticket);
+
+	EXPECT_FALSE(client.take(other_pk, 1000).has_value());
+	auto taken = client.take(server_pk, 1000);
+	ASSERT_TRUE(taken.has_value());
+	EXPECT_EQ(std::memcmp(taken->secret, ticket.secret, SessionTicket::secret_size), 0);
+	EXPECT_FALSE(client.take(server_pk, 1000).has_value());
+
+	client.store(server_pk, ticket);
+	EXPECT_FALSE(client.take(server_pk, 2000).has_value());
+}
+
+TEST(SessionCacheTest, DerivesMatchingKeys) {
+	ASSERT_GE(sodium_init(), 0);
+
+	uint8_t secret[SessionTicket::secret_size];
+	uint8_t ephemeral_pk[crypto_kx_PUBLICKEYBYTES];
+	randombytes_buf(secret, sizeof(secret));
+	randombytes_buf(ephemeral_pk, sizeof(ephemeral_pk));
+
+	uint8_t client_rx[crypto_kx_SESSIONKEYBYTES], client_tx[crypto_kx_SESSIONKEYBYTES];
+	uint8_t server_rx[crypto_kx_SESSIONKEYBYTES], server_tx[crypto_kx_SESSIONKEYBYTES];
+	SessionCache::derive_keys(secret, ephemeral_pk, true, client_rx, client_tx);
+	SessionCache::derive_keys(secret, ephemeral_pk, false, server_rx, server_tx);
+
+	EXPECT_EQ(std::memcmp(client_rx, server_tx, sizeof(client_rx)), 0);
+	EXPECT_EQ(std::memcmp(client_tx, server_rx, sizeof(client_tx)), 0);
+	EXPECT_NE(std::memcmp(client_rx, client_tx, sizeof(client_rx)), 0);
+
+	uint8_t tag[SessionCache::auth_size], other[SessionCache::auth_size];
+	SessionCache::authenticate(tag, 1, 2, ephemeral_pk, secret);
+	SessionCache::authenticate(other, 2, 1, ephemeral_pk, secret);
+	EXPECT_NE(std::memcmp(tag, other, sizeof(tag)), 0);
+}
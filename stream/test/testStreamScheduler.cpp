@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/StreamScheduler.hpp>
+#include <map>
+
+
+using namespace marlin::stream;
+
+struct TestStream {
+	uint16_t id;
+	uint8_t priority = 1;
+	uint16_t weight = 1;
+	uint64_t deficit = 0;
+	bool is_scheduled = false;
+	uint64_t backlog = 0;
+};
+
+// Drains the scheduler the way the transport does, sending packets of the given size
+static std::vector<uint16_t> drain(StreamScheduler<TestStream> &scheduler, uint64_t packet_size) {
+	std::vector<uint16_t> order;
+	while(auto *stream = scheduler.front()) {
+		if(stream->backlog == 0) {
+			scheduler.pop();
+			continue;
+		}
+		if(stream->deficit < packet_size) {
+			scheduler.rotate(packet_size);
+			continue;
+		}
+		stream->deficit -= packet_size;
+		stream->backlog -= packet_size;
+		order.push_back(stream->id);
+	}
+	return order;
+}
+
+TEST(StreamSchedulerTest, StrictPriorityBetweenClasses) {
+	StreamScheduler<TestStream> scheduler;
+	TestStream bulk{1, 2}, normal{2, 1}, urgent{3, 0};
+	bulk.backlog = 5;
+	normal.backlog = 2;
+	urgent.backlog = 1;
+
+	EXPECT_TRUE(scheduler.schedule(bulk, 1));
+	EXPECT_TRUE(scheduler.schedule(normal, 1));
+	EXPECT_FALSE(scheduler.schedule(bulk, 1));
+	EXPECT_TRUE(scheduler.schedule(urgent, 1));
+	EXPECT_EQ(scheduler.size(), 3u);
+
+	auto order = drain(scheduler, 1);
+	EXPECT_EQ(order, std::vector<uint16_t>({3, 2, 2, 1, 1, 1, 1, 1}));
+	EXPECT_TRUE(scheduler.empty());
+	EXPECT_FALSE(bulk.is_scheduled);
+	EXPECT_EQ(bulk.deficit, 0u);
+}
+
+TEST(StreamSchedulerTest, WeightedRoundRobinWithinClass) {
+	StreamScheduler<TestStream> scheduler;
+	TestStream a{1}, b{2}, c{3};
+	a.weight = 3;
+	for(auto *stream : {&a, &b, &c}) {
+		stream->backlog = 1000000;
+		scheduler.schedule(*stream, 1000);
+	}
+
+	// Send part of the backlog, shares follow the weights
+	std::map<uint16_t, uint64_t> sent;
+	for(size_t i = 0; i < 10000; i++) {
+		auto *stream = scheduler.front();
+		if(stream->deficit < 100) {
+			scheduler.rotate(1000);
+			continue;
+		}
+		stream->deficit -= 100;
+		sent[stream->id] += 100;
+	}
+	EXPECT_NEAR((double)sent[1] / sent[2], 3, 0.1);
+	EXPECT_NEAR((double)sent[2] / sent[3], 1, 0.1);
+}
+
+TEST(StreamSchedulerTest, ParkAndReprioritize) {
+	StreamScheduler<TestStream> scheduler;
+	TestStream blocked{1}, other{2, 2};
+	scheduler.schedule(blocked, 1);
+	scheduler.schedule(other, 1);
+
+	// Blocked stream steps aside for the rest of the batch only
+	EXPECT_EQ(scheduler.front(), &blocked);
+	scheduler.park();
+	EXPECT_EQ(scheduler.front(), &other);
+	scheduler.unpark();
+	EXPECT_EQ(scheduler.front(), &blocked);
+	EXPECT_EQ(scheduler.size(), 2u);
+
+	// Urgent now, moves ahead right away
+	scheduler.set_priority(other, 0);
+	EXPECT_EQ(scheduler.front(), &other);
+	scheduler.set_priority(other, 200);
+	EXPECT_EQ(other.priority, StreamScheduler<TestStream>::num_priorities - 1);
+	EXPECT_EQ(scheduler.front(), &blocked);
+}